@@ -0,0 +1,192 @@
+/**
+ * Copyright (C) 2018 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "binary_file.hpp"
+
+#include <cassert>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <new>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace common {
+
+#define RAISE(msg) RAISE_EXCEPTION(BinaryFileException, msg)
+
+/*****************************************************************************
+ *                                                                           *
+ *   Writer                                                                  *
+ *                                                                           *
+ *****************************************************************************/
+
+BinaryFileWriter::BinaryFileWriter(const string& path, size_t buffer_size) : m_path(path), m_handle(-1), m_buffer(nullptr), m_buffer_capacity(buffer_size) {
+    if(buffer_size == 0) throw invalid_argument("[BinaryFileWriter::ctor] buffer_size == 0");
+    m_buffer = (char*) malloc(m_buffer_capacity);
+    if(m_buffer == nullptr) throw std::bad_alloc();
+
+    m_handle = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    if(m_handle < 0){
+        free(m_buffer); m_buffer = nullptr;
+        RAISE("Cannot create the file `" << path << "': " << strerror(errno) << " (" << errno << ")");
+    }
+}
+
+BinaryFileWriter::~BinaryFileWriter(){
+    if(m_handle >= 0){
+        try {
+            close();
+        } catch(BinaryFileException& e){
+            cerr << "[BinaryFileWriter::dtor] " << e.what() << endl;
+        }
+    }
+    free(m_buffer); m_buffer = nullptr;
+}
+
+void BinaryFileWriter::write(const void* data, size_t num_bytes){
+    assert(m_handle >= 0 && "File already closed");
+    const char* source = reinterpret_cast<const char*>(data);
+    m_bytes_written += num_bytes;
+
+    while(num_bytes > 0){
+        if(m_buffer_size == m_buffer_capacity) flush();
+        size_t cpy = min(num_bytes, m_buffer_capacity - m_buffer_size);
+        memcpy(m_buffer + m_buffer_size, source, cpy);
+        m_buffer_size += cpy;
+        source += cpy;
+        num_bytes -= cpy;
+    }
+}
+
+void BinaryFileWriter::flush(){
+    size_t offset = 0;
+    while(offset < m_buffer_size){
+        ssize_t rc = ::write(m_handle, m_buffer + offset, m_buffer_size - offset);
+        if(rc < 0){
+            if(errno == EINTR) continue;
+            RAISE("Cannot write into the file `" << m_path << "': " << strerror(errno) << " (" << errno << ")");
+        }
+        offset += rc;
+    }
+    m_buffer_size = 0;
+}
+
+void BinaryFileWriter::close(){
+    if(m_handle < 0) return; // already closed
+    int handle = m_handle;
+    auto close_handle = [&](){ ::close(handle); m_handle = -1; };
+
+    try {
+        flush();
+    } catch(...){
+        close_handle();
+        throw;
+    }
+    if(fsync(handle) != 0){
+        close_handle();
+        RAISE("Cannot synchronise the file `" << m_path << "': " << strerror(errno) << " (" << errno << ")");
+    }
+    m_handle = -1;
+    if(::close(handle) != 0){ RAISE("Cannot close the file `" << m_path << "': " << strerror(errno) << " (" << errno << ")"); }
+}
+
+/*****************************************************************************
+ *                                                                           *
+ *   Reader                                                                  *
+ *                                                                           *
+ *****************************************************************************/
+
+BinaryFileReader::BinaryFileReader(const string& path, size_t buffer_size) : m_path(path), m_handle(-1), m_buffer(nullptr), m_buffer_capacity(buffer_size) {
+    if(buffer_size == 0) throw invalid_argument("[BinaryFileReader::ctor] buffer_size == 0");
+    m_buffer = (char*) malloc(m_buffer_capacity);
+    if(m_buffer == nullptr) throw std::bad_alloc();
+
+    m_handle = ::open(path.c_str(), O_RDONLY);
+    if(m_handle < 0){
+        free(m_buffer); m_buffer = nullptr;
+        RAISE("Cannot open the file `" << path << "': " << strerror(errno) << " (" << errno << ")");
+    }
+    posix_fadvise(m_handle, 0, 0, POSIX_FADV_SEQUENTIAL); // only a hint, ignore the errors
+}
+
+BinaryFileReader::~BinaryFileReader(){
+    if(m_handle >= 0){ ::close(m_handle); m_handle = -1; }
+    free(m_buffer); m_buffer = nullptr;
+}
+
+size_t BinaryFileReader::read_direct(char* destination, size_t num_bytes){
+    size_t offset = 0;
+    while(offset < num_bytes){
+        ssize_t rc = ::read(m_handle, destination + offset, num_bytes - offset);
+        if(rc < 0){
+            if(errno == EINTR) continue;
+            RAISE("Cannot read from the file `" << m_path << "': " << strerror(errno) << " (" << errno << ")");
+        } else if (rc == 0){ // eof
+            break;
+        }
+        offset += rc;
+    }
+    return offset;
+}
+
+bool BinaryFileReader::fill(){
+    assert(m_buffer_position == m_buffer_size && "The staging area still contains unread data");
+    m_buffer_position = 0;
+    m_buffer_size = read_direct(m_buffer, m_buffer_capacity);
+    return m_buffer_size > 0;
+}
+
+void BinaryFileReader::read(void* destination, size_t num_bytes){
+    char* output = reinterpret_cast<char*>(destination);
+    const size_t num_bytes_requested = num_bytes;
+
+    // first consume the content of the staging area
+    size_t cpy = min(num_bytes, m_buffer_size - m_buffer_position);
+    memcpy(output, m_buffer + m_buffer_position, cpy);
+    m_buffer_position += cpy;
+    output += cpy;
+    num_bytes -= cpy;
+
+    if(num_bytes >= m_buffer_capacity){ // large read, avoid the additional copy
+        size_t rc = read_direct(output, num_bytes);
+        output += rc;
+        num_bytes -= rc;
+    } else {
+        while(num_bytes > 0 && fill()){
+            cpy = min(num_bytes, m_buffer_size);
+            memcpy(output, m_buffer, cpy);
+            m_buffer_position = cpy;
+            output += cpy;
+            num_bytes -= cpy;
+        }
+    }
+
+    if(num_bytes > 0){ RAISE("Unexpected end of the file `" << m_path << "', requested: " << num_bytes_requested << " bytes, missing: " << num_bytes << " bytes"); }
+    m_bytes_read += num_bytes_requested;
+}
+
+bool BinaryFileReader::eof(){
+    return m_buffer_position == m_buffer_size && !fill();
+}
+
+} // namespace common
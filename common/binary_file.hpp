@@ -0,0 +1,142 @@
+/**
+ * Copyright (C) 2018 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef COMMON_BINARY_FILE_HPP_
+#define COMMON_BINARY_FILE_HPP_
+
+#include <cinttypes>
+#include <cstddef>
+#include <string>
+
+#include "errorhandling.hpp"
+
+namespace common {
+
+DEFINE_EXCEPTION(BinaryFileException);
+
+/**
+ * Sequential writer for binary files. The data is staged in a large buffer and written to the file
+ * with a single syscall once the buffer is full, so that many small appends still result in large
+ * sequential writes.
+ */
+class BinaryFileWriter {
+    BinaryFileWriter(const BinaryFileWriter&) = delete;
+    BinaryFileWriter& operator=(const BinaryFileWriter&) = delete;
+
+    const std::string m_path; // the path of the file being written
+    int m_handle; // file descriptor
+    char* m_buffer; // staging area
+    const size_t m_buffer_capacity; // the size of the staging area, in bytes
+    size_t m_buffer_size = 0; // the number of bytes currently in the staging area
+    uint64_t m_bytes_written = 0; // total number of bytes appended so far
+
+public:
+    /**
+     * Create, or truncate, the file at the given path
+     */
+    BinaryFileWriter(const std::string& path, size_t buffer_size = (1ull << 22) /* 4 MB */);
+
+    /**
+     * Flush and close the file. Errors raised by the dtor are only reported to stderr, invoke #close to catch them.
+     */
+    ~BinaryFileWriter();
+
+    /**
+     * Append the given bytes to the file
+     */
+    void write(const void* data, size_t num_bytes);
+
+    /**
+     * Append the given value to the file
+     */
+    template<typename T>
+    void write(const T& value){ write(&value, sizeof(T)); }
+
+    /**
+     * Write the content of the staging area to the file
+     */
+    void flush();
+
+    /**
+     * Flush the pending data, synchronise the file to the storage device and close the handle
+     */
+    void close();
+
+    /**
+     * Total number of bytes appended so far
+     */
+    uint64_t bytes_written() const noexcept { return m_bytes_written; }
+};
+
+/**
+ * Sequential reader for binary files, counterpart of the BinaryFileWriter. Small reads are served from a
+ * staging buffer, while reads larger than the buffer are copied directly into the destination.
+ */
+class BinaryFileReader {
+    BinaryFileReader(const BinaryFileReader&) = delete;
+    BinaryFileReader& operator=(const BinaryFileReader&) = delete;
+
+    const std::string m_path; // the path of the file being read
+    int m_handle; // file descriptor
+    char* m_buffer; // staging area
+    const size_t m_buffer_capacity; // the size of the staging area, in bytes
+    size_t m_buffer_position = 0; // the next byte to read from the staging area
+    size_t m_buffer_size = 0; // the number of valid bytes in the staging area
+    uint64_t m_bytes_read = 0; // total number of bytes consumed so far
+
+    // Load the next chunk of the file into the staging area. Return false if the end of the file has been reached
+    bool fill();
+
+    // Read up to `num_bytes' directly from the file, bypassing the staging area
+    size_t read_direct(char* destination, size_t num_bytes);
+
+public:
+    /**
+     * Open the file at the given path
+     */
+    BinaryFileReader(const std::string& path, size_t buffer_size = (1ull << 22) /* 4 MB */);
+
+    /**
+     * Close the file
+     */
+    ~BinaryFileReader();
+
+    /**
+     * Read exactly `num_bytes' from the file. It raises an exception if the file is shorter than that
+     */
+    void read(void* destination, size_t num_bytes);
+
+    /**
+     * Read a single value from the file
+     */
+    template<typename T>
+    T read(){ T value; read(&value, sizeof(T)); return value; }
+
+    /**
+     * Whether all the content of the file has been consumed
+     */
+    bool eof();
+
+    /**
+     * Total number of bytes consumed so far
+     */
+    uint64_t bytes_read() const noexcept { return m_bytes_read; }
+};
+
+} // namespace common
+
+#endif /* COMMON_BINARY_FILE_HPP_ */
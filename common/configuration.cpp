@@ -74,6 +74,10 @@ Configuration::Configuration() {
             .descr("Capacity of the the internal memory pools");
     PARAMETER(bool, "hugetlb")
         .descr("Use huge pages (2Mb) with the algorithms that support memory rewiring");
+    PARAMETER(bool, "thp")
+        .descr("Use transparent huge pages (2Mb) with the algorithms that support memory rewiring. Unlike --hugetlb, it does not "
+                "require to reserve the pages in advance, but the kernel must allow huge pages for shared memory: "
+                "/sys/kernel/mm/transparent_hugepage/shmem_enabled set to `advise', `within_size' or `always'");
 }
 
 Configuration::~Configuration() {
@@ -239,4 +243,12 @@ bool use_huge_pages(){
     return false;
 }
 
+bool use_transparent_huge_pages(){
+    try {
+        return ARGREF(bool, "thp").get();
+    } catch( configuration::ConsoleArgumentError& e ){
+        return false; // the warning has already been emitted by use_huge_pages()
+    }
+}
+
 } // namespace configuration
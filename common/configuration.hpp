@@ -96,6 +96,11 @@ public:
  */
 bool use_huge_pages();
 
+/**
+ * Use transparent huge pages, when the huge pages cannot be reserved in hugetlbfs?
+ */
+bool use_transparent_huge_pages();
+
 } // namespace configuration
 
 
@@ -0,0 +1,147 @@
+/**
+ * Copyright (C) 2018 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef COMMON_EPOCH_MANAGER_HPP_
+#define COMMON_EPOCH_MANAGER_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cinttypes>
+#include <limits>
+
+#include "errorhandling.hpp"
+
+namespace common {
+
+/**
+ * Epoch based reclamation. All threads share a single global epoch. A thread announces the current global epoch
+ * in its own slot when it starts an operation (#enter) and it withdraws the announcement when it is done (#exit).
+ * An object retired at epoch e can be released once all the announced epochs are greater than e: the threads that
+ * could still hold a reference to the object have all left in the meanwhile.
+ *
+ * Each slot resides in its own cache line, so that announcing an epoch does not invalidate the slots of the other
+ * threads. The global epoch is only read on #enter and it is moved forward by #advance, which is amortised:
+ * #retire advances the global epoch once every `advance_threshold` retired objects, while the garbage collector
+ * advances it once per pass.
+ */
+class EpochManager {
+public:
+    constexpr static uint64_t NO_EPOCH = std::numeric_limits<uint64_t>::max(); // the slot of an inactive thread
+    constexpr static uint64_t MAX_NUM_SLOTS = 128; // max number of threads that can be registered
+
+private:
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> m_epoch { NO_EPOCH }; // the epoch announced by the thread, NO_EPOCH if inactive
+    };
+
+    alignas(64) std::atomic<uint64_t> m_global_epoch; // the current epoch, read by the threads on #enter
+    alignas(64) std::atomic<uint64_t> m_num_retired; // total number of objects retired, to amortise the advance of the global epoch
+    const uint64_t m_advance_threshold; // advance the global epoch every `m_advance_threshold' retired objects
+    std::atomic<uint64_t> m_num_slots; // number of slots currently in use
+    Slot m_slots[MAX_NUM_SLOTS];
+
+    EpochManager(const EpochManager&) = delete;
+    EpochManager& operator=(const EpochManager&) = delete;
+
+public:
+    /**
+     * Create a new instance, with no slots in use
+     */
+    EpochManager(uint64_t advance_threshold = 64) : m_global_epoch(1), m_num_retired(0), m_advance_threshold(std::max<uint64_t>(1, advance_threshold)), m_num_slots(0) { }
+
+    /**
+     * Set the number of slots in use, that is the number of threads that can announce an epoch
+     */
+    void resize(uint64_t num_slots){
+        if(num_slots > MAX_NUM_SLOTS){ RAISE_EXCEPTION(Exception, "Given size (" << num_slots << ") greater than the maximum capacity: " << MAX_NUM_SLOTS); }
+        m_num_slots.store(num_slots, std::memory_order_release);
+    }
+
+    /**
+     * Number of slots in use
+     */
+    uint64_t size() const { return m_num_slots.load(std::memory_order_relaxed); }
+
+    /**
+     * Announce the current global epoch in the given slot. The announcement is sequentially consistent, so that
+     * it is visible to the garbage collector before the thread reads any shared pointer.
+     * @return the epoch announced
+     */
+    uint64_t enter(uint64_t slot_id) noexcept {
+        assert(slot_id < MAX_NUM_SLOTS && "Invalid slot");
+        uint64_t epoch = m_global_epoch.load(std::memory_order_acquire);
+        m_slots[slot_id].m_epoch.store(epoch, std::memory_order_seq_cst);
+        return epoch;
+    }
+
+    /**
+     * Withdraw the announcement of the given slot
+     */
+    void exit(uint64_t slot_id) noexcept {
+        assert(slot_id < MAX_NUM_SLOTS && "Invalid slot");
+        m_slots[slot_id].m_epoch.store(NO_EPOCH, std::memory_order_release);
+    }
+
+    /**
+     * The epoch announced in the given slot, NO_EPOCH if the thread is inactive
+     */
+    uint64_t epoch(uint64_t slot_id) const noexcept {
+        assert(slot_id < MAX_NUM_SLOTS && "Invalid slot");
+        return m_slots[slot_id].m_epoch.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * The current global epoch
+     */
+    uint64_t current() const noexcept {
+        return m_global_epoch.load(std::memory_order_acquire);
+    }
+
+    /**
+     * Move the global epoch forward
+     * @return the new global epoch
+     */
+    uint64_t advance() noexcept {
+        return m_global_epoch.fetch_add(1, std::memory_order_seq_cst) +1;
+    }
+
+    /**
+     * Retrieve the epoch to tag an object that has just been unlinked from the data structure
+     */
+    uint64_t retire() noexcept {
+        uint64_t epoch = m_global_epoch.load(std::memory_order_seq_cst);
+        if((m_num_retired.fetch_add(1, std::memory_order_relaxed) +1) % m_advance_threshold == 0){ advance(); }
+        return epoch;
+    }
+
+    /**
+     * The minimum epoch announced among the slots in use, NO_EPOCH if all threads are inactive. Objects retired at
+     * an epoch less than the value returned can be safely released.
+     */
+    uint64_t min_epoch() const noexcept {
+        uint64_t result = NO_EPOCH;
+        for(uint64_t i = 0, sz = m_num_slots.load(std::memory_order_acquire); i < sz; i++){
+            result = std::min(result, m_slots[i].m_epoch.load(std::memory_order_seq_cst));
+        }
+        return result;
+    }
+};
+
+} // namespace common
+
+#endif /* COMMON_EPOCH_MANAGER_HPP_ */
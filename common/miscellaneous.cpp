@@ -25,12 +25,11 @@
 #include <cstdint> // rand
 #include <cstdio> // popen
 #include <cstring> // strerror
-#include <event2/event.h> // libevent_global_shutdown
-#include <event2/thread.h> // evthread_use_pthreads
+#include <fstream>
+#include <immintrin.h> // _mm_stream_si64, _mm_stream_si128
 #include <iostream>
 #include <libgen.h>
 #include <memory>
-#include <mutex>
 #if defined(HAVE_LIBNUMA)
 #include <numa.h>
 #endif
@@ -38,10 +37,12 @@
 #include <random>
 #include <sched.h>
 #include <sstream>
+#include <sys/resource.h> // getrusage
 #include <sys/sysinfo.h> // get_nprocs
 #include <sys/stat.h>
 #include <sys/syscall.h>
 #include <sys/types.h>
+#include <time.h> // clock_gettime
 #include <unistd.h> // gethostname, getcwd, syscall
 
 #include "configuration.hpp"
@@ -252,6 +253,18 @@ int64_t get_thread_id(){
     return tid;
 }
 
+uint64_t get_thread_cpu_time(){
+    struct timespec ts;
+    if(clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0){ RAISE_EXCEPTION(Exception, "[get_thread_cpu_time] clock_gettime: " << strerror(errno) << " (" << errno << ")"); }
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000ull + ts.tv_nsec / 1000;
+}
+
+uint64_t get_thread_page_faults(){
+    struct rusage usage;
+    if(getrusage(RUSAGE_THREAD, &usage) != 0){ RAISE_EXCEPTION(Exception, "[get_thread_page_faults] getrusage: " << strerror(errno) << " (" << errno << ")"); }
+    return static_cast<uint64_t>(usage.ru_minflt) + static_cast<uint64_t>(usage.ru_majflt);
+}
+
 void set_thread_name(const std::string& name){
     set_thread_name(pthread_self(), name);
 }
@@ -265,7 +278,7 @@ void set_thread_name(pthread_t thread, const std::string& name){
 }
 
 size_t get_memory_page_size() {
-    if(!configuration::use_huge_pages()){
+    if(!configuration::use_huge_pages() && !configuration::use_transparent_huge_pages()){
         long result = sysconf(_SC_PAGESIZE);
         if (result <= 0){ // a page should have at least 1 byte
             RAISE_EXCEPTION(Exception, "[get_memory_page_size] sysconf(_SC_PAGESIZE), error: " << strerror(errno) << " (" << errno << ")");
@@ -276,6 +289,18 @@ size_t get_memory_page_size() {
     }
 }
 
+string get_transparent_huge_pages_shmem_policy(){
+    ifstream file("/sys/kernel/mm/transparent_hugepage/shmem_enabled");
+    string line;
+    if(!file.good() || !getline(file, line)) return "";
+
+    // the policy in effect is enclosed in square brackets, e.g. "always within_size advise [never] deny force"
+    size_t start = line.find('[');
+    size_t end = line.find(']', start);
+    if(start == string::npos || end == string::npos) return "";
+    return line.substr(start +1, end - start -1);
+}
+
 
 int memfd_create(const char* name, unsigned int flags){
 #if defined(MEMFD_CREATE_WRAPPER)
@@ -483,36 +508,6 @@ string git_last_commit(){
     return git_read_last_commit();
 }
 
-/*********************************************************************************************************************
- *                                                                                                                   *
- *  libevent                                                                                                         *
- *                                                                                                                   *
- *********************************************************************************************************************/
-static int g_libevent_active_clients = 0; // number of invocations libevent_init - invocations to libevent_shutdown
-static mutex g_libevent_mutex; // concurrency protection for multiple invocations to libevent_init and libevent_shutdown
-
-void libevent_init(){
-    scoped_lock<mutex> lock(g_libevent_mutex);
-    assert(g_libevent_active_clients >= 0 && "Negative counter");
-    if(g_libevent_active_clients > 0){
-        g_libevent_active_clients += 1;
-    } else {
-        int rc = evthread_use_pthreads();
-        if(rc != 0) RAISE_EXCEPTION(Exception, "[libevent_init] Cannot initialise the library");
-        assert(g_libevent_active_clients == 0 && "Multiple inits of the same library?");
-        g_libevent_active_clients = 1;
-    }
-}
-
-void libevent_shutdown(){
-    scoped_lock<mutex> lock(g_libevent_mutex);
-    assert(g_libevent_active_clients >= 0 && "Negative counter");
-    if(g_libevent_active_clients == 1){
-       libevent_global_shutdown(); // it doesn't return anything
-    }
-    g_libevent_active_clients -= 1;
-}
-
 /*********************************************************************************************************************
  *                                                                                                                   *
  *  Miscellaneous                                                                                                    *
@@ -624,4 +619,25 @@ void interleaved_scatter(int64_t* __restrict destination, int64_t* __restrict so
     aligned_scatter(destination, source, blocks_per_segment - overfilled_blocks, elements_per_block);
 }
 
+void memcpy_nontemporal(int64_t* __restrict destination, const int64_t* __restrict source, size_t num_elements) noexcept {
+    size_t i = 0;
+
+    // align the destination to 16 bytes
+    if(num_elements > 0 && (reinterpret_cast<uintptr_t>(destination) % 16) != 0){
+        _mm_stream_si64(reinterpret_cast<long long*>(destination), source[0]);
+        i = 1;
+    }
+
+    // bulk of the copy, two elements at the time
+    for( ; i + 2 <= num_elements; i += 2){
+        __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+        _mm_stream_si128(reinterpret_cast<__m128i*>(destination + i), value);
+    }
+
+    // tail
+    if(i < num_elements){
+        _mm_stream_si64(reinterpret_cast<long long*>(destination + i), source[i]);
+    }
+}
+
 } // namespace common
@@ -111,12 +111,29 @@ int64_t get_thread_id();
 void set_thread_name(const std::string& name);
 void set_thread_name(pthread_t thread, const std::string& name);
 
+/**
+ * Get the CPU time consumed so far by the current thread, in microseconds
+ */
+uint64_t get_thread_cpu_time();
+
+/**
+ * Get the number of page faults, both minor & major, incurred so far by the current thread
+ */
+uint64_t get_thread_page_faults();
+
 /**
  * Get the size of a memory page for the current architecture, in bytes
- * The result is affected by the setting on huge pages  (--hugetlb)
+ * The result is affected by the setting on huge pages  (--hugetlb and --thp)
  */
 size_t get_memory_page_size();
 
+/**
+ * Retrieve the policy of the kernel on transparent huge pages for shared memory, as set in
+ * /sys/kernel/mm/transparent_hugepage/shmem_enabled (e.g. never, advise, within_size, always),
+ * or an empty string if it cannot be determined
+ */
+std::string get_transparent_huge_pages_shmem_policy();
+
 /**
  * Split the string `s' in array of words separated by the given delimiter
  */
@@ -179,6 +196,13 @@ inline uint64_t rdtscp(){
     return rax;
 }
 
+/**
+ * Hint the processor that the current thread is in a spin loop
+ */
+inline void cpu_relax(){
+    __asm__ __volatile__("pause": : :"memory");
+}
+
 /**
  * Compiler barrier
  */
@@ -216,6 +240,19 @@ void aligned_scatter(int64_t* destination, int64_t* source, int num_blocks, int
 void interleaved_gather(int64_t* __restrict destination, int64_t* __restrict source, size_t blocks_per_segment, size_t source_sz) noexcept;
 void interleaved_scatter(int64_t* __restrict destination, int64_t* __restrict source, size_t blocks_per_segment, size_t destination_sz) noexcept;
 
+/**
+ * Copy `num_elements' from source to destination with non-temporal (streaming) stores, that is, bypassing the
+ * cache. The stores are weakly ordered: invoke #store_fence() before making the destination visible to other threads.
+ */
+void memcpy_nontemporal(int64_t* __restrict destination, const int64_t* __restrict source, size_t num_elements) noexcept;
+
+/**
+ * Store fence, all the previous stores (including the non-temporal ones) become globally visible before the following stores
+ */
+inline void store_fence(){
+    __asm__ __volatile__("sfence": : :"memory");
+}
+
 /**
  * 2^ceil(log2(x))
  */
@@ -252,16 +289,6 @@ struct timeval duration2timeval(Duration duration){
  */
 int memfd_create(const char* name, unsigned int flags);
 
-/**
- * Initialise the library libevent. If the library has been already initialised, this call is ignored.
- */
-void libevent_init();
-
-/**
- * Shutdown the library libevent. This should be invoked once for each call to libevent_init().
- */
-void libevent_shutdown();
-
 } // namespace common
 
 #endif /* COMMON_MISCELLANEOUS_HPP_ */
@@ -0,0 +1,156 @@
+/**
+ * Copyright (C) 2018 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef COMMON_MPSC_QUEUE_HPP_
+#define COMMON_MPSC_QUEUE_HPP_
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+
+namespace common {
+
+/**
+ * An unbounded lock-free queue, for multiple producers and a single consumer. It is the intrusive linked list
+ * of D. Vyukov: a producer appends its node with a single atomic exchange on the tail, while the consumer
+ * pops from the head without any atomic read-modify-write.
+ *
+ * The operations that can be performed are: Q.push(element) by any thread, Q.pop(element) and Q.empty()
+ * only by the consumer.
+ *
+ * A push that has exchanged the tail, but not yet linked its node, is not visible to the consumer: the queue
+ * may temporarily appear empty, until the producer completes the push.
+ *
+ * The nodes popped by the consumer are not deallocated, they are recycled by the next pushes through a free list.
+ * The free list is a Treiber stack, its head packs the pointer to the first node in the lower 48 bits and a version
+ * in the upper 16 bits, incremented on each update, so that a producer popping a node cannot incur in the ABA problem.
+ * The nodes are only released by the destructor.
+ */
+template <typename T>
+class MPSCQueue {
+    struct Node {
+        std::atomic<Node*> m_next;
+        T m_value;
+        Node() : m_next(nullptr), m_value() { }
+        Node(const T& value) : m_next(nullptr), m_value(value) { }
+    };
+
+    alignas(64) std::atomic<Node*> m_tail; // the last node appended, contended by the producers
+    alignas(64) Node* m_head; // the sentinel, owned by the consumer. The next node is the first element in the queue
+    alignas(64) std::atomic<uint64_t> m_free; // the nodes already consumed, ready to be reused by the producers
+
+    static_assert(sizeof(void*) == sizeof(uint64_t), "Expected 64-bit pointers");
+    static constexpr uint64_t FREE_PTR_MASK = (1ull << 48) -1; // the bits of m_free storing the pointer to the first node
+    static constexpr uint64_t FREE_VERSION = 1ull << 48; // the increment of the version in m_free
+
+    /**
+     * Retrieve a node from the free list, or allocate a new node if the free list is empty
+     */
+    Node* acquire_node(const T& item){
+        uint64_t head = m_free.load(std::memory_order_acquire);
+        Node* node = nullptr;
+        uint64_t next;
+        do {
+            node = reinterpret_cast<Node*>(head & FREE_PTR_MASK);
+            if(node == nullptr) return new Node(item);
+            // the node may be concurrently acquired by another producer, in this case the version has changed and the CAS fails
+            next = reinterpret_cast<uint64_t>(node->m_next.load(std::memory_order_relaxed)) | ((head & ~FREE_PTR_MASK) + FREE_VERSION);
+        } while(!m_free.compare_exchange_weak(head, next, std::memory_order_acquire, std::memory_order_acquire));
+
+        node->m_next.store(nullptr, std::memory_order_relaxed);
+        node->m_value = item;
+        return node;
+    }
+
+    /**
+     * Append the given node, already consumed, to the free list
+     */
+    void release_node(Node* node){
+        assert((reinterpret_cast<uint64_t>(node) & ~FREE_PTR_MASK) == 0 && "The address does not fit in 48 bits");
+        uint64_t head = m_free.load(std::memory_order_relaxed);
+        uint64_t next;
+        do {
+            node->m_next.store(reinterpret_cast<Node*>(head & FREE_PTR_MASK), std::memory_order_relaxed);
+            next = reinterpret_cast<uint64_t>(node) | ((head & ~FREE_PTR_MASK) + FREE_VERSION);
+        } while(!m_free.compare_exchange_weak(head, next, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    MPSCQueue(const MPSCQueue&) = delete;
+    MPSCQueue& operator=(const MPSCQueue&) = delete;
+
+public:
+    /**
+     * Initialise an empty queue
+     */
+    MPSCQueue() : m_tail(nullptr), m_head(nullptr), m_free(0) {
+        m_head = new Node();
+        m_tail.store(m_head, std::memory_order_relaxed);
+    }
+
+    /**
+     * Destructor. There should be no concurrent producers at this point.
+     */
+    ~MPSCQueue(){
+        while(m_head != nullptr){
+            Node* next = m_head->m_next.load(std::memory_order_relaxed);
+            delete m_head;
+            m_head = next;
+        }
+
+        Node* node = reinterpret_cast<Node*>(m_free.load(std::memory_order_relaxed) & FREE_PTR_MASK);
+        while(node != nullptr){
+            Node* next = node->m_next.load(std::memory_order_relaxed);
+            delete node;
+            node = next;
+        }
+    }
+
+    /**
+     * Append a new element at the end. It can be invoked concurrently by multiple threads.
+     * The link is published with a sequentially consistent store, so that a consumer announcing itself
+     * asleep before checking #empty() and a producer checking that flag after #push() cannot both miss each other.
+     */
+    void push(const T& item){
+        Node* node = acquire_node(item);
+        Node* prev = m_tail.exchange(node, std::memory_order_acq_rel);
+        prev->m_next.store(node, std::memory_order_seq_cst);
+    }
+
+    /**
+     * Remove the element at the start and store it in `item`. Only the consumer can invoke this method.
+     * @return true if an element was retrieved, false if the queue is empty
+     */
+    bool pop(T& item){
+        Node* next = m_head->m_next.load(std::memory_order_acquire);
+        if(next == nullptr) return false;
+        item = next->m_value;
+        release_node(m_head);
+        m_head = next; // next becomes the new sentinel
+        return true;
+    }
+
+    /**
+     * Check whether the queue is empty. Only the consumer can invoke this method.
+     */
+    bool empty() const {
+        return m_head->m_next.load(std::memory_order_seq_cst) == nullptr;
+    }
+};
+
+} // namespace common
+
+#endif /* COMMON_MPSC_QUEUE_HPP_ */
@@ -0,0 +1,261 @@
+/**
+ * Copyright (C) 2018 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef COMMON_TIMER_WHEEL_HPP_
+#define COMMON_TIMER_WHEEL_HPP_
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cinttypes>
+#include <cstddef>
+
+namespace common {
+
+/**
+ * A hierarchical timer wheel, to be driven by a single thread. The time is discretised in ticks of the given resolution. The wheel
+ * consists of NUM_LEVELS levels of NUM_SLOTS slots each: the slots of the first level cover one tick each, the slots of the level L
+ * cover NUM_SLOTS^L ticks. When the wheel completes a round of a level, the timers in the next slot of the upper level are
+ * cascaded to the lower levels, as in the classic Varghese & Lauck scheme.
+ *
+ * The timers are intrusive: the caller owns the memory of each Timer and the wheel only links them in its slots. Both #schedule and
+ * #cancel take constant time and never allocate memory. A timer fires at most one tick after its deadline.
+ */
+class TimerWheel {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * A timer, to be embedded or stored by the user. It must not be moved while it is scheduled.
+     */
+    struct Timer {
+        Timer* m_prev = nullptr; // previous timer in the same slot
+        Timer* m_next = nullptr; // next timer in the same slot, nullptr if the timer is not scheduled
+        uint64_t m_expiry = 0; // the tick when the timer expires
+
+        // Check whether the timer is currently scheduled in a wheel
+        bool scheduled() const { return m_next != nullptr; }
+    };
+
+private:
+    constexpr static uint64_t SLOT_BITS = 6;
+    constexpr static uint64_t NUM_SLOTS = 1ull << SLOT_BITS; // number of slots in each level
+    constexpr static uint64_t SLOT_MASK = NUM_SLOTS -1;
+    constexpr static uint64_t NUM_LEVELS = 4;
+    constexpr static uint64_t HORIZON = 1ull << (SLOT_BITS * NUM_LEVELS); // number of ticks covered by the whole wheel
+
+    const Clock::duration m_resolution; // the duration of a tick
+    const Clock::time_point m_origin; // the time point of the tick 0
+    uint64_t m_current = 0; // the last tick processed, all timers with expiry <= m_current have already fired
+    uint64_t m_size = 0; // number of timers scheduled
+    Timer m_slots[NUM_LEVELS][NUM_SLOTS]; // the sentinels of the circular lists of timers
+
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    // Convert a time point into a tick, rounding up
+    uint64_t to_tick(Clock::time_point time) const {
+        if(time <= m_origin) return 0;
+        return ((time - m_origin) + m_resolution - Clock::duration(1)) / m_resolution;
+    }
+
+    // Append the timer to the list of the given sentinel
+    static void link(Timer* sentinel, Timer* timer){
+        timer->m_prev = sentinel->m_prev;
+        timer->m_next = sentinel;
+        sentinel->m_prev->m_next = timer;
+        sentinel->m_prev = timer;
+    }
+
+    // Remove the timer from its list
+    static void unlink(Timer* timer){
+        timer->m_prev->m_next = timer->m_next;
+        timer->m_next->m_prev = timer->m_prev;
+        timer->m_prev = timer->m_next = nullptr;
+    }
+
+    // Move all the timers in the list `from' into the empty list `to'
+    static void splice(Timer* from, Timer* to){
+        assert(to->m_next == to && "The destination list must be empty");
+        if(from->m_next == from) return; // empty
+        to->m_next = from->m_next;
+        to->m_prev = from->m_prev;
+        to->m_next->m_prev = to;
+        to->m_prev->m_next = to;
+        from->m_next = from->m_prev = from;
+    }
+
+    // Insert the timer in the slot matching its expiry, relative to the current tick
+    void place(Timer* timer){
+        assert(timer->m_expiry >= m_current && "The timer should have already fired");
+        uint64_t delta = timer->m_expiry - m_current;
+        uint64_t expiry = timer->m_expiry;
+        if(delta >= HORIZON){ // beyond the horizon, it will be placed again when its slot is cascaded
+            expiry = m_current + HORIZON -1;
+            delta = HORIZON -1;
+        }
+        uint64_t level = 0;
+        while(delta >= (1ull << (SLOT_BITS * (level +1)))) level++;
+        link(&m_slots[level][(expiry >> (SLOT_BITS * level)) & SLOT_MASK], timer);
+    }
+
+    // Move the timers of the current slot of the given level to the lower levels
+    void cascade(uint64_t level){
+        Timer list; list.m_prev = list.m_next = &list;
+        splice(&m_slots[level][(m_current >> (SLOT_BITS * level)) & SLOT_MASK], &list);
+        while(list.m_next != &list){
+            Timer* timer = list.m_next;
+            unlink(timer);
+            place(timer);
+        }
+    }
+
+    // Fire all the timers in the given list
+    template<typename Callback>
+    void fire(Timer* sentinel, Callback& callback){
+        // detach the list first, the callback can schedule or cancel other timers
+        Timer list; list.m_prev = list.m_next = &list;
+        splice(sentinel, &list);
+        while(list.m_next != &list){
+            Timer* timer = list.m_next;
+            unlink(timer);
+            m_size--;
+            callback(timer);
+        }
+    }
+
+public:
+    /**
+     * Initialise an empty wheel
+     * @param resolution the duration of a tick
+     */
+    TimerWheel(Clock::duration resolution, Clock::time_point origin = Clock::now()) : m_resolution(resolution), m_origin(origin) {
+        assert(resolution.count() > 0 && "Invalid resolution");
+        for(uint64_t level = 0; level < NUM_LEVELS; level++){
+            for(uint64_t slot = 0; slot < NUM_SLOTS; slot++){
+                m_slots[level][slot].m_prev = m_slots[level][slot].m_next = &m_slots[level][slot];
+            }
+        }
+    }
+
+    /**
+     * Destructor. The timers still scheduled are simply discarded.
+     */
+    ~TimerWheel(){ clear(); }
+
+    /**
+     * Schedule the given timer to expire at the given deadline. If the deadline has already passed, the timer fires at the next
+     * call to #advance.
+     */
+    void schedule(Timer* timer, Clock::time_point deadline){
+        assert(timer != nullptr && "Null pointer");
+        assert(!timer->scheduled() && "The timer is already scheduled");
+        timer->m_expiry = std::max(to_tick(deadline), m_current +1);
+        place(timer);
+        m_size++;
+    }
+
+    /**
+     * Remove the given timer from the wheel, without firing it. It is a nop if the timer is not scheduled.
+     */
+    void cancel(Timer* timer){
+        assert(timer != nullptr && "Null pointer");
+        if(!timer->scheduled()) return;
+        unlink(timer);
+        m_size--;
+    }
+
+    /**
+     * Fire, by invoking callback(Timer*), all timers whose deadline is not later than the given time point
+     */
+    template<typename Callback>
+    void advance(Clock::time_point now, Callback callback){
+        uint64_t target = now <= m_origin ? 0 : (now - m_origin) / m_resolution;
+        while(m_current < target){
+            if(m_size == 0){ m_current = target; break; } // skip the idle ticks
+
+            m_current++;
+
+            // cascade the upper levels whose round has been completed, from the highest, as it can refill the lower levels
+            uint64_t level = 1;
+            while(level < NUM_LEVELS && (m_current & ((1ull << (SLOT_BITS * level)) -1)) == 0) level++;
+            while(--level > 0){ cascade(level); }
+
+            fire(&m_slots[0][m_current & SLOT_MASK], callback);
+        }
+    }
+
+    /**
+     * Fire all timers scheduled, regardless of their deadline
+     */
+    template<typename Callback>
+    void expire_all(Callback callback){
+        while(m_size > 0){
+            for(uint64_t level = 0; level < NUM_LEVELS; level++){
+                for(uint64_t slot = 0; slot < NUM_SLOTS; slot++){
+                    fire(&m_slots[level][slot], callback);
+                }
+            }
+        }
+    }
+
+    /**
+     * Remove all timers, without firing them
+     */
+    void clear(){
+        for(uint64_t level = 0; level < NUM_LEVELS; level++){
+            for(uint64_t slot = 0; slot < NUM_SLOTS; slot++){
+                Timer* sentinel = &m_slots[level][slot];
+                while(sentinel->m_next != sentinel){ unlink(sentinel->m_next); }
+            }
+        }
+        m_size = 0;
+    }
+
+    /**
+     * The time point when the wheel needs to be advanced next, that is not later than the earliest deadline of the timers scheduled.
+     * Clock::time_point::max() if there are no timers.
+     */
+    Clock::time_point next_deadline() const {
+        if(m_size == 0) return Clock::time_point::max();
+
+        // the timers in the upper levels are cascaded at the end of the round of the first level
+        uint64_t tick = (m_current | SLOT_MASK) +1;
+        for(uint64_t i = 1; i < NUM_SLOTS; i++){
+            const Timer* sentinel = &m_slots[0][(m_current + i) & SLOT_MASK];
+            if(sentinel->m_next != sentinel){
+                tick = std::min(tick, m_current + i);
+                break;
+            }
+        }
+        return m_origin + tick * m_resolution;
+    }
+
+    /**
+     * Number of timers scheduled
+     */
+    size_t size() const { return m_size; }
+
+    /**
+     * Check whether there are no timers scheduled
+     */
+    bool empty() const { return m_size == 0; }
+};
+
+} // namespace common
+
+#endif /* COMMON_TIMER_WHEEL_HPP_ */
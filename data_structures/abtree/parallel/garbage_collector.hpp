@@ -41,8 +41,10 @@ private:
     bool m_thread_is_running = false;
     const ThreadContextList& m_thread_contexts;
     mutable common::SpinLock m_mutex; // sync
-    mutable std::condition_variable_any m_condvar; // only to start the instance
+    mutable std::condition_variable_any m_condvar; // to start the instance and to wake up the background thread
     const std::chrono::milliseconds m_timer_interval; // sleep duration
+    constexpr static uint64_t m_wakeup_threshold = 64; // wake up the background thread ahead of the timer after this number of objects have been marked
+    uint64_t m_num_marked = 0; // number of objects marked since the last pass
 
     struct DeleteInterface {
         virtual void free(void* ptr) = 0;
@@ -59,7 +61,7 @@ private:
         }
     };
     struct Item {
-        uint64_t m_timestamp; // the timestamp when this object has been added to the garbage collector
+        uint64_t m_timestamp; // the global epoch when this object has been added to the garbage collector
         void* m_pointer; // object to be deleted
         std::unique_ptr<DeleteInterface> m_deleter;
     };
@@ -120,9 +122,14 @@ public:
 template<typename T, typename Callable>
 void GarbageCollector::mark(T* ptr, Callable callable){
     using namespace std;
-    auto ts = common::rdtscp(); // read timestamp counter (cpu clock)
-    lock_guard<common::SpinLock> lock(m_mutex);
-    m_items_to_delete.append(new Item{ts, ptr, unique_ptr<DeleteInterface>{ new DeleteImplementation<T, Callable>(callable) }});
+    auto ts = m_thread_contexts.epochs().retire(); // current global epoch
+    bool wakeup = false;
+    {
+        lock_guard<common::SpinLock> lock(m_mutex);
+        m_items_to_delete.append(new Item{ts, ptr, unique_ptr<DeleteInterface>{ new DeleteImplementation<T, Callable>(callable) }});
+        wakeup = (++m_num_marked == m_wakeup_threshold);
+    }
+    if(wakeup) m_condvar.notify_one();
 }
 template<typename T>
 void GarbageCollector::mark(T* ptr){
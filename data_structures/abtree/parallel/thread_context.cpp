@@ -33,10 +33,10 @@ namespace data_structures::abtree::parallel {
  *   ThreadContext                                                           *
  *                                                                           *
  *****************************************************************************/
-ThreadContext::ThreadContext() : m_epoch(numeric_limits<uint64_t>::max()) { }
-ThreadContext::~ThreadContext(){ bye(); }
-void ThreadContext::hello(){ m_epoch = rdtscp(); }
-void ThreadContext::bye(){ m_epoch = numeric_limits<uint64_t>::max(); }
+ThreadContext::ThreadContext() : m_epochs(nullptr), m_epoch_slot(0) { }
+ThreadContext::~ThreadContext(){ if(m_epochs != nullptr) bye(); }
+void ThreadContext::hello(){ m_epochs->enter(m_epoch_slot); }
+void ThreadContext::bye(){ m_epochs->exit(m_epoch_slot); }
 thread_local int ThreadContext::thread_id { -1 };
 
 /*****************************************************************************
@@ -44,13 +44,19 @@ thread_local int ThreadContext::thread_id { -1 };
  *   ThreadContextList                                                       *
  *                                                                           *
  *****************************************************************************/
-ThreadContextList::ThreadContextList() { }
+ThreadContextList::ThreadContextList() {
+    for(uint64_t i = 0; i < m_capacity; i++){
+        m_contexts[i].m_epochs = &m_epochs;
+        m_contexts[i].m_epoch_slot = i;
+    }
+}
 ThreadContextList::~ThreadContextList() { resize(0); }
 
 void ThreadContextList::resize(uint64_t size){
     scoped_lock<SpinLock> lock(m_spinlock); // this is going to be used only by the garbage collector, it's okay to lock here
     if(size > m_capacity){ RAISE_EXCEPTION(Exception, "Given size (" << size << ") greater than the maximum capacity: " << m_capacity); }
     m_size = size;
+    m_epochs.resize(size);
 }
 
 ThreadContext* ThreadContextList::operator[](uint64_t index) const {
@@ -59,12 +65,11 @@ ThreadContext* ThreadContextList::operator[](uint64_t index) const {
 }
 
 uint64_t ThreadContextList::min_epoch() const {
-    uint64_t min_epoch = numeric_limits<uint64_t>::max();
-    scoped_lock<SpinLock> lock(m_spinlock); // this is going to be used only by the garbage collector, it's okay to lock here
-    for(uint64_t i =0; i < m_size; i++){
-        min_epoch = std::min(min_epoch, m_contexts[i].epoch());
-    }
-    return min_epoch;
+    return m_epochs.min_epoch();
+}
+
+EpochManager& ThreadContextList::epochs() const {
+    return const_cast<EpochManager&>(m_epochs);
 }
 
 ThreadContext& ThreadContextList::my_context() const {
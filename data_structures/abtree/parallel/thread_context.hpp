@@ -19,6 +19,7 @@
 
 #include <cinttypes>
 
+#include "common/epoch_manager.hpp"
 #include "common/spin_lock.hpp"
 
 #include "third-party/art-olc/Epoche.h"
@@ -29,11 +30,13 @@ namespace data_structures::abtree::parallel {
 /**
  * A ThreadContext represents state information associated to a single thread operating on the
  * data structure. The information contained is :
- * - the current epoch of the thread (+ inf if the thread is inactive)
+ * - the current epoch of the thread (+ inf if the thread is inactive), announced in its own slot of the EpochManager
  */
 class ThreadContext {
+    friend class ThreadContextList;
 private:
-    uint64_t m_epoch; // current epoch, +inf if the thread is inactive
+    common::EpochManager* m_epochs; // where the epochs of all threads are announced
+    uint64_t m_epoch_slot; // the slot for this context in m_epochs
 
 public:
     /**
@@ -49,10 +52,10 @@ public:
     /**
      * Return the current epoch
      */
-    uint64_t epoch() const { return m_epoch; }
+    uint64_t epoch() const { return m_epochs->epoch(m_epoch_slot); }
 
     /**
-     * (Re)-join in the current absolute epoch (that is the current hw timestamp)
+     * (Re)-join in the current global epoch
      */
     void hello();
 
@@ -71,8 +74,9 @@ public:
  * A safe enough list of thread contexts
  */
 class ThreadContextList {
-    constexpr static uint64_t m_capacity = 128;
+    constexpr static uint64_t m_capacity = common::EpochManager::MAX_NUM_SLOTS;
     uint64_t m_size = 0;
+    common::EpochManager m_epochs; // it must outlive the contexts
     ThreadContext m_contexts[m_capacity];
     mutable common::SpinLock m_spinlock;
 
@@ -89,6 +93,9 @@ public:
 
     uint64_t min_epoch() const;
 
+    // The global epoch and the announcements of the threads
+    common::EpochManager& epochs() const;
+
     // Retrieve the context associated to the current thread
     ThreadContext& my_context() const;
 };
@@ -116,7 +123,7 @@ public:
     ThreadContext& context();
 
     /**
-     * Rejoin a new absolute epoch
+     * Rejoin the current global epoch
      */
     void tick();
 };
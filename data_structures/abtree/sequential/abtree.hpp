@@ -32,7 +32,7 @@ namespace data_structures::abtree::sequential {
 /**
  * Basic, sequential implementation of a B+ tree
  */
-class ABTree : public data_structures::InterfaceRQ {
+class ABTree : public data_structures::InterfaceRQ, public data_structures::BulkLoading {
     ABTree(const ABTree&) = delete;
     ABTree& operator= (ABTree&) = delete;
 
@@ -315,7 +315,7 @@ public:
    * Load the given elements in the array. It assumes the data structure is empty
    * before the method is invoked.
    */
-  virtual void load(const std::pair<int64_t, int64_t>* elements, size_t elements_sz);
+  virtual void load(const std::pair<int64_t, int64_t>* elements, size_t elements_sz) override;
 
   /**
    * Verify that all nodes in the tree respect the proper bounds. If the validation fails,
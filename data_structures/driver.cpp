@@ -20,6 +20,7 @@
 
 #include <algorithm>
 #include <iomanip>
+#include <iostream>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -29,6 +30,7 @@
 
 #include "common/configuration.hpp"
 #include "common/console_arguments.hpp"
+#include "common/database.hpp"
 #include "common/errorhandling.hpp"
 #include "common/miscellaneous.hpp"
 
@@ -48,6 +50,7 @@
 #include "rma/baseline/packed_memory_array.hpp"
 #include "rma/batch_processing/packed_memory_array.hpp"
 #include "rma/common/knobs.hpp"
+#include "rma/common/rewired_memory.hpp"
 #include "rma/one_by_one/packed_memory_array.hpp"
 
 using namespace std;
@@ -57,6 +60,74 @@ namespace data_structures {
 
 static bool initialised = false;
 
+static rma::common::NumaPolicy parse_numa_policy(const string& value){
+    if(value == "interleaved"){
+        return rma::common::NumaPolicy::INTERLEAVED;
+    } else if(value == "owner"){
+        return rma::common::NumaPolicy::OWNER;
+    } else if(value == "partitioned"){
+        return rma::common::NumaPolicy::PARTITIONED;
+    } else {
+        return rma::common::NumaPolicy::NONE;
+    }
+}
+
+// The threshold for the non-temporal stores, either set by the user or, with --rma_nontemporal_calibrate, measured on this machine
+static uint64_t get_nontemporal_threshold(){
+    if(!ARGREF(bool, "rma_nontemporal_calibrate").get()) return ARGREF(uint64_t, "rma_nontemporal_threshold").get();
+
+    uint64_t threshold = rma::common::Knobs::calibrate_nontemporal_threshold();
+    cout << "[non-temporal stores] calibrated threshold: " << threshold << " bytes" << endl;
+    if(config().db() != nullptr){
+        config().db()->add("nontemporal_calibration")("threshold", threshold);
+    }
+    return threshold;
+}
+
+// Set the knobs of the RMA variants from the command line arguments
+static void apply_rma_knobs(rma::common::Knobs& knobs){
+    auto argument_rank = ARGREF(double, "apma_rank");
+    if(argument_rank.is_set()){ knobs.m_rank_threshold = argument_rank.get(); }
+    knobs.set_nontemporal_threshold(get_nontemporal_threshold());
+    if(ARGREF(string, "rma_scheduling").get() == "priority"){ knobs.set_scheduling_policy(rma::common::SchedulingPolicy::PRIORITY); }
+    knobs.set_master_spin_time(ARGREF(uint64_t, "rma_master_spin").get());
+    knobs.set_retained_buffer_memory(ARGREF(uint64_t, "rma_retained_buffers").get());
+    knobs.set_proactive_budget(ARGREF(double, "rma_proactive_budget").get());
+    knobs.set_numa_policy(parse_numa_policy(ARGREF(string, "rma_numa").get()));
+    knobs.set_memory_budget(ARGREF(uint64_t, "rma_memory_budget").get());
+    knobs.set_prefault_buffer_memory(ARGREF(uint64_t, "rma_prefault_buffers").get());
+    knobs.set_key_compression(ARGREF(bool, "rma_key_compression").get());
+}
+
+// With --hugetlb or --thp, check on a probe extent whether the kernel actually grants the huge pages to the rewired memory
+static void report_huge_pages(){
+    const bool hugetlb = configuration::use_huge_pages();
+    const bool thp = configuration::use_transparent_huge_pages();
+    if(!hugetlb && !thp) return; // nop
+
+    string shmem_policy = get_transparent_huge_pages_shmem_policy();
+    double coverage = rma::common::RewiredMemory::probe_huge_pages();
+    cout << "[huge pages] mode: " << (hugetlb ? "hugetlb" : "thp");
+    if(!hugetlb){ cout << ", shmem policy: " << (shmem_policy.empty() ? "unknown" : shmem_policy); }
+    cout << ", coverage: " << coverage * 100.0 << "%" << endl;
+    if(coverage < 1.0){
+        cerr << "[WARNING] The rewired memory is not fully backed by huge pages. ";
+        if(hugetlb){
+            cerr << "Reserve the pages in /proc/sys/vm/nr_hugepages or /proc/sys/vm/nr_overcommit_hugepages, or use --thp instead";
+        } else {
+            cerr << "Set /sys/kernel/mm/transparent_hugepage/shmem_enabled to `advise' or `within_size'";
+        }
+        cerr << endl;
+    }
+
+    if(config().db() != nullptr){
+        config().db()->add("huge_pages")
+                ("mode", string(hugetlb ? "hugetlb" : "thp"))
+                ("shmem_policy", shmem_policy)
+                ("coverage", coverage);
+    }
+}
+
 void initialise() {
 //    if(initialised) RAISE_EXCEPTION(Exception, "Function pma::initialise() already called once");
     if(initialised) return;
@@ -85,6 +156,56 @@ void initialise() {
                 "updates are recorded.");
         param_sampling_rate.set_default(knobs.get_sampling_rate());
         param_sampling_rate.validate_fn([](double value){ return (value >= 0. && value <= 1.); });
+
+        auto param_nontemporal = PARAMETER(uint64_t, "rma_nontemporal_threshold").hint("bytes").descr("Minimum size, in bytes, "
+                "of a window to rebalance or resize to copy its elements with non-temporal stores, bypassing the cache. By default, "
+                "the size of the last level cache. Only used in the algorithms rma_baseline, rma_1by1 and rma_batch");
+        param_nontemporal.set_default(knobs.get_nontemporal_threshold());
+        PARAMETER(bool, "rma_nontemporal_calibrate").descr("Measure on this machine the threshold for the non-temporal stores, "
+                "rather than using --rma_nontemporal_threshold. Only used in the algorithms rma_baseline, rma_1by1 and rma_batch");
+
+        PARAMETER(string, "rma_scheduling").hint("fifo|priority").set_default("fifo").descr("The order in which the "
+                "rebalancer processes the postponed tasks. With `fifo' in order of arrival, with `priority' first the tasks "
+                "with the most threads waiting in their gates. Only used in the algorithms rma_baseline, rma_1by1 and rma_batch")
+                .validate_fn([](const string& value){ return value == "fifo" || value == "priority"; });
+
+        auto param_master_spin = PARAMETER(uint64_t, "rma_master_spin").hint("microsecs").descr("How long the rebalancer polls "
+                "its command queue before going to sleep, in microsecs. Only worth enabling when the clients and the rebalancing workers "
+                "leave some cores idle. Only used in the algorithms rma_baseline, rma_1by1 and rma_batch");
+        param_master_spin.set_default(knobs.get_master_spin_time());
+
+        auto param_retained_buffers = PARAMETER(uint64_t, "rma_retained_buffers").hint("bytes").descr("Max amount of free buffer "
+                "space, in bytes, to keep backed by physical memory after a rebalance. The excess is returned to the OS. "
+                "Only used in the algorithms rma_baseline, rma_1by1 and rma_batch");
+        param_retained_buffers.set_default(knobs.get_retained_buffer_memory());
+
+        auto param_proactive_budget = PARAMETER(double, "rma_proactive_budget").hint("[0, 1]").descr("Fraction of the time of the "
+                "rebalancer to spend, when idle, rebalancing the gates about to overflow before a client requests it. 0 disables it. "
+                "Only used in the algorithms rma_baseline, rma_1by1 and rma_batch")
+                .validate_fn([](double value){ return (value >= 0. && value <= 1.); });
+        param_proactive_budget.set_default(knobs.get_proactive_budget());
+
+        PARAMETER(string, "rma_numa").hint("none|interleaved|owner|partitioned").set_default("none").descr("How to place the "
+                "arrays among the NUMA nodes. With `none' the pages are allocated on the node touching them first, with `interleaved' "
+                "they are interleaved among all nodes, with `owner' they are bound to the node of the rebalancer, with `partitioned' "
+                "the extents are range partitioned among the nodes. The rebalancing workers are pinned accordingly. "
+                "Only used in the algorithms rma_baseline, rma_1by1 and rma_batch")
+                .validate_fn([](const string& value){ return value == "none" || value == "interleaved" || value == "owner" || value == "partitioned"; });
+
+        auto param_memory_budget = PARAMETER(uint64_t, "rma_memory_budget").hint("bytes").descr("Soft limit, in bytes, on the physical "
+                "memory used by the arrays. As the usage nears the budget, the densities are raised to postpone the resizes, the upsizes are "
+                "capped and the writers are slowed down. 0 means unlimited. Only used in the algorithms rma_baseline, rma_1by1 and rma_batch");
+        param_memory_budget.set_default(knobs.get_memory_budget());
+
+        auto param_prefault_buffers = PARAMETER(uint64_t, "rma_prefault_buffers").hint("bytes").descr("Amount of free buffer "
+                "space, in bytes, the rebalancer keeps populated when idle, so that the workers do not fault in the buffers while "
+                "rewiring. The extents added by extending the arrays in place are populated as well. 0 disables it. Only used in the algorithms "
+                "rma_baseline, rma_1by1 and rma_batch");
+        param_prefault_buffers.set_default(knobs.get_prefault_buffer_memory());
+
+        PARAMETER(bool, "rma_key_compression").descr("Compress the keys of the segments with a frame of reference codec, at the end "
+                "of each rebalance and after the initial insertions. The segments are decompressed when updated. Only used in the algorithms "
+                "rma_baseline and rma_baseline_set");
     }
 
 
@@ -111,6 +232,14 @@ void initialise() {
 //        // Rank threshold
 //        auto argument_rank = ARGREF(double, "apma_rank");
 //        if(argument_rank.is_set()){ algorithm->knobs().m_rank_threshold = argument_rank.get(); }
+//        algorithm->knobs().set_nontemporal_threshold(get_nontemporal_threshold());
+//        if(ARGREF(string, "rma_scheduling").get() == "priority"){ algorithm->knobs().set_scheduling_policy(data_structures::rma::common::SchedulingPolicy::PRIORITY); }
+//        algorithm->knobs().set_master_spin_time(ARGREF(uint64_t, "rma_master_spin").get());
+//        algorithm->knobs().set_retained_buffer_memory(ARGREF(uint64_t, "rma_retained_buffers").get());
+//        algorithm->knobs().set_proactive_budget(ARGREF(double, "rma_proactive_budget").get());
+//        algorithm->knobs().set_numa_policy(parse_numa_policy(ARGREF(string, "rma_numa").get()));
+//        algorithm->knobs().set_memory_budget(ARGREF(uint64_t, "rma_memory_budget").get());
+//        algorithm->knobs().set_prefault_buffer_memory(ARGREF(uint64_t, "rma_prefault_buffers").get());
 //
 //        // Right now, it is the same as `apma_parallel_scan'. To only use the standard thresholds:
 //        algorithm->knobs().set_thresholds_switch(numeric_limits<int32_t>::max());
@@ -130,11 +259,32 @@ void initialise() {
                 "extent size: " << extent_mult << " (" << get_memory_page_size() * extent_mult << " bytes), "
                         "worker threads in the rebalancer: " << worker_threads_rebalancer << ", "
                         "segments per lock: " << segments_per_lock);
+        report_huge_pages();
         auto algorithm = make_unique<rma::baseline::PackedMemoryArray>(iB, lB, extent_mult, worker_threads_rebalancer, segments_per_lock);
 
-        // Rank threshold
-        auto argument_rank = ARGREF(double, "apma_rank");
-        if(argument_rank.is_set()){ algorithm->knobs().m_rank_threshold = argument_rank.get(); }
+        apply_rma_knobs(algorithm->knobs());
+
+        return algorithm;
+    });
+
+    REGISTER_DATA_STRUCTURE("rma_baseline_set", "Same as rma_baseline, but it only stores the keys, as an ordered set, without the array for the values. "
+            "Set the size of an extent with the option --extent_size=N", [](){
+        uint64_t iB = ARGREF(uint64_t, "iB");
+        uint64_t lB = ARGREF(uint64_t, "lB");
+        auto param_extent_mult = ARGREF(uint64_t, "extent_size");
+        if(!param_extent_mult.is_set())
+            RAISE_EXCEPTION(configuration::ConsoleArgumentError, "[rma_baseline_set] Mandatory parameter --extent size not set.");
+        uint64_t extent_mult = param_extent_mult.get();
+        uint64_t worker_threads_rebalancer = ARGREF(uint64_t, "apma_rebalancing_threads");
+        uint64_t segments_per_lock = ARGREF(uint64_t, "apma_segments_per_lock");
+        LOG_VERBOSE("[rma_baseline_set] index block size (iB): " << iB << ", segment size (lB): " << lB << ", "
+                "extent size: " << extent_mult << " (" << get_memory_page_size() * extent_mult << " bytes), "
+                        "worker threads in the rebalancer: " << worker_threads_rebalancer << ", "
+                        "segments per lock: " << segments_per_lock);
+        report_huge_pages();
+        auto algorithm = make_unique<rma::baseline::PackedMemoryArray>(iB, lB, extent_mult, worker_threads_rebalancer, segments_per_lock, /* key only */ true);
+
+        apply_rma_knobs(algorithm->knobs());
 
         return algorithm;
     });
@@ -153,16 +303,19 @@ void initialise() {
                 "extent size: " << extent_mult << " (" << get_memory_page_size() * extent_mult << " bytes), "
                         "worker threads in the rebalancer: " << worker_threads_rebalancer << ", "
                         "segments per lock: " << segments_per_lock);
+        report_huge_pages();
+        if(ARGREF(bool, "rma_key_compression").get())
+            RAISE_EXCEPTION(configuration::ConsoleArgumentError, "[rma_1by1] The option --rma_key_compression is only supported by rma_baseline and rma_baseline_set");
         auto algorithm = make_unique<rma::one_by_one::PackedMemoryArray>(iB, lB, extent_mult, worker_threads_rebalancer, segments_per_lock);
 
-        // Rank threshold
-        auto argument_rank = ARGREF(double, "apma_rank");
-        if(argument_rank.is_set()){ algorithm->knobs().m_rank_threshold = argument_rank.get(); }
+        apply_rma_knobs(algorithm->knobs());
 
         return algorithm;
     });
 
     PARAMETER(uint64_t, "delay").descr("The minimum amount of time to delay a rebalance in apma_parallel3, in milliseconds").set_default(0);
+    PARAMETER(uint64_t, "delay_max").descr("The maximum amount of time to delay a rebalance in rma_batch, in milliseconds. When greater than "
+            "--delay, the delay of each gate adapts to its update rate in [delay, delay_max]").set_default(0);
 
     REGISTER_DATA_STRUCTURE("rma_batch", "Parallel version of APMA/int3 (with Katriel's thresholds). This version includes asynchronous writes to minimise "
             "the number of writers locked in a gate. Set the size of an extent with the option --extent_size=N", [](){
@@ -175,15 +328,17 @@ void initialise() {
         uint64_t worker_threads_rebalancer = ARGREF(uint64_t, "apma_rebalancing_threads");
         uint64_t segments_per_lock = ARGREF(uint64_t, "apma_segments_per_lock");
         auto rebal_delay = chrono::milliseconds(ARGREF(uint64_t, "delay"));
+        auto rebal_delay_max = max(rebal_delay, chrono::milliseconds(ARGREF(uint64_t, "delay_max")));
         LOG_VERBOSE("[rma_batch] index block size (iB): " << iB << ", segment size (lB): " << lB << ", "
                 "extent size: " << extent_mult << " (" << get_memory_page_size() * extent_mult << " bytes), "
                         "worker threads in the rebalancer: " << worker_threads_rebalancer << ", "
-                        "segments per lock: " << segments_per_lock << ", rebalancer delay: " << rebal_delay.count());
-        auto algorithm = make_unique<rma::batch_processing::PackedMemoryArray>(iB, lB, extent_mult, worker_threads_rebalancer, segments_per_lock, rebal_delay);
+                        "segments per lock: " << segments_per_lock << ", rebalancer delay: " << rebal_delay.count() << ", max: " << rebal_delay_max.count());
+        report_huge_pages();
+        if(ARGREF(bool, "rma_key_compression").get())
+            RAISE_EXCEPTION(configuration::ConsoleArgumentError, "[rma_batch] The option --rma_key_compression is only supported by rma_baseline and rma_baseline_set");
+        auto algorithm = make_unique<rma::batch_processing::PackedMemoryArray>(iB, lB, extent_mult, worker_threads_rebalancer, segments_per_lock, rebal_delay, rebal_delay_max);
 
-        // Rank threshold
-        auto argument_rank = ARGREF(double, "apma_rank");
-        if(argument_rank.is_set()){ algorithm->knobs().m_rank_threshold = argument_rank.get(); }
+        apply_rma_knobs(algorithm->knobs());
 
         return algorithm;
     });
@@ -219,8 +374,15 @@ void initialise() {
      * Parallel scan
      */
     PARAMETER(uint64_t, "duration")["D"].hint("secs").descr("The duration of each scan in the experiment parallel_scan, in seconds.").set_default(360);
+    PARAMETER(string, "load_snapshot").hint("path").descr("Load the content of the data structure from the given snapshot, in place of the "
+            "initial insertions. Only used in the experiment parallel_scan");
+    PARAMETER(string, "save_snapshot").hint("path").descr("Save the content of the data structure into the given snapshot, after the "
+            "initial insertions, to be reloaded in the next runs with --load_snapshot. Only used in the experiment parallel_scan");
     REGISTER_EXPERIMENT("parallel_scan", "Perform scans with multiple threads over 1% of the data structure. Use -I to set the size of the data structure and -D the duration of each scan, in seconds", [](shared_ptr<Interface> data_structure){
-        return make_unique<experiments::ParallelScan>(data_structure, chrono::seconds( ARGREF(uint64_t, "duration") ));
+        auto param_load_snapshot = ARGREF(string, "load_snapshot");
+        auto param_save_snapshot = ARGREF(string, "save_snapshot");
+        return make_unique<experiments::ParallelScan>(data_structure, chrono::seconds( ARGREF(uint64_t, "duration") ),
+                param_load_snapshot.is_set() ? param_load_snapshot.get() : string{}, param_save_snapshot.is_set() ? param_save_snapshot.get() : string{});
     });
 
     /**
@@ -278,6 +440,9 @@ void initialise() {
         PARAMETER(string, "algorithm")["a"].hint().required().record(false)
                 .descr(helpstr.str())
                 .validate_fn([](const std::string& algorithm){
+            if(algorithm == "rma_1by1_set" || algorithm == "rma_batch_set")
+                RAISE_EXCEPTION(configuration::ConsoleArgumentError, "Invalid algorithm: " << algorithm << ". The key-only (set) mode is only "
+                        "implemented by the baseline RMA, use the algorithm rma_baseline_set");
             auto& list = factory().algorithms();
             auto res = find_if(begin(list), end(list), [&algorithm](auto& impl){
                 return impl->name() == algorithm;
@@ -345,6 +510,14 @@ void execute(){
     string name_experiment = ARGREF(string, "experiment");
     shared_ptr<experiments::Interface> experiment;
 
+    // the snapshots are only supported by the experiment parallel_scan, do not silently ignore the options elsewhere
+    if(name_experiment != "parallel_scan"){
+        if(ARGREF(string, "load_snapshot").is_set())
+            RAISE_EXCEPTION(configuration::ConsoleArgumentError, "The option --load_snapshot is only supported by the experiment parallel_scan, experiment: " << name_experiment);
+        if(ARGREF(string, "save_snapshot").is_set())
+            RAISE_EXCEPTION(configuration::ConsoleArgumentError, "The option --save_snapshot is only supported by the experiment parallel_scan, experiment: " << name_experiment);
+    }
+
     experiment = factory().make_experiment(name_experiment, factory().make_algorithm(name_algorithm));
 
     experiment->execute();
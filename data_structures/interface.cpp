@@ -38,12 +38,18 @@ size_t Interface::memory_footprint() const{
     return 0;
 }
 
+size_t Interface::memory_footprint_resident() const{
+    return memory_footprint();
+}
+
 InterfaceRQ::~InterfaceRQ(){ }
 
 std::unique_ptr<Iterator> InterfaceRQ::iterator() const {
     return find(numeric_limits<int64_t>::min(), numeric_limits<int64_t>::max());
 }
 
+BulkLoading::~BulkLoading(){ }
+
 Iterator::~Iterator(){ }
 
 std::ostream& operator<<(std::ostream& out, const Interface::SumResult& sum){
@@ -101,6 +101,11 @@ public:
      */
     virtual std::size_t memory_footprint() const;
 
+    /**
+     * Return the physical memory (in bytes) actually resident for the whole data structure. By default, the same as the space footprint
+     */
+    virtual std::size_t memory_footprint_resident() const;
+
     /**
      * Dump the content of the container to stdout, for debugging purposes
      */
@@ -133,6 +138,24 @@ public:
     virtual std::unique_ptr<Iterator> iterator() const;
 };
 
+/**
+ * [Interface]
+ * An optional interface for the data structures that can be built from a sorted sequence of elements
+ * faster than inserting them one by one. It is used to reload a snapshot, see snapshot.hpp
+ */
+class BulkLoading {
+public:
+    /**
+     * Destructor
+     */
+    virtual ~BulkLoading();
+
+    /**
+     * Load the given elements, sorted by key, into the data structure. It assumes the data structure
+     * is empty before the method is invoked.
+     */
+    virtual void load(const std::pair<int64_t, int64_t>* elements, std::size_t elements_sz) = 0;
+};
 
 std::ostream& operator<<(std::ostream& out, const Interface::SumResult& sum);
 
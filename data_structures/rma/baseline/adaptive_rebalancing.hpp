@@ -28,6 +28,7 @@
 // forward declarations
 namespace data_structures::rma::common {
     struct DensityBounds;
+    class MemoryBudget;
     class MoveDetectorInfo;
 }
 
@@ -53,6 +54,7 @@ private:
     const size_t m_height; // the height of the calibrator tree
     const size_t m_segment_capacity; // the capacity of each segment
     const data_structures::rma::common::DensityBounds& m_densities;
+    const data_structures::rma::common::MemoryBudget& m_memory_budget; // the upper thresholds are raised as the memory usage nears the budget
     common::MoveDetectorInfo* m_ptr_move_detector_info;
     const bool m_fill_segments; // Whether the segment can be filled to the maximum capacity
 
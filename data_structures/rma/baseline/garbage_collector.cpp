@@ -88,8 +88,11 @@ void GarbageCollector::start(){
 
 void GarbageCollector::stop(){
     COUT_DEBUG("Stopping...");
-    m_thread_can_execute = false;
-    barrier();
+    {
+        scoped_lock<mutex> lock(m_mutex);
+        m_thread_can_execute = false;
+    }
+    m_condvar.notify_all();
     if(m_background_thread.joinable())
         m_background_thread.join(); // wait for the thread to finish
 }
@@ -105,7 +108,10 @@ void GarbageCollector::run(){
     m_condvar.notify_one();
 
     while(m_thread_can_execute){
-        std::this_thread::sleep_for(m_timer_interval);
+        { // wait for the timer to expire or for enough objects to be marked
+            unique_lock<mutex> lock(m_mutex);
+            m_condvar.wait_for(lock, m_timer_interval, [this](){ return !m_thread_can_execute || m_num_marked >= m_wakeup_threshold; });
+        }
         perform_gc_pass();
     }
     m_thread_is_running = false;
@@ -115,14 +121,16 @@ void GarbageCollector::run(){
 void GarbageCollector::perform_gc_pass(){
     COUT_DEBUG("Performing a pass of garbage collection...");
 
-    // current epoch
+    // move the global epoch forward, the threads entering from now on do not hold back the objects marked so far
+    m_instance->m_thread_contexts.epochs().advance();
     auto epoch = m_instance->m_thread_contexts.min_epoch();
     vector<Item*> items;
     items.reserve(/* magic number */ 64);
     {  // restrict the scope
         lock_guard<mutex> lock(m_mutex);
+        m_num_marked = 0;
         for(uint64_t i = 0, sz = m_items_to_delete.size(); i < sz; i++){
-            if(m_items_to_delete[0]->m_timestamp > epoch) break; // done
+            if(m_items_to_delete[0]->m_timestamp >= epoch) break; // done, some thread may still access it
             items.push_back(m_items_to_delete[0]);
             m_items_to_delete.pop();
         }
@@ -139,6 +147,10 @@ void GarbageCollector::perform_gc_pass(){
     COUT_DEBUG("Pass finished");
 }
 
+uint64_t GarbageCollector::retire_epoch(){
+    return m_instance->m_thread_contexts.epochs().retire();
+}
+
 void GarbageCollector::dump(std::ostream& out) const {
     auto current_epoch = m_instance->m_thread_contexts.min_epoch();
 
@@ -81,7 +81,7 @@ void Iterator::restart(){
         try {
             auto context = m_pma->get_context();
             context->hello();
-            auto gate_id = m_pma->m_locks.get(context)->find(m_min);
+            auto gate_id = m_pma->m_index.get(*context)->find(m_min);
             acquire_lock(gate_id);
             done = true;
         } catch (data_structures::rma::common::Abort) { /* retry  */ };
@@ -123,8 +123,16 @@ void Iterator::acquire_lock(uint64_t gate_id){
                     context->wait();
                 }
                 break;
-            case Gate::State::WRITE:
             case Gate::State::REBAL:
+                if(gate.m_resize_readers && !gate.m_resize_draining){ // the old storage is being copied by a resize, but it can still be read
+                    gate.m_num_active_threads++;
+                    lock.unlock();
+                    m_gate = gates + gate_id;
+                    done = true;
+                    break;
+                }
+                // fall through
+            case Gate::State::WRITE:
                 // add the thread in the queue
                 gate.m_queue.append({ Gate::State::READ, context } );
                 lock.unlock();
@@ -148,18 +156,20 @@ void Iterator::release_lock(){
            m_gate->wake_next();
        } break;
        case Gate::State::REBAL: {
-           send_message_to_rebalancer = true;
+           // with m_resize_readers, the worker executing the resize waits for the readers to leave
+           send_message_to_rebalancer = !m_gate->m_resize_readers;
        } break;
        default:
            assert(0 && "Invalid state");
        }
     }
     m_min = m_gate->m_fence_high_key +1; // next restarting point
+    auto gate_id = m_gate->lock_id();
     m_gate->unlock();
     m_gate = nullptr;
 
     if(send_message_to_rebalancer){
-        m_pma->m_rebalancer->exit(m_gate->lock_id());
+        m_pma->m_rebalancer->exit(gate_id);
     }
 }
 
@@ -184,23 +194,43 @@ void Iterator::set_offset(uint64_t segment_id){
     auto stop_segment_id = (segment_id /2) *2 +1; // odd segment
     m_stop = stop_segment_id * m_pma->m_storage.m_segment_capacity + m_pma->m_storage.m_segment_sizes[stop_segment_id] -1; // inclusive
 
-    int64_t* __restrict keys = m_pma->m_storage.m_keys;
-    while(m_offset <= m_stop && keys[m_offset] < m_min){
+    // decode the pair of segments if either of them is compressed
+    const Storage& storage = m_pma->m_storage;
+    auto start_segment_id = stop_segment_id -1; // even segment
+    if(storage.is_encoded(start_segment_id) || storage.is_encoded(stop_segment_id)){
+        auto size_lhs = storage.m_segment_sizes[start_segment_id];
+        m_decoded_keys.resize(size_lhs + storage.m_segment_sizes[stop_segment_id]);
+        storage.get_keys(start_segment_id, m_decoded_keys.data());
+        storage.get_keys(stop_segment_id, m_decoded_keys.data() + size_lhs);
+        m_decoded_start = stop_segment_id * storage.m_segment_capacity - size_lhs;
+    } else {
+        m_decoded_start = -1;
+    }
+
+    while(m_offset <= m_stop && get_key(m_offset) < m_min){
         m_offset++;
     }
     if(m_last){
-        while(m_offset <= m_stop && keys[m_stop] > m_max){
+        while(m_offset <= m_stop && get_key(m_stop) > m_max){
             m_stop--;
         }
     }
 }
 
+int64_t Iterator::get_key(int64_t position) const {
+    if(m_decoded_start < 0){
+        return m_pma->m_storage.m_keys[position];
+    } else {
+        return m_decoded_keys[position - m_decoded_start];
+    }
+}
+
 void Iterator::fetch_next_chunk(){
     assert(m_offset > m_stop && "Invalid position");
 
     auto next_segment_id = (m_stop / m_pma->m_storage.m_segment_capacity) +1;
     if(next_segment_id % 2 == 1) return; // it means the stop offset has been moved from its fixed position due to reaching the maximum of the interval
-    if(next_segment_id > m_pma->m_storage.m_number_segments) return; // depleted
+    if(next_segment_id >= m_pma->m_storage.m_number_segments) return; // depleted
     if(next_segment_id % m_pma->get_segments_per_lock() == 0){
         // move to the next lock
         release_lock();
@@ -220,10 +250,9 @@ bool Iterator::hasNext() const {
 }
 
 pair<int64_t, int64_t> Iterator::next(){
-    int64_t* keys = m_pma->m_storage.m_keys;
-    int64_t* values = m_pma->m_storage.m_values;
-
-    pair<int64_t, int64_t> result { keys[m_offset], values[m_offset] };
+    const Storage& storage = m_pma->m_storage;
+    int64_t key = get_key(m_offset);
+    pair<int64_t, int64_t> result { key, storage.m_key_only ? key : storage.m_values[m_offset] };
 
     m_offset++;
     if(m_offset > m_stop) fetch_next_chunk();
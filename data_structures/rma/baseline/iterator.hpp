@@ -15,6 +15,9 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <cinttypes>
+#include <vector>
+
 #include "data_structures/interface.hpp"
 #include "data_structures/iterator.hpp"
 
@@ -31,6 +34,13 @@ class Iterator : public ::data_structures::Iterator {
     int64_t m_offset = 0; // the current position in the storage
     int64_t m_stop = -1; // index when the current sequence stops
     bool m_last = false; // whether the iterator has been consumed
+    std::vector<int64_t> m_decoded_keys; // the plain keys of the current pair of segments, when at least one of them is compressed
+    int64_t m_decoded_start = -1; // the position in the storage of m_decoded_keys[0], or -1 to read the keys directly from the storage
+
+    /**
+     * Retrieve the key at the given position in the storage
+     */
+    int64_t get_key(int64_t position) const;
 
     /**
      * Acquire the next extent
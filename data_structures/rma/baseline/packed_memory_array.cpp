@@ -29,11 +29,14 @@
 #include <stdexcept>
 #include <thread>
 #include <utility>
+#include <vector>
 
+#include "common/binary_file.hpp"
 #include "common/circular_array.hpp"
 #include "common/miscellaneous.hpp"
 #include "rma/common/abort.hpp"
 #include "rma/common/buffered_rewired_memory.hpp"
+#include "rma/common/key_compression.hpp"
 #include "rma/common/move_detector_info.hpp"
 #include "rma/common/rewired_memory.hpp"
 #include "adaptive_rebalancing.hpp"
@@ -70,12 +73,13 @@ mutex _debug_mutex;
  *                                                                           *
  *****************************************************************************/
 
-PackedMemoryArray::PackedMemoryArray(size_t btree_block_size, size_t pma_segment_size, size_t pages_per_extent, size_t num_worker_threads, size_t segments_per_lock) :
-        m_storage(pma_segment_size, pages_per_extent),
+PackedMemoryArray::PackedMemoryArray(size_t btree_block_size, size_t pma_segment_size, size_t pages_per_extent, size_t num_worker_threads, size_t segments_per_lock, bool key_only) :
+        m_storage(pma_segment_size, pages_per_extent, /* num segments */ 1, key_only),
         m_index(new StaticIndex(btree_block_size)),
         m_locks(Gate::allocate(1, segments_per_lock)),
         m_detector(m_knobs, 1, 8),
         m_density_bounds1(0, 0.75, 0.75, 1), /* there is rationale for these hardwired thresholds */
+        m_rewiring_cost(common::RewiringCostModel::calibrated(pages_per_extent)),
         m_rebalancer(new RebalancingMaster{ this, num_worker_threads } ),
         m_garbage_collector( new GarbageCollector(this) ),
         m_segments_per_lock(segments_per_lock){
@@ -294,8 +298,16 @@ Gate* PackedMemoryArray::reader_on_entry(int64_t key, int64_t start_gate_id) con
                     context->wait();
                 }
                 break;
-            case Gate::State::WRITE:
             case Gate::State::REBAL:
+                if(gate.m_resize_readers && !gate.m_resize_draining){ // the old storage is being copied by a resize, but it can still be read
+                    gate.m_num_active_threads++;
+                    lock.unlock();
+                    result = gates + gate_id;
+                    done = true;
+                    break;
+                }
+                // fall through
+            case Gate::State::WRITE:
                 // add the thread in the queue
                 gate.m_queue.append({ Gate::State::READ, context } );
                 lock.unlock();
@@ -321,7 +333,8 @@ void PackedMemoryArray::reader_on_exit(Gate* gate) const {
            gate->wake_next();
        } break;
        case Gate::State::REBAL: {
-           send_message_to_rebalancer = true;
+           // with m_resize_readers, the worker executing the resize waits for the readers to leave
+           send_message_to_rebalancer = !gate->m_resize_readers;
        } break;
        default:
            assert(0 && "Invalid state");
@@ -360,7 +373,10 @@ const data_structures::rma::common::CachedDensityBounds& PackedMemoryArray::get_
 
 std::pair<double, double> PackedMemoryArray::get_thresholds(int height) const {
     assert(height >= 1 && height <= m_storage.hyperheight());
-    return get_thresholds().thresholds(height);
+    auto thresholds = get_thresholds().thresholds(height);
+    // as the memory budget nears, accept denser windows to postpone the resizes
+    thresholds.second = m_memory_budget.raise_upper_threshold(thresholds.second, get_thresholds().get_upper_threshold_leaves());
+    return thresholds;
 }
 
 void PackedMemoryArray::set_thresholds(int height_calibrator_tree){
@@ -387,6 +403,14 @@ CachedMemoryPool& PackedMemoryArray::memory_pool() {
     return m_memory_pool;
 }
 
+const MemoryBudget& PackedMemoryArray::memory_budget() const {
+    return m_memory_budget;
+}
+
+void PackedMemoryArray::update_memory_budget() {
+    m_memory_budget.update(m_knobs.get_memory_budget(), memory_footprint_resident());
+}
+
 Detector& PackedMemoryArray::detector(){
     return m_detector;
 }
@@ -416,6 +440,15 @@ size_t PackedMemoryArray::memory_footprint() const {
     return sizeof(decltype(*this)) + space_index + space_locks + space_storage + space_detector;
 }
 
+size_t PackedMemoryArray::memory_footprint_resident() const {
+    size_t space_index = m_index.get_unsafe()->memory_footprint();
+    size_t space_locks = get_segments_per_lock() * (sizeof(Gate) + /* separator keys */ (m_index.get_unsafe()->node_size() -1) * sizeof(int64_t));
+    size_t space_storage = m_storage.memory_footprint_resident();
+    size_t space_detector = m_detector.capacity() * m_detector.sizeof_entry() * sizeof(uint64_t);
+
+    return sizeof(decltype(*this)) + space_index + space_locks + space_storage + space_detector;
+}
+
 /*****************************************************************************
  *                                                                           *
  *   Index                                                                   *
@@ -441,6 +474,7 @@ void PackedMemoryArray::set_separator_key(uint64_t segment_id, int64_t key) {
  *                                                                           *
  *****************************************************************************/
 void PackedMemoryArray::insert(int64_t key, int64_t value){
+    m_memory_budget.throttle(); // back pressure, when the memory usage nears the budget
     bool done = false;
     do {
         try {
@@ -486,7 +520,7 @@ void PackedMemoryArray::insert_empty(int64_t key, int64_t value){
     m_storage.m_segment_sizes[0] = 1;
     size_t pos = m_storage.m_segment_capacity -1;
     m_storage.m_keys[pos] = key;
-    m_storage.m_values[pos] = value;
+    if(!m_storage.m_key_only) m_storage.m_values[pos] = value;
     m_cardinality = 1;
 }
 
@@ -494,6 +528,7 @@ bool PackedMemoryArray::insert_common(size_t segment_id, int64_t key, int64_t va
     assert(!empty() && "Wrong method: use ::insert_empty");
     assert(segment_id < m_storage.m_number_segments && "Overflow: attempting to access an invalid segment in the PMA");
 //    COUT_DEBUG("segment_id: " << segment_id << ", element: <" << key << ", " << value << ">");
+    if(m_storage.is_encoded(segment_id)) m_storage.decode(segment_id, 1); // restore the plain keys before altering them
 
     // is this bucket full ?
     auto bucket_cardinality = m_storage.m_segment_sizes[segment_id];
@@ -513,7 +548,8 @@ bool PackedMemoryArray::storage_insert_unsafe(size_t segment_id, int64_t key, in
     assert(m_storage.m_segment_sizes[segment_id] < m_storage.m_segment_capacity && "This segment is full!");
 
     int64_t* __restrict keys = m_storage.m_keys + segment_id * m_storage.m_segment_capacity;
-    int64_t* __restrict values = m_storage.m_values + segment_id * m_storage.m_segment_capacity;
+    const bool key_only = m_storage.m_key_only;
+    int64_t* __restrict values = key_only ? nullptr : m_storage.m_values + segment_id * m_storage.m_segment_capacity;
     bool minimum = false; // the inserted key is the new minimum ?
     size_t sz = m_storage.m_segment_sizes[segment_id];
     assert(sz < m_storage.m_segment_capacity && "Segment overfilled");
@@ -532,10 +568,12 @@ bool PackedMemoryArray::storage_insert_unsafe(size_t segment_id, int64_t key, in
 //        COUT_DEBUG("(even) segment_id: " << segment_id << ", start: " << start << ", stop: " << stop << ", key: " << key << ", value: " << value << ", position: " << i);
         keys[i] = key;
 
-        for(size_t j = start; j < i; j++){
-            values[j] = values[j+1];
+        if(!key_only){
+            for(size_t j = start; j < i; j++){
+                values[j] = values[j+1];
+            }
+            values[i] = value;
         }
-        values[i] = value;
 
         minimum = (i == start);
         bool maximum = (i == stop);
@@ -554,10 +592,12 @@ bool PackedMemoryArray::storage_insert_unsafe(size_t segment_id, int64_t key, in
 //        COUT_DEBUG("(odd) segment_id: " << segment_id << ", key: " << key << ", value: " << value << ", position: " << i);
         keys[i] = key;
 
-        for(size_t j = sz; j > i; j--){
-            values[j] = values[j-1];
+        if(!key_only){
+            for(size_t j = sz; j > i; j--){
+                values[j] = values[j-1];
+            }
+            values[i] = value;
         }
-        values[i] = value;
 
         minimum = (i == 0);
         bool maximum = (i == sz);
@@ -617,8 +657,10 @@ bool PackedMemoryArray::do_remove(Gate* gate, int64_t key, int64_t* out_value){
 
     auto segment_id = gate->find(key);
 //    COUT_DEBUG("Gate: " << gate->gate_id() << ", segment: " << segment_id << ", key: " << key);
+    if(m_storage.is_encoded(segment_id)) m_storage.decode(segment_id, 1); // restore the plain keys before altering them
     int64_t* __restrict keys = m_storage.m_keys + segment_id * m_storage.m_segment_capacity;
-    int64_t* __restrict values = m_storage.m_values + segment_id * m_storage.m_segment_capacity;
+    const bool key_only = m_storage.m_key_only;
+    int64_t* __restrict values = key_only ? nullptr : m_storage.m_values + segment_id * m_storage.m_segment_capacity;
     size_t sz = m_storage.m_segment_sizes[segment_id];
     assert(sz > 0 && "Empty segment!");
 
@@ -634,11 +676,15 @@ bool PackedMemoryArray::do_remove(Gate* gate, int64_t key, int64_t* out_value){
             if(i > imin) predecessor = keys[i-1];
             if(i < m_storage.m_segment_capacity -1) successor = keys[i+1];
 
-            value = values[i];
+            value = key_only ? key : values[i];
             // shift the rest of the elements by 1
             for(size_t j = i; j > imin; j--){
                 keys[j] = keys[j -1];
-                values[j] = values[j-1];
+            }
+            if(!key_only){
+                for(size_t j = i; j > imin; j--){
+                    values[j] = values[j-1];
+                }
             }
 
             sz--;
@@ -662,11 +708,15 @@ bool PackedMemoryArray::do_remove(Gate* gate, int64_t key, int64_t* out_value){
             if(i > 0) predecessor = keys[i-1];
             if(i < sz -1) successor = keys[i+1];
 
-            value = values[i];
+            value = key_only ? key : values[i];
             // shift the rest of the elements by 1
             for(size_t j = i; j < sz - 1; j++){
                 keys[j] = keys[j+1];
-                values[j] = values[j+1];
+            }
+            if(!key_only){
+                for(size_t j = i; j < sz - 1; j++){
+                    values[j] = values[j+1];
+                }
             }
 
             sz--;
@@ -756,6 +806,11 @@ bool PackedMemoryArray::rebalance_local(size_t segment_id, int64_t* key, int64_t
     bool do_resize { false };
     bool is_local_rebalance = rebalance_find_window(segment_id, is_insert, &window_start, &window_length, &cardinality, &do_resize);
     if(!is_local_rebalance) return false;
+    if(do_resize){
+        m_storage.decode(0, m_storage.m_number_segments);
+    } else {
+        m_storage.decode(window_start, window_length);
+    }
 
     auto metadata = rebalance_plan(is_insert, window_start, window_length, cardinality, do_resize);
 
@@ -768,6 +823,15 @@ bool PackedMemoryArray::rebalance_local(size_t segment_id, int64_t* key, int64_t
     rebalance_run_apma(metadata, /* fill the segments ? */ true);
     do_rebalance_local(metadata);
 
+    // compress the segments just spread
+    if(m_knobs.get_key_compression()){
+        if(do_resize){
+            m_storage.encode(0, m_storage.m_number_segments);
+        } else {
+            m_storage.encode(window_start, window_length);
+        }
+    }
+
     return true;
 }
 
@@ -858,7 +922,8 @@ RebalancePlan PackedMemoryArray::rebalance_plan(bool is_insert, int64_t window_s
         result.m_window_length = window_length;
     } else if (is_insert){ // resize on insertion
         result.m_window_start = 0;
-        size_t ideal_number_of_segments = max<size_t>(ceil( static_cast<double>(cardinality_after) / (m_density_bounds1.get_upper_threshold_root() * m_storage.m_segment_capacity) ), m_storage.m_number_segments +1);
+        const double upper_threshold_root = m_memory_budget.raise_upper_threshold(m_density_bounds1.get_upper_threshold_root(), m_density_bounds1.get_upper_threshold_leaves());
+        size_t ideal_number_of_segments = max<size_t>(ceil( static_cast<double>(cardinality_after) / (upper_threshold_root * m_storage.m_segment_capacity) ), m_storage.m_number_segments +1);
         if(ideal_number_of_segments < density_threshold){
             result.m_window_length = m_storage.m_number_segments * 2;
             if(result.m_window_length > m_storage.get_segments_per_extent()){ // use rewiring
@@ -974,13 +1039,14 @@ void PackedMemoryArray::resize_local(const RebalancePlan& action) {
     int64_t* __restrict xKeys = m_storage.m_keys;
     int64_t* __restrict xValues = m_storage.m_values;
     decltype(m_storage.m_segment_sizes) __restrict xSizes = m_storage.m_segment_sizes;
+    const bool key_only = m_storage.m_key_only; // xValues & ixValues are nullptr
     m_detector.resize(num_segments);
 
     // fetch the first non-empty input segment
     size_t input_segment_id = 0;
     size_t input_size = ixSizes[0];
     int64_t* input_keys = ixKeys + m_storage.m_segment_capacity;
-    int64_t* input_values = ixValues + m_storage.m_segment_capacity;
+    int64_t* input_values = key_only ? nullptr : ixValues + m_storage.m_segment_capacity;
     bool input_segment_odd = false; // consider '0' as even
     if(input_size == 0){ // corner case, the first segment is empty!
         assert(!do_insert && "Otherwise we shouldn't see empty segments");
@@ -989,7 +1055,7 @@ void PackedMemoryArray::resize_local(const RebalancePlan& action) {
         input_size = ixSizes[1];
     } else { // stick to the first segment, even!
         input_keys -= input_size;
-        input_values -= input_size;
+        if(!key_only) input_values -= input_size;
     }
 
     // start copying the elements
@@ -1013,7 +1079,7 @@ void PackedMemoryArray::resize_local(const RebalancePlan& action) {
         size_t output_offset = output_segment_odd ? 0 : m_storage.m_segment_capacity - elements_to_copy;
         size_t output_canonical_index = j * m_storage.m_segment_capacity;
         int64_t* output_keys = xKeys + output_canonical_index + output_offset;
-        int64_t* output_values = xValues + output_canonical_index + output_offset;
+        int64_t* output_values = key_only ? nullptr : xValues + output_canonical_index + output_offset;
         xSizes[j] = elements_to_copy;
         if(input_size > 0) // protect from the edge case: the first segment will contain only one element, that is the new element to be inserted
             set_separator_key(j, input_keys[0]);
@@ -1034,11 +1100,11 @@ void PackedMemoryArray::resize_local(const RebalancePlan& action) {
             } else {
                 input_copied = output_copied = cpy1;
                 memcpy(output_keys, input_keys, cpy1 * sizeof(m_storage.m_keys[0]));
-                memcpy(output_values, input_values, cpy1 * sizeof(m_storage.m_values[0]));
+                if(!key_only) memcpy(output_values, input_values, cpy1 * sizeof(m_storage.m_values[0]));
             }
             assert(output_copied >= 1 && "Made no progress");
             output_keys += output_copied; input_keys += input_copied;
-            output_values += output_copied; input_values += input_copied;
+            if(!key_only){ output_values += output_copied; input_values += input_copied; }
             input_size -= input_copied;
 
 //            COUT_DEBUG("cpy1: " << cpy1 << ", elements_to_copy: " << elements_to_copy - cpy1 << ", input_size: " << input_size);
@@ -1064,7 +1130,7 @@ void PackedMemoryArray::resize_local(const RebalancePlan& action) {
                     size_t offset = input_segment_odd ? 0 : m_storage.m_segment_capacity - input_size;
                     size_t input_canonical_index = input_segment_id * m_storage.m_segment_capacity;
                     input_keys = ixKeys + input_canonical_index + offset;
-                    input_values = ixValues + input_canonical_index + offset;
+                    if(!key_only) input_values = ixValues + input_canonical_index + offset;
                 }
                 assert(input_segment_id <= (m_storage.m_number_segments +1) && "Infinite loop");
             }
@@ -1112,7 +1178,9 @@ void PackedMemoryArray::resize_local(const RebalancePlan& action) {
     }
 
     // update the PMA properties
+    size_t num_segments_before = m_storage.m_number_segments;
     m_storage.m_number_segments = num_segments;
+    m_storage.resize_encoded_segments(num_segments_before); // no segment is compressed at this point
 }
 
 /*****************************************************************************
@@ -1129,7 +1197,8 @@ void PackedMemoryArray::spread_local(const RebalancePlan& action){
     auto fn_deallocate = [this](void* ptr){ m_memory_pool.deallocate(ptr); };
     unique_ptr<int64_t, decltype(fn_deallocate)> input_keys_ptr{ m_memory_pool.allocate<int64_t>(action.get_cardinality_after()), fn_deallocate };
     int64_t* __restrict input_keys = input_keys_ptr.get();
-    unique_ptr<int64_t, decltype(fn_deallocate)> input_values_ptr{ m_memory_pool.allocate<int64_t>(action.get_cardinality_after()), fn_deallocate };
+    const bool key_only = m_storage.m_key_only;
+    unique_ptr<int64_t, decltype(fn_deallocate)> input_values_ptr{ key_only ? nullptr : m_memory_pool.allocate<int64_t>(action.get_cardinality_after()), fn_deallocate };
     int64_t* __restrict input_values = input_values_ptr.get();
 
     // 1) first copy all elements in input keys
@@ -1163,7 +1232,7 @@ void PackedMemoryArray::spread_local(const RebalancePlan& action){
         }
 
         input_keys += length;
-        input_values += length;
+        if(!key_only) input_values += length;
         segment_id += partitions[i].m_segments;
 
         // adjust the starting offset of the inserted key
@@ -1183,14 +1252,16 @@ size_t PackedMemoryArray::spread_insert_unsafe(int64_t* __restrict keys_from, in
     size_t i = 0;
     while(i < num_elements && keys_from[i] < new_key){
         keys_to[i] = keys_from[i];
-        values_to[i] = values_from[i];
         i++;
     }
     keys_to[i] = new_key;
-    values_to[i] = new_value;
-
     memcpy(keys_to + i + 1, keys_from + i, (num_elements -i) * sizeof(keys_to[0]));
-    memcpy(values_to + i + 1, values_from + i, (num_elements -i) * sizeof(values_to[0]));
+
+    if(!m_storage.m_key_only){
+        memcpy(values_to, values_from, i * sizeof(values_to[0]));
+        values_to[i] = new_value;
+        memcpy(values_to + i + 1, values_from + i, (num_elements -i) * sizeof(values_to[0]));
+    }
 
     m_cardinality++;
 
@@ -1204,7 +1275,8 @@ void PackedMemoryArray::spread_load(const RebalancePlan& action, int64_t* __rest
     // workspace
     using segment_size_t = remove_pointer_t<decltype(m_storage.m_segment_sizes)>;
     int64_t* __restrict workspace_keys = m_storage.m_keys + action.m_window_start * m_storage.m_segment_capacity;
-    int64_t* __restrict workspace_values = m_storage.m_values + action.m_window_start * m_storage.m_segment_capacity;
+    const bool key_only = m_storage.m_key_only;
+    int64_t* __restrict workspace_values = key_only ? nullptr : m_storage.m_values + action.m_window_start * m_storage.m_segment_capacity;
     segment_size_t* __restrict workspace_sizes = m_storage.m_segment_sizes + action.m_window_start;
 
     bool do_insert = action.is_insert();
@@ -1214,21 +1286,21 @@ void PackedMemoryArray::spread_load(const RebalancePlan& action, int64_t* __rest
         size_t length = workspace_sizes[i -1] + workspace_sizes[i];
         size_t offset = (m_storage.m_segment_capacity * i) - workspace_sizes[i-1];
         int64_t* __restrict keys_from = workspace_keys + offset;
-        int64_t* __restrict values_from = workspace_values + offset;
+        int64_t* __restrict values_from = key_only ? nullptr : workspace_values + offset;
 
         // destination
         if (new_key_segment == i || new_key_segment == i -1){
             position_key_inserted += spread_insert_unsafe(keys_from, values_from, keys_to, values_to, length, action.m_insert_key, action.m_insert_value);
             if(output_position_key_inserted) *output_position_key_inserted = position_key_inserted;
             do_insert = false;
-            keys_to++; values_to++;
+            keys_to++; if(!key_only) values_to++;
         } else {
             memcpy(keys_to, keys_from, sizeof(keys_to[0]) * length);
-            memcpy(values_to, values_from, sizeof(values_from[0]) * length);
+            if(!key_only) memcpy(values_to, values_from, sizeof(values_from[0]) * length);
             if(do_insert) { position_key_inserted += length; } // the inserted key has not been yet inserted
         }
 
-        keys_to += length; values_to += length;
+        keys_to += length; if(!key_only) values_to += length;
     }
 
     if(do_insert){
@@ -1240,16 +1312,11 @@ void PackedMemoryArray::spread_load(const RebalancePlan& action, int64_t* __rest
 void PackedMemoryArray::spread_save(size_t segment_id, int64_t* keys_from, int64_t* values_from, size_t cardinality, const spread_detector_record* detector_record){
     assert(cardinality > 0 && "Empty segment");
 
-    int64_t* keys_to = m_storage.m_keys + segment_id * m_storage.m_segment_capacity;
-    int64_t* values_to = m_storage.m_values + segment_id * m_storage.m_segment_capacity;
-
-    if(segment_id %2  == 0){ // even segment, adjust the base addresses
-        keys_to += m_storage.m_segment_capacity - cardinality;
-        values_to += m_storage.m_segment_capacity - cardinality;
-    }
+    // even segments are filled at the end
+    size_t offset = segment_id * m_storage.m_segment_capacity + (segment_id %2 == 0 ? m_storage.m_segment_capacity - cardinality : 0);
 
-    memcpy(keys_to, keys_from, sizeof(keys_to[0]) * cardinality);
-    memcpy(values_to, values_from, sizeof(values_to[0]) * cardinality);
+    memcpy(m_storage.m_keys + offset, keys_from, sizeof(keys_from[0]) * cardinality);
+    if(!m_storage.m_key_only) memcpy(m_storage.m_values + offset, values_from, sizeof(values_from[0]) * cardinality);
 
     set_separator_key(segment_id, keys_from[0]);
     m_storage.m_segment_sizes[segment_id] = cardinality;
@@ -1259,9 +1326,10 @@ void PackedMemoryArray::spread_save(size_t segment_id, int64_t* keys_from, int64
 }
 
 void PackedMemoryArray::spread_save(size_t window_start, size_t window_length, int64_t* keys_from, int64_t* values_from, size_t cardinality, const spread_detector_record* detector_record){
+    const bool key_only = m_storage.m_key_only;
     int64_t* __restrict keys_to = m_storage.m_keys + window_start * m_storage.m_segment_capacity;
-    int64_t* __restrict values_to = m_storage.m_values + window_start * m_storage.m_segment_capacity;
-    uint16_t* __restrict segment_sizes = m_storage.m_segment_sizes + window_start;
+    int64_t* __restrict values_to = key_only ? nullptr : m_storage.m_values + window_start * m_storage.m_segment_capacity;
+    Storage::segment_size_t* __restrict segment_sizes = m_storage.m_segment_sizes + window_start;
 
     auto card_per_segment = cardinality / window_length;
     auto odd_segments = cardinality % window_length;
@@ -1294,14 +1362,16 @@ void PackedMemoryArray::spread_save(size_t window_start, size_t window_length, i
     if(window_start %2 == 1){
         size_t this_card = card_per_segment + odd_segments;
         memcpy(keys_to, keys_from, sizeof(keys_to[0]) * this_card);
-        memcpy(values_to, values_from, sizeof(values_to[0]) * this_card);
         set_separator_key(window_start, keys_to[0]);
 
         window_start++;
         keys_to += m_storage.m_segment_capacity;
-        values_to += m_storage.m_segment_capacity;
         keys_from += this_card;
-        values_from += this_card;
+        if(!key_only){
+            memcpy(values_to, values_from, sizeof(values_to[0]) * this_card);
+            values_to += m_storage.m_segment_capacity;
+            values_from += this_card;
+        }
         window_length--;
         if(odd_segments > 0) odd_segments--;
     }
@@ -1316,28 +1386,28 @@ void PackedMemoryArray::spread_save(size_t window_start, size_t window_length, i
         size_t length = card_left + card_right;
         size_t offset = i * m_storage.m_segment_capacity - card_left;
         int64_t* keys_to_start = keys_to + offset;
-        int64_t* values_to_start = values_to + offset;
 
         set_separator_key(window_start + i-1,  keys_from[0]);
         set_separator_key(window_start + i,   (keys_from + card_left)[0]);
 
         memcpy(keys_to_start, keys_from, length * sizeof(keys_to_start[0]));
-        memcpy(values_to_start, values_from, length * sizeof(values_from[0]));
-
         keys_from += length;
-        values_from += length;
+
+        if(!key_only){
+            memcpy(values_to + offset, values_from, length * sizeof(values_from[0]));
+            values_from += length;
+        }
     }
 
     // 5) copy the last segment, if it's at an even position
     if(window_length % 2 == 1){
         size_t offset = window_length * m_storage.m_segment_capacity - card_per_segment;
         int64_t* keys_to_start = keys_to + offset;
-        int64_t* values_to_start = values_to + offset;
 
         set_separator_key(window_start + window_length -1, keys_from[0]);
 
         memcpy(keys_to_start, keys_from, card_per_segment * sizeof(keys_to_start[0]));
-        memcpy(values_to_start, values_from, card_per_segment * sizeof(values_from[0]));
+        if(!key_only) memcpy(values_to + offset, values_from, card_per_segment * sizeof(values_from[0]));
     }
 }
 
@@ -1380,6 +1450,14 @@ int64_t PackedMemoryArray::find(int64_t key) const {
 int64_t PackedMemoryArray::do_find(Gate* gate, int64_t key) const{
     auto segment_id = gate->find(key);
 
+    if(m_storage.is_encoded(segment_id)){
+        int64_t position = m_storage.find_key(segment_id, key);
+        if(position < 0) return -1;
+        if(m_storage.m_key_only) return key;
+        size_t start = segment_id % 2 == 0 ? m_storage.m_segment_capacity - m_storage.m_segment_sizes[segment_id] : 0;
+        return *(m_storage.m_values + segment_id * m_storage.m_segment_capacity + start + position);
+    }
+
     int64_t* __restrict keys = m_storage.m_keys + segment_id * m_storage.m_segment_capacity;
     size_t sz = m_storage.m_segment_sizes[segment_id];
 
@@ -1392,6 +1470,13 @@ int64_t PackedMemoryArray::do_find(Gate* gate, int64_t key) const{
         stop = sz;
     }
 
+    if(m_storage.m_key_only){
+        for(size_t i = start; i < stop; i++){
+            if(keys[i] == key) return key;
+        }
+        return -1;
+    }
+
     for(size_t i = start; i < stop; i++){
         if(keys[i] == key){
             return *(m_storage.m_values + segment_id * m_storage.m_segment_capacity + i);
@@ -1415,6 +1500,7 @@ int PackedMemoryArray::find_position(size_t segment_id, int64_t key) const noexc
     if(key == std::numeric_limits<int64_t>::max()) return static_cast<int>(sz);
     // in ::rebalance, we may temporary alter the size of a segment to segment_capacity +1
     sz = min<size_t>(sz, m_storage.m_segment_capacity); // avoid overflow
+    if(m_storage.is_encoded(segment_id)) return m_storage.find_key(segment_id, key);
 
     int64_t* __restrict keys = m_storage.m_keys + segment_id * m_storage.m_segment_capacity;
     int start, stop;
@@ -1477,6 +1563,8 @@ unique_ptr<::data_structures::Iterator> PackedMemoryArray::iterator() const {
 
     if(result.m_num_elements == 0)
         result.m_first_key = 0;
+    if(m_storage.m_key_only) // the values are implicitly equal to the keys
+        result.m_sum_values = result.m_sum_keys;
 
     return result;
 }
@@ -1485,6 +1573,7 @@ void PackedMemoryArray::do_sum(uint64_t gate_id, int64_t& next_min, int64_t max,
     assert(sum != nullptr && "Null pointer");
 //    COUT_DEBUG("gate_id: " << gate_id << ", min: " << next_min << ", max: " << max << ", partial sum: " << *sum);
     bool sum_done = false;
+    const bool key_only = m_storage.m_key_only; // do not read the values, ::sum() sets them equal to the keys
 
 #if !defined(NDEBUG) // DEBUG ONLY
     int64_t key_previous = numeric_limits<int64_t>::min();
@@ -1497,17 +1586,36 @@ void PackedMemoryArray::do_sum(uint64_t gate_id, int64_t& next_min, int64_t max,
 
         if(read_all){ // read the whole content protected by this gate
             int64_t* __restrict keys = m_storage.m_keys + gate->m_window_start * m_storage.m_segment_capacity;
-            int64_t* __restrict values = m_storage.m_values + gate->m_window_start * m_storage.m_segment_capacity;
-            uint16_t* __restrict cardinalities = m_storage.m_segment_sizes + gate->m_window_start;
+            int64_t* __restrict values = key_only ? nullptr : m_storage.m_values + gate->m_window_start * m_storage.m_segment_capacity;
+            Storage::segment_size_t* __restrict cardinalities = m_storage.m_segment_sizes + gate->m_window_start;
 
             sum->m_first_key = std::min(sum->m_first_key, keys[m_storage.m_segment_capacity - cardinalities[0]]);
             for(int64_t segment_id = 0, last_segment_id = gate->m_window_length; segment_id < last_segment_id; segment_id+= 2){
                 int64_t start = (segment_id+1) * m_storage.m_segment_capacity - cardinalities[segment_id];
                 int64_t end = start + cardinalities[segment_id] + cardinalities[segment_id +1];
 
+                if(m_storage.is_encoded(gate->m_window_start + segment_id) || m_storage.is_encoded(gate->m_window_start + segment_id +1)){
+                    // the keys are compressed, sum them segment by segment without decoding
+                    int64_t segment_start = start;
+                    for(int64_t j = segment_id; j <= segment_id +1; j++){
+                        int64_t segment_end = segment_start + cardinalities[j];
+                        if(m_storage.is_encoded(gate->m_window_start + j)){
+                            sum->m_sum_keys += KeyCompression::sum(reinterpret_cast<uint64_t*>(keys + segment_start), cardinalities[j]);
+                        } else {
+                            for(int64_t i = segment_start; i < segment_end; i++){ sum->m_sum_keys += keys[i]; }
+                        }
+                        segment_start = segment_end;
+                    }
+                    if(!key_only){
+                        for(int64_t i = start; i < end; i++){ sum->m_sum_values += values[i]; }
+                    }
+                    sum->m_num_elements += (end - start);
+                    continue;
+                }
+
                 for(int64_t i = start; i < end; i++){
                     sum->m_sum_keys += keys[i];
-                    sum->m_sum_values += values[i];
+                    if(!key_only) sum->m_sum_values += values[i];
 #if !defined(NDEBUG)
                     assert(keys[i] >= key_previous && "Sorted order not respected");
                     key_previous = keys[i];
@@ -1515,10 +1623,16 @@ void PackedMemoryArray::do_sum(uint64_t gate_id, int64_t& next_min, int64_t max,
                 }
                 sum->m_num_elements += (end - start);
             }
-            sum->m_last_key = keys[m_storage.m_segment_capacity * (gate->m_window_length -1) + cardinalities[gate->m_window_length -1] -1];
+            if(m_storage.is_encoded(gate->m_window_start + gate->m_window_length -1)){
+                sum->m_last_key = m_storage.get_key(gate->m_window_start + gate->m_window_length -1, cardinalities[gate->m_window_length -1] -1);
+            } else {
+                sum->m_last_key = keys[m_storage.m_segment_capacity * (gate->m_window_length -1) + cardinalities[gate->m_window_length -1] -1];
+            }
+        } else if(has_encoded_segments(gate)){ // read partially a chunk with compressed keys
+            sum_done = do_sum_decoded(gate, next_min, max, sum);
         } else { // read only partially this chunk of the array
             int64_t* __restrict keys = m_storage.m_keys;
-            uint16_t* __restrict cardinalities = m_storage.m_segment_sizes;
+            Storage::segment_size_t* __restrict cardinalities = m_storage.m_segment_sizes;
 
             bool min_notfound = true;
             int64_t segment_begin = gate->find(next_min), start = 0;
@@ -1598,7 +1712,7 @@ void PackedMemoryArray::do_sum(uint64_t gate_id, int64_t& next_min, int64_t max,
                     sum->m_num_elements += (stop - offset);
                     while(offset < stop){
                         sum->m_sum_keys += keys[offset];
-                        sum->m_sum_values += values[offset];
+                        if(!key_only) sum->m_sum_values += values[offset];
 #if !defined(NDEBUG)
                         assert(keys[offset] >= key_previous && "Sorted order not respected");
                         key_previous = keys[offset];
@@ -1637,6 +1751,49 @@ void PackedMemoryArray::do_sum(uint64_t gate_id, int64_t& next_min, int64_t max,
 }
 
 
+bool PackedMemoryArray::has_encoded_segments(const Gate* gate) const noexcept {
+    const size_t window_end = std::min<size_t>(gate->m_window_start + gate->m_window_length, std::max<size_t>(2, m_storage.m_number_segments));
+    for(size_t segment_id = gate->m_window_start; segment_id < window_end; segment_id++){
+        if(m_storage.is_encoded(segment_id)) return true;
+    }
+    return false;
+}
+
+bool PackedMemoryArray::do_sum_decoded(const Gate* gate, int64_t min, int64_t max, ::data_structures::Interface::SumResult* __restrict sum) const {
+    const bool key_only = m_storage.m_key_only;
+    const size_t window_start = gate->m_window_start;
+    const size_t window_end = std::min<size_t>(window_start + gate->m_window_length, std::max<size_t>(2, m_storage.m_number_segments));
+
+    // decode the keys, and gather the values, of the whole gate
+    size_t num_elements = 0;
+    for(size_t segment_id = window_start; segment_id < window_end; segment_id++){ num_elements += m_storage.m_segment_sizes[segment_id]; }
+    vector<int64_t> keys(num_elements);
+    vector<int64_t> values(key_only ? 0 : num_elements);
+    for(size_t segment_id = window_start, position = 0; segment_id < window_end; segment_id++){
+        size_t size = m_storage.m_segment_sizes[segment_id];
+        m_storage.get_keys(segment_id, keys.data() + position);
+        if(!key_only){
+            size_t offset = segment_id * m_storage.m_segment_capacity + (segment_id %2 == 0 ? m_storage.m_segment_capacity - size : 0);
+            memcpy(values.data() + position, m_storage.m_values + offset, size * sizeof(values[0]));
+        }
+        position += size;
+    }
+
+    size_t first = std::lower_bound(begin(keys), end(keys), min) - begin(keys);
+    size_t last = std::upper_bound(begin(keys), end(keys), max) - begin(keys); // exclusive
+    if(first < last){
+        sum->m_first_key = std::min(sum->m_first_key, keys[first]);
+        for(size_t i = first; i < last; i++){
+            sum->m_sum_keys += keys[i];
+            if(!key_only) sum->m_sum_values += values[i];
+        }
+        sum->m_num_elements += (last - first);
+        sum->m_last_key = keys[last -1];
+    }
+
+    return last < num_elements;
+}
+
 Gate* PackedMemoryArray::sum_on_entry(uint64_t gate_id, int64_t min, int64_t max, bool* out_readall) const{
     Gate* gate = reader_on_entry(min, gate_id);
     if(out_readall != nullptr){
@@ -1649,12 +1806,181 @@ void PackedMemoryArray::sum_on_exit(Gate* gate) const {
     reader_on_exit(gate);
 }
 
+/*****************************************************************************
+ *                                                                           *
+ *   Checkpoint                                                              *
+ *                                                                           *
+ *****************************************************************************/
+/**
+ * Layout of a checkpoint:
+ * - the header, see below
+ * - for each gate: the separator key in the index, the fence keys and the separator keys of its segments (segments_per_lock -1)
+ * - the cardinalities of all segments, as an array of Storage::segment_size_t
+ * - for each segment: its keys followed by its values (omitted in key-only mode)
+ */
+namespace {
+struct CheckpointHeader {
+    char m_magic[8]; // file signature
+    uint64_t m_version; // format of the checkpoint
+    uint64_t m_segment_capacity; // the capacity of each segment
+    uint64_t m_segments_per_lock; // the number of segments per gate
+    uint64_t m_key_only; // whether the values have been stored
+    uint64_t m_number_segments; // the total number of segments
+    uint64_t m_cardinality; // the total number of elements
+};
+constexpr char CHECKPOINT_MAGIC[8] = { 'R', 'M', 'A', 'C', 'K', 'P', 'T', '\0' };
+constexpr uint64_t CHECKPOINT_VERSION = 1;
+} // anonymous namespace
+
+void PackedMemoryArray::checkpoint(const string& path) {
+    COUT_DEBUG("path: " << path);
+    m_rebalancer->stop(); // wait for the pending rebalances to complete, and prevent new ones from being issued
+    auto restart_rebalancer = [this](void*){ m_rebalancer->start(); };
+    unique_ptr<PackedMemoryArray, decltype(restart_rebalancer)> rebalancer_guard { this, restart_rebalancer };
+
+    const size_t num_segments = m_storage.m_number_segments;
+    const size_t num_locks = get_number_locks();
+    const size_t segment_capacity = m_storage.m_segment_capacity;
+    const bool key_only = m_storage.m_key_only;
+    StaticIndex* index = m_index.get_unsafe();
+    Gate* locks = m_locks.get_unsafe();
+
+    BinaryFileWriter writer { path };
+    CheckpointHeader header;
+    memcpy(header.m_magic, CHECKPOINT_MAGIC, sizeof(header.m_magic));
+    header.m_version = CHECKPOINT_VERSION;
+    header.m_segment_capacity = segment_capacity;
+    header.m_segments_per_lock = get_segments_per_lock();
+    header.m_key_only = key_only;
+    header.m_number_segments = num_segments;
+    header.m_cardinality = m_cardinality;
+    writer.write(header);
+
+    // gates
+    for(size_t i = 0; i < num_locks; i++){
+        writer.write<int64_t>(index->get_separator_key(i));
+        writer.write<int64_t>(locks[i].m_fence_low_key);
+        writer.write<int64_t>(locks[i].m_fence_high_key);
+        writer.write(locks[i].m_separator_keys, (get_segments_per_lock() -1) * sizeof(int64_t));
+    }
+
+    // segments
+    writer.write(m_storage.m_segment_sizes, num_segments * sizeof(m_storage.m_segment_sizes[0]));
+    unique_ptr<int64_t[]> decoded_keys { new int64_t[segment_capacity] }; // the checkpoint always stores the plain keys
+    for(size_t segment_id = 0; segment_id < num_segments; segment_id++){
+        size_t size = m_storage.m_segment_sizes[segment_id];
+        size_t offset = segment_id * segment_capacity + (segment_id %2 == 0 ? segment_capacity - size : 0);
+        if(m_storage.is_encoded(segment_id)){
+            m_storage.get_keys(segment_id, decoded_keys.get());
+            writer.write(decoded_keys.get(), size * sizeof(int64_t));
+        } else {
+            writer.write(m_storage.m_keys + offset, size * sizeof(int64_t));
+        }
+        if(!key_only) writer.write(m_storage.m_values + offset, size * sizeof(int64_t));
+    }
+
+    writer.close();
+}
+
+void PackedMemoryArray::restore(const string& path) {
+    COUT_DEBUG("path: " << path);
+    if(!empty()){ RAISE_EXCEPTION(Exception, "Cannot restore the checkpoint `" << path << "', the data structure is not empty"); }
+
+    BinaryFileReader reader { path };
+    CheckpointHeader header = reader.read<CheckpointHeader>();
+    if(memcmp(header.m_magic, CHECKPOINT_MAGIC, sizeof(header.m_magic)) != 0 || header.m_version != CHECKPOINT_VERSION){
+        RAISE_EXCEPTION(Exception, "The file `" << path << "' is not a checkpoint of this data structure");
+    }
+    if(header.m_segment_capacity != m_storage.m_segment_capacity){
+        RAISE_EXCEPTION(Exception, "Segment capacity mismatch, checkpoint: " << header.m_segment_capacity << ", data structure: " << m_storage.m_segment_capacity);
+    }
+    if(header.m_segments_per_lock != get_segments_per_lock()){
+        RAISE_EXCEPTION(Exception, "Segments per lock mismatch, checkpoint: " << header.m_segments_per_lock << ", data structure: " << get_segments_per_lock());
+    }
+    if(static_cast<bool>(header.m_key_only) != m_storage.m_key_only){
+        RAISE_EXCEPTION(Exception, "Key-only mode mismatch, checkpoint: " << header.m_key_only << ", data structure: " << m_storage.m_key_only);
+    }
+    const size_t num_segments = header.m_number_segments;
+    const size_t segments_per_lock = get_segments_per_lock();
+    if(num_segments == 0 || (num_segments > segments_per_lock && num_segments % segments_per_lock != 0)){
+        RAISE_EXCEPTION(Exception, "Invalid number of segments in the checkpoint: " << num_segments);
+    }
+    const size_t num_locks = max<size_t>(1, num_segments / segments_per_lock);
+
+    m_rebalancer->stop(); // in case a proactive rebalance is still in progress
+    auto restart_rebalancer = [this](void*){ m_rebalancer->start(); };
+    unique_ptr<PackedMemoryArray, decltype(restart_rebalancer)> rebalancer_guard { this, restart_rebalancer };
+
+    // rebuild the index & the gates
+    unique_ptr<StaticIndex> index { new StaticIndex(m_index.get_unsafe()->node_size(), num_locks) };
+    auto locks_deleter = [num_locks](Gate* gates){ Gate::deallocate(gates, num_locks); };
+    unique_ptr<Gate, decltype(locks_deleter)> locks { Gate::allocate(num_locks, segments_per_lock), locks_deleter };
+    for(size_t i = 0; i < num_locks; i++){
+        index->set_separator_key(i, reader.read<int64_t>());
+        locks.get()[i].m_fence_low_key = reader.read<int64_t>();
+        locks.get()[i].m_fence_high_key = reader.read<int64_t>();
+        reader.read(locks.get()[i].m_separator_keys, (segments_per_lock -1) * sizeof(int64_t));
+    }
+
+    // load the segments
+    Storage storage { m_storage.m_segment_capacity, m_storage.m_pages_per_extent, num_segments, m_storage.m_key_only };
+    const size_t segment_capacity = storage.m_segment_capacity;
+    reader.read(storage.m_segment_sizes, num_segments * sizeof(storage.m_segment_sizes[0]));
+    uint64_t cardinality = 0;
+    for(size_t segment_id = 0; segment_id < num_segments; segment_id++){
+        size_t size = storage.m_segment_sizes[segment_id];
+        if(size > segment_capacity){ RAISE_EXCEPTION(Exception, "Invalid cardinality for the segment " << segment_id << ": " << size); }
+        size_t offset = segment_id * segment_capacity + (segment_id %2 == 0 ? segment_capacity - size : 0);
+        reader.read(storage.m_keys + offset, size * sizeof(int64_t));
+        if(!storage.m_key_only) reader.read(storage.m_values + offset, size * sizeof(int64_t));
+
+        locks.get()[segment_id / segments_per_lock].m_cardinality += size;
+        cardinality += size;
+    }
+    if(cardinality != header.m_cardinality){
+        RAISE_EXCEPTION(Exception, "Cardinality mismatch, header: " << header.m_cardinality << ", segments: " << cardinality);
+    }
+
+    // install the new content
+    Gate::deallocate(m_locks.get_unsafe(), get_number_locks());
+    delete m_index.get_unsafe();
+    m_storage = std::move(storage);
+    m_locks.set(locks.release());
+    m_index.set(index.release());
+    m_locks.timestamp() = m_index.timestamp() = m_thread_contexts.epochs().advance();
+    m_cardinality = cardinality;
+    m_detector.resize(num_segments);
+    m_primary_densities = num_segments > balanced_thresholds_cutoff();
+    set_thresholds(ceil(log2(num_segments)) +1);
+    if(m_knobs.get_key_compression()){ m_storage.encode(0, num_segments); }
+}
+
 /*****************************************************************************
  *                                                                           *
  *   Dump                                                                    *
  *                                                                           *
  *****************************************************************************/
 
+/*****************************************************************************
+ *                                                                           *
+ *   Key compression                                                         *
+ *                                                                           *
+ *****************************************************************************/
+
+void PackedMemoryArray::build() {
+    if(!m_knobs.get_key_compression()) return;
+
+    m_rebalancer->stop(); // wait for the pending rebalances to complete, and prevent new ones from being issued
+    auto restart_rebalancer = [this](void*){ m_rebalancer->start(); };
+    unique_ptr<PackedMemoryArray, decltype(restart_rebalancer)> rebalancer_guard { this, restart_rebalancer };
+
+    m_storage.encode(0, m_storage.m_number_segments);
+}
+
+size_t PackedMemoryArray::key_footprint() const noexcept {
+    return m_storage.key_footprint();
+}
+
 void PackedMemoryArray::dump() const { dump(std::cout);  }
 
 void PackedMemoryArray::dump(std::ostream& out) const {
@@ -1755,6 +2081,7 @@ void PackedMemoryArray::dump_storage(std::ostream& out, bool* integrity_check) c
     int64_t* values = m_storage.m_values;
     auto sizes = m_storage.m_segment_sizes;
     size_t tot_count = 0;
+    vector<int64_t> decoded_keys(m_storage.m_segment_capacity);
 
     for(size_t i = 0; i < m_storage.m_number_segments; i++){
         out << "[" << i << "] ";
@@ -1764,9 +2091,20 @@ void PackedMemoryArray::dump_storage(std::ostream& out, bool* integrity_check) c
         size_t start = even ? m_storage.m_segment_capacity - sizes[i] : 0;
         size_t end = even ? m_storage.m_segment_capacity : sizes[i];
 
+        const int64_t* segment_keys = keys;
+        if(m_storage.is_encoded(i)){ // print the plain keys
+            out << "(compressed) ";
+            m_storage.get_keys(i, decoded_keys.data() + start);
+            segment_keys = decoded_keys.data();
+        }
+
         for(size_t j = start, sz = end; j < sz; j++){
             if(j > start) out << ", ";
-            out << "<" << keys[j] << ", " << values[j] << ">";
+            if(m_storage.m_key_only){
+                out << "<" << segment_keys[j] << ">";
+            } else {
+                out << "<" << segment_keys[j] << ", " << values[j] << ">";
+            }
 
 //            // only for the unit tests
 //            if(keys[j] <= 0){
@@ -1774,11 +2112,11 @@ void PackedMemoryArray::dump_storage(std::ostream& out, bool* integrity_check) c
 //                if(integrity_check) *integrity_check = false;
 //            }
 
-            if(keys[j] < previous_key){
-                out << " (ERROR: order mismatch: " << previous_key << " > " << keys[j] << ")";
+            if(segment_keys[j] < previous_key){
+                out << " (ERROR: order mismatch: " << previous_key << " > " << segment_keys[j] << ")";
                 if(integrity_check) *integrity_check = false;
             }
-            previous_key = keys[j];
+            previous_key = segment_keys[j];
         }
         out << endl;
 
@@ -1786,15 +2124,15 @@ void PackedMemoryArray::dump_storage(std::ostream& out, bool* integrity_check) c
         int64_t gate_id = i / get_segments_per_lock();
         if(i % get_segments_per_lock() == 0){
             int64_t indexed_key = m_index.get_unsafe()->get_separator_key(gate_id);
-            if(keys[start] < indexed_key){
-                out << " (ERROR: invalid key in the index, minimum: " << keys[start] << ", indexed key: " << indexed_key << ", gate: " << gate_id  << ")" << end;
+            if(segment_keys[start] < indexed_key){
+                out << " (ERROR: invalid key in the index, minimum: " << segment_keys[start] << ", indexed key: " << indexed_key << ", gate: " << gate_id  << ")" << end;
                 if(integrity_check) *integrity_check = false;
             }
         } else { // check the content in the extent
             int64_t offset = i % get_segments_per_lock() -1;
             int64_t  indexed_key = m_locks.get_unsafe()[gate_id].m_separator_keys[offset];
-            if(keys[start] != indexed_key){
-                out << " (ERROR: invalid key in the extent, minimum: " << keys[start] << ", indexed key: " << indexed_key << ", gate: " << gate_id  << ")" << end;
+            if(segment_keys[start] != indexed_key){
+                out << " (ERROR: invalid key in the extent, minimum: " << segment_keys[start] << ", indexed key: " << indexed_key << ", gate: " << gate_id  << ")" << end;
                 if(integrity_check) *integrity_check = false;
             }
         }
@@ -1802,7 +2140,7 @@ void PackedMemoryArray::dump_storage(std::ostream& out, bool* integrity_check) c
 
         // next segment
         keys += m_storage.m_segment_capacity;
-        values += m_storage.m_segment_capacity;
+        if(!m_storage.m_key_only) values += m_storage.m_segment_capacity;
     }
 
     if(m_cardinality != tot_count){
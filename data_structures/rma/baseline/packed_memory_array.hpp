@@ -20,6 +20,7 @@
 
 #include <atomic>
 #include <mutex>
+#include <string>
 #include <type_traits>
 #include <vector>
 
@@ -29,7 +30,9 @@
 #include "rma/common/density_bounds.hpp"
 #include "rma/common/detector.hpp"
 #include "rma/common/knobs.hpp"
+#include "rma/common/memory_budget.hpp"
 #include "rma/common/memory_pool.hpp"
+#include "rma/common/rewiring_cost_model.hpp"
 #include "rma/common/static_index.hpp"
 #include "pointer.hpp"
 #include "rebalance_plan.hpp"
@@ -73,6 +76,8 @@ protected:
     CachedDensityBounds m_density_bounds1; // primary thresholds (for num_segmnets>balanced_thresholds_cutoff())
     bool m_primary_densities = false; // use the primary thresholds?
     common::CachedMemoryPool m_memory_pool;
+    const common::RewiringCostModel& m_rewiring_cost; // whether to rewire or to copy back the extents of a rebalance, shared by all instances
+    common::MemoryBudget m_memory_budget; // back pressure as the memory usage nears the budget set in the knobs
     RebalancingMaster* m_rebalancer;
     GarbageCollector* m_garbage_collector; // garbage collector
     ThreadContextList m_thread_contexts; // the list of thread contexts, to keep track of the thread epochs
@@ -115,6 +120,12 @@ protected:
     void do_sum(uint64_t start_gate, int64_t& next_min, int64_t max, ::data_structures::Interface::SumResult* __restrict result) const;
     void sum_on_exit(Gate* gate) const;
 
+    // Check whether any segment of the given gate has its keys compressed
+    bool has_encoded_segments(const Gate* gate) const noexcept;
+
+    // Sum the elements in [min, max] of a gate with compressed segments, after decoding them. Return true if the gate contains keys greater than max
+    bool do_sum_decoded(const Gate* gate, int64_t min, int64_t max, ::data_structures::Interface::SumResult* __restrict result) const;
+
     // Insert the first element in the (empty) container
     void insert_empty(int64_t key, int64_t value);
 
@@ -175,6 +186,10 @@ protected:
     // Retrieve the number of segments after that the primary thresholds are used
     size_t balanced_thresholds_cutoff() const;
 
+    // Refresh the memory usage against the budget set in the knobs. Invoked by the RebalancingMaster at the end of each resize, when
+    // no other rebalance is in progress, so that the windows are always evaluated with the same thresholds
+    void update_memory_budget();
+
     // Dump the content of the locks
     void dump_locks(std::ostream& out, bool* integrity_check) const;
 
@@ -194,8 +209,9 @@ public:
      * @param pages_per_extent the number of contiguous O.S. pages that compose an extent, the minimum granularity for rewiring
      * @param num_worker_threads the number of workers in the rebalancer
      * @param segments_per_lock the number of continguous segments protected by a single lock/gate
+     * @param key_only whether to store only the keys, as an ordered set. The value associated to each key is the key itself
      */
-    PackedMemoryArray(size_t index_B, size_t pma_segment_size, size_t pages_per_extent, size_t num_worker_threads, size_t segments_per_lock);
+    PackedMemoryArray(size_t index_B, size_t pma_segment_size, size_t pages_per_extent, size_t num_worker_threads, size_t segments_per_lock, bool key_only = false);
 
     /**
      * Destructor
@@ -248,6 +264,11 @@ public:
      */
     common::CachedMemoryPool& memory_pool();
 
+    /**
+     * Current memory usage versus the budget set in the knobs, as of the last resize
+     */
+    const common::MemoryBudget& memory_budget() const;
+
     /**
      * Accessor to the underlying predictor/detector
      */
@@ -303,6 +324,27 @@ public:
      */
     void unregister_thread();
 
+    /**
+     * Save the content of the data structure into the given file, to be reloaded later with #restore. The file contains the
+     * segments, in their current layout, together with the separator keys of the index and the gates. Pending rebalances are
+     * completed before taking the checkpoint. This method is not thread safe, no other thread can operate on the data structure
+     * while the checkpoint is in progress.
+     */
+    void checkpoint(const std::string& path);
+
+    /**
+     * Reload the content of a checkpoint previously saved with #checkpoint. The data structure must be empty and have the same
+     * segment capacity, number of segments per lock and key-only mode of the checkpoint. Only the index and the gates are
+     * rebuilt, the segments are read as they are. This method is not thread safe.
+     */
+    void restore(const std::string& path);
+
+    /**
+     * Compress the keys of all segments, when the knob key_compression is set. Invoked by the experiments after the initial
+     * insertions. Pending rebalances are completed before compressing the segments. This method is not thread safe.
+     */
+    void build() override;
+
     /**
      *  Dump the content of the data structure (for debugging purposes)
      *  This method is not thread safe
@@ -322,6 +364,13 @@ public:
      * Memory footprint
      */
     size_t memory_footprint() const override;
+    size_t memory_footprint_resident() const override;
+
+    /**
+     * Amount of space, in bytes, actually taken by the keys, that is the bytes a full scan needs to read. With
+     * the knob key_compression, it is less than the cardinality of the data structure times 8 bytes.
+     */
+    size_t key_footprint() const noexcept;
 };
 
 } // namespace
@@ -17,13 +17,18 @@
 
 #include "rebalancing_master.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <cmath>
 #include <cstdlib> // abs, debug only
 #include <iostream>
 #include <mutex>
 #include <sstream>
+#include <thread>
+#include <utility>
+#include <vector>
 
+#include "common/configuration.hpp" // LOG_VERBOSE
 #include "common/errorhandling.hpp"
 #include "common/miscellaneous.hpp"
 
@@ -53,6 +58,9 @@ extern mutex _debug_mutex; // PackedMemoryArray.cpp
     #define COUT_DEBUG(msg)
 #endif
 
+// The master is pinned to the first socket, it is the owner of the gates with NumaPolicy::OWNER
+constexpr int OWNER_NUMA_NODE = 0;
+
 /*****************************************************************************
  *                                                                           *
  *   Initialisation                                                          *
@@ -63,6 +71,18 @@ RebalancingMaster::RebalancingMaster(PackedMemoryArray* pma, uint64_t num_worker
 
 RebalancingMaster::~RebalancingMaster() {
     stop();
+
+#if defined(PROFILING)
+    LOG_VERBOSE("[RebalancingMaster::dtor] Computing the rebalancing statistics....");
+    auto t0 = chrono::steady_clock::now();
+    auto stats = get_rebalancing_stastistics(m_stats_completed_tasks);
+    auto t1 = chrono::steady_clock::now();
+    cout << "Statistics computed in " << chrono::duration_cast<chrono::seconds>(t1 - t0).count() << " seconds\n";
+    cout << stats << endl;;
+    cout << m_master_stats << endl;
+    cout << m_instance->memory_pool().get_statistics() << endl;
+    if(m_instance->knobs().get_memory_budget() > 0){ cout << m_instance->memory_budget() << endl; }
+#endif
 }
 
 void RebalancingMaster::start(){
@@ -70,7 +90,9 @@ void RebalancingMaster::start(){
 
     scoped_lock<mutex> lock(m_mutex);
     if(m_handle.joinable()){ RAISE_EXCEPTION(Exception, "Main thread already started") };
-    m_queue.clear();
+    InternalTask message;
+    while(m_queue.pop(message)) { /* discard the messages left from a previous run */ };
+    m_inbox.clear();
     m_handle = thread(&RebalancingMaster::main_thread, this);
 }
 
@@ -79,9 +101,8 @@ void RebalancingMaster::stop(){
     { // restrict the scope
         scoped_lock<mutex> lock(m_mutex);
         if(!m_handle.joinable()) return; // already stopped
-        m_queue.append(InternalTask{InternalTask::Type::Stop, 0});
-        m_condvar.notify_one();
     }
+    send_message(InternalTask{InternalTask::Type::Stop, 0});
     m_handle.join();
 }
 
@@ -95,28 +116,16 @@ RebalancingPool& RebalancingMaster::thread_pool(){
  *                                                                           *
  *****************************************************************************/
 void RebalancingMaster::rebalance(uint64_t gate_id){
-    {
-        scoped_lock<mutex> lock(m_mutex);
-        m_queue.append(InternalTask{InternalTask::Type::Rebalance, gate_id });
-    }
-    m_condvar.notify_one();
+    send_message(InternalTask{InternalTask::Type::Rebalance, gate_id});
 }
 
 void RebalancingMaster::exit(uint64_t gate_id){
-    {
-        scoped_lock<mutex> lock(m_mutex);
-        m_queue.append(InternalTask{InternalTask::Type::ClientExit, gate_id });
-    }
-    m_condvar.notify_one();
+    send_message(InternalTask{InternalTask::Type::ClientExit, gate_id});
 }
 
 void RebalancingMaster::task_done(RebalancingTask* task){
     assert(task != nullptr && "Null pointer");
-    {
-        scoped_lock<mutex> lock(m_mutex);
-        m_queue.append(InternalTask{InternalTask::Type::TaskDone, reinterpret_cast<uint64_t>(task) });
-    }
-    m_condvar.notify_one();
+    send_message(InternalTask{InternalTask::Type::TaskDone, reinterpret_cast<uint64_t>(task)});
 }
 
 /*****************************************************************************
@@ -124,27 +133,100 @@ void RebalancingMaster::task_done(RebalancingTask* task){
  *   Controller thread                                                       *
  *                                                                           *
  *****************************************************************************/
+void RebalancingMaster::send_message(InternalTask message){
+    IF_PROFILING( message.m_time_sent = chrono::steady_clock::now() );
+    m_queue.push(message);
+
+    // Both the push and the load of m_sleeping are sequentially consistent: either we observe the master going to sleep
+    // or the master observes our message before parking. Notify under the mutex, not to slip in before the master waits.
+    if(m_sleeping){
+        scoped_lock<mutex> lock(m_mutex);
+        m_condvar.notify_one();
+    }
+}
+
+void RebalancingMaster::fetch_messages(){
+    assert(m_inbox.empty() && "There are still messages to process");
+
+    if(m_queue.empty()){
+        // with spare cores, the next message is likely to arrive shortly. Spin for a while, rather than paying a futex wait & wake up.
+        // Yield between the rounds, the threads the master is waiting for may need this core
+        const auto spin_time = chrono::microseconds(m_instance->knobs().get_master_spin_time());
+        if(spin_time.count() > 0){
+            auto t0 = chrono::steady_clock::now();
+            do {
+                for(int i = 0; i < 64 && m_queue.empty(); i++){ cpu_relax(); }
+                if(m_queue.empty()){ this_thread::yield(); }
+            } while(m_queue.empty() && (chrono::steady_clock::now() - t0) < spin_time);
+        }
+
+        if(!m_queue.empty()){
+            IF_PROFILING( m_master_stats.m_num_spins++ );
+        }
+
+        // how long to sleep before looking again for the gates to rebalance proactively
+        constexpr auto PROACTIVE_INTERVAL = chrono::milliseconds(10);
+        while(m_queue.empty()){
+            // the master is idle, use its spare time to rebalance the gates before the clients find them full
+            while(m_queue.empty() && proactive_rebalance()){ /* next round */ }
+            if(!m_queue.empty()) break;
+
+            // spare the workers of the next rebalances from faulting in their buffers
+            prefault_buffers();
+            if(!m_queue.empty()) break;
+
+            // Zzz
+            unique_lock<mutex> lock(m_mutex);
+            m_sleeping = true;
+            auto has_messages = [this](){ return !m_queue.empty(); };
+            if(m_instance->knobs().get_proactive_budget() > 0){
+                m_condvar.wait_for(lock, PROACTIVE_INTERVAL, has_messages);
+            } else {
+                m_condvar.wait(lock, has_messages);
+            }
+            m_sleeping = false;
+            IF_PROFILING( m_master_stats.m_num_parks++ );
+        }
+    }
+
+    // process the messages in batch
+    InternalTask message;
+    while(m_queue.pop(message)){
+#if defined(PROFILING)
+        int64_t latency = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - message.m_time_sent).count();
+        m_master_stats.m_num_messages++;
+        m_master_stats.m_message_latency_sum += latency;
+        m_master_stats.m_message_latency_max = std::max(m_master_stats.m_message_latency_max, latency);
+#endif
+        m_inbox.append(message);
+    }
+    IF_PROFILING( m_master_stats.m_num_batches++ );
+    IF_PROFILING( m_master_stats.m_batch_size_max = std::max<int64_t>(m_master_stats.m_batch_size_max, m_inbox.size()) );
+}
+
 void RebalancingMaster::main_thread(){
     COUT_DEBUG("Master node started");
 
     // we promised in the paper that all threads are pinned to the first socket
 #if defined(HAVE_LIBNUMA)
-    pin_thread_to_numa_node(0);
+    pin_thread_to_numa_node(OWNER_NUMA_NODE);
 #endif
 
     bool stop_loop = false;
+    m_stop_requested = false;
+    m_proactive_time = 0;
+    m_proactive_epoch = chrono::steady_clock::now();
     m_thread_pool.start();
+    IF_PROFILING( auto wallclock_t0 = chrono::steady_clock::now() );
+    IF_PROFILING( uint64_t cpu_time_t0 = get_thread_cpu_time() );
+    IF_PROFILING( uint64_t page_faults_t0 = get_thread_page_faults() );
 
     do {
-        InternalTask task;
-
-        { // Fetch the next task from the queue
-            unique_lock<mutex> lock(m_mutex);
-            if(m_queue.empty()){ m_condvar.wait(lock, [this](){ return !m_queue.empty(); }); }
-            assert(!m_queue.empty() && "Precondition not satified: there should be at least one item in the queue at this point");
-            task = m_queue[0];
-            m_queue.pop();
-        }
+        // Fetch the next task from the queue
+        if(m_inbox.empty()){ fetch_messages(); }
+        assert(!m_inbox.empty() && "Precondition not satified: there should be at least one item in the queue at this point");
+        InternalTask task = m_inbox[0];
+        m_inbox.pop();
 
         COUT_DEBUG("Task received: " << task.to_string());
 
@@ -155,6 +237,7 @@ void RebalancingMaster::main_thread(){
             if(!m_resizing && !ignore_lock(gate_id)){
                 RebalancingTask* task = rebal_init(gate_id);
                 if(task != nullptr){ // task == nullptr => ignore this request
+                    IF_PROFILING( m_master_stats.m_requested_rebalances++ );
                     rebal_resume(task);
 
                     // append the task in the list of tasks to execute
@@ -168,6 +251,7 @@ void RebalancingMaster::main_thread(){
         case InternalTask::Type::TaskDone: {
             // a task has been performed by a rebal worker
             RebalancingTask* rebal_task = reinterpret_cast<RebalancingTask*>(task.m_payload);
+            IF_PROFILING( auto task_done_t0 = chrono::steady_clock::now() );
 
             // remove the task from the execution list
             auto it = std::find_if(begin(m_executing), end(m_executing), [rebal_task](const RebalancingTask* task){ return rebal_task == task; });
@@ -184,11 +268,17 @@ void RebalancingMaster::main_thread(){
                         m_todo[i]->m_blocked_on_lock = -1;
                     }
                 }
+#if defined(PROFILING)
+                // a proactive rebalance spared the clients a rebalance if none of them had to wait for it
+                if(rebal_task->m_proactive && count_waiters(rebal_task) == 0){ m_master_stats.m_proactive_avoided++; }
+#endif
                 // 2) unlock the client threads associated to the gates rebalanced
                 for(size_t i = rebal_task->get_lock_start(), end = rebal_task->get_lock_end(); i < end; i++){
                     release_lock(i);
                 }
-                // 3) go through the todo list
+                // 3) return to the OS the buffer space exceeding the budget
+                m_instance->m_storage.trim_buffers(m_instance->m_memory_budget.cap_retained_memory(m_instance->knobs().get_retained_buffer_memory()));
+                // 4) go through the todo list
                 process_todo_list();
             } break;
             case RebalanceOperation::RESIZE:
@@ -209,6 +299,8 @@ void RebalancingMaster::main_thread(){
                     delete rebal_task->m_ptr_storage; rebal_task->m_ptr_storage = nullptr;
                 }
 
+                m_instance->update_memory_budget(); // before the clients can access the new storage
+
                 // 2) Install the new index & the group of locks
                 size_t num_locks_old = rebal_task->m_num_locks;
                 Gate* locks_old = m_instance->m_locks.get_unsafe();
@@ -223,7 +315,7 @@ void RebalancingMaster::main_thread(){
                 m_instance->m_locks.set(locks_new);
                 m_instance->m_index.set(index_new);
                 barrier();
-                m_instance->m_locks.timestamp() = m_instance->m_index.timestamp() = rdtscp();
+                m_instance->m_locks.timestamp() = m_instance->m_index.timestamp() = m_instance->m_thread_contexts.epochs().advance();
 
                 // 3) Invalidate the old locks and unblock the threads
                 for(size_t i = 0; i < num_locks_old; i++){
@@ -237,8 +329,20 @@ void RebalancingMaster::main_thread(){
             default:
                 assert(0 && "Invalid task type");
             }
+
+            IF_PROFILING(auto task_done_t1 = chrono::steady_clock::now());
+            IF_PROFILING(rebal_task->m_statistics.m_master_release_time = chrono::duration_cast<chrono::microseconds>(task_done_t1 - task_done_t0).count());
+            IF_PROFILING(rebal_task->m_statistics.m_master_wallclock_time = chrono::duration_cast<chrono::microseconds>(task_done_t1 - rebal_task->m_statistics.m_time_init).count());
+            IF_PROFILING(m_stats_completed_tasks.push_back(rebal_task->m_statistics));
+
             // release the memory for the task
             delete rebal_task; rebal_task = nullptr;
+
+            // a request to stop was postponed until the completion of the pending tasks
+            if(m_stop_requested && !busy()){
+                m_thread_pool.stop();
+                stop_loop = true;
+            }
         } break;
         case InternalTask::Type::ClientExit: {
             // a client thread has just released a gate/lock
@@ -250,10 +354,13 @@ void RebalancingMaster::main_thread(){
             if(task->ready_for_execution()){ process_todo_list(); }
         } break;
         case InternalTask::Type::Stop: {
-            assert(!m_thread_pool.active() && "Wrong termination order: all client threads must have terminated before invoking this method!");
-            assert(m_executing.size() == 0 && "There should be no jobs on execution");
-            m_thread_pool.stop();
-            stop_loop = true;
+            if(busy()){ // proactive rebalances may still be in progress, terminate once they are completed
+                m_stop_requested = true;
+            } else {
+                assert(!m_thread_pool.active() && "Wrong termination order: all client threads must have terminated before invoking this method!");
+                m_thread_pool.stop();
+                stop_loop = true;
+            }
         } break; // done
         default:
             assert(0 && "Invalid task");
@@ -263,6 +370,10 @@ void RebalancingMaster::main_thread(){
 
     m_thread_pool.stop();
 
+    IF_PROFILING( m_master_stats.m_wallclock_time = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - wallclock_t0).count() );
+    IF_PROFILING( m_master_stats.m_cpu_time = get_thread_cpu_time() - cpu_time_t0 );
+    IF_PROFILING( m_master_stats.m_page_faults = get_thread_page_faults() - page_faults_t0 );
+
     COUT_DEBUG("Master node stopped");
 }
 
@@ -346,6 +457,8 @@ RebalancingTask* RebalancingMaster::rebal_init(uint64_t lock_id){
 
 void RebalancingMaster::rebal_resume(RebalancingTask* task){
     COUT_DEBUG("task: " << task);
+    IF_PROFILING( RebalancingTimer timer { task->m_statistics.m_master_search_time } );
+    IF_PROFILING( task->m_statistics.m_master_num_resumes++ );
     assert(task != nullptr);
 
     const int64_t segments_per_lock = m_instance->get_segments_per_lock();
@@ -427,6 +540,7 @@ void RebalancingMaster::rebal_resume(RebalancingTask* task){
             // merge with an overlapping task?
             if(UNLIKELY(last_sibling != nullptr && last_sibling->is_superset_of(index, 1))){
                 COUT_DEBUG("[rhs] merge with task: " << last_sibling);
+                IF_PROFILING( task->m_statistics.m_master_num_tasks_merged++ );
                 for(size_t i = 0; i < last_sibling->m_wait_to_complete.size(); i++){
                     task->m_wait_to_complete.push_back(last_sibling->m_wait_to_complete[i]);
                 }
@@ -444,6 +558,7 @@ void RebalancingMaster::rebal_resume(RebalancingTask* task){
         while(index >= lock_start){
             if(UNLIKELY(last_sibling != nullptr && last_sibling->is_superset_of(index, 1))){
                 COUT_DEBUG("[lhs] merge with task: " << last_sibling);
+                IF_PROFILING( task->m_statistics.m_master_num_tasks_merged++ );
                 for(size_t i = 0; i < last_sibling->m_wait_to_complete.size(); i++){
                     task->m_wait_to_complete.push_back(last_sibling->m_wait_to_complete[i]);
                 }
@@ -497,6 +612,7 @@ void RebalancingMaster::rebal_resume(RebalancingTask* task){
 
 void RebalancingMaster::launch_task(RebalancingWorker* worker, RebalancingTask* task){
     assert(worker != nullptr && "Null pointer");
+    IF_PROFILING( RebalancingTimer timer { task->m_statistics.m_master_launch_time } );
     assert(task != nullptr && "Null pointer");
     assert(task->ready_for_execution() && "Cannot execute this task yet");
     assert(task->m_plan.m_operation == RebalanceOperation::RESIZE || task->m_plan.m_operation == RebalanceOperation::REBALANCE); // It cannot be REBALANCE_RESIZE at this stage
@@ -542,12 +658,26 @@ void RebalancingMaster::launch_task(RebalancingWorker* worker, RebalancingTask*
         task->m_ptr_locks = Gate::allocate(task->get_lock_length(), m_instance->get_segments_per_lock());
 
         // update the storage
+        IF_PROFILING( uint64_t page_faults_t0 = get_thread_page_faults() );
         if(operation == RebalanceOperation::RESIZE){
-            task->m_ptr_storage = new Storage(m_instance->m_storage.m_segment_capacity, m_instance->m_storage.m_pages_per_extent, task->get_window_length());
+            task->m_ptr_storage = new Storage(m_instance->m_storage.m_segment_capacity, m_instance->m_storage.m_pages_per_extent, task->get_window_length(), m_instance->m_storage.m_key_only);
+            apply_numa_policy(task->m_ptr_storage); // before the workers fill it
         } else { // RebalanceOperation::RESIZE_REBALANCE
             assert(task->m_plan.m_window_length >= m_instance->m_storage.m_number_segments);
-            task->m_ptr_storage->extend(task->m_plan.m_window_length - m_instance->m_storage.m_number_segments);
+            // populate the new extents in a single pass, rather than letting the workers fault them in page by page
+            const bool prefault = m_instance->knobs().get_prefault_buffer_memory() > 0;
+            task->m_ptr_storage->extend(task->m_plan.m_window_length - m_instance->m_storage.m_number_segments, prefault);
         }
+        IF_PROFILING( task->m_statistics.m_master_page_faults = get_thread_page_faults() - page_faults_t0 );
+
+        // profiling statistics
+#if defined(PROFILING)
+        if(task->get_window_length() >= m_instance->m_storage.m_number_segments){
+            task->m_statistics.m_type = RebalancingStatistics::Type::UPSIZE;
+        } else {
+            task->m_statistics.m_type = RebalancingStatistics::Type::DOWNSIZE;
+        }
+#endif
     }
 
 #if defined(DEBUG)
@@ -567,6 +697,13 @@ void RebalancingMaster::launch_task(RebalancingWorker* worker, RebalancingTask*
     }
 #endif
 
+    // rewire or copy back the extents of the window, whatever the cost model deems cheaper
+    const int64_t num_extents = max<int64_t>(1, task->m_plan.m_window_length / m_instance->m_storage.get_segments_per_extent());
+    task->m_use_rewiring = m_instance->m_rewiring_cost.use_rewiring(num_extents);
+
+    IF_PROFILING(task->m_statistics.m_window_length = task->m_plan.m_window_length);
+    IF_PROFILING(task->m_statistics.m_master_use_rewiring = task->m_use_rewiring);
+
     m_executing.push_back(task);
     worker->execute(task);
 }
@@ -574,6 +711,9 @@ void RebalancingMaster::launch_task(RebalancingWorker* worker, RebalancingTask*
 
 void RebalancingMaster::process_todo_list(){
     bool workers_available = true;
+    apply_numa_policy(&(m_instance->m_storage));
+
+    if(m_instance->knobs().get_scheduling_policy() == common::SchedulingPolicy::PRIORITY){ sort_todo_list(); }
 
     // go through the whole list of tasks to be processed
     for(size_t i = 0, sz = m_todo.size(); i < sz; i++){
@@ -587,7 +727,7 @@ void RebalancingMaster::process_todo_list(){
             if(!task->m_rebalancing_window_computed){ rebal_resume(task); }
 
             if(task->ready_for_execution()){
-                RebalancingWorker* worker = m_thread_pool.acquire();
+                RebalancingWorker* worker = m_thread_pool.acquire_on_node(m_instance->m_storage.get_numa_node(task->get_window_start()));
                 if(worker == nullptr){ // there are no threads available at the moment to execute this task
                     workers_available = false;
                 } else {
@@ -604,6 +744,46 @@ void RebalancingMaster::process_todo_list(){
     }
 }
 
+void RebalancingMaster::apply_numa_policy(Storage* storage){
+    const common::NumaPolicy policy = m_instance->knobs().get_numa_policy();
+    storage->set_numa_policy(policy, OWNER_NUMA_NODE);
+    m_thread_pool.set_numa_policy(policy, OWNER_NUMA_NODE);
+}
+
+void RebalancingMaster::sort_todo_list(){
+    if(m_todo.size() <= 1) return; // nop
+    // each millisecond spent in the todo list counts as an additional waiter, so that no task is postponed indefinitely
+    constexpr int64_t AGING_INTERVAL_MICROSECS = 1000;
+    const auto now = chrono::steady_clock::now();
+
+    vector<pair<uint64_t, RebalancingTask*>> tasks;
+    tasks.reserve(m_todo.size());
+    while(!m_todo.empty()){
+        RebalancingTask* task = m_todo[0];
+        m_todo.pop();
+        if(task == nullptr) continue; // merged with another task
+        uint64_t age = chrono::duration_cast<chrono::microseconds>(now - task->m_time_created).count() / AGING_INTERVAL_MICROSECS;
+        tasks.emplace_back(count_waiters(task) + age, task);
+    }
+
+    // in case of ties, keep the order of arrival
+    std::stable_sort(begin(tasks), end(tasks), [](const auto& t1, const auto& t2){ return t1.first > t2.first; });
+    for(auto& t : tasks){ m_todo.append(t.second); }
+}
+
+uint64_t RebalancingMaster::count_waiters(const RebalancingTask* task) const {
+    Gate* gates = m_instance->m_locks.get_unsafe();
+    const int64_t lock_end = std::min<int64_t>(task->get_lock_end(), m_instance->get_number_locks());
+    uint64_t result = 0;
+    for(int64_t lock_id = task->get_lock_start(); lock_id < lock_end; lock_id++){
+        Gate& gate = gates[lock_id];
+        gate.lock();
+        result += gate.m_queue.size();
+        gate.unlock();
+    }
+    return result;
+}
+
 uint64_t RebalancingMaster::acquire_lock(RebalancingTask* task, uint64_t lock_id){
     assert(task != nullptr && "Null pointer");
     assert(task->m_rebalancing_window_computed == false && "Invalid state for the task");
@@ -666,6 +846,88 @@ void RebalancingMaster::cleanup_lock(Gate& gate){
     gate.unlock();
 }
 
+bool RebalancingMaster::proactive_rebalance(){
+    constexpr double PROACTIVE_DENSITY = 0.9; // rebalance a gate when its density reaches 90% of its upper threshold
+    constexpr uint64_t PROACTIVE_GATES_PER_ROUND = 64; // max number of gates to inspect before checking again the command queue
+
+    // only when there is nothing else to do
+    const double budget = m_instance->knobs().get_proactive_budget();
+    if(budget <= 0 || m_resizing || m_stop_requested || !m_todo.empty()) return false;
+    const uint64_t num_locks = m_instance->get_number_locks();
+    if(num_locks < 2) return false; // there is no window larger than a single gate to spread its elements
+    if(m_instance->m_storage.m_number_segments >= 2 * m_instance->balanced_thresholds_cutoff() && (2*m_instance->m_cardinality) < m_instance->m_storage.capacity()){
+        return false; // any task would be turned into a downsize, leave it to the clients
+    }
+    auto t0 = chrono::steady_clock::now();
+    if(m_proactive_time > budget * chrono::duration_cast<chrono::microseconds>(t0 - m_proactive_epoch).count()) return false; // budget exhausted
+
+    // a gate is about to overflow when its density approaches the upper threshold at its height. It also needs to be above the threshold
+    // of its parent window, otherwise the rebalance of the parent would not make room in the gate
+    const uint64_t segments_per_lock = m_instance->get_segments_per_lock();
+    const int height = static_cast<int>(log2(segments_per_lock)) +1;
+    const double theta = std::max(PROACTIVE_DENSITY * m_instance->get_thresholds(height).second, m_instance->get_thresholds(height +1).second);
+    const uint64_t threshold = theta * segments_per_lock * m_instance->m_storage.m_segment_capacity;
+    Gate* gates = m_instance->m_locks.get_unsafe();
+
+    bool task_started = false;
+    for(uint64_t i = 0; i < PROACTIVE_GATES_PER_ROUND && !task_started && m_proactive_num_idle < num_locks; i++){
+        uint64_t gate_id = (m_proactive_cursor++) % num_locks;
+        m_proactive_num_idle++;
+        IF_PROFILING( m_master_stats.m_proactive_gates_inspected++ );
+        if(ignore_lock(gate_id)) continue;
+
+        // close the gate, as a client would do before requesting a rebalance
+        Gate* gate = gates + gate_id;
+        gate->lock();
+        bool rebalance = gate->m_state == Gate::State::FREE && gate->m_cardinality > threshold;
+        if(rebalance){ gate->m_state = Gate::State::REBAL; }
+        gate->unlock();
+        if(!rebalance) continue;
+
+        COUT_DEBUG("proactive rebalance, gate: " << gate_id);
+        RebalancingTask* task = rebal_init(gate_id);
+        assert(task != nullptr && "The gate has just been set in the state REBAL");
+        task->m_proactive = true;
+        rebal_resume(task);
+        m_todo.append(task);
+        process_todo_list();
+
+        m_proactive_num_idle = 0;
+        task_started = true;
+        IF_PROFILING( m_master_stats.m_proactive_rebalances++ );
+    }
+
+    int64_t elapsed = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - t0).count();
+    m_proactive_time += elapsed;
+    IF_PROFILING( m_master_stats.m_proactive_time += elapsed );
+
+    if(!task_started && m_proactive_num_idle >= num_locks){ // a full pass without any gate to rebalance
+        m_proactive_num_idle = 0;
+        return false;
+    }
+
+    return true;
+}
+
+void RebalancingMaster::prefault_buffers(){
+    const uint64_t prefault_memory = m_instance->knobs().get_prefault_buffer_memory();
+    if(prefault_memory == 0 || m_resizing || m_stop_requested) return;
+
+    // beyond the retained memory, the buffers would be returned to the OS at the end of the next rebalance
+    const uint64_t memory = std::min<uint64_t>(prefault_memory, m_instance->m_memory_budget.cap_retained_memory(m_instance->knobs().get_retained_buffer_memory()));
+#if defined(PROFILING)
+    auto t0 = chrono::steady_clock::now();
+    m_master_stats.m_prefault_buffers += m_instance->m_storage.prefault_buffers(memory);
+    m_master_stats.m_prefault_time += chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - t0).count();
+#else
+    m_instance->m_storage.prefault_buffers(memory);
+#endif
+}
+
+bool RebalancingMaster::busy() const {
+    return !m_todo.empty() || !m_executing.empty();
+}
+
 int64_t RebalancingMaster::next_window_length(int64_t current_window_length) const {
     int64_t next_length = hyperceil(current_window_length);
     if(next_length == current_window_length){
@@ -22,13 +22,16 @@
 #include <cstdlib>
 #include <cstring>
 #include <mutex> // debug
+#include <new> // bad_alloc
 #include <numeric>
 #include <stdexcept>
 #include <thread> // debug
+#include <vector>
 
 #include "common/errorhandling.hpp"
 #include "common/miscellaneous.hpp" // hyperceil, get_memory_page_size
 #include "rma/common/buffered_rewired_memory.hpp"
+#include "rma/common/key_compression.hpp"
 #include "rma/common/rewired_memory.hpp"
 
 using namespace common;
@@ -58,25 +61,32 @@ extern mutex _debug_mutex;
  *                                                                           *
  *****************************************************************************/
 
-Storage::Storage(uint64_t segment_size, uint64_t pages_per_extent, uint64_t num_segments) : m_segment_capacity(hyperceil(segment_size)), m_pages_per_extent(pages_per_extent){
-    if(hyperceil(segment_size ) > numeric_limits<uint16_t>::max()) throw std::invalid_argument("segment size too big, maximum is " + std::to_string( numeric_limits<uint16_t>::max() ));
+Storage::Storage(uint64_t segment_size, uint64_t pages_per_extent, uint64_t num_segments, bool key_only) : m_segment_capacity(hyperceil(segment_size)), m_pages_per_extent(pages_per_extent), m_key_only(key_only), m_numa_policy(NumaPolicy::NONE), m_numa_owner(0), m_encoded_segments(nullptr){
+    if(hyperceil(segment_size ) > numeric_limits<segment_size_t>::max()) throw std::invalid_argument("segment size too big, maximum is " + std::to_string( numeric_limits<segment_size_t>::max() ));
     if(m_segment_capacity < 32) throw std::invalid_argument("segment size too small, minimum is 32");
     if(hyperceil(m_pages_per_extent) != m_pages_per_extent) throw std::invalid_argument("pages per extent must be a value from a power of 2");
-    if(get_memory_page_size() % (m_segment_capacity * sizeof(m_keys[0])) != 0) throw std::invalid_argument("segment capacity must be a divisor of the virtual page size");
+    if((m_pages_per_extent * get_memory_page_size()) % (m_segment_capacity * sizeof(m_keys[0])) != 0) throw std::invalid_argument("segment capacity must be a divisor of the extent size");
 
     m_number_segments = num_segments;
 
     // memory allocations
     alloc_workspace(num_segments, &m_keys, &m_values, &m_segment_sizes, &m_memory_keys, &m_memory_values, &m_memory_sizes);
+    m_encoded_segments = (uint8_t*) calloc(max<size_t>(2, num_segments), sizeof(m_encoded_segments[0]));
+    if(m_encoded_segments == nullptr){
+        dealloc_workspace(&m_keys, &m_values, &m_segment_sizes, &m_memory_keys, &m_memory_values, &m_memory_sizes);
+        throw std::bad_alloc();
+    }
 }
 
 Storage::~Storage(){
     dealloc_workspace(&m_keys, &m_values, &m_segment_sizes, &m_memory_keys, &m_memory_values, &m_memory_sizes);
+    free(m_encoded_segments); m_encoded_segments = nullptr;
 }
 
 Storage& Storage::operator=(Storage&& storage){
     assert(storage.m_segment_capacity == storage.m_segment_capacity);
     assert(storage.m_pages_per_extent == storage.m_pages_per_extent);
+    assert(m_key_only == storage.m_key_only);
     dealloc_workspace(&m_keys, &m_values, &m_segment_sizes, &m_memory_keys, &m_memory_values, &m_memory_sizes);
 
     m_keys = storage.m_keys; storage.m_keys = nullptr;
@@ -86,6 +96,10 @@ Storage& Storage::operator=(Storage&& storage){
     m_memory_keys = storage.m_memory_keys; storage.m_memory_keys = nullptr;
     m_memory_values = storage.m_memory_values; storage.m_memory_values = nullptr;
     m_memory_sizes = storage.m_memory_sizes; storage.m_memory_sizes = nullptr;
+    m_numa_policy = storage.m_numa_policy; storage.m_numa_policy = NumaPolicy::NONE;
+    m_numa_owner = storage.m_numa_owner;
+    free(m_encoded_segments);
+    m_encoded_segments = storage.m_encoded_segments; storage.m_encoded_segments = nullptr;
 
     return *this;
 }
@@ -119,10 +133,12 @@ void Storage::alloc_workspace(size_t num_segments, int64_t** keys, int64_t** val
 
         *rewired_memory_keys = new BufferedRewiredMemory(m_pages_per_extent, elts_num_extents);
         *keys = (int64_t*) (*rewired_memory_keys)->get_start_address();
-        *rewired_memory_values = new BufferedRewiredMemory(m_pages_per_extent, elts_num_extents);
-        *values = (int64_t*) (*rewired_memory_values)->get_start_address();
-        *rewired_memory_cardinalities = new RewiredMemory(m_pages_per_extent, card_num_extents, (*rewired_memory_keys)->get_max_memory() * sizeof(uint16_t) / sizeof(int64_t));
-        *sizes = (uint16_t*) (*rewired_memory_cardinalities)->get_start_address();
+        if(!m_key_only){
+            *rewired_memory_values = new BufferedRewiredMemory(m_pages_per_extent, elts_num_extents);
+            *values = (int64_t*) (*rewired_memory_values)->get_start_address();
+        }
+        *rewired_memory_cardinalities = new RewiredMemory(m_pages_per_extent, card_num_extents, (*rewired_memory_keys)->get_max_memory() * sizeof(segment_size_t) / sizeof(int64_t));
+        *sizes = (segment_size_t*) (*rewired_memory_cardinalities)->get_start_address();
     } else {
         COUT_DEBUG("posix_memalign with " << num_segments << " segments (" << elts_space_required_bytes << " bytes)");
 
@@ -132,10 +148,12 @@ void Storage::alloc_workspace(size_t num_segments, int64_t** keys, int64_t** val
             RAISE_EXCEPTION(Exception, "[Storage::alloc_workspace] It cannot obtain a chunk of aligned memory. " <<
                     "Requested size: " << elts_space_required_bytes);
         }
-        rc = posix_memalign((void**) values, /* alignment */ 64,  /* size */ elts_space_required_bytes);
-        if(rc != 0) {
-            RAISE_EXCEPTION(Exception, "[Storage::alloc_workspace] It cannot obtain a chunk of aligned memory. " <<
-                    "Requested size: " << elts_space_required_bytes);
+        if(!m_key_only){
+            rc = posix_memalign((void**) values, /* alignment */ 64,  /* size */ elts_space_required_bytes);
+            if(rc != 0) {
+                RAISE_EXCEPTION(Exception, "[Storage::alloc_workspace] It cannot obtain a chunk of aligned memory. " <<
+                        "Requested size: " << elts_space_required_bytes);
+            }
         }
 
         rc = posix_memalign((void**) sizes, /* alignment */ 64,  /* size */ card_space_required_bytes);
@@ -152,10 +170,10 @@ void Storage::alloc_workspace(size_t num_segments, int64_t** keys, int64_t** val
     onError.release(); // avoid invoking dealloc_workspace, the memory has been (apparently) allocated
 }
 
-void Storage::extend(size_t num_segments_to_add){
+void Storage::extend(size_t num_segments_to_add, bool prefault){
     COUT_DEBUG("num_segments_to_add: " << num_segments_to_add << ", page size: " << get_memory_page_size());
     assert(m_memory_keys != nullptr);
-    assert(m_memory_values != nullptr);
+    assert((m_key_only || m_memory_values != nullptr) && "The memory for the values should have been allocated");
     assert(m_memory_sizes != nullptr);
 
     const size_t bytes_per_segment = m_segment_capacity * sizeof(m_keys[0]);
@@ -186,19 +204,23 @@ void Storage::extend(size_t num_segments_to_add){
     COUT_DEBUG("[after] segments: " << num_segments_after << ", elts extents: " << elts_num_extents_total << ", card extents: " << sizes_num_extents_total);
 
     if (elts_num_extents_required > 0){
-        m_memory_keys->extend(elts_num_extents_required);
-        m_memory_values->extend(elts_num_extents_required);
+        m_memory_keys->extend(elts_num_extents_required, prefault);
+        if(!m_key_only) m_memory_values->extend(elts_num_extents_required, prefault);
     }
     if(sizes_num_extents_required > 0){
         m_memory_sizes->extend(sizes_num_extents_required);
+        if(m_numa_policy != NumaPolicy::NONE){ // the arrays for the keys & values already re-apply their policy on their own
+            m_memory_sizes->set_numa_policy(m_memory_sizes->get_start_address(), m_memory_sizes->get_allocated_extents(), m_numa_policy, m_numa_owner);
+        }
     }
 
     m_keys = (int64_t*) m_memory_keys->get_start_address();
-    m_values = (int64_t*) m_memory_values->get_start_address();
-    m_segment_sizes = (uint16_t*) m_memory_sizes->get_start_address();
+    if(!m_key_only) m_values = (int64_t*) m_memory_values->get_start_address();
+    m_segment_sizes = (segment_size_t*) m_memory_sizes->get_start_address();
 
     // update the properties
     m_number_segments = num_segments_after;
+    resize_encoded_segments(num_segments_before);
 }
 
 void Storage::dealloc_workspace(int64_t** keys, int64_t** values, decltype(m_segment_sizes)* sizes, BufferedRewiredMemory** rewired_memory_keys, BufferedRewiredMemory** rewired_memory_values, RewiredMemory** rewired_memory_cardinalities){
@@ -267,9 +289,181 @@ int64_t Storage::get_minimum(size_t segment_id) const noexcept {
 
 size_t Storage::memory_footprint() const noexcept {
     size_t memory_keys = m_memory_keys != nullptr ? m_memory_keys->get_allocated_memory_size() : capacity() * sizeof(m_keys[0]);
-    size_t memory_values = m_memory_values != nullptr ? m_memory_values->get_allocated_memory_size() : capacity() * sizeof(m_values[0]);
+    size_t memory_values = m_key_only ? 0 : m_memory_values != nullptr ? m_memory_values->get_allocated_memory_size() : capacity() * sizeof(m_values[0]);
     size_t memory_sizes = m_memory_sizes != nullptr ? m_memory_sizes->get_allocated_memory_size() : capacity() * sizeof(m_segment_sizes[0]);
     return memory_keys + memory_values + memory_sizes;
 }
 
+size_t Storage::memory_footprint_resident() const {
+    size_t memory_keys = m_memory_keys != nullptr ? m_memory_keys->get_resident_memory_size() : capacity() * sizeof(m_keys[0]);
+    size_t memory_values = m_key_only ? 0 : m_memory_values != nullptr ? m_memory_values->get_resident_memory_size() : capacity() * sizeof(m_values[0]);
+    size_t memory_sizes = m_memory_sizes != nullptr ? m_memory_sizes->get_resident_memory_size() : capacity() * sizeof(m_segment_sizes[0]);
+    return memory_keys + memory_values + memory_sizes;
+}
+
+void Storage::trim_buffers(size_t retained_memory){
+    if(m_memory_keys == nullptr) return; // the storage does not use rewired memory
+    assert(m_key_only || m_memory_values != nullptr);
+
+    scoped_lock<decltype(m_mutex)> lock(m_mutex);
+    const size_t num_columns = m_key_only ? 1 : 2; /* keys & values */
+    const size_t num_buffers = retained_memory / (num_columns * m_memory_keys->get_extent_size());
+    m_memory_keys->set_retained_buffers(num_buffers);
+    m_memory_keys->trim();
+    if(!m_key_only){
+        m_memory_values->set_retained_buffers(num_buffers);
+        m_memory_values->trim();
+    }
+}
+
+size_t Storage::prefault_buffers(size_t memory){
+    if(m_memory_keys == nullptr) return 0; // the storage does not use rewired memory
+    assert(m_key_only || m_memory_values != nullptr);
+
+    vector<pair<void*, size_t>> runs;
+    { // the workers acquiring their buffers only wait for the selection, not for the page faults
+        scoped_lock<decltype(m_mutex)> lock(m_mutex);
+        const size_t num_columns = m_key_only ? 1 : 2; /* keys & values */
+        const size_t num_buffers = memory / (num_columns * m_memory_keys->get_extent_size());
+        runs = m_memory_keys->select_prefault_buffers(num_buffers);
+        if(!m_key_only){
+            auto runs_values = m_memory_values->select_prefault_buffers(num_buffers);
+            runs.insert(end(runs), begin(runs_values), end(runs_values));
+        }
+    }
+
+    // a worker may already be filling or rewiring these buffers, populating them never alters their content
+    size_t num_prefaulted = 0;
+    for(auto& run : runs){
+        RewiredMemory::populate(run.first, run.second);
+        num_prefaulted += run.second / m_memory_keys->get_extent_size();
+    }
+    return num_prefaulted;
+}
+
+void Storage::set_numa_policy(NumaPolicy policy, int owner_node){
+    if(m_memory_keys == nullptr) return; // the storage does not use rewired memory
+    if(policy == m_numa_policy && owner_node == m_numa_owner) return; // nop
+
+    scoped_lock<decltype(m_mutex)> lock(m_mutex);
+    m_memory_keys->set_numa_policy(policy, owner_node);
+    if(!m_key_only) m_memory_values->set_numa_policy(policy, owner_node);
+    m_memory_sizes->set_numa_policy(m_memory_sizes->get_start_address(), m_memory_sizes->get_allocated_extents(), policy, owner_node);
+    m_numa_policy = policy;
+    m_numa_owner = owner_node;
+}
+
+int Storage::get_numa_node(size_t segment_id) const noexcept {
+    if(m_memory_keys == nullptr) return -1;
+    return m_memory_keys->get_numa_node(segment_id / get_segments_per_extent());
+}
+
+/*****************************************************************************
+ *                                                                           *
+ *   Key compression                                                         *
+ *                                                                           *
+ *****************************************************************************/
+namespace {
+// scratch space to encode & decode a segment in place, as large as a segment
+thread_local vector<int64_t> g_codec_buffer;
+int64_t* codec_buffer(size_t segment_capacity){
+    if(g_codec_buffer.size() < segment_capacity){ g_codec_buffer.resize(segment_capacity); }
+    return g_codec_buffer.data();
+}
+} // anonymous namespace
+
+void Storage::encode(size_t window_start, size_t window_length){
+    const size_t window_end = min<size_t>(window_start + window_length, m_number_segments);
+    for(size_t segment_id = window_start; segment_id < window_end; segment_id++){
+        if(m_encoded_segments[segment_id]) continue; // already compressed
+
+        size_t size = m_segment_sizes[segment_id];
+        int64_t* keys = m_keys + segment_id * m_segment_capacity + (segment_id %2 == 0 ? m_segment_capacity - size : 0);
+        size_t encoded_size = KeyCompression::compressed_size(size, KeyCompression::bit_width(keys, size));
+        if(encoded_size >= size) continue; // not worth it, this also skips the empty segments
+
+        uint64_t* buffer = reinterpret_cast<uint64_t*>(codec_buffer(m_segment_capacity));
+        KeyCompression::encode(keys, size, buffer);
+        memcpy(keys, buffer, encoded_size * sizeof(buffer[0]));
+        m_encoded_segments[segment_id] = 1;
+    }
+}
+
+void Storage::decode(size_t window_start, size_t window_length){
+    const size_t window_end = min<size_t>(window_start + window_length, m_number_segments);
+    for(size_t segment_id = window_start; segment_id < window_end; segment_id++){
+        if(!m_encoded_segments[segment_id]) continue;
+
+        size_t size = m_segment_sizes[segment_id];
+        int64_t* keys = m_keys + segment_id * m_segment_capacity + (segment_id %2 == 0 ? m_segment_capacity - size : 0);
+        int64_t* buffer = codec_buffer(m_segment_capacity);
+        KeyCompression::decode(reinterpret_cast<uint64_t*>(keys), size, buffer);
+        memcpy(keys, buffer, size * sizeof(buffer[0]));
+        m_encoded_segments[segment_id] = 0;
+    }
+}
+
+void Storage::get_keys(size_t segment_id, int64_t* output) const noexcept {
+    size_t size = m_segment_sizes[segment_id];
+    int64_t* keys = m_keys + segment_id * m_segment_capacity + (segment_id %2 == 0 ? m_segment_capacity - size : 0);
+    if(m_encoded_segments[segment_id]){
+        KeyCompression::decode(reinterpret_cast<uint64_t*>(keys), size, output);
+    } else {
+        memcpy(output, keys, size * sizeof(keys[0]));
+    }
+}
+
+int64_t Storage::get_key(size_t segment_id, size_t position) const noexcept {
+    size_t size = m_segment_sizes[segment_id];
+    assert(position < size && "Invalid position");
+    int64_t* keys = m_keys + segment_id * m_segment_capacity + (segment_id %2 == 0 ? m_segment_capacity - size : 0);
+    if(m_encoded_segments[segment_id]){
+        return KeyCompression::get(reinterpret_cast<uint64_t*>(keys), position);
+    } else {
+        return keys[position];
+    }
+}
+
+int64_t Storage::find_key(size_t segment_id, int64_t key) const noexcept {
+    size_t size = m_segment_sizes[segment_id];
+    int64_t* keys = m_keys + segment_id * m_segment_capacity + (segment_id %2 == 0 ? m_segment_capacity - size : 0);
+    if(m_encoded_segments[segment_id]){
+        const uint64_t* input = reinterpret_cast<uint64_t*>(keys);
+        uint64_t position = KeyCompression::lower_bound(input, size, key);
+        return (position < size && KeyCompression::get(input, position) == key) ? position : -1;
+    } else {
+        for(size_t i = 0; i < size; i++){
+            if(keys[i] == key) return i;
+        }
+        return -1;
+    }
+}
+
+void Storage::resize_encoded_segments(size_t num_segments_before){
+    const size_t num_slots_before = max<size_t>(2, num_segments_before);
+    const size_t num_slots_after = max<size_t>(2, m_number_segments);
+    if(num_slots_before == num_slots_after) return;
+
+    uint8_t* encoded_segments = (uint8_t*) realloc(m_encoded_segments, num_slots_after * sizeof(m_encoded_segments[0]));
+    if(encoded_segments == nullptr) throw std::bad_alloc();
+    m_encoded_segments = encoded_segments;
+    if(num_slots_after > num_slots_before){
+        memset(m_encoded_segments + num_slots_before, 0, (num_slots_after - num_slots_before) * sizeof(m_encoded_segments[0]));
+    }
+}
+
+size_t Storage::key_footprint() const noexcept {
+    size_t num_words = 0;
+    for(size_t segment_id = 0; segment_id < m_number_segments; segment_id++){
+        size_t size = m_segment_sizes[segment_id];
+        if(m_encoded_segments[segment_id]){
+            const uint64_t* input = reinterpret_cast<uint64_t*>(m_keys + segment_id * m_segment_capacity + (segment_id %2 == 0 ? m_segment_capacity - size : 0));
+            num_words += KeyCompression::compressed_size(size, /* bit width */ input[1]);
+        } else {
+            num_words += size;
+        }
+    }
+    return num_words * sizeof(m_keys[0]);
+}
+
 } // namespace
@@ -24,6 +24,7 @@
 namespace data_structures::rma::common {
 class RewiredMemory; // forward decl.
 class BufferedRewiredMemory; // forward decl.
+enum class NumaPolicy; // forward decl.
 }
 
 namespace data_structures::rma::baseline {
@@ -36,23 +37,29 @@ struct Storage {
     Storage& operator=(const Storage& storage) = delete;
 
     int64_t* m_keys; // pma for the keys
-    int64_t* m_values; // pma for the values
-    uint16_t* m_segment_sizes; // array, containing the cardinalities of each segment
-    const uint16_t m_segment_capacity; // the max number of elements in a segment
+    int64_t* m_values; // pma for the values, nullptr in key-only mode
+    using segment_size_t = uint32_t; // the type for the cardinality of a segment, it bounds the capacity of a segment
+    segment_size_t* m_segment_sizes; // array, containing the cardinalities of each segment
+    const segment_size_t m_segment_capacity; // the max number of elements in a segment
     uint32_t m_number_segments; // the total number of segments, i.e. capacity / segment_size
     const size_t m_pages_per_extent; // number of virtual pages per extent, used in the RewiredMemory
+    const bool m_key_only; // whether to store only the keys, as a set. The value of each element is implicitly its own key
     data_structures::rma::common::BufferedRewiredMemory* m_memory_keys = nullptr; // memory space used for the keys
     data_structures::rma::common::BufferedRewiredMemory* m_memory_values = nullptr; // memory space used for the values
     data_structures::rma::common::RewiredMemory* m_memory_sizes = nullptr; // memory space used for the segment cardinalities
     mutable std::mutex m_mutex; // used to protect rewiring by usage of multiple workers
+    data_structures::rma::common::NumaPolicy m_numa_policy; // current placement of the arrays among the NUMA nodes
+    int m_numa_owner; // the node where the arrays are bound with NumaPolicy::OWNER
+    uint8_t* m_encoded_segments; // array, whether the keys of each segment are compressed with the KeyCompression codec
 
 public:
     /**
      * Create the underlying arrays to store the elements
      * @param segment_size: the capacity, in terms of number of elements, of a single segment of the array. That is: the block size.
      * @param pages_per_extent: the number of virtual pages to form an extent. An extent is the minimum granularity for the rewiring
+     * @param key_only: if true, do not allocate the array for the values
      */
-    Storage(uint64_t segment_size, uint64_t pages_per_extents =1, uint64_t num_segments =1);
+    Storage(uint64_t segment_size, uint64_t pages_per_extents =1, uint64_t num_segments =1, bool key_only = false);
 
     /**
      * Move constructor
@@ -65,7 +72,7 @@ public:
     ~Storage();
 
     /**
-     * Allocate the space to hold `num_segments'
+     * Allocate the space to hold `num_segments'. In key-only mode, both `values' and `rewired_memory_values' are set to nullptr
      */
     void alloc_workspace(size_t num_segments, int64_t** keys, int64_t** values, decltype(m_segment_sizes)* sizes, data_structures::rma::common::BufferedRewiredMemory** rewired_memory_keys, data_structures::rma::common::BufferedRewiredMemory** rewired_memory_values, data_structures::rma::common::RewiredMemory** rewired_memory_cardinalities);
 
@@ -76,8 +83,9 @@ public:
 
     /**
      * Extend the arrays for the keys/values/cardinalities by `num_segments' additional segments
+     * @param prefault whether to populate the page tables of the new extents for the keys & values, before the workers fill them
      */
-    void extend(size_t num_segments);
+    void extend(size_t num_segments, bool prefault = false);
 
     /**
      * Retrieve the number of segments per extent
@@ -110,9 +118,85 @@ public:
     int64_t get_minimum(size_t segment_id) const noexcept;
 
     /**
-     * Retrieve the memory footprint used by the storage
+     * Check whether the keys of the given segment are compressed
+     */
+    bool is_encoded(size_t segment_id) const noexcept;
+
+    /**
+     * Compress the keys of the segments in [window_start, window_start + window_length) that take less space with the
+     * KeyCompression codec. The encoding is stored in place of the keys, from the first slot used by the segment, so that
+     * the first word is still the minimum of the segment. The values are not altered, the i-th value of a segment is still
+     * associated to its i-th key. The caller must have exclusive access to the window.
+     */
+    void encode(size_t window_start, size_t window_length);
+
+    /**
+     * Restore the plain keys of the compressed segments in [window_start, window_start + window_length). The caller must
+     * have exclusive access to the window.
+     */
+    void decode(size_t window_start, size_t window_length);
+
+    /**
+     * Copy the keys of the given segment into `output', decompressing them if required
+     */
+    void get_keys(size_t segment_id, int64_t* output) const noexcept;
+
+    /**
+     * Retrieve the key at the given position of the segment, with 0 being the first key of the segment
+     */
+    int64_t get_key(size_t segment_id, size_t position) const noexcept;
+
+    /**
+     * Retrieve the position of the given key in the segment, with 0 being the first key of the segment, or -1 if not present
+     */
+    int64_t find_key(size_t segment_id, int64_t key) const noexcept;
+
+    /**
+     * Resize the array of the compressed segments to the current number of segments. The segments beyond
+     * `num_segments_before' are marked as not compressed.
+     */
+    void resize_encoded_segments(size_t num_segments_before);
+
+    /**
+     * Retrieve the amount of space, in bytes, actually taken by the keys, that is the bytes a full scan needs to read
+     */
+    size_t key_footprint() const noexcept;
+
+    /**
+     * Return to the OS the physical memory of the free buffers exceeding `retained_memory' bytes, for both
+     * the keys and the values. It acquires the lock on the storage.
+     */
+    void trim_buffers(size_t retained_memory);
+
+    /**
+     * Keep populated `memory' bytes of free buffer space, for both the keys and the values, ahead of the next rebalances. It
+     * acquires the lock on the storage only to select the buffers, they are populated after the lock has been released.
+     * @return the number of buffers populated by this invocation
+     */
+    size_t prefault_buffers(size_t memory);
+
+    /**
+     * Place the arrays among the NUMA nodes according to the given policy. It is a nop if the policy is already
+     * in place or the storage does not use rewired memory. It acquires the lock on the storage.
+     */
+    void set_numa_policy(data_structures::rma::common::NumaPolicy policy, int owner_node);
+
+    /**
+     * Retrieve the NUMA node where the given segment is bound, or -1 if it is not bound to a single node
+     */
+    int get_numa_node(size_t segment_id) const noexcept;
+
+    /**
+     * Retrieve the memory footprint used by the storage, that is the memory reserved including the buffer space
      */
     size_t memory_footprint() const noexcept;
+
+    /**
+     * Retrieve the amount of physical memory actually resident for the storage
+     */
+    size_t memory_footprint_resident() const;
 };
 
+inline bool Storage::is_encoded(size_t segment_id) const noexcept { return m_encoded_segments[segment_id]; }
+
 } // namespace
@@ -54,7 +54,10 @@ extern mutex _debug_mutex; // PackedMemoryArray.cpp
  *                                                                           *
  *****************************************************************************/
 ThreadContextList::ThreadContextList() {
-
+    for(uint64_t i = 0; i < m_capacity; i++){
+        m_contexts[i].m_epochs = &m_epochs;
+        m_contexts[i].m_epoch_slot = i;
+    }
 }
 
 ThreadContextList::~ThreadContextList() {
@@ -82,6 +85,7 @@ void ThreadContextList::resize(uint64_t size){
         }
     }
     m_size = size;
+    m_epochs.resize(size);
 }
 
 ThreadContext* ThreadContextList::operator[](uint64_t index) const {
@@ -90,12 +94,11 @@ ThreadContext* ThreadContextList::operator[](uint64_t index) const {
 }
 
 uint64_t ThreadContextList::min_epoch() const {
-    uint64_t min_epoch = numeric_limits<uint64_t>::max();
-    scoped_lock<mutex> lock(m_mutex); // this is going to be used only by the garbage collector, it's okay to lock here
-    for(uint64_t i =0; i < m_size; i++){
-        min_epoch = std::min(min_epoch, m_contexts[i].epoch());
-    }
-    return min_epoch;
+    return m_epochs.min_epoch();
+}
+
+EpochManager& ThreadContextList::epochs() const {
+    return const_cast<EpochManager&>(m_epochs);
 }
 
 /*****************************************************************************
@@ -104,7 +107,7 @@ uint64_t ThreadContextList::min_epoch() const {
  *                                                                           *
  *****************************************************************************/
 
-ThreadContext::ThreadContext() : m_timestamp(numeric_limits<uint64_t>::max()), m_hosted(false), m_spurious_wake(false) { }
+ThreadContext::ThreadContext() : m_epochs(nullptr), m_epoch_slot(0), m_hosted(false), m_spurious_wake(false) { }
 
 ThreadContext::~ThreadContext() {
     assert(!busy());
@@ -129,15 +132,15 @@ bool ThreadContext::busy() const {
 }
 
 void ThreadContext::hello() noexcept {
-    m_timestamp = rdtscp(); // cpu clock
+    m_epochs->enter(m_epoch_slot);
 }
 
 void ThreadContext::bye() noexcept {
-    m_timestamp = numeric_limits<uint64_t>::max();
+    m_epochs->exit(m_epoch_slot);
 }
 
 uint64_t ThreadContext::epoch() const noexcept {
-    return m_timestamp;
+    return m_epochs->epoch(m_epoch_slot);
 }
 
 void ThreadContext::register_thread(int thread_id){
@@ -22,6 +22,8 @@
 #include <mutex>
 #include <vector>
 
+#include "common/epoch_manager.hpp"
+
 namespace data_structures::rma::baseline {
 
 // Forward declarations
@@ -34,7 +36,8 @@ friend class ThreadContextList;
 private:
 //    union {
 //        struct {
-            uint64_t m_timestamp; // the current timestamp (or epoch) for the current thread. Only utilised for the purposes of the Garbage Collector
+            ::common::EpochManager* m_epochs; // the epochs announced by the threads. Only utilised for the purposes of the Garbage Collector
+            uint64_t m_epoch_slot; // the slot in m_epochs where this context announces its epoch
             bool m_hosted; // whether a thread owns this context
             mutable std::mutex m_mutex; // auxiliary mutex for the condition variable. It's acquired when a thread is operating
             std::condition_variable_any m_condition_variable; // auxiliary cond. variable to block this thread when an extent is full
@@ -83,12 +86,12 @@ public:
     uint64_t epoch() const noexcept;
 
     /**
-     * Set the current timestamp for the current (worker) thread
+     * Announce the current global epoch for the current (worker) thread
      */
     void hello() noexcept;
 
     /**
-     * Remove the timestamp for the current (worker) thread
+     * Remove the epoch announced by the current (worker) thread
      */
     void bye() noexcept;
 
@@ -108,8 +111,9 @@ public:
  * A safe enough list of thread contexts
  */
 class ThreadContextList {
-    constexpr static uint64_t m_capacity = 128;
+    constexpr static uint64_t m_capacity = ::common::EpochManager::MAX_NUM_SLOTS;
     uint64_t m_size = 0;
+    ::common::EpochManager m_epochs; // it must outlive the contexts
     ThreadContext m_contexts[m_capacity];
     mutable std::mutex m_mutex;
 
@@ -125,6 +129,9 @@ public:
     ThreadContext* operator[](uint64_t index) const;
 
     uint64_t min_epoch() const;
+
+    // The global epoch and the announcements of the threads
+    ::common::EpochManager& epochs() const;
 };
 
 /**
@@ -22,6 +22,7 @@
 #include <vector>
 
 #include "rma/common/memory_pool.hpp"
+#include "storage.hpp"
 
 namespace data_structures::rma::baseline {
 
@@ -29,7 +30,7 @@ class PackedMemoryArray; // forward declaration
 
 struct Interval {
     uint32_t m_start;
-    uint16_t m_length;
+    uint32_t m_length;
     int16_t m_weight;
     int32_t m_associated_segment;
 
@@ -52,7 +53,7 @@ using VectorOfIntervals = std::vector<Interval, common::CachedAllocator<Interval
 class Weights {
 private:
     PackedMemoryArray& m_pma;
-    const uint16_t* m_cardinalities;
+    const Storage::segment_size_t* m_cardinalities;
     const size_t m_segment_start;
     const size_t m_segment_length;
 //    const double m_threshold;
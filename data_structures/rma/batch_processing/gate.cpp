@@ -53,6 +53,8 @@ extern mutex _debug_mutex; // PackedMemoryArray.cpp
 Gate::Gate(uint32_t window_start, uint32_t window_length) : m_window_start(window_start), m_window_length(window_length), m_queue(/* initial capacity */ 2) {
     m_num_active_threads = 0;
     m_cardinality = 0;
+    m_cardinality_last_rebal = 0;
+    m_rebal_delay = std::chrono::microseconds::zero();
     m_fence_low_key = m_fence_high_key = numeric_limits<int64_t>::min();
     m_separator_keys = nullptr; // needs to be set eventually
     m_async_queue = nullptr;
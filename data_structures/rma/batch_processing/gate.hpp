@@ -42,7 +42,7 @@ public:
         FREE, // no threads are operating on this gate
         READ, // one or more readers are active on this gate
         WRITE, // one & only one writer is active on this gate
-        TIMEOUT, // set by the timer manager on an occupied gate, the last reader/writer must ask to rebalance the gate
+        TIMEOUT, // set by the rebalancer when the delay of a rebalance expires on an occupied gate, the last reader/writer must ask to rebalance the gate
         REBAL, // this gate is closed and it's currently being rebalanced
     };
     State m_state = State::FREE; // whether reader/writer/rebalancing in progress?
@@ -57,6 +57,8 @@ public:
     int64_t m_fence_high_key; // the maximum key that can be stored in this gate (exclusive)
     ClientContextQueue* m_async_queue; // queue to add/remove elements asynchronously
     std::chrono::steady_clock::time_point m_time_last_rebal; // the last time this gate was rebalanced
+    uint32_t m_cardinality_last_rebal; // the cardinality of this gate after its last rebalance, to estimate its update rate
+    std::chrono::microseconds m_rebal_delay; // minimum amount of time that must pass since the last rebalance before the master can rebalance this gate again
 
     struct SleepingBeauty{
         State m_purpose; // either read or write
@@ -216,7 +216,7 @@ void Iterator::fetch_next_chunk(){
 
     auto next_segment_id = (m_stop / m_pma->m_storage.m_segment_capacity) +1;
     if(next_segment_id % 2 == 1) return; // it means the stop offset has been moved from its fixed position due to reaching the maximum of the interval
-    if(next_segment_id > m_pma->m_storage.m_number_segments) return; // depleted
+    if(next_segment_id >= m_pma->m_storage.m_number_segments) return; // depleted
     if(next_segment_id % m_pma->get_segments_per_lock() == 0){
         // move to the next lock
         release_lock();
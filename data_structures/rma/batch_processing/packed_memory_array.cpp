@@ -33,7 +33,6 @@
 #include "iterator.hpp"
 #include "rebalancing_master.hpp"
 #include "thread_context.hpp"
-#include "timer_manager.hpp"
 
 using namespace common;
 using namespace data_structures::rma::common;
@@ -61,16 +60,17 @@ mutex _debug_mutex;
  *                                                                           *
  *****************************************************************************/
 
-PackedMemoryArray::PackedMemoryArray(size_t btree_block_size, size_t pma_segment_size, size_t pages_per_extent, size_t num_worker_threads, size_t segments_per_lock, chrono::milliseconds delay_rebalance) :
+PackedMemoryArray::PackedMemoryArray(size_t btree_block_size, size_t pma_segment_size, size_t pages_per_extent, size_t num_worker_threads, size_t segments_per_lock, chrono::milliseconds delay_rebalance, chrono::milliseconds delay_rebalance_max) :
         m_storage(pma_segment_size, pages_per_extent),
         m_index(new StaticIndex(btree_block_size)),
         m_locks(Gate::allocate(1, segments_per_lock)),
         m_density_bounds1(0, 0.75, 0.75, 1), /* there is rationale for these hardwired thresholds */
+        m_rewiring_cost(common::RewiringCostModel::calibrated(pages_per_extent)),
         m_rebalancer(new RebalancingMaster{ this, num_worker_threads } ),
         m_garbage_collector( new GarbageCollector(this) ),
-        m_timer_manager( new TimerManager(this) ),
         m_segments_per_lock(segments_per_lock),
-        m_delayed_rebalance(delay_rebalance){
+        m_delayed_rebalance(delay_rebalance),
+        m_delayed_rebalance_max(max(delay_rebalance, delay_rebalance_max)){
     if(!is_power_of_2(segments_per_lock)) throw std::invalid_argument("[PackedMemoryArray::ctor] Invalid value for the `segments_per_lock', it is not a power of 2");
     if(segments_per_lock < 2) throw std::invalid_argument("[PackedMemoryArray::ctor] Invalid value for the `segments_per_lock', it must be >= 2");
     if(segments_per_lock > 256) throw std::invalid_argument("[PackedMemoryArray::ctor] This implementation does not support more than 256 segments per lock/gate, due to the implmentation limit of std::bitset<256> in ClientContext");
@@ -79,6 +79,7 @@ PackedMemoryArray::PackedMemoryArray(size_t btree_block_size, size_t pma_segment
 
     // set the init time for the gates
     m_locks.get_unsafe()->m_time_last_rebal = chrono::steady_clock::now();
+    m_locks.get_unsafe()->m_rebal_delay = m_delayed_rebalance;
 
     // start the garbage collector
     GC()->start();
@@ -86,9 +87,6 @@ PackedMemoryArray::PackedMemoryArray(size_t btree_block_size, size_t pma_segment
     // start the rebalancer
     m_rebalancer->start();
 
-    // start the timer manager
-    m_timer_manager->start();
-
     // by default allow one thread to run
     m_thread_contexts.resize(1);
 
@@ -97,9 +95,6 @@ PackedMemoryArray::PackedMemoryArray(size_t btree_block_size, size_t pma_segment
 
 
 PackedMemoryArray::~PackedMemoryArray() {
-    // stop the timer manager (impl. called by the dtor)
-    delete m_timer_manager; m_timer_manager = nullptr;
-
     // stop the rebalancer
     delete m_rebalancer; m_rebalancer = nullptr;
 
@@ -360,10 +355,9 @@ bool PackedMemoryArray::writer_on_exit(Gate* gate, int64_t cardinality_change, b
             context->queue_new();
 
             auto now = chrono::steady_clock::now();
-            if(now < gate->m_time_last_rebal + m_delayed_rebalance){ // delay this rebalance
+            if(now < gate->m_time_last_rebal + gate->m_rebal_delay){ // delay this rebalance
                 gate->m_state = Gate::State::FREE;
-                auto delay_usecs = chrono::duration_cast<chrono::microseconds>(gate->m_time_last_rebal + m_delayed_rebalance - now);
-                m_timer_manager->delay_rebalance(gate->lock_id(), gate->m_time_last_rebal, delay_usecs);
+                m_rebalancer->delay_rebalance(gate->lock_id());
                 gate->wake_next(context);
             } else { // rebalance immediately
                 gate->m_state = Gate::State::REBAL;
@@ -534,6 +528,8 @@ Gate* PackedMemoryArray::reader_on_entry(int64_t key, int64_t start_gate_id) con
             case Gate::State::WRITE:
             case Gate::State::TIMEOUT:
             case Gate::State::REBAL:
+                // unlike the other variants, readers are not admitted during a resize: the resize also merges the pending
+                // updates queued in the gates, and the readers exiting a gate apply its pending deletions
                 { // add the thread in the queue
                     std::promise<void> producer;
                     std::future<void> consumer = producer.get_future();
@@ -588,60 +584,6 @@ void PackedMemoryArray::reader_on_exit(Gate* gate) const {
 }
 
 
-/*****************************************************************************
- *                                                                           *
- *   Timeout                                                                 *
- *   - Only invoked by the Timer Manager                                     *
- *                                                                           *
- *****************************************************************************/
-void PackedMemoryArray::timeout(size_t gate_id, std::chrono::steady_clock::time_point time_last_rebal){
-    auto context = m_thread_contexts.timer_manager();
-    ScopedState scope{context};
-
-    try {
-        bool send_rebalance_request = false; // request a global rebalance ?
-
-        if(gate_id >= get_number_locks()) return; // it may refer a gate_id that doesn't exist anymore due to a downsize
-
-        Gate& gate = m_locks.get(context)[gate_id]; // it can throw an Abort exception
-
-        unique_lock<Gate> lock(gate);
-
-        if(gate.m_time_last_rebal == time_last_rebal){ // check that the gate hasn't been rebalanced in the meanwhile
-            switch(gate.m_state){
-            case Gate::State::FREE:
-                assert(gate.m_num_active_threads == 0 && "Great, the gate is free but there are registered threads being active on it");
-                send_rebalance_request = true;
-                gate.m_state = Gate::State::REBAL;
-                break;
-            case Gate::State::READ:
-            case Gate::State::WRITE:
-                assert(gate.m_num_active_threads > 0 && "There should be some client thread still active on this gate");
-                gate.m_state = Gate::State::TIMEOUT; // the last client thread that leaves this gate needs to invoke the global rebalancer
-                break;
-            case Gate::State::TIMEOUT:
-                // we've already requested to rebalance this segment?
-                assert(gate.m_num_active_threads > 0 && "There should be some client thread still active on this gate");
-                /* nop */
-                break;
-            case Gate::State::REBAL:
-                /* nop */
-                break;
-            }
-        }
-
-        lock.unlock();
-
-        if(send_rebalance_request)
-            rebalance_global(gate_id, false);
-
-    } catch(Abort) {
-        // if we abort, then it means that the PMA has resized in the meanwhile and the request
-        // to rebalance became obsolete -> nop
-    }
-}
-
-
 /*****************************************************************************
  *                                                                           *
  *   Miscellaneous                                                           *
@@ -668,7 +610,10 @@ const CachedDensityBounds& PackedMemoryArray::get_thresholds() const {
 
 std::pair<double, double> PackedMemoryArray::get_thresholds(int height) const {
     assert(height >= 1 && height <= m_storage.hyperheight());
-    return get_thresholds().thresholds(height);
+    auto thresholds = get_thresholds().thresholds(height);
+    // as the memory budget nears, accept denser windows to postpone the resizes
+    thresholds.second = m_memory_budget.raise_upper_threshold(thresholds.second, get_thresholds().get_upper_threshold_leaves());
+    return thresholds;
 }
 
 void PackedMemoryArray::set_thresholds(int height_calibrator_tree){
@@ -695,6 +640,14 @@ CachedMemoryPool& PackedMemoryArray::memory_pool() {
     return m_memory_pool;
 }
 
+const MemoryBudget& PackedMemoryArray::memory_budget() const {
+    return m_memory_budget;
+}
+
+void PackedMemoryArray::update_memory_budget() {
+    m_memory_budget.update(m_knobs.get_memory_budget(), memory_footprint_resident());
+}
+
 Knobs& PackedMemoryArray::knobs(){
     return m_knobs;
 }
@@ -711,6 +664,18 @@ size_t PackedMemoryArray::get_number_locks() const noexcept {
     return max<size_t>(1ull, m_storage.m_number_segments / get_segments_per_lock());
 }
 
+chrono::microseconds PackedMemoryArray::get_rebalance_delay(int64_t key) const {
+    Gate* gates = m_locks.get_unsafe();
+    uint64_t gate_id = m_index.get_unsafe()->find(key);
+    // as in #check_fence_keys, the index is only a hint, move to the gate whose fence keys contain the key
+    Gate::Direction direction;
+    while((direction = gates[gate_id].check_fence_keys(key)) != Gate::Direction::GO_AHEAD){
+        assert(direction != Gate::Direction::INVALID && "The rebalancer should be idle");
+        gate_id += (direction == Gate::Direction::RIGHT) ? 1 : -1;
+    }
+    return gates[gate_id].m_rebal_delay;
+}
+
 void PackedMemoryArray::build() {
     on_complete();
 }
@@ -723,6 +688,14 @@ size_t PackedMemoryArray::memory_footprint() const {
     return sizeof(decltype(*this)) + space_index + space_locks + space_storage;
 }
 
+size_t PackedMemoryArray::memory_footprint_resident() const {
+    size_t space_index = m_index.get_unsafe()->memory_footprint();
+    size_t space_locks = get_segments_per_lock() * (sizeof(Gate) + /* separator keys */ (m_index.get_unsafe()->node_size() -1) * sizeof(int64_t));
+    size_t space_storage = m_storage.memory_footprint_resident();
+
+    return sizeof(decltype(*this)) + space_index + space_locks + space_storage;
+}
+
 void PackedMemoryArray::rebalance_global(uint64_t gate_id, bool client_exit) const{
     if(client_exit){
         m_rebalancer->exit(gate_id);
@@ -790,6 +763,7 @@ int64_t PackedMemoryArray::max_separator_key(size_t segment_id){
  *                                                                           *
  *****************************************************************************/
 void PackedMemoryArray::insert(int64_t key, int64_t value){
+    m_memory_budget.throttle(); // back pressure, when the memory usage nears the budget
     ClientContext* context = get_context();
     ScopedState scope { context };
 
@@ -1177,8 +1151,9 @@ void PackedMemoryArray::rebalance_plan(RebalancePlan* plan) const {
         }
         assert(plan->m_window_length * m_storage.m_segment_capacity >= plan->get_cardinality_after() && "There is not enough space to store all the elements");
         assert(plan->m_window_length < m_storage.m_number_segments && "We are not downsizing the array...");
-    } else if (density > get_thresholds().get_upper_threshold_root()){ // upsize
-        size_t ideal_number_of_segments = max<size_t>(ceil( static_cast<double>(plan->get_cardinality_after()) / (m_density_bounds1.get_upper_threshold_root() * m_storage.m_segment_capacity) ), m_storage.m_number_segments +1);
+    } else if (density > m_memory_budget.raise_upper_threshold(get_thresholds().get_upper_threshold_root(), get_thresholds().get_upper_threshold_leaves())){ // upsize
+        const double upper_threshold_root = m_memory_budget.raise_upper_threshold(m_density_bounds1.get_upper_threshold_root(), m_density_bounds1.get_upper_threshold_leaves());
+        size_t ideal_number_of_segments = max<size_t>(ceil( static_cast<double>(plan->get_cardinality_after()) / (upper_threshold_root * m_storage.m_segment_capacity) ), m_storage.m_number_segments +1);
         if(ideal_number_of_segments < density_threshold){
             plan->m_window_length = m_storage.m_number_segments;
             do {
@@ -1352,7 +1327,7 @@ void PackedMemoryArray::spread_local(const RebalancePlan& action, InsertionT* in
     int64_t* __restrict input_keys = input_keys_ptr.get();
     unique_ptr<int64_t, decltype(fn_deallocate)> input_values_ptr{ m_memory_pool.allocate<int64_t>(action.get_cardinality_after()), fn_deallocate };
     int64_t* __restrict input_values = input_values_ptr.get();
-    uint16_t* __restrict segment_sizes_shifted = m_storage.m_segment_sizes + action.m_window_start;
+    Storage::segment_size_t* __restrict segment_sizes_shifted = m_storage.m_segment_sizes + action.m_window_start;
 
     // 1) first copy all elements in input keys
     int64_t insert_position = -1;
@@ -1606,7 +1581,7 @@ void PackedMemoryArray::do_sum(uint64_t gate_id, int64_t& next_min, int64_t max,
         if(read_all){ // read the whole content protected by this gate
             int64_t* __restrict keys = m_storage.m_keys + gate->m_window_start * m_storage.m_segment_capacity;
             int64_t* __restrict values = m_storage.m_values + gate->m_window_start * m_storage.m_segment_capacity;
-            uint16_t* __restrict cardinalities = m_storage.m_segment_sizes + gate->m_window_start;
+            Storage::segment_size_t* __restrict cardinalities = m_storage.m_segment_sizes + gate->m_window_start;
 
             sum->m_first_key = std::min(sum->m_first_key, keys[m_storage.m_segment_capacity - cardinalities[0]]);
             for(int64_t segment_id = 0, last_segment_id = gate->m_window_length; segment_id < last_segment_id; segment_id+= 2){
@@ -1626,7 +1601,7 @@ void PackedMemoryArray::do_sum(uint64_t gate_id, int64_t& next_min, int64_t max,
             sum->m_last_key = keys[m_storage.m_segment_capacity * (gate->m_window_length -1) + cardinalities[gate->m_window_length -1] -1];
         } else { // read only partially this chunk of the array
             int64_t* __restrict keys = m_storage.m_keys;
-            uint16_t* __restrict cardinalities = m_storage.m_segment_sizes;
+            Storage::segment_size_t* __restrict cardinalities = m_storage.m_segment_sizes;
 
             bool min_notfound = true;
             int64_t segment_begin = gate->find(next_min), start = 0;
@@ -1958,7 +1933,6 @@ void PackedMemoryArray::on_destroy_worker(int worker_id) {
 }
 
 void PackedMemoryArray::on_complete(){
-    m_timer_manager->flush();
     m_rebalancer->complete();
 }
 
@@ -28,7 +28,9 @@
 #include "data_structures/parallel.hpp"
 #include "rma/common/density_bounds.hpp"
 #include "rma/common/knobs.hpp"
+#include "rma/common/memory_budget.hpp"
 #include "rma/common/memory_pool.hpp"
+#include "rma/common/rewiring_cost_model.hpp"
 #include "rma/common/static_index.hpp"
 #include "pointer.hpp"
 #include "rebalance_plan.hpp"
@@ -45,7 +47,6 @@ class RebalancingMaster;
 class RebalancingTask;
 class RebalancingWorker;
 class SpreadWithRewiring; // forward decl.
-class TimerManager;
 class Weights;
 
 class PackedMemoryArray : public InterfaceRQ, public ParallelCallbacks {
@@ -55,7 +56,6 @@ friend class RebalancingMaster;
 friend class RebalancingTask;
 friend class RebalancingWorker;
 friend class SpreadWithRewiring;
-friend class TimerManager;
 friend class Weights;
 
 // aliases
@@ -74,12 +74,14 @@ protected:
     CachedDensityBounds m_density_bounds1; // primary thresholds (for num_segmnets>balanced_thresholds_cutoff())
     bool m_primary_densities = false; // use the primary thresholds?
     CachedMemoryPool m_memory_pool;
+    const common::RewiringCostModel& m_rewiring_cost; // whether to rewire or to copy back the extents of a rebalance, shared by all instances
+    common::MemoryBudget m_memory_budget; // back pressure as the memory usage nears the budget set in the knobs
     RebalancingMaster* m_rebalancer;
     GarbageCollector* m_garbage_collector; // garbage collector
-    TimerManager* m_timer_manager; // delayed rebalances
     ThreadContextList m_thread_contexts; // the list of thread contexts, to keep track of the thread epochs
     const uint64_t m_segments_per_lock; // number of contiguous segments per lock\gate
-    const std::chrono::milliseconds m_delayed_rebalance; // minimum amount of time that must pass before a gate can be rebalanced by the master
+    const std::chrono::microseconds m_delayed_rebalance; // minimum amount of time that must pass before a gate can be rebalanced by the master
+    const std::chrono::microseconds m_delayed_rebalance_max; // the delay of each gate adapts to its update rate up to this amount of time
 
     // Check this is the correct lock
     bool check_fence_keys(Gate& gate, uint64_t& gate_id, int64_t key) const;
@@ -186,6 +188,10 @@ protected:
     // Retrieve the number of segments after that the primary thresholds are used
     size_t balanced_thresholds_cutoff() const;
 
+    // Refresh the memory usage against the budget set in the knobs. Invoked by the RebalancingMaster at the end of each resize, when
+    // no other rebalance is in progress, so that the windows are always evaluated with the same thresholds
+    void update_memory_budget();
+
     // Dump the content of the locks
     void dump_locks(std::ostream& out, bool* integrity_check) const;
 
@@ -200,11 +206,8 @@ protected:
     // Helper for the class Weights. This method is not thread safe.
     int find_position(size_t segment_id, int64_t key) const noexcept;
 
-    // Invoked by the Timer, when a gate is ready for rebalance
-    void timeout(size_t gate_id, std::chrono::steady_clock::time_point time_last_rebal);
-
 public:
-    PackedMemoryArray(size_t index_B, size_t pma_segment_size, size_t pages_per_extent, size_t num_worker_threads, size_t segments_per_lock, std::chrono::milliseconds delay_rebalance = std::chrono::milliseconds(0));
+    PackedMemoryArray(size_t index_B, size_t pma_segment_size, size_t pages_per_extent, size_t num_worker_threads, size_t segments_per_lock, std::chrono::milliseconds delay_rebalance = std::chrono::milliseconds(0), std::chrono::milliseconds delay_rebalance_max = std::chrono::milliseconds(0));
 
     /**
      * Destructor
@@ -257,6 +260,11 @@ public:
      */
     CachedMemoryPool& memory_pool();
 
+    /**
+     * Current memory usage versus the budget set in the knobs, as of the last resize
+     */
+    const common::MemoryBudget& memory_budget() const;
+
     /**
      * APMA settings
      */
@@ -292,6 +300,12 @@ public:
      */
     size_t get_number_locks() const noexcept;
 
+    /**
+     * Retrieve the delay that must pass since the last rebalance of the gate holding the given key, before the master can rebalance it again.
+     * This method is not thread safe, invoke it only when the rebalancer is idle, e.g. after #on_complete
+     */
+    std::chrono::microseconds get_rebalance_delay(int64_t key) const;
+
     /**
      * Set the maximum number of worker threads
      */
@@ -332,6 +346,7 @@ public:
      * Memory footprint
      */
     size_t memory_footprint() const override;
+    size_t memory_footprint_resident() const override;
 
 };
 
@@ -17,12 +17,16 @@
 
 #include "rebalancing_master.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <cmath>
-#include <cstdlib> // abs, debug only
+#include <cstdlib> // abs
 #include <iostream>
 #include <mutex>
 #include <sstream>
+#include <thread>
+#include <utility>
+#include <vector>
 
 #include "common/configuration.hpp" // LOG_VERBOSE
 #include "common/errorhandling.hpp"
@@ -54,13 +58,17 @@ extern mutex _debug_mutex; // PackedMemoryArray.cpp
     #define COUT_DEBUG(msg)
 #endif
 
+// The master is pinned to the first socket, it is the owner of the gates with NumaPolicy::OWNER
+constexpr int OWNER_NUMA_NODE = 0;
+
 /*****************************************************************************
  *                                                                           *
  *   Initialisation                                                          *
  *                                                                           *
  *****************************************************************************/
+static constexpr auto TIMER_RESOLUTION = chrono::microseconds(100); // the granularity of the delayed rebalances
 
-RebalancingMaster::RebalancingMaster(PackedMemoryArray* pma, uint64_t num_workers) : m_instance(pma), m_thread_pool(num_workers){ }
+RebalancingMaster::RebalancingMaster(PackedMemoryArray* pma, uint64_t num_workers) : m_instance(pma), m_thread_pool(num_workers), m_timers(TIMER_RESOLUTION) { }
 
 RebalancingMaster::~RebalancingMaster() {
     stop();
@@ -72,6 +80,9 @@ RebalancingMaster::~RebalancingMaster() {
     auto t1 = chrono::steady_clock::now();
     cout << "Statistics computed in " << chrono::duration_cast<chrono::seconds>(t1 - t0).count() << " seconds\n";
     cout << stats << endl;;
+    cout << m_master_stats << endl;
+    cout << m_instance->memory_pool().get_statistics() << endl;
+    if(m_instance->knobs().get_memory_budget() > 0){ cout << m_instance->memory_budget() << endl; }
 #endif
 }
 
@@ -80,7 +91,9 @@ void RebalancingMaster::start(){
 
     scoped_lock<mutex> lock(m_mutex);
     if(m_handle.joinable()){ RAISE_EXCEPTION(Exception, "Main thread already started") };
-    m_queue.clear();
+    InternalTask message;
+    while(m_queue.pop(message)) { /* discard the messages left from a previous run */ };
+    m_inbox.clear();
     m_handle = thread(&RebalancingMaster::main_thread, this);
 }
 
@@ -89,9 +102,8 @@ void RebalancingMaster::stop(){
     { // restrict the scope
         scoped_lock<mutex> lock(m_mutex);
         if(!m_handle.joinable()) return; // already stopped
-        m_queue.append(InternalTask{InternalTask::Type::Stop, 0});
-        m_condvar.notify_one();
     }
+    send_message(InternalTask{InternalTask::Type::Stop, 0});
     m_handle.join();
 }
 
@@ -105,40 +117,28 @@ RebalancingPool& RebalancingMaster::thread_pool(){
  *                                                                           *
  *****************************************************************************/
 void RebalancingMaster::rebalance(uint64_t gate_id){
-    {
-        scoped_lock<mutex> lock(m_mutex);
-        m_queue.append(InternalTask{InternalTask::Type::Rebalance, gate_id });
-    }
-    m_condvar.notify_one();
+    send_message(InternalTask{InternalTask::Type::Rebalance, gate_id});
 }
 
 void RebalancingMaster::exit(uint64_t gate_id){
-    {
-        scoped_lock<mutex> lock(m_mutex);
-        m_queue.append(InternalTask{InternalTask::Type::ClientExit, gate_id });
-    }
-    m_condvar.notify_one();
+    send_message(InternalTask{InternalTask::Type::ClientExit, gate_id});
 }
 
 void RebalancingMaster::task_done(RebalancingTask* task){
     assert(task != nullptr && "Null pointer");
-    {
-        scoped_lock<mutex> lock(m_mutex);
-        m_queue.append(InternalTask{InternalTask::Type::TaskDone, reinterpret_cast<uint64_t>(task) });
-    }
-    m_condvar.notify_one();
+    send_message(InternalTask{InternalTask::Type::TaskDone, reinterpret_cast<uint64_t>(task)});
 }
 
 
+void RebalancingMaster::delay_rebalance(uint64_t gate_id){
+    send_message(InternalTask{InternalTask::Type::DelayRebalance, gate_id});
+}
+
 void RebalancingMaster::complete(){
     std::promise<void> producer;
     std::future<void> consumer = producer.get_future();
     COUT_DEBUG("Waiting for the rebalancer to become idle... ");
-    {
-        scoped_lock<mutex> lock(m_mutex);
-        m_queue.append(InternalTask{InternalTask::Type::Wait2Complete, reinterpret_cast<uint64_t>(&producer)});
-    }
-    m_condvar.notify_one();
+    send_message(InternalTask{InternalTask::Type::Wait2Complete, reinterpret_cast<uint64_t>(&producer)});
 
     consumer.wait(); // Zzz
 
@@ -150,28 +150,111 @@ void RebalancingMaster::complete(){
  *   Controller thread                                                       *
  *                                                                           *
  *****************************************************************************/
+void RebalancingMaster::send_message(InternalTask message){
+    IF_PROFILING( message.m_time_sent = chrono::steady_clock::now() );
+    m_queue.push(message);
+
+    // Both the push and the load of m_sleeping are sequentially consistent: either we observe the master going to sleep
+    // or the master observes our message before parking. Notify under the mutex, not to slip in before the master waits.
+    if(m_sleeping){
+        scoped_lock<mutex> lock(m_mutex);
+        m_condvar.notify_one();
+    }
+}
+
+void RebalancingMaster::fetch_messages(){
+    assert(m_inbox.empty() && "There are still messages to process");
+
+    // check the delayed rebalances once per batch, the master may never go idle under a heavy load
+    expire_timers();
+
+    if(m_queue.empty()){
+        // with spare cores, the next message is likely to arrive shortly. Spin for a while, rather than paying a futex wait & wake up.
+        // Yield between the rounds, the threads the master is waiting for may need this core
+        const auto spin_time = chrono::microseconds(m_instance->knobs().get_master_spin_time());
+        if(spin_time.count() > 0){
+            auto t0 = chrono::steady_clock::now();
+            do {
+                for(int i = 0; i < 64 && m_queue.empty(); i++){ cpu_relax(); }
+                if(m_queue.empty()){ this_thread::yield(); }
+            } while(m_queue.empty() && (chrono::steady_clock::now() - t0) < spin_time);
+        }
+
+        if(!m_queue.empty()){
+            IF_PROFILING( m_master_stats.m_num_spins++ );
+        }
+
+        // how long to sleep before looking again for the gates to rebalance proactively
+        constexpr auto PROACTIVE_INTERVAL = chrono::milliseconds(10);
+        while(m_queue.empty()){
+            expire_timers();
+
+            // the master is idle, use its spare time to rebalance the gates before the clients find them full
+            while(m_queue.empty() && proactive_rebalance()){ /* next round */ }
+            if(!m_queue.empty()) break;
+
+            // spare the workers of the next rebalances from faulting in their buffers
+            prefault_buffers();
+            if(!m_queue.empty()) break;
+
+            // Zzz, until the next delayed rebalance is due
+            unique_lock<mutex> lock(m_mutex);
+            m_sleeping = true;
+            auto has_messages = [this](){ return !m_queue.empty(); };
+            auto wake_up = m_timers.next_deadline();
+            if(m_instance->knobs().get_proactive_budget() > 0){
+                wake_up = std::min(wake_up, chrono::steady_clock::now() + PROACTIVE_INTERVAL);
+            }
+            if(wake_up == chrono::steady_clock::time_point::max()){
+                m_condvar.wait(lock, has_messages);
+            } else {
+                m_condvar.wait_until(lock, wake_up, has_messages);
+            }
+            m_sleeping = false;
+            IF_PROFILING( m_master_stats.m_num_parks++ );
+        }
+    }
+
+    // process the messages in batch
+    InternalTask message;
+    while(m_queue.pop(message)){
+#if defined(PROFILING)
+        int64_t latency = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - message.m_time_sent).count();
+        m_master_stats.m_num_messages++;
+        m_master_stats.m_message_latency_sum += latency;
+        m_master_stats.m_message_latency_max = std::max(m_master_stats.m_message_latency_max, latency);
+#endif
+        m_inbox.append(message);
+    }
+    IF_PROFILING( m_master_stats.m_num_batches++ );
+    IF_PROFILING( m_master_stats.m_batch_size_max = std::max<int64_t>(m_master_stats.m_batch_size_max, m_inbox.size()) );
+}
+
 void RebalancingMaster::main_thread(){
     COUT_DEBUG("Master node started");
     set_thread_name("RB Master");
 
     // we promised in the paper that all threads are pinned to the first socket
 #if defined(HAVE_LIBNUMA)
-    pin_thread_to_numa_node(0);
+    pin_thread_to_numa_node(OWNER_NUMA_NODE);
 #endif
 
     bool stop_loop = false;
+    m_stop_requested = false;
+    m_proactive_time = 0;
+    m_proactive_epoch = chrono::steady_clock::now();
+    m_gate_timers.assign(m_instance->get_number_locks(), ::common::TimerWheel::Timer{});
     m_thread_pool.start();
+    IF_PROFILING( auto wallclock_t0 = chrono::steady_clock::now() );
+    IF_PROFILING( uint64_t cpu_time_t0 = get_thread_cpu_time() );
+    IF_PROFILING( uint64_t page_faults_t0 = get_thread_page_faults() );
 
     do {
-        InternalTask task;
-
-        { // Fetch the next task from the queue
-            unique_lock<mutex> lock(m_mutex);
-            if(m_queue.empty()){ m_condvar.wait(lock, [this](){ return !m_queue.empty(); }); }
-            assert(!m_queue.empty() && "Precondition not satified: there should be at least one item in the queue at this point");
-            task = m_queue[0];
-            m_queue.pop();
-        }
+        // Fetch the next task from the queue
+        if(m_inbox.empty()){ fetch_messages(); }
+        assert(!m_inbox.empty() && "Precondition not satified: there should be at least one item in the queue at this point");
+        InternalTask task = m_inbox[0];
+        m_inbox.pop();
 
         COUT_DEBUG("Task received: " << task.to_string());
 
@@ -182,6 +265,7 @@ void RebalancingMaster::main_thread(){
             if(!m_resizing && !ignore_lock(gate_id)){
                 RebalancingTask* task = rebal_init(gate_id);
                 if(task != nullptr){ // task == nullptr => ignore this request
+                    IF_PROFILING( m_master_stats.m_requested_rebalances++ );
                     rebal_resume(task);
 
                     // append the task in the list of tasks to execute
@@ -212,13 +296,19 @@ void RebalancingMaster::main_thread(){
                         m_todo[i]->m_blocked_on_lock = -1;
                     }
                 }
+#if defined(PROFILING)
+                // a proactive rebalance spared the clients a rebalance if none of them had to wait for it
+                if(rebal_task->m_proactive && count_waiters(rebal_task) == 0){ m_master_stats.m_proactive_avoided++; }
+#endif
                 // 2) unlock the client threads associated to the gates rebalanced
                 WakeList worker_list;
                 auto now = chrono::steady_clock::now();
                 for(size_t i = rebal_task->get_lock_start(), end = rebal_task->get_lock_end(); i < end; i++){
                     release_lock(i, /* workspace */ worker_list, /* time of the last rebalance */ now);
                 }
-                // 3) go through the todo list
+                // 3) return to the OS the buffer space exceeding the budget
+                m_instance->m_storage.trim_buffers(m_instance->m_memory_budget.cap_retained_memory(m_instance->knobs().get_retained_buffer_memory()));
+                // 4) go through the todo list
                 process_todo_list();
             } break;
             case RebalanceOperation::RESIZE:
@@ -239,11 +329,15 @@ void RebalancingMaster::main_thread(){
                     delete rebal_task->m_ptr_storage; rebal_task->m_ptr_storage = nullptr;
                 }
 
+                m_instance->update_memory_budget(); // before the clients can access the new storage
+
                 // 2) Set the time when the storage was created
                 auto now = chrono::steady_clock::now();
                 Gate* locks_new = rebal_task->m_ptr_locks;
                 for(size_t i = 0, sz = rebal_task->get_lock_length(); i < sz; i++){
                     locks_new[i].m_time_last_rebal = now;
+                    locks_new[i].m_cardinality_last_rebal = locks_new[i].m_cardinality;
+                    locks_new[i].m_rebal_delay = m_instance->m_delayed_rebalance;
                 }
 
                 // 3) Install the new index & the group of locks
@@ -260,7 +354,11 @@ void RebalancingMaster::main_thread(){
                 m_instance->m_locks.set(locks_new);
                 m_instance->m_index.set(index_new);
                 barrier();
-                m_instance->m_locks.timestamp() = m_instance->m_index.timestamp() = rdtscp();
+                m_instance->m_locks.timestamp() = m_instance->m_index.timestamp() = m_instance->m_thread_contexts.epochs().advance();
+
+                // the timers refer to the old gates, the new gates have just been rebalanced
+                m_timers.clear();
+                m_gate_timers.assign(rebal_task->get_lock_length(), ::common::TimerWheel::Timer{});
 
                 // 4) Invalidate the old locks and unblock the threads
                 WakeList worker_list;
@@ -289,6 +387,12 @@ void RebalancingMaster::main_thread(){
                 for(auto p : m_wait2complete){ p->set_value(); }
                 m_wait2complete.clear();
             }
+
+            // a request to stop was postponed until the completion of the pending tasks
+            if(m_stop_requested && !busy()){
+                m_thread_pool.stop();
+                stop_loop = true;
+            }
         } break;
         case InternalTask::Type::ClientExit: {
             // a client thread has just released a gate/lock
@@ -299,8 +403,22 @@ void RebalancingMaster::main_thread(){
             wait_to_complete_remove(task, lock_id);
             if(task->ready_for_execution()){ process_todo_list(); }
         } break;
+        case InternalTask::Type::DelayRebalance: {
+            uint64_t gate_id = task.m_payload;
+            assert(m_gate_timers.size() == m_instance->get_number_locks() && "Expected one timer for each gate");
+            if(gate_id >= m_instance->get_number_locks()) break; // it may refer a gate_id that doesn't exist anymore due to a downsize
+            // the gate cannot have been rebalanced since the request was sent: its time_last_rebal is the same read by the client.
+            // If the gate is already waiting for its timer, the deadline is the same as well
+            if(!m_gate_timers[gate_id].scheduled()){
+                Gate* gate = m_instance->m_locks.get_unsafe() + gate_id;
+                m_timers.schedule(&m_gate_timers[gate_id], gate->m_time_last_rebal + gate->m_rebal_delay);
+            }
+        } break;
         case InternalTask::Type::Wait2Complete: {
             auto producer = reinterpret_cast<std::promise<void>*>(task.m_payload);
+            // do not wait for the delayed rebalances to expire
+            m_timers.expire_all([this](::common::TimerWheel::Timer* timer){ timeout(timer - m_gate_timers.data()); });
+
             if(!busy()){
                 assert(m_wait2complete.empty() && "If the rebalancer is not busy, there should no other promises in the list ");
                 producer->set_value();
@@ -309,10 +427,14 @@ void RebalancingMaster::main_thread(){
             }
         } break;
         case InternalTask::Type::Stop: {
-            assert(!m_thread_pool.active() && "Wrong termination order: all client threads must have terminated before invoking this method!");
-            assert(m_executing.size() == 0 && "There should be no jobs on execution");
-            m_thread_pool.stop();
-            stop_loop = true;
+            m_timers.clear(); // discard the delayed rebalances
+            if(busy()){ // proactive rebalances may still be in progress, terminate once they are completed
+                m_stop_requested = true;
+            } else {
+                assert(!m_thread_pool.active() && "Wrong termination order: all client threads must have terminated before invoking this method!");
+                m_thread_pool.stop();
+                stop_loop = true;
+            }
         } break; // done
         default:
             assert(0 && "Invalid task");
@@ -322,6 +444,10 @@ void RebalancingMaster::main_thread(){
 
     m_thread_pool.stop();
 
+    IF_PROFILING( m_master_stats.m_wallclock_time = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - wallclock_t0).count() );
+    IF_PROFILING( m_master_stats.m_cpu_time = get_thread_cpu_time() - cpu_time_t0 );
+    IF_PROFILING( m_master_stats.m_page_faults = get_thread_page_faults() - page_faults_t0 );
+
     COUT_DEBUG("Master node stopped");
 }
 
@@ -598,12 +724,17 @@ void RebalancingMaster::launch_task(RebalancingWorker* worker, RebalancingTask*
         task->m_ptr_locks = Gate::allocate(task->get_lock_length(), m_instance->get_segments_per_lock());
 
         // update the storage
+        IF_PROFILING( uint64_t page_faults_t0 = get_thread_page_faults() );
         if(operation == RebalanceOperation::RESIZE){
             task->m_ptr_storage = new Storage(m_instance->m_storage.m_segment_capacity, m_instance->m_storage.m_pages_per_extent, task->get_window_length());
+            apply_numa_policy(task->m_ptr_storage); // before the workers fill it
         } else { // RebalanceOperation::RESIZE_REBALANCE
             assert(task->m_plan.m_window_length >= m_instance->m_storage.m_number_segments);
-            task->m_ptr_storage->extend(task->m_plan.m_window_length - m_instance->m_storage.m_number_segments);
+            // populate the new extents in a single pass, rather than letting the workers fault them in page by page
+            const bool prefault = m_instance->knobs().get_prefault_buffer_memory() > 0;
+            task->m_ptr_storage->extend(task->m_plan.m_window_length - m_instance->m_storage.m_number_segments, prefault);
         }
+        IF_PROFILING( task->m_statistics.m_master_page_faults = get_thread_page_faults() - page_faults_t0 );
 
         // profiling statistics
 #if defined(PROFILING)
@@ -632,7 +763,12 @@ void RebalancingMaster::launch_task(RebalancingWorker* worker, RebalancingTask*
     }
 #endif
 
+    // rewire or copy back the extents of the window, whatever the cost model deems cheaper
+    const int64_t num_extents = max<int64_t>(1, task->m_plan.m_window_length / m_instance->m_storage.get_segments_per_extent());
+    task->m_use_rewiring = m_instance->m_rewiring_cost.use_rewiring(num_extents);
+
     IF_PROFILING(task->m_statistics.m_window_length = task->m_plan.m_window_length);
+    IF_PROFILING(task->m_statistics.m_master_use_rewiring = task->m_use_rewiring);
 
     m_executing.push_back(task);
     worker->execute(task);
@@ -641,6 +777,9 @@ void RebalancingMaster::launch_task(RebalancingWorker* worker, RebalancingTask*
 
 void RebalancingMaster::process_todo_list(){
     bool workers_available = true;
+    apply_numa_policy(&(m_instance->m_storage));
+
+    if(m_instance->knobs().get_scheduling_policy() == common::SchedulingPolicy::PRIORITY){ sort_todo_list(); }
 
     // go through the whole list of tasks to be processed
     for(size_t i = 0, sz = m_todo.size(); i < sz; i++){
@@ -654,7 +793,7 @@ void RebalancingMaster::process_todo_list(){
             if(!task->is_rebalancing_window_computed()){ rebal_resume(task); }
 
             if(task->ready_for_execution()){
-                RebalancingWorker* worker = m_thread_pool.acquire();
+                RebalancingWorker* worker = m_thread_pool.acquire_on_node(m_instance->m_storage.get_numa_node(task->get_window_start()));
                 if(worker == nullptr){ // there are no threads available at the moment to execute this task
                     workers_available = false;
                 } else {
@@ -671,6 +810,46 @@ void RebalancingMaster::process_todo_list(){
     }
 }
 
+void RebalancingMaster::apply_numa_policy(Storage* storage){
+    const common::NumaPolicy policy = m_instance->knobs().get_numa_policy();
+    storage->set_numa_policy(policy, OWNER_NUMA_NODE);
+    m_thread_pool.set_numa_policy(policy, OWNER_NUMA_NODE);
+}
+
+void RebalancingMaster::sort_todo_list(){
+    if(m_todo.size() <= 1) return; // nop
+    // each millisecond spent in the to-do list counts as an additional waiter, so that no task is postponed indefinitely
+    constexpr int64_t AGING_INTERVAL_MICROSECS = 1000;
+    const auto now = chrono::steady_clock::now();
+
+    vector<pair<uint64_t, RebalancingTask*>> tasks;
+    tasks.reserve(m_todo.size());
+    while(!m_todo.empty()){
+        RebalancingTask* task = m_todo[0];
+        m_todo.pop();
+        if(task == nullptr) continue; // merged with another task
+        uint64_t age = chrono::duration_cast<chrono::microseconds>(now - task->m_time_created).count() / AGING_INTERVAL_MICROSECS;
+        tasks.emplace_back(count_waiters(task) + age, task);
+    }
+
+    // in case of ties, keep the order of arrival
+    std::stable_sort(begin(tasks), end(tasks), [](const auto& t1, const auto& t2){ return t1.first > t2.first; });
+    for(auto& t : tasks){ m_todo.append(t.second); }
+}
+
+uint64_t RebalancingMaster::count_waiters(const RebalancingTask* task) const {
+    Gate* gates = m_instance->m_locks.get_unsafe();
+    const int64_t lock_end = std::min<int64_t>(task->get_lock_end(), m_instance->get_number_locks());
+    uint64_t result = 0;
+    for(int64_t lock_id = task->get_lock_start(); lock_id < lock_end; lock_id++){
+        Gate& gate = gates[lock_id];
+        gate.lock();
+        result += gate.m_queue.size();
+        gate.unlock();
+    }
+    return result;
+}
+
 std::pair<uint64_t, uint64_t> RebalancingMaster::acquire_lock(RebalancingTask* task, uint64_t lock_id){
     assert(task != nullptr && "Null pointer");
     assert(lock_id < m_instance->get_number_locks() && "Invalid gate/lock ID");
@@ -721,6 +900,8 @@ void RebalancingMaster::release_lock(uint64_t lock_id, WakeList& worker_list, ch
 
     gate->m_state = Gate::State::FREE;
     gate->m_time_last_rebal = time_last_rebal;
+    gate->m_cardinality_last_rebal = gate->m_cardinality;
+    m_timers.cancel(&m_gate_timers[lock_id]); // a delayed rebalance is not needed anymore
 
     // Use #wake_all rather than #wake_next! Potentially the fence keys have been changed, to threads
     // upon wake up might move to other gates. If other threads are in the wait list, they
@@ -745,6 +926,69 @@ void RebalancingMaster::cleanup_lock(Gate& gate, WakeList& worker_list){
     worker_list();
 }
 
+bool RebalancingMaster::proactive_rebalance(){
+    constexpr double PROACTIVE_DENSITY = 0.9; // rebalance a gate when its density reaches 90% of its upper threshold
+    constexpr uint64_t PROACTIVE_GATES_PER_ROUND = 64; // max number of gates to inspect before checking again the command queue
+
+    // only when there is nothing else to do
+    const double budget = m_instance->knobs().get_proactive_budget();
+    if(budget <= 0 || m_resizing || m_stop_requested || !m_todo.empty()) return false;
+    const uint64_t num_locks = m_instance->get_number_locks();
+    if(num_locks < 2) return false; // there is no window larger than a single gate to spread its elements
+    if(m_instance->m_storage.m_number_segments >= 2 * m_instance->balanced_thresholds_cutoff() && (2*m_instance->m_cardinality) < m_instance->m_storage.capacity()){
+        return false; // any task would be turned into a downsize, leave it to the clients
+    }
+    auto t0 = chrono::steady_clock::now();
+    if(m_proactive_time > budget * chrono::duration_cast<chrono::microseconds>(t0 - m_proactive_epoch).count()) return false; // budget exhausted
+
+    // a gate is about to overflow when its density approaches the upper threshold at its height. It also needs to be above the threshold
+    // of its parent window, otherwise the rebalance of the parent would not make room in the gate
+    const uint64_t segments_per_lock = m_instance->get_segments_per_lock();
+    const int height = static_cast<int>(log2(segments_per_lock)) +1;
+    const double theta = std::max(PROACTIVE_DENSITY * m_instance->get_thresholds(height).second, m_instance->get_thresholds(height +1).second);
+    const uint64_t threshold = theta * segments_per_lock * m_instance->m_storage.m_segment_capacity;
+    Gate* gates = m_instance->m_locks.get_unsafe();
+
+    bool task_started = false;
+    for(uint64_t i = 0; i < PROACTIVE_GATES_PER_ROUND && !task_started && m_proactive_num_idle < num_locks; i++){
+        uint64_t gate_id = (m_proactive_cursor++) % num_locks;
+        m_proactive_num_idle++;
+        IF_PROFILING( m_master_stats.m_proactive_gates_inspected++ );
+        if(ignore_lock(gate_id)) continue;
+
+        // close the gate, as a client would do before requesting a rebalance
+        Gate* gate = gates + gate_id;
+        gate->lock();
+        bool rebalance = gate->m_state == Gate::State::FREE && gate->m_cardinality > threshold;
+        if(rebalance){ gate->m_state = Gate::State::REBAL; }
+        gate->unlock();
+        if(!rebalance) continue;
+
+        COUT_DEBUG("proactive rebalance, gate: " << gate_id);
+        RebalancingTask* task = rebal_init(gate_id);
+        assert(task != nullptr && "The gate has just been set in the state REBAL");
+        task->m_proactive = true;
+        rebal_resume(task);
+        m_todo.append(task);
+        process_todo_list();
+
+        m_proactive_num_idle = 0;
+        task_started = true;
+        IF_PROFILING( m_master_stats.m_proactive_rebalances++ );
+    }
+
+    int64_t elapsed = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - t0).count();
+    m_proactive_time += elapsed;
+    IF_PROFILING( m_master_stats.m_proactive_time += elapsed );
+
+    if(!task_started && m_proactive_num_idle >= num_locks){ // a full pass without any gate to rebalance
+        m_proactive_num_idle = 0;
+        return false;
+    }
+
+    return true;
+}
+
 int64_t RebalancingMaster::next_window_length(int64_t current_window_length) const {
     int64_t next_length = hyperceil(current_window_length);
     if(next_length == current_window_length){
@@ -765,6 +1009,7 @@ uint64_t RebalancingMaster::bulk_loading_init(RebalancingTask* task, Gate* gate)
 
     // is there an asynchronous queue associated to this gate?
     ClientContextQueue* async_queue = gate->m_async_queue;
+    adapt_delay(task, gate, async_queue == nullptr ? 0 : async_queue->insertions().size() + async_queue->deletions().size());
     if(async_queue == nullptr) return 0;
     gate->m_async_queue = nullptr; // reset the value of the async queue
 
@@ -800,6 +1045,87 @@ uint64_t RebalancingMaster::bulk_loading_init(RebalancingTask* task, Gate* gate)
     return num_insertions;
 }
 
+void RebalancingMaster::adapt_delay(RebalancingTask* task, Gate* gate, uint64_t batch_size){
+    IF_PROFILING( task->m_statistics.m_master_batch_size += batch_size );
+    IF_PROFILING( task->m_statistics.m_master_delay = max<int64_t>(task->m_statistics.m_master_delay, gate->m_rebal_delay.count()) );
+    const auto delay_min = m_instance->m_delayed_rebalance;
+    const auto delay_max = m_instance->m_delayed_rebalance_max;
+    if(delay_min == delay_max) return; // fixed delay
+
+    // the update rate observed since the last rebalance, in elements per microsecond
+    const int64_t num_updates = abs(static_cast<int64_t>(gate->m_cardinality) - static_cast<int64_t>(gate->m_cardinality_last_rebal)) + batch_size;
+    const int64_t elapsed = max<int64_t>(1, chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - gate->m_time_last_rebal).count());
+    const double update_rate = static_cast<double>(num_updates) / elapsed;
+    const double batch_target = m_instance->m_storage.m_segment_capacity; // a batch worth delaying a rebalance, enough to fill a segment
+
+    chrono::microseconds delay;
+    if(update_rate * delay_max.count() < batch_target){ // cold gate, not even the max delay would accumulate a batch: rebalance immediately
+        delay = delay_min;
+    } else if(batch_size >= batch_target){ // hot gate, keep deferring its rebalances to accumulate larger batches
+        delay = max(gate->m_rebal_delay * 2, TIMER_RESOLUTION * 10);
+    } else { // enough time to accumulate a batch at the current rate, but not less than what the timers can resolve
+        delay = max(chrono::microseconds( static_cast<int64_t>(batch_target / update_rate) ), TIMER_RESOLUTION);
+    }
+    gate->m_rebal_delay = std::clamp(delay, delay_min, delay_max);
+    COUT_DEBUG("gate: " << gate->lock_id() << ", batch size: " << batch_size << ", update rate: " << update_rate << " elts/us, delay: " << gate->m_rebal_delay.count() << " us");
+}
+
+void RebalancingMaster::expire_timers(){
+    if(m_timers.empty()) return;
+    m_timers.advance(chrono::steady_clock::now(), [this](::common::TimerWheel::Timer* timer){ timeout(timer - m_gate_timers.data()); });
+}
+
+void RebalancingMaster::timeout(uint64_t gate_id){
+    COUT_DEBUG("timeout, gate_id: " << gate_id);
+    assert(gate_id < m_instance->get_number_locks() && "Invalid gate ID");
+    Gate* gate = m_instance->m_locks.get_unsafe() + gate_id;
+    bool rebalance = false;
+
+    gate->lock();
+    switch(gate->m_state){
+    case Gate::State::FREE:
+        assert(gate->m_num_active_threads == 0 && "Great, the gate is free but there are registered threads being active on it");
+        gate->m_state = Gate::State::REBAL;
+        rebalance = true;
+        break;
+    case Gate::State::READ:
+    case Gate::State::WRITE:
+        assert(gate->m_num_active_threads > 0 && "There should be some client thread still active on this gate");
+        gate->m_state = Gate::State::TIMEOUT; // the last client thread that leaves this gate needs to invoke the global rebalancer
+        break;
+    case Gate::State::TIMEOUT:
+    case Gate::State::REBAL:
+        /* nop, we've already requested to rebalance this gate */
+        break;
+    }
+    gate->unlock();
+
+    if(rebalance && !m_resizing && !ignore_lock(gate_id)){
+        RebalancingTask* task = rebal_init(gate_id);
+        if(task != nullptr){
+            IF_PROFILING( m_master_stats.m_requested_rebalances++ );
+            rebal_resume(task);
+            m_todo.append(task);
+            process_todo_list();
+        }
+    }
+}
+
+void RebalancingMaster::prefault_buffers(){
+    const uint64_t prefault_memory = m_instance->knobs().get_prefault_buffer_memory();
+    if(prefault_memory == 0 || m_resizing || m_stop_requested) return;
+
+    // beyond the retained memory, the buffers would be returned to the OS at the end of the next rebalance
+    const uint64_t memory = std::min<uint64_t>(prefault_memory, m_instance->m_memory_budget.cap_retained_memory(m_instance->knobs().get_retained_buffer_memory()));
+#if defined(PROFILING)
+    auto t0 = chrono::steady_clock::now();
+    m_master_stats.m_prefault_buffers += m_instance->m_storage.prefault_buffers(memory);
+    m_master_stats.m_prefault_time += chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - t0).count();
+#else
+    m_instance->m_storage.prefault_buffers(memory);
+#endif
+}
+
 bool RebalancingMaster::busy() const {
     return !m_todo.empty() || !m_executing.empty();
 }
@@ -884,6 +1210,8 @@ string RebalancingMaster::InternalTask::to_string() const {
         stream << "terminate"; break;
     case Type::Wait2Complete:
         stream << "wait2complete"; break;
+    case Type::DelayRebalance:
+        stream << "delay the rebalance of the gate: " << m_payload; break;
     default:
         stream << "???";
     }
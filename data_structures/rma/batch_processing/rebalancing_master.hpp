@@ -17,6 +17,8 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <future>
 #include <mutex>
@@ -25,8 +27,10 @@
 #include <vector>
 
 #include "common/circular_array.hpp"
+#include "common/mpsc_queue.hpp"
+#include "common/timer_wheel.hpp"
+#include "rma/common/rebalancing_statistics.hpp"
 #include "rebalancing_pool.hpp"
-#include "rebalancing_statistics.hpp"
 
 namespace data_structures::rma::batch_processing {
 
@@ -35,6 +39,7 @@ class Gate;
 class PackedMemoryArray;
 class RebalancingTask;
 class WakeList;
+struct Storage;
 
 class RebalancingMaster {
 private:
@@ -45,20 +50,31 @@ private:
 
     // Internal tasks
     struct InternalTask {
-        enum class Type { Invalid, Rebalance, TaskDone, ClientExit, Stop, Wait2Complete };
+        enum class Type { Invalid, Rebalance, TaskDone, ClientExit, Stop, Wait2Complete, DelayRebalance };
         Type m_type;
         uint64_t m_payload;
+        IF_PROFILING( std::chrono::steady_clock::time_point m_time_sent ); // when the message was pushed in the queue
         std::string to_string() const; // for debug purposes only
     };
     // Concurrent queue
-    mutable std::mutex m_mutex;
-    ::common::CircularArray<InternalTask> m_queue;
+    ::common::MPSCQueue<InternalTask> m_queue; // lock-free, the clients & the workers push, the master pops
+    ::common::CircularArray<InternalTask> m_inbox; // messages already drained from m_queue, to be processed by the master
+    std::atomic<bool> m_sleeping = false; // whether the master is, or is about to be, parked in m_condvar
+    mutable std::mutex m_mutex; // only to park & wake up the master
     std::condition_variable m_condvar;
     std::thread m_handle; // Handle to the controller thread
     bool m_resizing = false; // Whether the whole PMA is currently being resized
+    bool m_stop_requested = false; // Whether a request to stop arrived while some tasks were still pending or in execution
+    uint64_t m_proactive_cursor = 0; // the next gate to inspect for a proactive rebalance
+    uint64_t m_proactive_num_idle = 0; // number of consecutive gates inspected without starting a proactive rebalance
+    int64_t m_proactive_time = 0; // in microsecs, time spent so far by the master on the proactive rebalances
+    std::chrono::steady_clock::time_point m_proactive_epoch; // when the master started, to compute the budget for the proactive rebalances
     RebalancingPool m_thread_pool; // Thread pool
-    IF_PROFILING( std::vector<RebalancingStatistics> m_stats_completed_tasks );
+    IF_PROFILING( std::vector<common::RebalancingStatistics> m_stats_completed_tasks );
+    IF_PROFILING( common::MasterStatistics m_master_stats );
     std::vector<std::promise<void>*> m_wait2complete; // array of cond. vars to be notified when the master does not have jobs pending
+    ::common::TimerWheel m_timers; // the delayed rebalances
+    std::vector<::common::TimerWheel::Timer> m_gate_timers; // one timer for each gate, the gate id is the position in the vector
 
     // Check if a rebalancing window is already on execution or in the to-do list for the given gate id
     bool ignore_lock(uint64_t lock_id) const;
@@ -77,6 +93,15 @@ private:
     // Process the list of tasks in the to-do list
     void process_todo_list();
 
+    // Place the given storage and the workers of the thread pool among the NUMA nodes, as set in the knobs
+    void apply_numa_policy(Storage* storage);
+
+    // Reorder the to-do list by priority, the tasks with the most threads waiting in their gates first
+    void sort_todo_list();
+
+    // Total number of threads waiting in the gates of the given task
+    uint64_t count_waiters(const RebalancingTask* task) const;
+
     // Find the task created to process the given lock id
     RebalancingTask* get_todo_task_for(size_t lock_id) const;
 
@@ -89,12 +114,34 @@ private:
     // Add a BlkEntry instance in the task for the insertions, and perform all remaining deletions in gate's writer queue
     uint64_t bulk_loading_init(RebalancingTask* task, Gate* gate);
 
+    // Set the delay of the next rebalance of the gate, from its update rate and the size of the batch accumulated since its last rebalance
+    void adapt_delay(RebalancingTask* task, Gate* gate, uint64_t batch_size);
+
     // Check whether there tasks pending or in execution
     bool busy() const;
 
     // Validate the cardinalities of the locks and segments before launching a task
     void debug_validate_launch_task_cardinality(RebalancingTask* task) const;
 
+    // Push a message in the command queue, waking up the master only if it is sleeping
+    void send_message(InternalTask message);
+
+    // Drain the command queue into the inbox. Spin for a while if it is empty, then go to sleep
+    void fetch_messages();
+
+    // While idle, inspect a few gates and start the rebalance of the first one about to overflow. Return false if there is nothing
+    // left to do until the next interval, that is the budget is exhausted or no gate needs to be rebalanced
+    bool proactive_rebalance();
+
+    // While idle, populate the free buffers the next rebalances are going to acquire, see Knobs::get_prefault_buffer_memory()
+    void prefault_buffers();
+
+    // Fire the delayed rebalances whose deadline has passed
+    void expire_timers();
+
+    // The delay to rebalance the given gate has elapsed
+    void timeout(uint64_t gate_id);
+
 protected:
     void main_thread(); // Controller
 
@@ -140,6 +187,11 @@ public:
      */
     void task_done(RebalancingTask* task);
 
+    /**
+     * Rebalance the given gate once the minimum delay since its last rebalance has elapsed
+     */
+    void delay_rebalance(uint64_t gate_id);
+
     /**
      * Synchronously wait the master has completed all of its jobs
      */
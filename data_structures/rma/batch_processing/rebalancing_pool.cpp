@@ -18,6 +18,9 @@
 #include "rebalancing_pool.hpp"
 
 #include <cassert>
+
+#include "common/miscellaneous.hpp"
+#include "rma/common/knobs.hpp"
 #include "rebalancing_worker.hpp"
 
 using namespace std;
@@ -34,19 +37,22 @@ extern mutex _debug_mutex; // PackedMemoryArray.cpp
 #endif
 
 
-RebalancingPool::RebalancingPool(uint64_t num_workers) : m_num_workers_active(0){
+RebalancingPool::RebalancingPool(uint64_t num_workers) : m_num_workers(num_workers), m_num_workers_active(0), m_numa_policy(common::NumaPolicy::NONE), m_numa_owner(0){
     // create the pool
+    m_workers.reserve(num_workers);
     m_workers_idle.reserve(num_workers);
     for(size_t i = 0; i < num_workers; i++){
-        m_workers_idle.push_back(new RebalancingWorker());
+        m_workers.push_back(new RebalancingWorker());
+        m_workers_idle.push_back(m_workers.back());
     }
 }
 
 RebalancingPool::~RebalancingPool() {
     stop();
 
-    for(size_t i = 0; i < m_workers_idle.size(); i++){
-        delete m_workers_idle[i]; m_workers_idle[i] = nullptr;
+    m_workers_idle.clear();
+    for(size_t i = 0; i < m_workers.size(); i++){
+        delete m_workers[i]; m_workers[i] = nullptr;
     }
 }
 
@@ -79,6 +85,27 @@ RebalancingWorker* RebalancingPool::acquire(){
     }
 }
 
+RebalancingWorker* RebalancingPool::acquire_on_node(int numa_node){
+    scoped_lock<mutex> lock(m_mutex);
+    if(m_workers_idle.empty()) return nullptr;
+
+    // as #acquire(), the last worker released, unless there is an idle worker in the given node
+    size_t index = m_workers_idle.size() -1;
+    if(numa_node >= 0){
+        for(size_t i = m_workers_idle.size(); i > 0; i--){
+            if(m_workers_idle[i -1]->get_numa_node() == numa_node){
+                index = i -1;
+                break;
+            }
+        }
+    }
+
+    RebalancingWorker* worker = m_workers_idle[index];
+    m_workers_idle.erase(m_workers_idle.begin() + index);
+    m_num_workers_active++;
+    return worker;
+}
+
 vector<RebalancingWorker*> RebalancingPool::acquire(size_t num_workers){
     scoped_lock<mutex> lock(m_mutex);
     vector<RebalancingWorker*> result;
@@ -101,4 +128,26 @@ bool RebalancingPool::active() const {
     return m_num_workers_active > 0;
 }
 
+void RebalancingPool::set_numa_policy(common::NumaPolicy policy, int owner_node){
+    scoped_lock<mutex> lock(m_mutex);
+    if(policy == m_numa_policy && owner_node == m_numa_owner) return; // nop
+
+    const int num_nodes = ::common::get_numa_max_node() +1; // 0 if libnuma is not available
+    for(size_t i = 0; i < m_workers.size(); i++){
+        int numa_node = -1;
+        if(num_nodes > 0){
+            switch(policy){
+            case common::NumaPolicy::NONE: numa_node = -1; break;
+            case common::NumaPolicy::OWNER: numa_node = owner_node; break;
+            case common::NumaPolicy::INTERLEAVED:
+            case common::NumaPolicy::PARTITIONED: numa_node = i % num_nodes; break;
+            }
+        }
+        m_workers[i]->set_numa_node(numa_node);
+    }
+
+    m_numa_policy = policy;
+    m_numa_owner = owner_node;
+}
+
 } // namespace
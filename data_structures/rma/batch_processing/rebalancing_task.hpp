@@ -18,14 +18,16 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
 #include <cinttypes>
 #include <condition_variable>
 #include <mutex>
 #include <ostream>
 #include <vector>
 
+#include "rma/common/rebalancing_statistics.hpp"
+#include "rma/common/subtask_deques.hpp"
 #include "rebalance_plan.hpp"
-#include "rebalancing_statistics.hpp"
 
 namespace data_structures::rma::common { class StaticIndex; } // forward decl.
 
@@ -38,6 +40,10 @@ class PackedMemoryArray;
 class RebalancingMaster;
 struct Storage;
 
+// aliases
+using RebalancingStatistics = common::RebalancingStatistics;
+using RebalancingTimer = common::RebalancingTimer;
+
 class RebalancingTask {
 public:
     PackedMemoryArray * const m_pma;
@@ -56,10 +62,19 @@ public:
     int64_t m_blocked_on_lock = -1; // only used by the Master to keep track which extent need to be processed before this task can be executed
     size_t m_num_locks = 0; // keep track of the previous number of gates, before a resize
     bool m_forced_resize; // true if |cardinality| < capacity /2
+    bool m_use_rewiring = true; // whether the extents spread into a buffer are rewired (true) or copied back in place (false)
+    bool m_proactive = false; // whether the task was started by the master on its own, rather than on request of a client
+    const std::chrono::steady_clock::time_point m_time_created = std::chrono::steady_clock::now(); // to age the priority of the task in the todo list
 
     // Bulk Loading
     using insertion_t = std::pair<int64_t, int64_t>;
     std::vector<ClientContextQueue*> m_blkld_elts; // writer queues with the elements to insert, possibly unsorted
+    std::vector<insertion_t> m_blkld_sorted; // the elements of all writer queues, merged into a single sorted stream
+    std::vector<int64_t> m_blkld_partitions; // the first key of each partition of the sorted stream, merged in parallel by the workers
+    std::atomic<int64_t> m_blkld_next_queue = 0; // the next writer queue to sort
+    std::atomic<int64_t> m_blkld_queues_sorted = 0; // the number of writer queues sorted so far
+    std::atomic<int64_t> m_blkld_num_partitions = -1; // the number of partitions to merge, -1 until the first worker has defined them
+    std::atomic<int64_t> m_blkld_next_partition = 0; // the next partition to merge
 
     // Only used by the workers
     struct SubTask {
@@ -69,7 +84,7 @@ public:
         int64_t m_blkload_start, m_blkload_end;
         int64_t m_cardinality; // total cardinality (input + bulk loading)
     };
-    std::vector<SubTask> m_subtasks;
+    common::SubTaskDeques<SubTask> m_subtasks; // one deque per worker, idle workers steal from the others
     std::vector<int64_t> m_input_watermarks;
     std::mutex m_workers_mutex;
     std::condition_variable m_workers_condvar;
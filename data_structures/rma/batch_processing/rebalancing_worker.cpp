@@ -17,11 +17,15 @@
 
 #include "rebalancing_worker.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <chrono> // debug only
 #include <condition_variable>
 #include <limits>
 #include <mutex>
+#if defined(HAVE_LIBNUMA)
+#include <numa.h>
+#endif
 #include <thread>
 #include <vector> // check all
 
@@ -75,7 +79,7 @@ thread_local std::vector<std::tuple<int64_t, int64_t, int64_t>> _debug_items;
 
 static RebalancingTask* const FLAG_STOP = reinterpret_cast<RebalancingTask*>(0x1);
 
-RebalancingWorker::RebalancingWorker() : m_task(nullptr), m_worker_id(-1) {
+RebalancingWorker::RebalancingWorker() : m_task(nullptr), m_worker_id(-1), m_blkld_merge(false), m_numa_node(-1), m_numa_node_current(-2 /* not pinned yet */) {
 
 }
 
@@ -107,23 +111,46 @@ void RebalancingWorker::execute(RebalancingTask* task){
     execute0(task, 0);
 }
 
-void RebalancingWorker::execute0(RebalancingTask* task, int64_t worker_id){
+void RebalancingWorker::execute0(RebalancingTask* task, int64_t worker_id, bool blkld_merge){
     assert(worker_id >= 0 && "Invalid worker ID");
+    assert((!blkld_merge || worker_id > 0) && "Only the other workers can be acquired to merge the bulk loading queues");
     unique_lock<mutex> lock(m_mutex);
     if(m_task != nullptr) RAISE_EXCEPTION(Exception, "A task is already on execution.");
     m_task = task;
     m_worker_id = worker_id;
+    m_blkld_merge = blkld_merge;
     m_condition_variable.notify_one();
     lock.unlock();
 }
 
+void RebalancingWorker::set_numa_node(int numa_node) noexcept {
+    m_numa_node = numa_node;
+}
+
+int RebalancingWorker::get_numa_node() const noexcept {
+    return m_numa_node;
+}
+
+void RebalancingWorker::pin_to_numa_node(){
+#if defined(HAVE_LIBNUMA)
+    int numa_node = m_numa_node;
+    if(numa_node == m_numa_node_current) return; // already there
+    if(numa_node < 0){
+        pin_thread_to_cpu(0, /* verbose */ false);
+    } else {
+        pin_thread_to_numa_node(numa_node);
+        // drop the memory binding set by pin_thread_to_cpu, the buffers written by this worker should be allocated in its node
+        numa_set_localalloc();
+    }
+    m_numa_node_current = numa_node;
+#endif
+}
+
 void RebalancingWorker::main_thread() {
     COUT_DEBUG("Started");
     set_thread_name(string("RB Worker ") + to_string(get_thread_id()));
 
-#if defined(HAVE_LIBNUMA)
-    pin_thread_to_cpu(0, /* verbose */ false);
-#endif
+    pin_to_numa_node();
 
     unique_lock<mutex> lock(m_mutex);
     while(true){
@@ -138,6 +165,7 @@ void RebalancingWorker::main_thread() {
         RebalancingPool& thread_pool = master->thread_pool();
 
         // Execute the task received
+        pin_to_numa_node();
         do_execute();
 
         // BUGFIX: when worker_id > 0, after do_execute() completed we cannot look at the content of m_task:
@@ -146,6 +174,7 @@ void RebalancingWorker::main_thread() {
         // cleanup its state for the next task
         m_task = nullptr;
         m_worker_id = -1;
+        m_blkld_merge = false;
 
         thread_pool.release(this); // done
         if(submit_task_done != nullptr){
@@ -199,6 +228,8 @@ void RebalancingWorker::do_execute() {
 
         // Remove all elts from the bulk loading queues
         clear_blkload_queues();
+    } else if(m_blkld_merge){ // worker_id > 0, acquired by sort_blkload_elts()
+        do_merge_blkload_elts();
     } else { // worker_id > 0
         do_execute_queue();
     }
@@ -213,6 +244,7 @@ void RebalancingWorker::do_execute() {
  *****************************************************************************/
 void RebalancingWorker::do_execute_single(){
     IF_PROFILING( auto t0 = chrono::steady_clock::now() );
+    IF_PROFILING( uint64_t page_faults_t0 = get_thread_page_faults() );
 
     switch(m_task->m_plan.m_operation){
     case RebalanceOperation::REBALANCE: {
@@ -240,6 +272,7 @@ void RebalancingWorker::do_execute_single(){
 
     IF_PROFILING( auto t1 = chrono::steady_clock::now() );
     IF_PROFILING( m_task->m_statistics.m_worker_task_exec_time.push_back( (int64_t) chrono::duration_cast<chrono::microseconds>(t1 - t0).count() ));
+    IF_PROFILING( m_task->m_statistics.m_worker_page_faults += get_thread_page_faults() - page_faults_t0 );
 }
 
 /*****************************************************************************
@@ -248,15 +281,19 @@ void RebalancingWorker::do_execute_single(){
  *                                                                           *
  *****************************************************************************/
 void RebalancingWorker::make_subtasks(){
-    constexpr size_t EXTENTS_PER_SUBTASK = 4; // at least 8 MB => 128k slots
+    constexpr int64_t EXTENTS_PER_SUBTASK = 4; // at least 8 MB => 128k slots
+    constexpr int64_t SUBTASKS_PER_WORKER = 4; // create more subtasks than workers, so that idle workers can steal the remaining ones
     Storage& storage_input = m_task->m_pma->m_storage;
     const int64_t segments_per_extent = storage_input.get_segments_per_extent();
     const size_t segment_capacity = storage_input.m_segment_capacity;
     const int64_t window_end_before = m_task->m_plan.m_operation == RebalanceOperation::REBALANCE ? m_task->get_window_end() : storage_input.m_number_segments;
     InputIterator position { storage_input, m_task->get_window_start(), window_end_before };
-    const int64_t num_subtasks = max<int64_t>(m_task->get_extent_length() / EXTENTS_PER_SUBTASK, 1); // at least one subtask
+    // split the window in chunks of EXTENTS_PER_SUBTASK, but use finer subtasks (down to one extent each) when there are not
+    // enough of them to balance the load among the workers, e.g. with skewed bulk loading queues
+    const int64_t num_workers = m_task->m_master->thread_pool().num_workers();
+    const int64_t num_subtasks = max<int64_t>(1, max(m_task->get_extent_length() / EXTENTS_PER_SUBTASK, min<int64_t>(m_task->get_extent_length(), num_workers * SUBTASKS_PER_WORKER)));
     BulkLoadingIterator loader { m_task };
-
+    vector<RebalancingTask::SubTask> subtasks;
 
     if(num_subtasks == 1){
         RebalancingTask::SubTask subtask;
@@ -270,7 +307,7 @@ void RebalancingWorker::make_subtasks(){
         subtask.m_blkload_end = loader.get_absolute_position_end();
         subtask.m_cardinality = m_task->m_plan.get_cardinality_after();
         COUT_DEBUG("Single subtask: " << subtask);
-        m_task->m_subtasks.push_back(subtask);
+        subtasks.push_back(subtask);
         IF_PROFILING( m_task->m_statistics.m_worker_num_subtaks = 1 );
     } else {
         IF_PROFILING( RebalancingTimer timer { m_task->m_statistics.m_worker_make_subtasks_time } );
@@ -292,7 +329,7 @@ void RebalancingWorker::make_subtasks(){
         for(int64_t subtask_id = 0; subtask_id < num_subtasks; subtask_id++){
             RebalancingTask::SubTask subtask;
             // output window
-            subtask.m_output_extent_start = (subtask_id == 0) ? m_task->get_extent_start() : m_task->m_subtasks.back().m_output_extent_end;
+            subtask.m_output_extent_start = (subtask_id == 0) ? m_task->get_extent_start() : subtasks.back().m_output_extent_end;
             int64_t subtask_num_extents = extents_per_subtask + (subtask_id < num_odd_subtasks);
             assert(subtask_num_extents >= 1);
             subtask.m_output_extent_end = subtask.m_output_extent_start + subtask_num_extents;
@@ -372,7 +409,7 @@ void RebalancingWorker::make_subtasks(){
             debug_loader_last = _debug_loader_start + _debug_loader_count;
 #endif
 
-            m_task->m_subtasks.push_back(subtask);
+            subtasks.push_back(subtask);
             IF_PROFILING( m_task->m_statistics.m_worker_num_subtaks++ );
         }
 
@@ -381,11 +418,15 @@ void RebalancingWorker::make_subtasks(){
 #endif
 
         // reverse the order of the queue, workers fetch from the latest to the first
-        std::reverse(begin(m_task->m_subtasks), end(m_task->m_subtasks));
+        std::reverse(begin(subtasks), end(subtasks));
     }
+
+    // one contiguous block of subtasks for each worker
+    m_task->m_subtasks.assign(subtasks, num_workers);
 }
 
 void RebalancingWorker::do_execute_queue(){
+    IF_PROFILING( uint64_t page_faults_t0 = get_thread_page_faults() );
     int64_t next_worker_id = 1;
     const bool is_rebalance = m_task->m_plan.m_operation == RebalanceOperation::REBALANCE || m_task->m_plan.m_operation == RebalanceOperation::RESIZE_REBALANCE;
 
@@ -398,12 +439,12 @@ void RebalancingWorker::do_execute_queue(){
 
         { // fetch the next subtask to execute
             unique_lock<mutex> lock(m_task->m_workers_mutex);
-            if(m_task->m_subtasks.empty()){
+            bool stolen = false;
+            if(!m_task->m_subtasks.fetch(m_worker_id, subtask, stolen)){
                 break; // terminate the while loop
             } else {
-                subtask = m_task->m_subtasks.back();
-                m_task->m_subtasks.pop_back();
-                COUT_DEBUG("Subtask fetched: " << subtask);
+                COUT_DEBUG("Subtask fetched: " << subtask << ", stolen: " << stolen);
+                IF_PROFILING( if(stolen){ m_task->m_statistics.m_worker_num_stolen_subtasks++; } );
 
                 if(is_rebalance){
                     if(subtask_protect_extent >= 0){ // remove the previous watermark
@@ -416,6 +457,11 @@ void RebalancingWorker::do_execute_queue(){
                     subtask_protect_extent = subtask.m_input_extent_start;
                     m_task->m_input_watermarks.push_back(subtask_protect_extent);
                     input_extent_watermark = *(std::min_element(begin(m_task->m_input_watermarks), end(m_task->m_input_watermarks)));
+                    // with stealing, the subtasks are not fetched from the first to the last anymore: also protect the input
+                    // of the subtasks still in the deques, the next subtask of each deque is the one reading the lowest extents
+                    m_task->m_subtasks.for_each_next([&input_extent_watermark](const RebalancingTask::SubTask& next){
+                        input_extent_watermark = min(input_extent_watermark, next.m_input_extent_start);
+                    });
                     COUT_DEBUG("Subtask input watermark (extent): " << subtask_protect_extent);
                 }
             }
@@ -455,7 +501,7 @@ void RebalancingWorker::do_execute_queue(){
     }
     assert(m_extents_to_rewire.empty());
 
-    IF_PROFILING( { unique_lock<mutex> lock(m_task->m_workers_mutex); for(auto time : execution_times) m_task->m_statistics.m_worker_task_exec_time.push_back(time); })
+    IF_PROFILING( { unique_lock<mutex> lock(m_task->m_workers_mutex); for(auto time : execution_times) m_task->m_statistics.m_worker_task_exec_time.push_back(time); m_task->m_statistics.m_worker_page_faults += get_thread_page_faults() - page_faults_t0; })
 
     m_task->m_active_workers--;
     m_task->m_workers_condvar.notify_all();
@@ -504,7 +550,7 @@ void RebalancingWorker::spread_local(){
     unique_ptr<int64_t, decltype(fn_deallocate)> ptr_workspace_values { memory_pool.allocate<int64_t>(plan.get_cardinality_before()), fn_deallocate };
     int64_t* __restrict workspace_keys = ptr_workspace_keys.get();
     int64_t* __restrict workspace_values = ptr_workspace_values.get();
-    uint16_t* __restrict input_cardinalities = m_task->m_ptr_storage->m_segment_sizes;
+    Storage::segment_size_t* __restrict input_cardinalities = m_task->m_ptr_storage->m_segment_sizes;
 
     // copy all input elements into the workspace
     assert(plan.m_window_start % 2 == 0 && "Expected to start from an even segment");
@@ -577,6 +623,17 @@ void RebalancingWorker::rebalance_rewire(Storage* storage, int64_t input_extent_
     const int64_t cardinality_per_segment = cardinality / (output_extent_length * segments_per_extent);
     int64_t num_odd_segments = cardinality % (output_extent_length * segments_per_extent);
 
+    // get some space from the rewiring facility, for all the extents to rewire at once: the extents from the watermark onwards
+    const int64_t first_buffer = max<int64_t>(0, min<int64_t>(output_extent_length, input_extent_watermark - output_extent_start));
+    const int64_t num_buffers = output_extent_length - first_buffer;
+    m_buffers_keys.resize(num_buffers);
+    m_buffers_values.resize(num_buffers);
+    if(num_buffers > 0){ // mutual exclusion
+        scoped_lock<SpinLock> lock(storage->m_mutex);
+        storage->m_memory_keys->acquire_buffers(m_buffers_keys.data(), num_buffers);
+        storage->m_memory_values->acquire_buffers(m_buffers_values.data(), num_buffers);
+    }
+
     for(int64_t i = 0; i < output_extent_length; i++){
         int64_t extent_id = output_extent_start + i;
         const bool use_rewiring = (extent_id >= input_extent_watermark);
@@ -598,13 +655,8 @@ void RebalancingWorker::rebalance_rewire(Storage* storage, int64_t input_extent_
         } else {
             COUT_DEBUG("extent: " << extent_id << ", spread with rewiring, watermark=" << input_extent_watermark);
 
-            // get some space from the rewiring facility
-            int64_t *buffer_keys{nullptr}, *buffer_values{nullptr};
-            { // mutual exclusion
-                scoped_lock<SpinLock> lock(storage->m_mutex);
-                buffer_keys = (int64_t*) storage->m_memory_keys->acquire_buffer();
-                buffer_values = (int64_t*) storage->m_memory_values->acquire_buffer();
-            }
+            int64_t* buffer_keys = (int64_t*) m_buffers_keys[i - first_buffer];
+            int64_t* buffer_values = (int64_t*) m_buffers_values[i - first_buffer];
             m_extents_to_rewire.push_back(Extent2Rewire{extent_id, buffer_keys, buffer_values});
 
             spread_rewire(storage,
@@ -624,6 +676,7 @@ void RebalancingWorker::spread_rewire(Storage* storage, int64_t& input_position_
     const size_t segments_per_extent = storage->get_segments_per_extent();
     const size_t segment_capacity = storage->m_segment_capacity;
     const size_t segment_base = extent_id * segments_per_extent;
+    const bool nontemporal = use_nontemporal_stores();
     int64_t input_idx {0}, input_run_sz {0}, input_initial_displacement{0};
     int64_t input_segment_id = (input_position_start / (2* segment_capacity)) *2; // even segment
     if(/* current position */ input_segment_id * segment_capacity < input_position_end){
@@ -704,8 +757,13 @@ void RebalancingWorker::spread_rewire(Storage* storage, int64_t& input_position_
             int64_t input_slots = input_run_sz - input_idx;
             int64_t cpy1 = min(input_slots, output_slots);
 
-            memcpy(output_keys + k, input_keys + input_idx, cpy1 * sizeof(output_keys[0]));
-            memcpy(output_values + k, input_values + input_idx, cpy1 * sizeof(output_keys[0]));
+            if(nontemporal){
+                memcpy_nontemporal(output_keys + k, input_keys + input_idx, cpy1);
+                memcpy_nontemporal(output_values + k, input_values + input_idx, cpy1);
+            } else {
+                memcpy(output_keys + k, input_keys + input_idx, cpy1 * sizeof(output_keys[0]));
+                memcpy(output_values + k, input_values + input_idx, cpy1 * sizeof(output_keys[0]));
+            }
 
             input_idx += cpy1;
             k += cpy1;
@@ -740,6 +798,8 @@ void RebalancingWorker::spread_rewire(Storage* storage, int64_t& input_position_
         set_separator_key(segment_base + output_segment_id + 1, output_keys[output_run_sz_lhs]);
     }
 
+    if(nontemporal) store_fence(); // the extent may be rewired or read by other threads as soon as we return
+
     // update the final position
     input_position_start = /* all inputs ahead are empty ? */ input_run_sz == 0 ?
             /* eof */ input_position_end :
@@ -773,7 +833,7 @@ void RebalancingWorker::resize(const Storage* input, Storage* output, int64_t in
 
     // input
     const int64_t segment_capacity = input->m_segment_capacity;
-    uint16_t* __restrict input_sizes = input->m_segment_sizes;
+    Storage::segment_size_t* __restrict input_sizes = input->m_segment_sizes;
     int64_t input_initial_displacement {0}, input_run_sz {0};
     int64_t input_segment_id = (input_position_start / (2* segment_capacity)) *2; // even segment
     if(/* current position */ input_segment_id * segment_capacity < input_position_end){
@@ -792,6 +852,7 @@ void RebalancingWorker::resize(const Storage* input, Storage* output, int64_t in
 
     // the loader should already be ready
     auto blkelt = loader.get();
+    const bool nontemporal = use_nontemporal_stores();
 
     // output
     int64_t* __restrict output_base_keys = output->m_keys + output_window_start * output->m_segment_capacity;
@@ -846,8 +907,13 @@ void RebalancingWorker::resize(const Storage* input, Storage* output, int64_t in
             int64_t output_slots = output_run_sz - k;
             int64_t input_slots = input_run_sz - input_idx;
             int64_t cpy1 = min(input_slots, output_slots);
-            memcpy(output_keys + k, input_keys + input_idx, cpy1 * sizeof(output_keys[0]));
-            memcpy(output_values + k, input_values + input_idx, cpy1 * sizeof(output_keys[0]));
+            if(nontemporal){
+                memcpy_nontemporal(output_keys + k, input_keys + input_idx, cpy1);
+                memcpy_nontemporal(output_values + k, input_values + input_idx, cpy1);
+            } else {
+                memcpy(output_keys + k, input_keys + input_idx, cpy1 * sizeof(output_keys[0]));
+                memcpy(output_values + k, input_values + input_idx, cpy1 * sizeof(output_keys[0]));
+            }
 
             input_idx += cpy1;
             k += cpy1;
@@ -884,9 +950,17 @@ void RebalancingWorker::resize(const Storage* input, Storage* output, int64_t in
             set_separator_key(output_window_start + segment_id + 1, output_keys[output_run_sz_lhs]);
     }
 
+    if(nontemporal) store_fence(); // the new storage is read by other threads as soon as the resize completes
+
     COUT_DEBUG("final position: " << (input_keys - input->m_keys + input_idx));
 }
 
+bool RebalancingWorker::use_nontemporal_stores() const {
+    // both keys & values are moved
+    uint64_t window_sz = m_task->m_plan.get_cardinality_after() * 2 * sizeof(int64_t);
+    return window_sz >= m_task->m_pma->knobs().get_nontemporal_threshold();
+}
+
 /*****************************************************************************
  *                                                                           *
  *   Index                                                                   *
@@ -925,17 +999,143 @@ void RebalancingWorker::set_separator_key(uint64_t segment_id, int64_t key){
  *****************************************************************************/
 void RebalancingWorker::sort_blkload_elts(){
     IF_PROFILING( RebalancingTimer timer { m_task->m_statistics.m_worker_sort_time } );
+    constexpr size_t PARALLEL_MERGE_THRESHOLD = 16384; // min number of elements to share the sort & the merge with other workers
+    constexpr int64_t PARTITIONS_PER_WORKER = 4; // create more partitions than workers, so that idle workers can fetch the remaining ones
+    auto& queues = m_task->m_blkld_elts;
+    auto& output = m_task->m_blkld_sorted;
+    assert(output.empty() && "The elements have already been merged");
+
+    // a single queue is already a sorted stream
+    if(queues.size() == 1){
+        auto& vect = queues[0]->insertions();
+        std::sort(std::begin(vect), std::end(vect));
+        output.swap(vect);
+        return;
+    }
+
+    size_t cardinality = 0;
+    for(size_t i = 0; i < queues.size(); i++){ cardinality += queues[i]->insertions().size(); }
+    output.resize(cardinality); // the partitions are merged directly into their position
+
+    // try to obtain more workers to sort & merge the queues
+    m_task->m_blkld_next_queue = 0;
+    m_task->m_blkld_queues_sorted = 0;
+    m_task->m_blkld_num_partitions = -1;
+    m_task->m_blkld_next_partition = 0;
+    m_task->m_active_workers = 0;
+    int64_t num_workers = 1; // myself
+    if(cardinality >= PARALLEL_MERGE_THRESHOLD){
+        std::vector<RebalancingWorker*> workers = m_task->m_master->thread_pool().acquire(queues.size() -1);
+        for(size_t i = 0; i < workers.size(); i++){
+            m_task->m_active_workers++;
+            workers[i]->execute0(m_task, num_workers++, /* merge only */ true);
+        }
+    }
 
-    // sort the list of vectors
-    std::sort(begin(m_task->m_blkld_elts), end(m_task->m_blkld_elts), [](auto v1, auto v2){
-       assert(! v1->empty() && ! v2->empty() );
-       return v1->insertions()[0] < v2->insertions()[0]; // just compare the first elt
-    });
+    // sort the single vectors & wait for the other workers to sort theirs
+    sort_blkload_queues();
+    while(m_task->m_blkld_queues_sorted < static_cast<int64_t>(queues.size())){ std::this_thread::yield(); }
+
+    // Each queue holds the insertions of a single gate. Partition the sorted stream at the first keys of the gates, so that each
+    // partition contains about the same number of elements. The elements of a partition are preceded in the sorted stream by all
+    // the elements with a smaller key, in all queues, so the workers can merge the partitions independently one from the other.
+    struct Head { int64_t m_key; size_t m_size; };
+    vector<Head> heads; heads.reserve(queues.size());
+    for(size_t i = 0; i < queues.size(); i++){
+        const auto& vect = queues[i]->insertions();
+        if(!vect.empty()){ heads.push_back(Head{ vect[0].first, vect.size() }); }
+    }
+    std::sort(begin(heads), end(heads), [](const Head& h1, const Head& h2){ return h1.m_key < h2.m_key; });
+    const size_t num_partitions_max = (num_workers > 1) ? min<size_t>(heads.size(), num_workers * PARTITIONS_PER_WORKER) : 1;
+    auto& partitions = m_task->m_blkld_partitions;
+    partitions.clear();
+    partitions.push_back(numeric_limits<int64_t>::min());
+    size_t num_elts = 0;
+    for(size_t i = 0; i < heads.size(); i++){
+        if(num_elts >= cardinality * partitions.size() / num_partitions_max && heads[i].m_key > partitions.back()){
+            partitions.push_back(heads[i].m_key);
+        }
+        num_elts += heads[i].m_size;
+    }
+    m_task->m_blkld_num_partitions = partitions.size(); // let the other workers start merging
+
+    merge_blkload_partitions();
+
+    // wait for all workers to complete
+    if(m_task->m_active_workers > 0){ // restrict the scope
+        unique_lock<mutex> lock(m_task->m_workers_mutex);
+        while(m_task->m_active_workers > 0){ m_task->m_workers_condvar.wait_for(lock, 1ms); } // 1 millisecond
+    }
+    assert(std::is_sorted(begin(output), end(output)) && "The elements have not been merged properly");
+}
+
+void RebalancingWorker::do_merge_blkload_elts(){
+    sort_blkload_queues();
+    while(m_task->m_blkld_num_partitions < 0){ std::this_thread::yield(); } // wait for the first worker to define the partitions
+    merge_blkload_partitions();
+
+    // after this point, the task can be released at any time by the first worker
+    unique_lock<mutex> lock(m_task->m_workers_mutex);
+    m_task->m_active_workers--;
+    m_task->m_workers_condvar.notify_all();
+}
 
-    // sort the single vectors
-    for(size_t i = 0; i < m_task->m_blkld_elts.size(); i++){
-        auto& vect = m_task->m_blkld_elts[i]->insertions();
+void RebalancingWorker::sort_blkload_queues(){
+    const int64_t num_queues = m_task->m_blkld_elts.size();
+    int64_t queue_id = 0;
+    while((queue_id = m_task->m_blkld_next_queue++) < num_queues){
+        auto& vect = m_task->m_blkld_elts[queue_id]->insertions();
         std::sort(std::begin(vect), std::end(vect));
+        m_task->m_blkld_queues_sorted++;
+    }
+}
+
+void RebalancingWorker::merge_blkload_partitions(){
+    const int64_t num_partitions = m_task->m_blkld_num_partitions;
+    int64_t partition_id = 0;
+    while((partition_id = m_task->m_blkld_next_partition++) < num_partitions){
+        merge_blkload_partition(partition_id);
+    }
+}
+
+void RebalancingWorker::merge_blkload_partition(int64_t partition_id){
+    using insertion_t = RebalancingTask::insertion_t;
+    const auto& queues = m_task->m_blkld_elts;
+    const auto& partitions = m_task->m_blkld_partitions;
+    const bool is_last = partition_id == static_cast<int64_t>(partitions.size()) -1;
+    auto compare_key = [](const insertion_t& element, int64_t key){ return element.first < key; };
+
+    // the range of each queue in the partition [partitions[partition_id], partitions[partition_id +1])
+    struct Run { const insertion_t* m_begin; const insertion_t* m_end; };
+    vector<Run> heap; heap.reserve(queues.size());
+    size_t offset = 0; // the position in the sorted stream of the first element of the partition
+    for(size_t i = 0; i < queues.size(); i++){
+        const auto& vect = queues[i]->insertions();
+        const insertion_t* vect_end = vect.data() + vect.size();
+        const insertion_t* run_begin = (partition_id == 0) ? vect.data() : std::lower_bound(vect.data(), vect_end, partitions[partition_id], compare_key);
+        const insertion_t* run_end = is_last ? vect_end : std::lower_bound(run_begin, vect_end, partitions[partition_id +1], compare_key);
+        offset += run_begin - vect.data();
+        if(run_begin < run_end){ heap.push_back(Run{ run_begin, run_end }); }
+    }
+
+    // k-way merge of the sorted runs. At each step, copy from the run with the smallest head all elements up to the head
+    // of the next run, so that runs covering disjoint ranges of keys are appended with a single copy each
+    auto greater = [](const Run& r1, const Run& r2){ return *(r1.m_begin) > *(r2.m_begin); }; // min heap
+    std::make_heap(begin(heap), end(heap), greater);
+    insertion_t* __restrict output = m_task->m_blkld_sorted.data() + offset;
+    while(!heap.empty()){
+        std::pop_heap(begin(heap), end(heap), greater);
+        Run& run = heap.back();
+        const insertion_t* stop = (heap.size() == 1) ? run.m_end : std::upper_bound(run.m_begin, run.m_end, *(heap.front().m_begin));
+        assert(stop > run.m_begin && "The run should contain at least its head");
+        output = std::copy(run.m_begin, stop, output);
+        run.m_begin = stop;
+
+        if(run.m_begin == run.m_end){
+            heap.pop_back();
+        } else {
+            std::push_heap(begin(heap), end(heap), greater);
+        }
     }
 }
 
@@ -944,6 +1144,7 @@ void RebalancingWorker::clear_blkload_queues(){
     for(size_t i = 0, sz = m_task->m_blkld_elts.size(); i < sz; i++){
         delete m_task->m_blkld_elts[i]; m_task->m_blkld_elts[i] = nullptr;
     }
+    std::vector<RebalancingTask::insertion_t>().swap(m_task->m_blkld_sorted); // release the memory
 }
 
 /*****************************************************************************
@@ -960,19 +1161,52 @@ void RebalancingWorker::reclaim_past_extents(int64_t input_extent_watermark){
     int64_t segment_capacity = storage->m_segment_capacity;
 
     scoped_lock<SpinLock> lock(storage->m_mutex);
-    do {
-        auto& metadata = m_extents_to_rewire.front();
-        auto extent_id = metadata.m_extent_id;
-        auto offset_dst = extent_id * segments_per_extent * segment_capacity;
-        auto keys_dst = storage->m_keys + offset_dst;
-        auto keys_src = metadata.m_buffer_keys;
-        auto values_dst = storage->m_values + offset_dst;
-        auto values_src = metadata.m_buffer_values;
-        m_extents_to_rewire.pop_front();
-//        COUT_DEBUG("reclaim buffers for extent: " << metadata.m_extent_id << ", keys: " << keys_src << ", values: " << values_src);
-        storage->m_memory_keys->swap_and_release(keys_dst, keys_src);
-        storage->m_memory_values->swap_and_release(values_dst, values_src);
-    } while (!m_extents_to_rewire.empty() && m_extents_to_rewire.front().m_extent_id < input_extent_watermark);
+    if(m_task->m_use_rewiring){
+        // collect the buffers to rewire, for the keys first and then for the values, and swap them in batch
+        IF_PROFILING( auto t0 = chrono::steady_clock::now() );
+        int64_t num_syscalls = 0;
+        size_t num_extents = 0;
+        while(num_extents < m_extents_to_rewire.size() && m_extents_to_rewire[num_extents].m_extent_id < input_extent_watermark){ num_extents++; }
+
+        m_rewire_pairs.clear();
+        for(size_t i = 0; i < num_extents; i++){
+            auto& metadata = m_extents_to_rewire[i];
+            m_rewire_pairs.emplace_back(storage->m_keys + metadata.m_extent_id * segments_per_extent * segment_capacity, metadata.m_buffer_keys);
+        }
+        num_syscalls += storage->m_memory_keys->swap_and_release_many(m_rewire_pairs.data(), m_rewire_pairs.size());
+
+        m_rewire_pairs.clear();
+        for(size_t i = 0; i < num_extents; i++){
+            auto& metadata = m_extents_to_rewire[i];
+            m_rewire_pairs.emplace_back(storage->m_values + metadata.m_extent_id * segments_per_extent * segment_capacity, metadata.m_buffer_values);
+        }
+        num_syscalls += storage->m_memory_values->swap_and_release_many(m_rewire_pairs.data(), m_rewire_pairs.size());
+
+        COUT_DEBUG("extents rewired: " << num_extents << ", mmap syscalls: " << num_syscalls);
+        m_extents_to_rewire.erase(begin(m_extents_to_rewire), begin(m_extents_to_rewire) + num_extents);
+
+        // the statistics are shared with the other workers of the task, but they are protected by the storage lock
+        IF_PROFILING( m_task->m_statistics.m_worker_rewiring_time += chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - t0).count() );
+        IF_PROFILING( m_task->m_statistics.m_worker_rewired_extents += num_extents * 2 );
+        IF_PROFILING( m_task->m_statistics.m_worker_rewiring_syscalls += num_syscalls );
+    } else { // cheaper to copy the buffers back in place
+        do {
+            auto& metadata = m_extents_to_rewire.front();
+            auto extent_id = metadata.m_extent_id;
+            auto offset_dst = extent_id * segments_per_extent * segment_capacity;
+            auto keys_dst = storage->m_keys + offset_dst;
+            auto keys_src = metadata.m_buffer_keys;
+            auto values_dst = storage->m_values + offset_dst;
+            auto values_src = metadata.m_buffer_values;
+            m_extents_to_rewire.pop_front();
+//            COUT_DEBUG("reclaim buffers for extent: " << metadata.m_extent_id << ", keys: " << keys_src << ", values: " << values_src);
+            const size_t extent_size = storage->m_memory_keys->get_extent_size();
+            memcpy(keys_dst, keys_src, extent_size);
+            memcpy(values_dst, values_src, extent_size);
+            storage->m_memory_keys->release_buffer(keys_src);
+            storage->m_memory_values->release_buffer(values_src);
+        } while (!m_extents_to_rewire.empty() && m_extents_to_rewire.front().m_extent_id < input_extent_watermark);
+    }
 }
 
 /*****************************************************************************
@@ -982,7 +1216,7 @@ void RebalancingWorker::reclaim_past_extents(int64_t input_extent_watermark){
  *****************************************************************************/
 void RebalancingWorker::update_segment_cardinalities() {
     IF_PROFILING( RebalancingTimer timer { m_task->m_statistics.m_worker_segment_cards } );
-    uint16_t* __restrict cardinalities_shifted = m_task->m_ptr_storage->m_segment_sizes + m_task->get_window_start();
+    Storage::segment_size_t* __restrict cardinalities_shifted = m_task->m_ptr_storage->m_segment_sizes + m_task->get_window_start();
     Gate* __restrict locks = m_task->m_ptr_locks;
 
     int64_t cardinality_per_segment = m_task->m_plan.get_cardinality_after() / m_task->get_window_length();
@@ -998,7 +1232,7 @@ void RebalancingWorker::update_segment_cardinalities() {
         for(int64_t j = 0; j < num_segments_per_lock; j++){
             int64_t tpma_card = cardinality_per_segment + (segment_id < num_odd_segments);
             lock_cardinality += tpma_card;
-            cardinalities_shifted[segment_id] = (uint16_t) tpma_card;
+            cardinalities_shifted[segment_id] = (Storage::segment_size_t) tpma_card;
             segment_id++;
         }
 
@@ -1060,7 +1294,7 @@ int64_t RebalancingWorker::InputIterator::get_key() const {
 
     // aliases
     const int64_t segment_capacity = m_storage.m_segment_capacity;
-    const uint16_t* __restrict cardinalities = m_storage.m_segment_sizes;
+    const Storage::segment_size_t* __restrict cardinalities = m_storage.m_segment_sizes;
 
     if(m_feature == MarkerPosition::END){
         int64_t segment_id = ((m_position -1) / (2* segment_capacity)) *2; // even segment
@@ -1103,7 +1337,7 @@ void RebalancingWorker::InputIterator::move_forwards_by(int64_t shift){
 
     // aliases
     const int64_t segment_capacity = m_storage.m_segment_capacity;
-    const uint16_t* __restrict cardinalities = m_storage.m_segment_sizes;
+    const Storage::segment_size_t* __restrict cardinalities = m_storage.m_segment_sizes;
 
     fetch_next_chunk();
 
@@ -1168,7 +1402,7 @@ void RebalancingWorker::InputIterator::move_backwards_by(int64_t shift){
 
     // aliases
     const int64_t segment_capacity = m_storage.m_segment_capacity;
-    const uint16_t* __restrict cardinalities = m_storage.m_segment_sizes;
+    const Storage::segment_size_t* __restrict cardinalities = m_storage.m_segment_sizes;
 
     int64_t segment_id { 0 };
     if(m_feature == MarkerPosition::END){
@@ -1263,118 +1497,38 @@ std::ostream& operator<<(std::ostream& out, const RebalancingWorker::InputIterat
 
 RebalancingWorker::BulkLoadingIterator::BulkLoadingIterator(const RebalancingTask* task) :
     BulkLoadingIterator(task, 0, task->m_plan.get_cardinality_after() - task->m_plan.get_cardinality_before()){ }
-RebalancingWorker::BulkLoadingIterator::BulkLoadingIterator(const RebalancingTask* task, size_t start, size_t end) : m_vectors(task->m_blkld_elts){
+RebalancingWorker::BulkLoadingIterator::BulkLoadingIterator(const RebalancingTask* task, size_t start, size_t end) : m_elements(task->m_blkld_sorted.data()){
     assert(start <= end && "Invalid range");
-
-    // start & end positions
-    abs2vect(m_vectors, start, &m_vect_start, &m_pos_start);
-    abs2vect(m_vectors, end, &m_vect_last, &m_pos_end);
-
-    // current position
-    m_vect_pos = m_vect_start;
-    m_position = m_pos_start;
-
-    assert((empty() || (0 <= m_vect_start && m_vect_last < m_vectors.size())) && "Invalid range");
-
-    m_cardinality = 0;
-    if(!empty()){
-        for(size_t i = m_vect_start; i <= m_vect_last; i++){
-            m_cardinality += m_vectors[i]->insertions().size();
-        }
-        // remove the leading and trailing elements
-        m_cardinality -= m_pos_start;
-        m_cardinality -= (m_vectors[m_vect_last]->insertions().size() - m_pos_end);
-    }
-}
-void RebalancingWorker::BulkLoadingIterator::abs2vect(const element_list_t& vectors, int64_t absolute_position, int64_t* out_vect_id, int64_t* out_vect_offset) {
-    assert(out_vect_id != nullptr && out_vect_offset != nullptr);
-    int64_t vect_id = 0;
-    int64_t vect_offset = 0;
-
-    while(absolute_position > 0 && vect_id < static_cast<int64_t>(vectors.size())){
-        if(absolute_position >= vectors[vect_id]->insertions().size()){
-            absolute_position -= vectors[vect_id]->insertions().size();
-            vect_id++;
-        } else { // absolute_position <= | vector size |
-            vect_offset = absolute_position;
-            absolute_position = 0; // terminate the loop
-        }
-    }
-
-    if(vect_id >= static_cast<int64_t>(vectors.size())){ // out of range
-        *out_vect_id = (vectors.size() > 0) ? vectors.size() -1 : 0;
-        *out_vect_offset = (vectors.size() > 0) ? vectors[vectors.size() -1]->insertions().size() : 0;
-    } else {
-        *out_vect_id = vect_id;
-        *out_vect_offset = vect_offset;
-    }
-}
-int64_t RebalancingWorker::BulkLoadingIterator::vect2abs(const element_list_t& vectors, int64_t final_vect_id, int64_t final_vect_offset) {
-    if(final_vect_id < 0 || vectors.size() == 0) return 0;
-    if(final_vect_id > vectors.size()) {
-        final_vect_id = vectors.size();
-        final_vect_offset = 0;
-    }
-
-    int64_t absolute_position = 0;
-    int64_t vect_id = 0;
-    while(vect_id < final_vect_id){
-        absolute_position += vectors[vect_id]->insertions().size();
-        vect_id++;
-    }
-
-    absolute_position += final_vect_offset;
-
-    return absolute_position;
+    const int64_t size = task->m_blkld_sorted.size();
+    m_start = min<int64_t>(start, size);
+    m_end = min<int64_t>(end, size);
+    m_position = m_start;
 }
 std::pair<int64_t, int64_t> RebalancingWorker::BulkLoadingIterator::get() const {
     if(is_ahead()) return make_pair(std::numeric_limits<int64_t>::max(), std::numeric_limits<int64_t>::max());
     if(is_behind()) return make_pair(std::numeric_limits<int64_t>::min(), std::numeric_limits<int64_t>::min());
-
-    assert(m_vect_pos > m_vect_start || (m_vect_pos == m_vect_start && m_position >= m_pos_start));
-    assert(m_vect_pos < m_vect_last || (m_vect_pos == m_vect_last && m_position < m_pos_end));
-
-    // current elt to fetch
-    return m_vectors[m_vect_pos]->insertions().operator[](m_position);
+    return m_elements[m_position];
 }
-size_t RebalancingWorker::BulkLoadingIterator::cardinality() const { return m_cardinality; }
-bool RebalancingWorker::BulkLoadingIterator::empty() const { return m_vect_start == m_vect_last && m_pos_start == m_pos_end; }
-bool RebalancingWorker::BulkLoadingIterator::is_ahead() const { return empty() || m_vect_pos > m_vect_last || (m_vect_pos == m_vect_last && m_position >= m_pos_end); }
-bool RebalancingWorker::BulkLoadingIterator::is_behind() const { return m_vect_pos < m_vect_start || (m_vect_pos == m_vect_start && m_position < m_pos_start); }
-int64_t RebalancingWorker::BulkLoadingIterator::get_absolute_position_start() const{ return vect2abs(m_vectors, m_vect_start, m_pos_start); }
-int64_t RebalancingWorker::BulkLoadingIterator::get_absolute_position_current() const { return vect2abs(m_vectors, m_vect_pos, m_position); }
-int64_t RebalancingWorker::BulkLoadingIterator::get_absolute_position_end() const { return vect2abs(m_vectors, m_vect_last, m_pos_end); }
+size_t RebalancingWorker::BulkLoadingIterator::cardinality() const { return m_end - m_start; }
+bool RebalancingWorker::BulkLoadingIterator::empty() const { return m_start == m_end; }
+bool RebalancingWorker::BulkLoadingIterator::is_ahead() const { return m_position >= m_end; }
+bool RebalancingWorker::BulkLoadingIterator::is_behind() const { return m_position < m_start; }
+int64_t RebalancingWorker::BulkLoadingIterator::get_absolute_position_start() const{ return m_start; }
+int64_t RebalancingWorker::BulkLoadingIterator::get_absolute_position_current() const { return m_position; }
+int64_t RebalancingWorker::BulkLoadingIterator::get_absolute_position_end() const { return m_end; }
 void RebalancingWorker::BulkLoadingIterator::operator++(int){
     if(is_ahead()) {
         return; /* nop */
     } else if(is_behind()){
-        m_vect_pos = m_vect_start;
-        m_position = m_pos_start;
+        m_position = m_start;
     } else {
         m_position++;
-
-        if(m_position >= m_vectors[m_vect_pos]->insertions().size()){
-            m_vect_pos++;
-            m_position = 0;
-        }
     }
 }
 void RebalancingWorker::BulkLoadingIterator::operator--(int){
     if(is_behind() || empty()){ return; /* nop */ };
-
-    if (is_ahead()){
-        m_vect_pos = m_vect_last;
-        m_position = m_pos_end;
-    }
-
+    if(is_ahead()){ m_position = m_end; }
     m_position--;
-    if(m_position < 0){
-        m_vect_pos--;
-        if(m_vect_pos >= m_vect_start){
-            assert(m_vectors[m_vect_pos]->insertions().size() > 0 && "Empty vector");
-            m_position = m_vectors[m_vect_pos]->insertions().size() -1;
-        }
-    }
 }
 
 #undef COUT_DEBUG_FORCE
@@ -17,10 +17,13 @@
 
 #pragma once
 
+#include <atomic>
 #include <condition_variable>
 #include <deque>
 #include <mutex>
 #include <thread>
+#include <utility>
+#include <vector>
 
 #include "rebalancing_task.hpp"
 
@@ -34,11 +37,17 @@ struct Storage;
 class RebalancingWorker {
     RebalancingTask* m_task; // the task to perform
     int64_t m_worker_id; // coordinator worker ?
+    bool m_blkld_merge; // whether the worker only helps to sort & merge the bulk loading queues, rather than executing the subtasks
+    std::atomic<int> m_numa_node; // the NUMA node where the worker should run, -1 to run in the first CPU
+    int m_numa_node_current; // the NUMA node where the worker is currently pinned, only accessed by the worker thread
     std::mutex m_mutex; // controller mutex
     std::condition_variable m_condition_variable; // sync the controller on the current task
     std::thread m_handle; // current thread handle
     struct Extent2Rewire{ int64_t m_extent_id; int64_t* m_buffer_keys; int64_t* m_buffer_values; };
     std::deque<Extent2Rewire> m_extents_to_rewire; // a list of extents to be rewired
+    std::vector<void*> m_buffers_keys; // the buffers acquired for the keys of the extents to rewire, sorted by address
+    std::vector<void*> m_buffers_values; // the buffers acquired for the values of the extents to rewire, sorted by address
+    std::vector<std::pair<void*, void*>> m_rewire_pairs; // workspace to reclaim the past extents, pairs <extent in use, buffer>
 
     class InputIterator {
         const Storage& m_storage;
@@ -85,20 +94,10 @@ class RebalancingWorker {
 
     // Retrieve one by one the elements to bulk load
     class BulkLoadingIterator{
-        using element_list_t = std::vector<ClientContextQueue*>;
-        const element_list_t& m_vectors; // list of vectors of the elts to insert, from the task
-        int64_t m_vect_start; // fist vector to examine (inclusive)
-        int64_t m_vect_last; // last vector to examine (inclusive)
-        int64_t m_vect_pos; // current vector being examined
-
-        int64_t m_pos_start; // the first position in the first vector
-        int64_t m_pos_end; // the last position in the last vector (m_vect_end -1)
-        int64_t m_position; // next element to fetch in the current vector
-
-        size_t m_cardinality; // the total amount of elements in the loader (whether visited or not)
-
-        static void abs2vect(const element_list_t& vectors, int64_t absolute_position, int64_t* out_vect_id, int64_t* out_vect_offset);
-        static int64_t vect2abs(const element_list_t& vectors, int64_t vect_id, int64_t vect_offset);
+        const std::pair<int64_t, int64_t>* m_elements; // the sorted stream of the elts to insert, from the task
+        int64_t m_start; // the first position in the stream (inclusive)
+        int64_t m_end; // the last position in the stream (exclusive)
+        int64_t m_position; // next element to fetch
 
     public:
         BulkLoadingIterator(const RebalancingTask* task);
@@ -124,6 +123,9 @@ class RebalancingWorker {
 private:
     void main_thread();
 
+    // Move the worker to the NUMA node set by the thread pool, if it is not already running there
+    void pin_to_numa_node();
+
     void do_execute();
     void do_execute_single(); // for windows < extent
     void do_execute_queue(); // for windows >= extent
@@ -135,7 +137,7 @@ private:
     void debug_content_before();
     void debug_content_after();
 
-    void execute0(RebalancingTask* task, int64_t worker_id);
+    void execute0(RebalancingTask* task, int64_t worker_id, bool blkld_merge = false);
 
     void do_execute(const RebalancingTask::SubTask& subtask);
 
@@ -147,15 +149,30 @@ private:
 
     void spread_local();
 
+    // Whether the window to rebalance or resize is large enough to copy its elements bypassing the cache
+    bool use_nontemporal_stores() const;
+
     void set_separator_key(uint64_t segment_id, int64_t key);
 
     void reclaim_past_extents(int64_t input_extent_watermark);
 
     void update_segment_cardinalities();
 
-    // sort the vectors to load in the task
+    // sort the vectors to load in the task & merge them into a single sorted stream, together with other workers from the pool
     void sort_blkload_elts();
 
+    // the workers acquired by #sort_blkload_elts: sort & merge the queues and partitions left, then leave the task
+    void do_merge_blkload_elts();
+
+    // sort the writer queues not taken yet by another worker
+    void sort_blkload_queues();
+
+    // merge the partitions not taken yet by another worker
+    void merge_blkload_partitions();
+
+    // merge the elements of all writer queues in the given partition, into their position of the sorted stream
+    void merge_blkload_partition(int64_t partition_id);
+
     // remove all elts from the writers' queues (clean up)
     void clear_blkload_queues();
 
@@ -169,6 +186,17 @@ public:
     void stop();
 
     void execute(RebalancingTask* task);
+
+    /**
+     * Set the NUMA node where the worker should run, -1 to run in the first CPU. The worker moves to the node
+     * at the start of its next task.
+     */
+    void set_numa_node(int numa_node) noexcept;
+
+    /**
+     * Retrieve the NUMA node where the worker should run, or -1 if it is not assigned to any node
+     */
+    int get_numa_node() const noexcept;
 };
 
 // for debugging purposes
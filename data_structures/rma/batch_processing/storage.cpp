@@ -58,11 +58,11 @@ extern mutex _debug_mutex;
  *                                                                           *
  *****************************************************************************/
 
-Storage::Storage(uint64_t segment_size, uint64_t pages_per_extent, uint64_t num_segments) : m_segment_capacity(hyperceil(segment_size)), m_pages_per_extent(pages_per_extent){
-    if(hyperceil(segment_size ) > numeric_limits<uint16_t>::max()) throw std::invalid_argument("segment size too big, maximum is " + std::to_string( numeric_limits<uint16_t>::max() ));
+Storage::Storage(uint64_t segment_size, uint64_t pages_per_extent, uint64_t num_segments) : m_segment_capacity(hyperceil(segment_size)), m_pages_per_extent(pages_per_extent), m_numa_policy(common::NumaPolicy::NONE), m_numa_owner(0){
+    if(hyperceil(segment_size ) > numeric_limits<segment_size_t>::max()) throw std::invalid_argument("segment size too big, maximum is " + std::to_string( numeric_limits<segment_size_t>::max() ));
     if(m_segment_capacity < 32) throw std::invalid_argument("segment size too small, minimum is 32");
     if(hyperceil(m_pages_per_extent) != m_pages_per_extent) throw std::invalid_argument("pages per extent must be a value from a power of 2");
-    if(get_memory_page_size() % (m_segment_capacity * sizeof(m_keys[0])) != 0) throw std::invalid_argument("segment capacity must be a divisor of the virtual page size");
+    if((m_pages_per_extent * get_memory_page_size()) % (m_segment_capacity * sizeof(m_keys[0])) != 0) throw std::invalid_argument("segment capacity must be a divisor of the extent size");
 
     m_number_segments = num_segments;
 
@@ -86,6 +86,8 @@ Storage& Storage::operator=(Storage&& storage){
     m_memory_keys = storage.m_memory_keys; storage.m_memory_keys = nullptr;
     m_memory_values = storage.m_memory_values; storage.m_memory_values = nullptr;
     m_memory_sizes = storage.m_memory_sizes; storage.m_memory_sizes = nullptr;
+    m_numa_policy = storage.m_numa_policy; storage.m_numa_policy = common::NumaPolicy::NONE;
+    m_numa_owner = storage.m_numa_owner;
 
     return *this;
 }
@@ -121,8 +123,8 @@ void Storage::alloc_workspace(size_t num_segments, int64_t** keys, int64_t** val
         *keys = (int64_t*) (*rewired_memory_keys)->get_start_address();
         *rewired_memory_values = new BufferedRewiredMemory(m_pages_per_extent, elts_num_extents);
         *values = (int64_t*) (*rewired_memory_values)->get_start_address();
-        *rewired_memory_cardinalities = new RewiredMemory(m_pages_per_extent, card_num_extents, (*rewired_memory_keys)->get_max_memory() * sizeof(uint16_t) / sizeof(int64_t));
-        *sizes = (uint16_t*) (*rewired_memory_cardinalities)->get_start_address();
+        *rewired_memory_cardinalities = new RewiredMemory(m_pages_per_extent, card_num_extents, (*rewired_memory_keys)->get_max_memory() * sizeof(segment_size_t) / sizeof(int64_t));
+        *sizes = (segment_size_t*) (*rewired_memory_cardinalities)->get_start_address();
     } else {
         COUT_DEBUG("posix_memalign with " << num_segments << " segments (" << elts_space_required_bytes << " bytes)");
 
@@ -152,7 +154,7 @@ void Storage::alloc_workspace(size_t num_segments, int64_t** keys, int64_t** val
     onError.release(); // avoid invoking dealloc_workspace, the memory has been (apparently) allocated
 }
 
-void Storage::extend(size_t num_segments_to_add){
+void Storage::extend(size_t num_segments_to_add, bool prefault){
     COUT_DEBUG("num_segments_to_add: " << num_segments_to_add << ", page size: " << get_memory_page_size());
     assert(m_memory_keys != nullptr);
     assert(m_memory_values != nullptr);
@@ -186,16 +188,19 @@ void Storage::extend(size_t num_segments_to_add){
     COUT_DEBUG("[after] segments: " << num_segments_after << ", elts extents: " << elts_num_extents_total << ", card extents: " << sizes_num_extents_total);
 
     if (elts_num_extents_required > 0){
-        m_memory_keys->extend(elts_num_extents_required);
-        m_memory_values->extend(elts_num_extents_required);
+        m_memory_keys->extend(elts_num_extents_required, prefault);
+        m_memory_values->extend(elts_num_extents_required, prefault);
     }
     if(sizes_num_extents_required > 0){
         m_memory_sizes->extend(sizes_num_extents_required);
+        if(m_numa_policy != common::NumaPolicy::NONE){ // the arrays for the keys & values already re-apply their policy on their own
+            m_memory_sizes->set_numa_policy(m_memory_sizes->get_start_address(), m_memory_sizes->get_allocated_extents(), m_numa_policy, m_numa_owner);
+        }
     }
 
     m_keys = (int64_t*) m_memory_keys->get_start_address();
     m_values = (int64_t*) m_memory_values->get_start_address();
-    m_segment_sizes = (uint16_t*) m_memory_sizes->get_start_address();
+    m_segment_sizes = (segment_size_t*) m_memory_sizes->get_start_address();
 
     // update the properties
     m_number_segments = num_segments_after;
@@ -272,4 +277,62 @@ size_t Storage::memory_footprint() const noexcept {
     return memory_keys + memory_values + memory_sizes;
 }
 
+size_t Storage::memory_footprint_resident() const {
+    size_t memory_keys = m_memory_keys != nullptr ? m_memory_keys->get_resident_memory_size() : capacity() * sizeof(m_keys[0]);
+    size_t memory_values = m_memory_values != nullptr ? m_memory_values->get_resident_memory_size() : capacity() * sizeof(m_values[0]);
+    size_t memory_sizes = m_memory_sizes != nullptr ? m_memory_sizes->get_resident_memory_size() : capacity() * sizeof(m_segment_sizes[0]);
+    return memory_keys + memory_values + memory_sizes;
+}
+
+void Storage::trim_buffers(size_t retained_memory){
+    if(m_memory_keys == nullptr) return; // the storage does not use rewired memory
+    assert(m_memory_values != nullptr);
+
+    scoped_lock<decltype(m_mutex)> lock(m_mutex);
+    const size_t num_buffers = retained_memory / (2 /* keys & values */ * m_memory_keys->get_extent_size());
+    m_memory_keys->set_retained_buffers(num_buffers);
+    m_memory_keys->trim();
+    m_memory_values->set_retained_buffers(num_buffers);
+    m_memory_values->trim();
+}
+
+size_t Storage::prefault_buffers(size_t memory){
+    if(m_memory_keys == nullptr) return 0; // the storage does not use rewired memory
+    assert(m_memory_values != nullptr);
+
+    vector<pair<void*, size_t>> runs;
+    { // the workers acquiring their buffers only wait for the selection, not for the page faults
+        scoped_lock<decltype(m_mutex)> lock(m_mutex);
+        const size_t num_buffers = memory / (2 /* keys & values */ * m_memory_keys->get_extent_size());
+        runs = m_memory_keys->select_prefault_buffers(num_buffers);
+        auto runs_values = m_memory_values->select_prefault_buffers(num_buffers);
+        runs.insert(end(runs), begin(runs_values), end(runs_values));
+    }
+
+    // a worker may already be filling or rewiring these buffers, populating them never alters their content
+    size_t num_prefaulted = 0;
+    for(auto& run : runs){
+        RewiredMemory::populate(run.first, run.second);
+        num_prefaulted += run.second / m_memory_keys->get_extent_size();
+    }
+    return num_prefaulted;
+}
+
+void Storage::set_numa_policy(common::NumaPolicy policy, int owner_node){
+    if(m_memory_keys == nullptr) return; // the storage does not use rewired memory
+    if(policy == m_numa_policy && owner_node == m_numa_owner) return; // nop
+
+    scoped_lock<decltype(m_mutex)> lock(m_mutex);
+    m_memory_keys->set_numa_policy(policy, owner_node);
+    m_memory_values->set_numa_policy(policy, owner_node);
+    m_memory_sizes->set_numa_policy(m_memory_sizes->get_start_address(), m_memory_sizes->get_allocated_extents(), policy, owner_node);
+    m_numa_policy = policy;
+    m_numa_owner = owner_node;
+}
+
+int Storage::get_numa_node(size_t segment_id) const noexcept {
+    if(m_memory_keys == nullptr) return -1;
+    return m_memory_keys->get_numa_node(segment_id / get_segments_per_extent());
+}
+
 } // namespace
@@ -26,6 +26,7 @@
 namespace data_structures::rma::common {
 class RewiredMemory; // forward decl.
 class BufferedRewiredMemory; // forward decl.
+enum class NumaPolicy; // forward decl.
 }
 
 namespace data_structures::rma::batch_processing {
@@ -39,14 +40,17 @@ struct Storage {
 
     int64_t* m_keys; // pma for the keys
     int64_t* m_values; // pma for the values
-    uint16_t* m_segment_sizes; // array, containing the cardinalities of each segment
-    const uint16_t m_segment_capacity; // the max number of elements in a segment
+    using segment_size_t = uint32_t; // the type for the cardinality of a segment, it bounds the capacity of a segment
+    segment_size_t* m_segment_sizes; // array, containing the cardinalities of each segment
+    const segment_size_t m_segment_capacity; // the max number of elements in a segment
     uint32_t m_number_segments; // the total number of segments, i.e. capacity / segment_size
     const size_t m_pages_per_extent; // number of virtual pages per extent, used in the RewiredMemory
     common::BufferedRewiredMemory* m_memory_keys = nullptr; // memory space used for the keys
     common::BufferedRewiredMemory* m_memory_values = nullptr; // memory space used for the values
     common::RewiredMemory* m_memory_sizes = nullptr; // memory space used for the segment cardinalities
     mutable ::common::SpinLock m_mutex; // used to protect rewiring by usage of multiple workers
+    common::NumaPolicy m_numa_policy; // current placement of the arrays among the NUMA nodes
+    int m_numa_owner; // the node where the arrays are bound with NumaPolicy::OWNER
 
 public:
     /**
@@ -78,8 +82,9 @@ public:
 
     /**
      * Extend the arrays for the keys/values/cardinalities by `num_segments' additional segments
+     * @param prefault whether to populate the page tables of the new extents for the keys & values, before the workers fill them
      */
-    void extend(size_t num_segments);
+    void extend(size_t num_segments, bool prefault = false);
 
     /**
      * Retrieve the number of segments per extent
@@ -112,9 +117,38 @@ public:
     int64_t get_minimum(size_t segment_id) const noexcept;
 
     /**
-     * Retrieve the memory footprint used by the storage
+     * Return to the OS the physical memory of the free buffers exceeding `retained_memory' bytes, for both
+     * the keys and the values. It acquires the lock on the storage.
+     */
+    void trim_buffers(size_t retained_memory);
+
+    /**
+     * Keep populated `memory' bytes of free buffer space, for both the keys and the values, ahead of the next rebalances. It
+     * acquires the lock on the storage only to select the buffers, they are populated after the lock has been released.
+     * @return the number of buffers populated by this invocation
+     */
+    size_t prefault_buffers(size_t memory);
+
+    /**
+     * Place the arrays among the NUMA nodes according to the given policy. It is a nop if the policy is already
+     * in place or the storage does not use rewired memory. It acquires the lock on the storage.
+     */
+    void set_numa_policy(common::NumaPolicy policy, int owner_node);
+
+    /**
+     * Retrieve the NUMA node where the given segment is bound, or -1 if it is not bound to a single node
+     */
+    int get_numa_node(size_t segment_id) const noexcept;
+
+    /**
+     * Retrieve the memory footprint used by the storage, that is the memory reserved including the buffer space
      */
     size_t memory_footprint() const noexcept;
+
+    /**
+     * Retrieve the amount of physical memory actually resident for the storage
+     */
+    size_t memory_footprint_resident() const;
 };
 
 } // namespace
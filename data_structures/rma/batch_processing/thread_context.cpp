@@ -55,7 +55,10 @@ extern mutex _debug_mutex; // PackedMemoryArray.cpp
  *                                                                           *
  *****************************************************************************/
 ThreadContextList::ThreadContextList() {
-
+    for(uint64_t i = 0; i < m_context_clients_capacity; i++){
+        m_context_clients[i].m_epochs = &m_epochs;
+        m_context_clients[i].m_epoch_slot = i;
+    }
 }
 
 ThreadContextList::~ThreadContextList() {
@@ -78,6 +81,7 @@ void ThreadContextList::resize(uint64_t size){
         }
     }
     m_context_clients_size = size;
+    m_epochs.resize(size);
 }
 
 ClientContext* ThreadContextList::operator[](uint64_t index) const {
@@ -85,18 +89,12 @@ ClientContext* ThreadContextList::operator[](uint64_t index) const {
     return const_cast<ClientContext*>(m_context_clients + index);
 }
 
-ThreadContext* ThreadContextList::timer_manager() const {
-    return const_cast<ThreadContext*>(&m_context_timer_manager);
+uint64_t ThreadContextList::min_epoch() const {
+    return m_epochs.min_epoch();
 }
 
-uint64_t ThreadContextList::min_epoch() const {
-    uint64_t min_epoch = numeric_limits<uint64_t>::max();
-    scoped_lock<mutex> lock(m_mutex); // this is going to be used only by the garbage collector, it's okay to lock here
-    for(uint64_t i =0; i < m_context_clients_size; i++){
-        min_epoch = std::min(min_epoch, m_context_clients[i].epoch());
-    }
-    min_epoch = std::min(min_epoch, m_context_timer_manager.epoch());
-    return min_epoch;
+EpochManager& ThreadContextList::epochs() const {
+    return const_cast<EpochManager&>(m_epochs);
 }
 
 /*****************************************************************************
@@ -104,7 +102,7 @@ uint64_t ThreadContextList::min_epoch() const {
  *   ThreadContext                                                           *
  *                                                                           *
  *****************************************************************************/
-ThreadContext::ThreadContext() : m_timestamp(numeric_limits<uint64_t>::max()) {
+ThreadContext::ThreadContext() : m_epochs(nullptr), m_epoch_slot(0) {
 
 }
 
@@ -113,15 +111,15 @@ ThreadContext::~ThreadContext() {
 }
 
 void ThreadContext::hello() noexcept {
-    m_timestamp = rdtscp(); // cpu clock
+    m_epochs->enter(m_epoch_slot);
 }
 
 void ThreadContext::bye() noexcept {
-    m_timestamp = numeric_limits<uint64_t>::max();
+    m_epochs->exit(m_epoch_slot);
 }
 
 uint64_t ThreadContext::epoch() const noexcept {
-    return m_timestamp;
+    return m_epochs->epoch(m_epoch_slot);
 }
 
 ::std::ostream& operator<<(::std::ostream& out, const ThreadContext& context){
@@ -190,7 +188,7 @@ int ClientContext::thread_id() {
 }
 
 ::std::ostream& operator<<(::std::ostream& out, const ClientContext& context){
-    out << "[ClientContext thread_id: " << ClientContext::m_thread_id << ", timestamp: " << context.epoch() << ", "
+    out << "[ClientContext thread_id: " << ClientContext::m_thread_id << ", epoch: " << context.epoch() << ", "
             "hosted: " << (context.m_hosted ? "yes" : "no") << ", local queue: " << context.queue_local() << ", spare/global queue: " << context.queue_spare() << "]";
     return out;
 }
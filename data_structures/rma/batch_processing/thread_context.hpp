@@ -25,6 +25,7 @@
 #include <utility> // std::swap
 #include <vector>
 
+#include "common/epoch_manager.hpp"
 #include "common/spin_lock.hpp"
 #include "wakelist.hpp"
 
@@ -41,11 +42,12 @@ class ThreadContext;
 class ThreadContextList;
 
 /**
- * Base Thread Context contain an epoch. It used by both the client threads that perform the single operations on the PMA
- * and the Timer Manager service to delay a rebalance
+ * Base Thread Context contain an epoch. It used by the client threads that perform the single operations on the PMA
  */
 class ThreadContext {
-    uint64_t m_timestamp; // the current timestamp (or epoch) for the current thread. Only utilised for the purposes of the Garbage Collector
+friend class ThreadContextList;
+    ::common::EpochManager* m_epochs; // the epochs announced by the threads. Only utilised for the purposes of the Garbage Collector
+    uint64_t m_epoch_slot; // the slot in m_epochs where this context announces its epoch
 
 public:
     /**
@@ -64,12 +66,12 @@ public:
     uint64_t epoch() const noexcept;
 
     /**
-     * Set the current timestamp for the current (worker) thread
+     * Announce the current global epoch for the current (worker) thread
      */
     void hello() noexcept;
 
     /**
-     * Remove the timestamp for the current (worker) thread
+     * Remove the epoch announced by the current (worker) thread
      */
     void bye() noexcept;
 
@@ -230,10 +232,10 @@ public:
  * A safe enough list of thread contexts
  */
 class ThreadContextList {
-    constexpr static uint64_t m_context_clients_capacity = 128;
+    constexpr static uint64_t m_context_clients_capacity = ::common::EpochManager::MAX_NUM_SLOTS;
     uint64_t m_context_clients_size = 0;
+    ::common::EpochManager m_epochs; // it must outlive the contexts
     ClientContext m_context_clients[m_context_clients_capacity];
-    ThreadContext m_context_timer_manager; // the context of the timer manager
     mutable std::mutex m_mutex;
 
 public:
@@ -247,10 +249,10 @@ public:
 
     ClientContext* operator[](uint64_t index) const;
 
-    // The context attached to the timer manager
-    ThreadContext* timer_manager() const;
-
     uint64_t min_epoch() const;
+
+    // The global epoch and the announcements of the threads
+    ::common::EpochManager& epochs() const;
 };
 
 /**
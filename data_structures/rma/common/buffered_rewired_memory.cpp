@@ -19,9 +19,12 @@
 
 #include <algorithm>
 #include <cassert>
+#include <functional>
 #include <iostream>
+#include <limits>
 
 #include "common/errorhandling.hpp"
+#include "common/miscellaneous.hpp"
 
 using namespace std;
 
@@ -51,7 +54,8 @@ namespace data_structures::rma::common {
 BufferedRewiredMemory::BufferedRewiredMemory(size_t pages_per_extent, size_t num_extents) :
         m_instance(pages_per_extent, num_extents),
         m_buffer_start_address(static_cast<char*>(m_instance.get_start_address()) + m_instance.get_allocated_memory_size()),
-        m_allocated_buffers(0)
+        m_allocated_buffers(0), m_retained_buffers(numeric_limits<size_t>::max()),
+        m_numa_policy(NumaPolicy::NONE), m_numa_owner(0)
         { }
 
 
@@ -72,18 +76,38 @@ void BufferedRewiredMemory::add_buffers(size_t num_extents){
     // update the state of the data structure
     m_allocated_buffers += num_extents;
 
+    // the new extents are in the buffer space, bound to the owner or interleaved as the rest of the memory
+    if(m_numa_policy == NumaPolicy::INTERLEAVED || m_numa_policy == NumaPolicy::OWNER){
+        m_instance.set_numa_policy(buffer_space, num_extents, m_numa_policy, m_numa_owner);
+    }
+
     COUT_DEBUG("acquired " << num_extents << " extents. Total buffer capacity: " << get_total_buffers() << " extents");
 }
 
 void* BufferedRewiredMemory::acquire_buffer(){
-    if(m_buffers.empty()){ add_buffers(max<size_t>(4, m_allocated_buffers * 0.5)); }
+    if(m_buffers.empty()){
+        if(!m_released_buffers.empty()){ // the physical memory will be allocated again on the first access
+            m_buffers.push_back(m_released_buffers.back());
+            m_released_buffers.pop_back();
+        } else {
+            add_buffers(max<size_t>(4, m_allocated_buffers * 0.5));
+        }
+    }
     assert(!m_buffers.empty());
     void* address = m_buffers.back();
     m_buffers.pop_back();
+    m_prefaulted_buffers.erase(address);
     COUT_DEBUG("address: " << address);
     return address;
 }
 
+void BufferedRewiredMemory::acquire_buffers(void** buffers, size_t num_buffers){
+    for(size_t i = 0; i < num_buffers; i++){
+        buffers[i] = acquire_buffer();
+    }
+    sort(buffers, buffers + num_buffers);
+}
+
 void BufferedRewiredMemory::swap_and_release(void* addr1, void* addr2){
     // check whether addr1 or addr2 is the pointer to the buffer
     char* ptr_bufferspace (nullptr);
@@ -112,7 +136,39 @@ void BufferedRewiredMemory::swap_and_release(void* addr1, void* addr2){
     COUT_DEBUG("userspace: " << (void*) ptr_userspace << ", bufferspace: " << (void*) ptr_bufferspace);
 
     m_instance.swap(ptr_userspace, ptr_bufferspace);
-    m_buffers.push_back(ptr_bufferspace);
+    m_buffers.push_back(ptr_bufferspace); // the remapped buffer, without page tables
+    if(m_numa_policy == NumaPolicy::PARTITIONED){
+        pair<void*, void*> rewired { ptr_userspace, ptr_bufferspace };
+        bind_partitions(&rewired, 1);
+    }
+}
+
+size_t BufferedRewiredMemory::swap_and_release_many(const pair<void*, void*>* pairs, size_t num_pairs){
+    char* start_address_buffers = (char*) m_buffer_start_address;
+    for(size_t i = 0; i < num_pairs; i++){
+        if((char*) pairs[i].first >= start_address_buffers || (char*) pairs[i].second < start_address_buffers){
+            RAISE("the pair " << i << " is not made of an extent in use and a buffer: " << pairs[i].first << ", " << pairs[i].second << ", buffer start address: " << (void*) start_address_buffers);
+        }
+    }
+    COUT_DEBUG("num pairs: " << num_pairs);
+
+    size_t num_syscalls = m_instance.swap_many(pairs, num_pairs);
+    if(m_numa_policy == NumaPolicy::PARTITIONED){ bind_partitions(pairs, num_pairs); }
+
+    // acquire_buffer() takes the buffers from the back of the deque, starting from the lowest address
+    size_t first_buffer = m_buffers.size();
+    for(size_t i = 0; i < num_pairs; i++){ m_buffers.push_back(pairs[i].second); }
+    sort(begin(m_buffers) + first_buffer, end(m_buffers), greater<void*>());
+
+    return num_syscalls;
+}
+
+void BufferedRewiredMemory::release_buffer(void* buffer){
+    if((char*) buffer < (char*) m_buffer_start_address){
+        RAISE("the pointer does not refer to a buffer: " << buffer << ", buffer start address: " << m_buffer_start_address);
+    }
+    COUT_DEBUG("bufferspace: " << buffer);
+    m_buffers.push_back(buffer);
 }
 
 /*****************************************************************************
@@ -120,10 +176,12 @@ void BufferedRewiredMemory::swap_and_release(void* addr1, void* addr2){
  *   Resize                                                                  *
  *                                                                           *
  *****************************************************************************/
-void BufferedRewiredMemory::extend(size_t num_extents){
+void BufferedRewiredMemory::extend(size_t num_extents, bool prefault){
     if(num_extents == 0) RAISE("The amount of extents specified is zero");
     assert(get_used_buffers() == 0 && "There are buffers in use!");
     if(get_used_buffers() != 0) RAISE("There are buffers in use: " << get_used_buffers() << "/" << get_total_buffers());
+    void* extension_start_address = m_buffer_start_address; // the new extents start where the buffer space currently starts
+    m_prefaulted_buffers.clear(); // the deque of the free buffers is rebuilt
 
     // the buffers are at the end of
     int64_t num_extents_buffer = get_total_buffers();
@@ -134,6 +192,7 @@ void BufferedRewiredMemory::extend(size_t num_extents){
         m_buffer_start_address = ((char*) m_buffer_start_address) + num_extents * extent_size;
         m_allocated_buffers = num_extents_buffer - num_extents;
         m_buffers.clear(); // rebuild the deque
+        m_released_buffers.clear(); // if any of them is still a hole, it is only going to be faulted in again
         char* buffer_address = (char*) m_buffer_start_address;
         for(size_t i = 0; i < m_allocated_buffers; i++){
             m_buffers.push_front(buffer_address);
@@ -145,9 +204,13 @@ void BufferedRewiredMemory::extend(size_t num_extents){
         // all the space previously occupied by the buffer space is now in use for the user data
         m_allocated_buffers = 0;
         m_buffers.clear();
+        m_released_buffers.clear();
 
         m_buffer_start_address = static_cast<char*>(m_instance.get_start_address()) + m_instance.get_allocated_memory_size();
     }
+
+    if(m_numa_policy != NumaPolicy::NONE) apply_numa_policy();
+    if(prefault) m_instance.prefault(extension_start_address, num_extents); // after the NUMA policy, to allocate the pages on the right nodes
 }
 
 void BufferedRewiredMemory::shrink(size_t num_extents){
@@ -164,6 +227,127 @@ void BufferedRewiredMemory::shrink(size_t num_extents){
     }
     m_allocated_buffers += num_extents;
     m_buffer_start_address = buffer_address;
+
+    trim();
+    if(m_numa_policy != NumaPolicy::NONE) apply_numa_policy();
+}
+
+void BufferedRewiredMemory::trim(){
+    // the buffers at the front of the deque are the least recently released
+    while(m_buffers.size() > m_retained_buffers){
+        void* buffer = m_buffers.front();
+        m_buffers.pop_front();
+        m_instance.release_physical_memory(buffer);
+        m_released_buffers.push_back(buffer);
+        m_prefaulted_buffers.erase(buffer);
+    }
+    COUT_DEBUG("resident free buffers: " << m_buffers.size() << ", released buffers: " << m_released_buffers.size());
+}
+
+size_t BufferedRewiredMemory::prefault_buffers(size_t num_buffers){
+    size_t num_prefaulted = 0;
+    for(auto& run : select_prefault_buffers(num_buffers)){
+        RewiredMemory::populate(run.first, run.second);
+        num_prefaulted += run.second / get_extent_size();
+    }
+    return num_prefaulted;
+}
+
+vector<pair<void*, size_t>> BufferedRewiredMemory::select_prefault_buffers(size_t num_buffers){
+    vector<pair<void*, size_t>> runs;
+
+    // make available enough free buffers
+    while(m_buffers.size() < num_buffers && !m_released_buffers.empty()){
+        m_buffers.push_front(m_released_buffers.back());
+        m_released_buffers.pop_back();
+    }
+    if(m_buffers.size() < num_buffers){ add_buffers(num_buffers - m_buffers.size()); }
+
+    // select the buffers that acquire_buffer() is going to hand out next and are not populated yet, coalescing the runs contiguous in virtual memory
+    const size_t extent_size = get_extent_size();
+    const size_t back = m_buffers.size() -1;
+    size_t i = 0;
+    while(i < num_buffers){
+        char* run_start = static_cast<char*>(m_buffers[back - i]);
+        if(!m_prefaulted_buffers.insert(run_start).second){ i++; continue; } // already populated
+
+        size_t run_length = 1;
+        while(i + run_length < num_buffers && m_buffers[back - i - run_length] == run_start + run_length * extent_size && m_prefaulted_buffers.insert(run_start + run_length * extent_size).second){
+            run_length++;
+        }
+        runs.emplace_back(run_start, run_length * extent_size);
+        i += run_length;
+    }
+
+    COUT_DEBUG("runs to prefault: " << runs.size() << ", free buffers: " << m_buffers.size() << ", released buffers: " << m_released_buffers.size());
+    return runs;
+}
+
+void BufferedRewiredMemory::set_retained_buffers(size_t num_buffers) noexcept {
+    m_retained_buffers = num_buffers;
+}
+
+size_t BufferedRewiredMemory::get_retained_buffers() const noexcept {
+    return m_retained_buffers;
+}
+
+/*****************************************************************************
+ *                                                                           *
+ *   NUMA placement                                                          *
+ *                                                                           *
+ *****************************************************************************/
+
+void BufferedRewiredMemory::set_numa_policy(NumaPolicy policy, int owner_node){
+    m_numa_policy = policy;
+    m_numa_owner = owner_node;
+    apply_numa_policy();
+}
+
+void BufferedRewiredMemory::apply_numa_policy(){
+    const size_t num_extents_in_use = get_allocated_extents() - get_total_buffers();
+    m_instance.set_numa_policy(get_start_address(), num_extents_in_use, m_numa_policy, m_numa_owner);
+
+    // with range partitioning, a buffer can be rewired into any partition. Let the worker filling it decide the node.
+    NumaPolicy buffer_policy = (m_numa_policy == NumaPolicy::PARTITIONED) ? NumaPolicy::NONE : m_numa_policy;
+    m_instance.set_numa_policy(m_buffer_start_address, get_total_buffers(), buffer_policy, m_numa_owner);
+
+    COUT_DEBUG("policy: " << m_numa_policy << ", extents in use: " << num_extents_in_use << ", buffers: " << get_total_buffers());
+}
+
+NumaPolicy BufferedRewiredMemory::get_numa_policy() const noexcept {
+    return m_numa_policy;
+}
+
+int BufferedRewiredMemory::get_numa_node(size_t extent_id) const noexcept {
+    if(extent_id >= get_allocated_extents() - get_total_buffers()) return -1;
+    return m_instance.get_numa_node((char*) get_start_address() + extent_id * get_extent_size());
+}
+
+int BufferedRewiredMemory::get_partition_node(size_t extent_id) const noexcept {
+    const int64_t num_nodes = ::common::get_numa_max_node() +1;
+    const int64_t num_extents = get_allocated_extents() - get_total_buffers();
+    if(num_nodes <= 0 || num_extents <= 0) return -1;
+    // the node k covers the extents in [k * num_extents / num_nodes, (k+1) * num_extents / num_nodes), see RewiredMemory::set_numa_policy
+    return ((static_cast<int64_t>(extent_id) +1) * num_nodes + num_extents -1) / num_extents -1;
+}
+
+void BufferedRewiredMemory::bind_partitions(const pair<void*, void*>* pairs, size_t num_pairs){
+    const size_t extent_size = get_extent_size();
+    char* start_address = (char*) get_start_address();
+
+    // bind the runs of contiguous extents in the same partition with a single call
+    size_t run_start = 0;
+    while(run_start < num_pairs){
+        char* first = (char*) pairs[run_start].first;
+        const int node = get_partition_node((first - start_address) / extent_size);
+        size_t run_end = run_start +1;
+        while(run_end < num_pairs && pairs[run_end].first == first + (run_end - run_start) * extent_size &&
+                get_partition_node(((char*) pairs[run_end].first - start_address) / extent_size) == node){
+            run_end++;
+        }
+        if(node >= 0){ m_instance.set_numa_policy(first, run_end - run_start, NumaPolicy::OWNER, node); }
+        run_start = run_end;
+    }
 }
 
 
@@ -189,13 +373,17 @@ size_t BufferedRewiredMemory::get_allocated_memory_size() const noexcept{
     return m_instance.get_allocated_memory_size();
 }
 
+size_t BufferedRewiredMemory::get_resident_memory_size() const {
+    return m_instance.get_resident_memory_size();
+}
+
 size_t BufferedRewiredMemory::get_total_buffers() const noexcept {
     return m_allocated_buffers;
 }
 
 size_t BufferedRewiredMemory::get_used_buffers() const noexcept{
-    assert(m_buffers.size() <= m_allocated_buffers && "The total number of free buffers must be less or equal those allocated");
-    return m_allocated_buffers - m_buffers.size();
+    assert(m_buffers.size() + m_released_buffers.size() <= m_allocated_buffers && "The total number of free buffers must be less or equal those allocated");
+    return m_allocated_buffers - m_buffers.size() - m_released_buffers.size();
 }
 
 size_t BufferedRewiredMemory::get_max_memory() const noexcept{
@@ -19,6 +19,9 @@
 #define RMA_BUFFERED_REWIRED_MEMORY_HPP_
 
 #include <deque>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include "rewired_memory.hpp"
 
@@ -29,12 +32,33 @@ class BufferedRewiredMemory {
     void* m_buffer_start_address;
     size_t m_allocated_buffers; // the total number of allocated buffers,
     std::deque<void*> m_buffers; // list of free virtual addresses that can be acquired for buffering
+    std::deque<void*> m_released_buffers; // free buffers whose physical memory has been returned to the OS
+    size_t m_retained_buffers; // the max number of free buffers to keep backed by physical memory
+    std::unordered_set<void*> m_prefaulted_buffers; // the free buffers whose page tables are already populated
+    NumaPolicy m_numa_policy; // placement of the physical memory among the NUMA nodes
+    int m_numa_owner; // the node to bind the memory with NumaPolicy::OWNER
 
     /**
      * Extend the physical memory to make available additional buffers
      */
     void add_buffers(size_t num_buffers);
 
+    /**
+     * Apply the NUMA policy to the extents in use and to the buffer space
+     */
+    void apply_numa_policy();
+
+    /**
+     * With NumaPolicy::PARTITIONED, the node of the partition covering the given extent in use
+     */
+    int get_partition_node(size_t extent_id) const noexcept;
+
+    /**
+     * With NumaPolicy::PARTITIONED, bind the extents in use that have just been rewired to the node of their partition. The physical
+     * memory taken from the buffer space is not bound to any node, or it is still bound to the partition of the extent it was rewired from.
+     */
+    void bind_partitions(const std::pair<void*, void*>* pairs, size_t num_pairs);
+
 public:
     /**
      * It allocates a chunk of rewired memory
@@ -46,6 +70,12 @@ public:
      */
     void* acquire_buffer();
 
+    /**
+     * Get `num_buffers' buffers at once, sorted by address. Acquiring the buffers of a window in a single call
+     * and rewiring them with #swap_and_release_many keeps the buffers in long contiguous runs.
+     */
+    void acquire_buffers(void** buffers, size_t num_buffers);
+
     /**
      * Rewires the memory of addr1 and addr2. Moreover, it assumes that either addr1
      * or addr2 (but not both) is a pointer to the buffer space. After the memory
@@ -53,17 +83,83 @@ public:
      */
     void swap_and_release(void* addr1, void* addr2);
 
+    /**
+     * Batched version of #swap_and_release, the first address of each pair refers to an extent in use, the second
+     * to a buffer. The extents are rewired with RewiredMemory::swap_many, then the buffers are reclaimed in order of
+     * address, so that the next acquisitions obtain them again as contiguous runs.
+     * @return the number of mmap syscalls issued
+     */
+    size_t swap_and_release_many(const std::pair<void*, void*>* pairs, size_t num_pairs);
+
+    /**
+     * Return a buffer to the free buffer space, without rewiring it. The content of the buffer is discarded.
+     */
+    void release_buffer(void* buffer);
+
     /**
      * Extend the amount of memory available. No buffers must be in use
+     * @param prefault whether to populate the page tables of the new extents, before the caller writes into them
      */
-    void extend(size_t num_extents);
+    void extend(size_t num_extents, bool prefault = false);
 
     /**
-     * Shrink the number of extents in use. The actual physical memory is not released but recycled as buffer space.
+     * Shrink the number of extents in use. The extents are recycled as buffer space, the physical memory of those
+     * exceeding the retained budget (#set_retained_buffers) is returned to the OS.
      * Precondition: no buffers must be in use.
      */
     void shrink(size_t num_extents);
 
+    /**
+     * Return to the OS the physical memory of the free buffers exceeding the retained budget. The buffers
+     * are still available to #acquire_buffer(), their memory is allocated again on the first access.
+     */
+    void trim();
+
+    /**
+     * Ensure the next `num_buffers' buffers handed out by #acquire_buffer are backed by physical memory and have their page tables
+     * populated, so that the worker filling them does not incur a page fault for each page. The buffers released to the OS
+     * are reclaimed first, then the buffer space is extended. The buffers already populated are not touched again.
+     * @return the number of buffers populated by this invocation
+     */
+    size_t prefault_buffers(size_t num_buffers);
+
+    /**
+     * As #prefault_buffers, but only select the buffers to populate, without populating them. The buffers are already accounted
+     * as populated. The caller is expected to pass each run to RewiredMemory::populate, which does not need to hold the lock
+     * protecting this instance, as long as the instance is not extended or shrunk in the meanwhile.
+     * @return the runs of buffers contiguous in virtual memory, as the pair <start address, length in bytes>
+     */
+    std::vector<std::pair<void*, size_t>> select_prefault_buffers(size_t num_buffers);
+
+    /**
+     * Set the max number of free buffers to keep backed by physical memory. It does not trim the buffer space by itself.
+     */
+    void set_retained_buffers(size_t num_buffers) noexcept;
+
+    /**
+     * Retrieve the max number of free buffers to keep backed by physical memory
+     */
+    size_t get_retained_buffers() const noexcept;
+
+    /**
+     * Set the placement of the physical memory among the NUMA nodes. The policy is applied to the extents in use, and
+     * again after each #extend and #shrink. With NumaPolicy::PARTITIONED, the buffer space is not bound to any node,
+     * its pages are allocated on the node of the first thread writing into them, that is the rebalancing worker. As the
+     * binding follows the physical memory, the buffers rewired into the extents in use are bound again to the node of
+     * their partition, migrating their pages if needed.
+     */
+    void set_numa_policy(NumaPolicy policy, int owner_node = 0);
+
+    /**
+     * Retrieve the current NUMA policy
+     */
+    NumaPolicy get_numa_policy() const noexcept;
+
+    /**
+     * Retrieve the NUMA node where the physical memory of the given extent in use is bound, or -1 if it is not bound to a single node
+     */
+    int get_numa_node(size_t extent_id) const noexcept;
+
     /**
      * Retrieve the pointer to the allocated virtual memory space
      */
@@ -84,6 +180,11 @@ public:
      */
     size_t get_allocated_memory_size() const noexcept;
 
+    /**
+     * Retrieve the amount of physical memory actually resident, in bytes
+     */
+    size_t get_resident_memory_size() const;
+
     /**
      * Retrieve the total number of buffers allocated, a single buffer corresponds to an extent
      */
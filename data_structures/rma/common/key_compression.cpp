@@ -0,0 +1,124 @@
+/**
+ * Copyright (C) 2018 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "key_compression.hpp"
+
+#include <cassert>
+#include <cstring>
+
+namespace data_structures::rma::common {
+
+// Mask with the `bit_width' least significant bits set
+static inline uint64_t width_mask(uint64_t bit_width){
+    return bit_width == 64 ? ~0ull : (1ull << bit_width) -1;
+}
+
+// Extract the delta at the given position. It always reads two words, without branching on whether the delta spans both of
+// them, so that the loops in #decode and #sum can be vectorised. The packed area is padded by one word for this reason.
+static inline uint64_t unpack(const uint64_t* __restrict packed, uint64_t position, uint64_t bit_width, uint64_t mask){
+    uint64_t bit = position * bit_width;
+    uint64_t word = bit / 64;
+    uint64_t shift = bit % 64;
+    // (x << 1) << (63 - shift) == x << (64 - shift), but it is also well defined, and equal to 0, when shift == 0
+    return ((packed[word] >> shift) | ((packed[word +1] << 1) << (63 - shift))) & mask;
+}
+
+uint64_t KeyCompression::bit_width(const int64_t* keys, uint64_t num_keys) noexcept {
+    if(num_keys <= 1) return 0;
+    uint64_t max_delta = static_cast<uint64_t>(keys[num_keys -1]) - static_cast<uint64_t>(keys[0]);
+    return max_delta == 0 ? 0 : 64 - __builtin_clzll(max_delta);
+}
+
+uint64_t KeyCompression::compressed_size(uint64_t num_keys, uint64_t bit_width) noexcept {
+    assert(bit_width <= 64 && "Invalid bit width");
+    return /* header */ 2 + (num_keys * bit_width + 63) / 64 + /* padding for #unpack */ 1;
+}
+
+uint64_t KeyCompression::encode(const int64_t* keys, uint64_t num_keys, uint64_t* output) noexcept {
+    assert((num_keys == 0 || keys != nullptr) && output != nullptr && "Null pointers");
+    const uint64_t width = bit_width(keys, num_keys);
+    const uint64_t size = compressed_size(num_keys, width);
+    const uint64_t base = num_keys > 0 ? static_cast<uint64_t>(keys[0]) : 0;
+
+    output[0] = base;
+    output[1] = width;
+    uint64_t* __restrict packed = output + 2;
+    memset(packed, 0, (size -2) * sizeof(uint64_t));
+    if(width == 0) return size;
+
+    for(uint64_t i = 0; i < num_keys; i++){
+        assert((i == 0 || keys[i -1] <= keys[i]) && "The keys are not sorted");
+        uint64_t delta = static_cast<uint64_t>(keys[i]) - base;
+        uint64_t bit = i * width;
+        uint64_t word = bit / 64;
+        uint64_t shift = bit % 64;
+        packed[word] |= delta << shift;
+        if(shift + width > 64){ packed[word +1] |= delta >> (64 - shift); }
+    }
+
+    return size;
+}
+
+void KeyCompression::decode(const uint64_t* __restrict input, uint64_t num_keys, int64_t* __restrict output) noexcept {
+    assert(input != nullptr && (num_keys == 0 || output != nullptr) && "Null pointers");
+    const uint64_t base = input[0];
+    const uint64_t width = input[1];
+    const uint64_t mask = width_mask(width);
+    const uint64_t* __restrict packed = input + 2;
+
+    for(uint64_t i = 0; i < num_keys; i++){
+        output[i] = static_cast<int64_t>(base + unpack(packed, i, width, mask));
+    }
+}
+
+int64_t KeyCompression::get(const uint64_t* input, uint64_t position) noexcept {
+    assert(input != nullptr && "Null pointer");
+    const uint64_t width = input[1];
+    return static_cast<int64_t>(input[0] + unpack(input + 2, position, width, width_mask(width)));
+}
+
+uint64_t KeyCompression::lower_bound(const uint64_t* input, uint64_t num_keys, int64_t key) noexcept {
+    assert(input != nullptr && "Null pointer");
+    uint64_t first = 0, count = num_keys;
+    while(count > 0){
+        uint64_t step = count / 2;
+        if(get(input, first + step) < key){
+            first += step +1;
+            count -= step +1;
+        } else {
+            count = step;
+        }
+    }
+    return first;
+}
+
+int64_t KeyCompression::sum(const uint64_t* input, uint64_t num_keys) noexcept {
+    assert(input != nullptr && "Null pointer");
+    const uint64_t base = input[0];
+    const uint64_t width = input[1];
+    const uint64_t mask = width_mask(width);
+    const uint64_t* __restrict packed = input + 2;
+
+    uint64_t sum_deltas = 0;
+    for(uint64_t i = 0; i < num_keys; i++){
+        sum_deltas += unpack(packed, i, width, mask);
+    }
+
+    return static_cast<int64_t>(base * num_keys + sum_deltas);
+}
+
+} // namespace
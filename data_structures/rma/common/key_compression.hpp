@@ -0,0 +1,73 @@
+/**
+ * Copyright (C) 2018 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cinttypes>
+#include <cstddef>
+
+namespace data_structures::rma::common {
+
+/**
+ * Frame of reference compression for a sorted run of keys, such as the content of a segment. The run is stored as its minimum,
+ * the base, followed by the deltas of each key from the base, bit-packed with the minimum width to represent the largest delta.
+ *
+ * Layout, in 64-bit words: [0] the base, [1] the bit width, [2..] the packed deltas. The delta of the i-th key starts at the
+ * bit i * width of the packed area, from the least significant bit of each word, and it may span two consecutive words.
+ */
+class KeyCompression {
+    KeyCompression() = delete; // static methods only
+
+public:
+    /**
+     * Number of bits required to represent the largest delta of the given sorted keys from the first one, in [0, 64]
+     */
+    static uint64_t bit_width(const int64_t* keys, uint64_t num_keys) noexcept;
+
+    /**
+     * Number of words required to encode `num_keys' keys with the given bit width, including the header
+     */
+    static uint64_t compressed_size(uint64_t num_keys, uint64_t bit_width) noexcept;
+
+    /**
+     * Encode the given sorted keys into `output', that must be large enough to hold #compressed_size words
+     * @return the number of words written
+     */
+    static uint64_t encode(const int64_t* keys, uint64_t num_keys, uint64_t* output) noexcept;
+
+    /**
+     * Decode all the `num_keys' keys from `input' into `output'
+     */
+    static void decode(const uint64_t* input, uint64_t num_keys, int64_t* output) noexcept;
+
+    /**
+     * Retrieve the key at the given position, without decoding the whole run
+     */
+    static int64_t get(const uint64_t* input, uint64_t position) noexcept;
+
+    /**
+     * Retrieve the position of the first key not less than `key' in the run of `num_keys' keys, or `num_keys' if all keys are smaller
+     */
+    static uint64_t lower_bound(const uint64_t* input, uint64_t num_keys, int64_t key) noexcept;
+
+    /**
+     * Sum all the `num_keys' keys in the run, without materialising them
+     */
+    static int64_t sum(const uint64_t* input, uint64_t num_keys) noexcept;
+};
+
+} // namespace
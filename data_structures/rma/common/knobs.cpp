@@ -17,12 +17,27 @@
 
 #include "knobs.hpp"
 
+#include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <cstring>
+#include <limits>
+#include <unistd.h>
+#include <vector>
+
+#include "common/miscellaneous.hpp" // memcpy_nontemporal
 
 using namespace std;
 
 namespace data_structures::rma::common {
 
+// The size of the last level cache, as reported by the C library, or 32 MB if it is not known
+static uint64_t last_level_cache_size(){
+    long size = sysconf(_SC_LEVEL3_CACHE_SIZE);
+    if(size <= 0){ size = sysconf(_SC_LEVEL2_CACHE_SIZE); }
+    return size > 0 ? size : (32ull << 20);
+}
+
 Knobs::Knobs(){
     m_rank_threshold = 0.99; // 99% of the values
     m_segment_threshold = 6;
@@ -32,6 +47,15 @@ Knobs::Knobs(){
     m_sampling_rate = 1;
     m_sampling_percentage = 100;
     m_thresholds_switch = 64; // there is some (forgotten...) rationale around this value
+    m_nontemporal_threshold = last_level_cache_size(); // windows larger than the last level cache would only evict the working set of the clients
+    m_scheduling_policy = SchedulingPolicy::FIFO;
+    m_master_spin_time = 0; // park immediately, spinning only pays off when the clients & the workers do not saturate the cores
+    m_retained_buffer_memory = 64ull << 20; // 64 MB, enough to serve the rebalances of a few extents without growing the buffer space again
+    m_proactive_budget = 0; // disabled, only rebalance on request of the clients
+    m_numa_policy = NumaPolicy::NONE; // first touch
+    m_memory_budget = 0; // unlimited, only bound by the max memory of the rewired arrays
+    m_prefault_buffer_memory = 0; // disabled, the workers fault in the buffers on their first write
+    m_key_compression = false; // store the keys uncompressed
 }
 
 void Knobs::set_sampling_rate(double value) {
@@ -45,6 +69,56 @@ void Knobs::set_thresholds_switch(int32_t value){
     m_thresholds_switch = value;
 }
 
+void Knobs::set_proactive_budget(double value){
+    assert(value >= 0 && value <= 1 && "Invalid value");
+    m_proactive_budget = value;
+}
+
+uint64_t Knobs::calibrate_nontemporal_threshold(){
+    static const uint64_t threshold = [](){
+        // the clients keep working on a set as large as half the last level cache, while the copy runs
+        const size_t llc_size = last_level_cache_size();
+        vector<int64_t> working_set(min<size_t>(llc_size / 2, 16ull << 20) / sizeof(int64_t), 1);
+        const size_t max_copy_sz = min<size_t>(llc_size * 4, 64ull << 20) / sizeof(int64_t);
+        vector<int64_t> source(max_copy_sz, 2), destination(max_copy_sz, 0); // fault in the pages before the measures
+        volatile int64_t sink = 0;
+        auto scan = [&](){
+            int64_t sum = 0;
+            for(auto value : working_set){ sum += value; }
+            sink = sink + sum;
+        };
+
+        // the median of a few rounds of: copy, then read again the working set
+        auto measure = [&](size_t num_elements, bool nontemporal){
+            constexpr size_t num_rounds = 5;
+            int64_t samples[num_rounds];
+            for(size_t i = 0; i < num_rounds; i++){
+                scan(); // load the working set in the cache
+                auto t0 = chrono::steady_clock::now();
+                if(nontemporal){
+                    ::common::memcpy_nontemporal(destination.data(), source.data(), num_elements);
+                    ::common::store_fence();
+                } else {
+                    memcpy(destination.data(), source.data(), num_elements * sizeof(int64_t));
+                }
+                scan();
+                samples[i] = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - t0).count();
+            }
+            std::sort(samples, samples + num_rounds);
+            return samples[num_rounds /2];
+        };
+
+        for(size_t num_elements = (1ull << 20) / sizeof(int64_t); num_elements <= max_copy_sz; num_elements *= 2){
+            if(measure(num_elements, /* non-temporal ? */ true) <= measure(num_elements, false)){
+                return num_elements * sizeof(int64_t);
+            }
+        }
+        return numeric_limits<uint64_t>::max(); // the cached stores were always cheaper
+    }();
+
+    return threshold;
+}
+
 ostream& operator<<(ostream& out, const Knobs& settings){
     out << "{APMA/Knobs rank ts: " << settings.get_rank_threshold() << ", " <<
             "segment ts: " << settings.get_segment_threshold() << ", " <<
@@ -52,8 +126,35 @@ ostream& operator<<(ostream& out, const Knobs& settings){
             "segment max count: " << settings.get_max_segment_counter() << ", " <<
             "sequence max count: " << settings.get_max_sequence_counter() << ", " <<
             "sampling rate: " << settings.get_sampling_rate() << ", " <<
-            "[apma_parallel] thresholds switch: " << settings.get_thresholds_switch() << "}";
+            "[apma_parallel] thresholds switch: " << settings.get_thresholds_switch() << ", " <<
+            "non-temporal stores threshold: " << settings.get_nontemporal_threshold() << " bytes, " <<
+            "scheduling policy: " << settings.get_scheduling_policy() << ", " <<
+            "master spin time: " << settings.get_master_spin_time() << " microsecs, " <<
+            "retained buffer memory: " << settings.get_retained_buffer_memory() << " bytes, " <<
+            "proactive rebalancing budget: " << settings.get_proactive_budget() << ", " <<
+            "numa policy: " << settings.get_numa_policy() << ", " <<
+            "memory budget: " << settings.get_memory_budget() << " bytes, " <<
+            "prefault buffer memory: " << settings.get_prefault_buffer_memory() << " bytes, " <<
+            "key compression: " << settings.get_key_compression() << "}";
+
+    return out;
+}
+
+ostream& operator<<(ostream& out, SchedulingPolicy policy){
+    switch(policy){
+    case SchedulingPolicy::FIFO: out << "fifo"; break;
+    case SchedulingPolicy::PRIORITY: out << "priority"; break;
+    }
+    return out;
+}
 
+ostream& operator<<(ostream& out, NumaPolicy policy){
+    switch(policy){
+    case NumaPolicy::NONE: out << "none"; break;
+    case NumaPolicy::INTERLEAVED: out << "interleaved"; break;
+    case NumaPolicy::OWNER: out << "owner"; break;
+    case NumaPolicy::PARTITIONED: out << "partitioned"; break;
+    }
     return out;
 }
 
@@ -22,6 +22,24 @@
 
 namespace data_structures::rma::common {
 
+/**
+ * The order in which the RebalancingMaster processes the tasks postponed in its todo list
+ */
+enum class SchedulingPolicy {
+    FIFO, // in order of arrival
+    PRIORITY, // first the tasks with the most threads waiting in their gates, aged by the time spent in the list
+};
+
+/**
+ * How the physical memory of the arrays is placed among the NUMA nodes
+ */
+enum class NumaPolicy {
+    NONE, // no policy, the pages are allocated on the node of the thread touching them first
+    INTERLEAVED, // the pages are interleaved among all nodes
+    OWNER, // the pages are bound to the node of the rebalancer, the owner of the gates
+    PARTITIONED, // the extents are range partitioned among the nodes, each node holds a contiguous interval of the keys
+};
+
 struct Knobs {
 public:
     double m_rank_threshold; // the rank of the element, normalised in [0, 1], to consider as threshold for the minimum timestamp
@@ -33,6 +51,15 @@ private:
     double m_sampling_rate; // the sample rate to forward an update to the detector, in [0, 1]
     int32_t m_sampling_percentage; // sample rate in percentage, in [0, 100]
     int32_t m_thresholds_switch; // number of extents after which the ``scan'' (or primary) density thresholds are employed. Only used in apma_parallel.
+    uint64_t m_nontemporal_threshold; // minimum size of a window to rebalance or resize, in bytes, to copy the elements with non-temporal stores
+    SchedulingPolicy m_scheduling_policy; // the order to process the tasks postponed by the RebalancingMaster
+    uint64_t m_master_spin_time; // in microsecs, how long the RebalancingMaster polls its command queue before going to sleep
+    uint64_t m_retained_buffer_memory; // in bytes, the max amount of free buffer space to keep backed by physical memory after a rebalance
+    double m_proactive_budget; // fraction of the time of the RebalancingMaster, in [0, 1], to spend rebalancing on its own the gates about to overflow. 0 = disabled
+    NumaPolicy m_numa_policy; // placement of the arrays among the NUMA nodes, applied by the RebalancingMaster at the next rebalance
+    uint64_t m_memory_budget; // in bytes, the physical memory the structure should not exceed, enforced by raising the densities, delaying the resizes and slowing down the writers. 0 = unlimited
+    uint64_t m_prefault_buffer_memory; // in bytes, the free buffer space the RebalancingMaster keeps populated ahead of the rebalances, the extents added by extending the arrays in place are populated as well. 0 = disabled
+    bool m_key_compression; // whether to compress the keys of the segments at the end of each rebalance, with the frame of reference codec. Only used in rma_baseline
 
 public:
     Knobs();
@@ -56,8 +83,53 @@ public:
     uint64_t get_thresholds_switch() const;
 
     void set_thresholds_switch(int32_t value);
+
+    uint64_t get_nontemporal_threshold() const;
+
+    void set_nontemporal_threshold(uint64_t value);
+
+    /**
+     * Measure the smallest copy, in bytes, for which the non-temporal stores cost less than the cached stores, once the clients
+     * read again the working set evicted by a cached copy. The measure is taken once per process, the following invocations
+     * return the same value. The default threshold is the size of the last level cache, without any measure.
+     */
+    static uint64_t calibrate_nontemporal_threshold();
+
+    SchedulingPolicy get_scheduling_policy() const;
+
+    void set_scheduling_policy(SchedulingPolicy value);
+
+    uint64_t get_master_spin_time() const;
+
+    void set_master_spin_time(uint64_t value);
+
+    uint64_t get_retained_buffer_memory() const;
+
+    void set_retained_buffer_memory(uint64_t value);
+
+    double get_proactive_budget() const;
+
+    void set_proactive_budget(double value);
+
+    NumaPolicy get_numa_policy() const;
+
+    void set_numa_policy(NumaPolicy value);
+
+    uint64_t get_memory_budget() const;
+
+    void set_memory_budget(uint64_t value);
+
+    uint64_t get_prefault_buffer_memory() const;
+
+    void set_prefault_buffer_memory(uint64_t value);
+
+    bool get_key_compression() const;
+
+    void set_key_compression(bool value);
 };
 
+std::ostream& operator<<(std::ostream& out, SchedulingPolicy policy);
+std::ostream& operator<<(std::ostream& out, NumaPolicy policy);
 std::ostream& operator<<(std::ostream& out, const Knobs& settings);
 
 inline double Knobs::get_rank_threshold() const{ return m_rank_threshold; }
@@ -68,5 +140,22 @@ inline uint64_t Knobs::get_max_segment_counter() const{ return m_max_segment_cou
 inline double Knobs::get_sampling_rate() const { return m_sampling_rate; }
 inline int32_t Knobs::get_sampling_percentage() const { return m_sampling_percentage; }
 inline uint64_t Knobs::get_thresholds_switch() const { return m_thresholds_switch; }
+inline uint64_t Knobs::get_nontemporal_threshold() const { return m_nontemporal_threshold; }
+inline void Knobs::set_nontemporal_threshold(uint64_t value) { m_nontemporal_threshold = value; }
+inline SchedulingPolicy Knobs::get_scheduling_policy() const { return m_scheduling_policy; }
+inline void Knobs::set_scheduling_policy(SchedulingPolicy value) { m_scheduling_policy = value; }
+inline uint64_t Knobs::get_master_spin_time() const { return m_master_spin_time; }
+inline void Knobs::set_master_spin_time(uint64_t value) { m_master_spin_time = value; }
+inline uint64_t Knobs::get_retained_buffer_memory() const { return m_retained_buffer_memory; }
+inline void Knobs::set_retained_buffer_memory(uint64_t value) { m_retained_buffer_memory = value; }
+inline double Knobs::get_proactive_budget() const { return m_proactive_budget; }
+inline NumaPolicy Knobs::get_numa_policy() const { return m_numa_policy; }
+inline void Knobs::set_numa_policy(NumaPolicy value) { m_numa_policy = value; }
+inline uint64_t Knobs::get_memory_budget() const { return m_memory_budget; }
+inline void Knobs::set_memory_budget(uint64_t value) { m_memory_budget = value; }
+inline uint64_t Knobs::get_prefault_buffer_memory() const { return m_prefault_buffer_memory; }
+inline void Knobs::set_prefault_buffer_memory(uint64_t value) { m_prefault_buffer_memory = value; }
+inline bool Knobs::get_key_compression() const { return m_key_compression; }
+inline void Knobs::set_key_compression(bool value) { m_key_compression = value; }
 
 } // namespace
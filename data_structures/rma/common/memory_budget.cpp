@@ -0,0 +1,77 @@
+/**
+ * Copyright (C) 2018 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "memory_budget.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+using namespace std;
+
+namespace data_structures::rma::common {
+
+void MemoryBudget::update(uint64_t budget, uint64_t usage) noexcept {
+    m_budget.store(budget, memory_order_relaxed);
+    m_usage.store(usage, memory_order_relaxed);
+
+    double back_pressure = 0;
+    if(budget > 0){
+        double pressure = static_cast<double>(usage) / budget;
+        back_pressure = clamp((pressure - SOFT_LIMIT) / (1 - SOFT_LIMIT), 0.0, 1.0);
+    }
+    m_back_pressure.store(back_pressure, memory_order_relaxed);
+}
+
+double MemoryBudget::get_pressure() const noexcept {
+    uint64_t budget = get_budget();
+    return budget > 0 ? static_cast<double>(get_usage()) / budget : 0.0;
+}
+
+double MemoryBudget::raise_upper_threshold(double theta, double theta_max) const noexcept {
+    double back_pressure = get_back_pressure();
+    if(back_pressure == 0 || theta >= theta_max) return theta;
+    return theta + (theta_max - theta) * back_pressure * MAX_THRESHOLD_RAISE;
+}
+
+uint64_t MemoryBudget::cap_retained_memory(uint64_t retained_memory) const noexcept {
+    return retained_memory * (1. - get_back_pressure());
+}
+
+void MemoryBudget::do_throttle(double back_pressure){
+    auto t0 = chrono::steady_clock::now();
+    uint64_t delay = back_pressure * MAX_WRITER_DELAY;
+    if(delay == 0){
+        this_thread::yield();
+    } else {
+        this_thread::sleep_for(chrono::microseconds(delay));
+    }
+    auto t1 = chrono::steady_clock::now();
+
+    m_num_throttled.fetch_add(1, memory_order_relaxed);
+    m_throttle_time.fetch_add(chrono::duration_cast<chrono::microseconds>(t1 - t0).count(), memory_order_relaxed);
+}
+
+ostream& operator<<(ostream& out, const MemoryBudget& budget){
+    out << "{MemoryBudget budget: ";
+    if(budget.get_budget() == 0){ out << "unlimited"; } else { out << budget.get_budget() << " bytes"; }
+    out << ", usage: " << budget.get_usage() << " bytes, pressure: " << budget.get_pressure() << ", back pressure: " << budget.get_back_pressure() <<
+            ", writers throttled: " << budget.get_num_throttled() << ", throttle time: " << budget.get_throttle_time() << " microsecs}";
+    return out;
+}
+
+} // namespace
@@ -0,0 +1,125 @@
+/**
+ * Copyright (C) 2018 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cinttypes>
+#include <cstddef>
+#include <ostream>
+
+namespace data_structures::rma::common {
+
+/**
+ * Soft limit on the physical memory used by a sparse array. The budget is set through the knobs and the usage, the
+ * resident memory footprint, is refreshed by the RebalancingMaster at the end of each resize. Once the usage crosses SOFT_LIMIT of the budget, the structure
+ * reacts with a back pressure, in [0, 1], that increases linearly up to the budget:
+ * - the upper density thresholds are raised towards the threshold of the leaves, to postpone the resizes. The upsizes
+ *   are also sized on the raised thresholds, so that the array grows by fewer extents at the time;
+ * - less free buffer space is retained after the rebalances;
+ * - the writers are delayed, up to MAX_WRITER_DELAY per update.
+ * The budget is not a hard cap: an upsize still grows the array by at least one extent, otherwise the new elements
+ * would not fit. The hard limit remains the max memory of the rewired arrays. The thresholds only change at the end
+ * of a resize, so that all windows are evaluated, and their elements spread, with the same densities.
+ */
+class MemoryBudget {
+    std::atomic<uint64_t> m_budget = 0; // in bytes, 0 = unlimited
+    std::atomic<uint64_t> m_usage = 0; // in bytes, the resident memory footprint recorded at the last refresh
+    std::atomic<double> m_back_pressure = 0; // in [0, 1], derived from the usage & the budget
+    std::atomic<uint64_t> m_num_throttled = 0; // number of updates delayed
+    std::atomic<uint64_t> m_throttle_time = 0; // in microsecs, total time the updates have been delayed
+
+public:
+    constexpr static double SOFT_LIMIT = 0.8; // fraction of the budget where the back pressure starts
+    constexpr static double MAX_THRESHOLD_RAISE = 0.5; // with the max back pressure, how far the upper thresholds are moved towards the leaves
+    constexpr static uint64_t MAX_WRITER_DELAY = 50; // in microsecs, the delay of a writer with the max back pressure
+
+    /**
+     * Refresh the budget and the current memory usage, both in bytes
+     */
+    void update(uint64_t budget, uint64_t usage) noexcept;
+
+    /**
+     * The budget, in bytes. 0 if unlimited
+     */
+    uint64_t get_budget() const noexcept;
+
+    /**
+     * The memory used at the time of the last refresh, in bytes
+     */
+    uint64_t get_usage() const noexcept;
+
+    /**
+     * Ratio between the usage and the budget. 0 if the budget is unlimited
+     */
+    double get_pressure() const noexcept;
+
+    /**
+     * Back pressure signal, in [0, 1]. It is 0 until the usage reaches SOFT_LIMIT of the budget and 1 once the budget is exhausted
+     */
+    double get_back_pressure() const noexcept;
+
+    /**
+     * Raise the upper threshold `theta' towards `theta_max', the threshold of the leaves, according to the back pressure
+     */
+    double raise_upper_threshold(double theta, double theta_max) const noexcept;
+
+    /**
+     * Scale down the free buffer space, in bytes, to retain after a rebalance, according to the back pressure
+     */
+    uint64_t cap_retained_memory(uint64_t retained_memory) const noexcept;
+
+    /**
+     * Delay the calling writer, in proportion to the back pressure
+     */
+    void throttle();
+
+    /**
+     * Number of updates delayed so far
+     */
+    uint64_t get_num_throttled() const noexcept;
+
+    /**
+     * Total time, in microsecs, the updates have been delayed
+     */
+    uint64_t get_throttle_time() const noexcept;
+
+private:
+    // Slow path of #throttle
+    void do_throttle(double back_pressure);
+};
+
+std::ostream& operator<<(std::ostream& out, const MemoryBudget& budget);
+
+/*****************************************************************************
+ *                                                                           *
+ *   Implementation details                                                  *
+ *                                                                           *
+ *****************************************************************************/
+
+inline uint64_t MemoryBudget::get_budget() const noexcept { return m_budget.load(std::memory_order_relaxed); }
+inline uint64_t MemoryBudget::get_usage() const noexcept { return m_usage.load(std::memory_order_relaxed); }
+inline double MemoryBudget::get_back_pressure() const noexcept { return m_back_pressure.load(std::memory_order_relaxed); }
+inline uint64_t MemoryBudget::get_num_throttled() const noexcept { return m_num_throttled.load(std::memory_order_relaxed); }
+inline uint64_t MemoryBudget::get_throttle_time() const noexcept { return m_throttle_time.load(std::memory_order_relaxed); }
+
+inline void MemoryBudget::throttle(){
+    double back_pressure = get_back_pressure();
+    if(back_pressure > 0){ do_throttle(back_pressure); }
+}
+
+} // namespace
@@ -17,10 +17,14 @@
 
 #include "memory_pool.hpp"
 
+#include <algorithm>
 #include <cstdlib> // malloc, free
+#include <mutex>
 #include <new>
 #include <sstream>
 #include <stdexcept>
+#include <thread>
+#include <unordered_set>
 
 #include "common/configuration.hpp"
 #include "common/console_arguments.hpp"
@@ -52,5 +56,134 @@ CachedMemoryPool_ThreadUnsafe::CachedMemoryPool_ThreadUnsafe() : CachedMemoryPoo
 
 CachedMemoryPool_ThreadUnsafe::CachedMemoryPool_ThreadUnsafe(size_t capacity) : m_pool(capacity), m_counter(0) {  }
 
+/*****************************************************************************
+ *                                                                           *
+ *   Thread-local arenas                                                     *
+ *                                                                           *
+ *****************************************************************************/
+
+namespace {
+
+std::atomic<uint64_t> g_next_pool_id { 1 }; // the id to assign to the next CachedMemoryPool_ThreadLocal
+std::atomic<uint64_t> g_next_thread_id { 1 }; // the id to assign to the next thread accessing the arenas
+std::mutex g_live_threads_mutex; // protect g_live_threads
+std::unordered_set<uint64_t> g_live_threads; // the ids of the threads not terminated yet
+
+/**
+ * Assign an id to the current thread, it stays registered as alive until the thread terminates. The arenas owned by
+ * a terminated thread can be claimed by other threads.
+ */
+struct ThreadId {
+    const uint64_t m_id;
+
+    ThreadId() : m_id(g_next_thread_id++) {
+        scoped_lock<mutex> lock(g_live_threads_mutex);
+        g_live_threads.insert(m_id);
+    }
+
+    ~ThreadId(){
+        scoped_lock<mutex> lock(g_live_threads_mutex);
+        g_live_threads.erase(m_id);
+    }
+};
+
+uint64_t get_thread_id(){
+    static thread_local ThreadId thread_id;
+    return thread_id.m_id;
+}
+
+} // anonymous namespace
+
+thread_local CachedMemoryPool_ThreadLocal::ThreadCache CachedMemoryPool_ThreadLocal::t_cache;
+
+CachedMemoryPool_ThreadLocal::CachedMemoryPool_ThreadLocal() :
+        CachedMemoryPool_ThreadLocal(get_default_capacity(), std::clamp<size_t>(2 * thread::hardware_concurrency(), 8, 256), 4ull << 20 /* 4 MB */) { }
+
+CachedMemoryPool_ThreadLocal::CachedMemoryPool_ThreadLocal(size_t global_capacity, size_t num_arenas, size_t arena_capacity) :
+        m_pool_id(g_next_pool_id++), m_arena_capacity((arena_capacity + 63) & ~static_cast<size_t>(63)), m_num_arenas(num_arenas),
+        m_arena_buffer(nullptr), m_arenas(nullptr), m_global_pool(global_capacity) {
+    if(m_num_arenas > 0 && m_arena_capacity > 0){
+        m_arena_buffer = (char*) malloc(m_num_arenas * m_arena_capacity); // the pages are only touched on demand
+        if(m_arena_buffer == nullptr) throw std::bad_alloc();
+        m_arenas = new Arena[m_num_arenas];
+    }
+}
+
+CachedMemoryPool_ThreadLocal::~CachedMemoryPool_ThreadLocal(){
+    delete[] m_arenas; m_arenas = nullptr;
+    free(m_arena_buffer); m_arena_buffer = nullptr;
+}
+
+CachedMemoryPool_ThreadLocal::Arena* CachedMemoryPool_ThreadLocal::claim_arena(){
+    const uint64_t thread_id = get_thread_id();
+    Arena* result = nullptr;
+
+    // the thread may already own an arena, from a previous access to this pool
+    for(size_t i = 0; i < m_num_arenas && result == nullptr; i++){
+        if(m_arenas[i].m_owner.load(memory_order_acquire) == thread_id){ result = m_arenas + i; }
+    }
+
+    // claim a free arena
+    for(size_t i = 0; i < m_num_arenas && result == nullptr; i++){
+        uint64_t expected = 0;
+        if(m_arenas[i].m_owner.compare_exchange_strong(expected, thread_id, memory_order_acq_rel)){ result = m_arenas + i; }
+    }
+
+    // claim an arena left by a terminated thread
+    if(result == nullptr && m_num_arenas > 0){
+        scoped_lock<mutex> lock(g_live_threads_mutex);
+        for(size_t i = 0; i < m_num_arenas && result == nullptr; i++){
+            uint64_t owner = m_arenas[i].m_owner.load(memory_order_acquire);
+            if(g_live_threads.count(owner) == 0 && m_arenas[i].m_owner.compare_exchange_strong(owner, thread_id, memory_order_acq_rel)){
+                result = m_arenas + i;
+            }
+        }
+    }
+
+    // with no arena available, the thread keeps using the global pool
+    t_cache.m_pool_id = m_pool_id;
+    t_cache.m_arena = result;
+    return result;
+}
+
+void* CachedMemoryPool_ThreadLocal::allocate_global(size_t n){
+    m_num_global_allocations.fetch_add(1, memory_order_relaxed);
+    scoped_lock<decltype(m_global_mutex)> lock(m_global_mutex);
+    return m_global_pool.allocate<char>(n);
+}
+
+bool CachedMemoryPool_ThreadLocal::empty() const {
+    for(size_t i = 0; i < m_num_arenas; i++){
+        if(m_arenas[i].m_counter.load(memory_order_acquire) != 0) return false;
+    }
+    scoped_lock<decltype(m_global_mutex)> lock(m_global_mutex);
+    return m_global_pool.empty();
+}
+
+MemoryPoolStatistics CachedMemoryPool_ThreadLocal::get_statistics() const {
+    MemoryPoolStatistics stats;
+    stats.m_num_arenas = m_num_arenas;
+    stats.m_arena_capacity = m_arena_capacity;
+    for(size_t i = 0; i < m_num_arenas; i++){
+        if(m_arenas[i].m_owner.load(memory_order_relaxed) != 0){ stats.m_num_arenas_owned++; }
+        stats.m_arena_allocations += m_arenas[i].m_num_allocations.load(memory_order_relaxed);
+        stats.m_arena_high_water_mark = max<uint64_t>(stats.m_arena_high_water_mark, m_arenas[i].m_high_water_mark.load(memory_order_relaxed));
+    }
+    stats.m_global_allocations = m_num_global_allocations.load(memory_order_relaxed);
+    scoped_lock<decltype(m_global_mutex)> lock(m_global_mutex);
+    stats.m_global_high_water_mark = m_global_pool.get_high_water_mark();
+    stats.m_malloc_allocations = m_global_pool.get_num_mallocs();
+    return stats;
+}
+
+std::ostream& operator<<(std::ostream& out, const MemoryPoolStatistics& stats){
+    out << "--- Memory pool ---\n";
+    out << "-> Arenas owned: " << stats.m_num_arenas_owned << "/" << stats.m_num_arenas << ", capacity of each arena: " << stats.m_arena_capacity << " bytes\n";
+    out << "-> Allocations served by the arenas: " << stats.m_arena_allocations << ", high water mark: " << stats.m_arena_high_water_mark << " bytes\n";
+    out << "-> Fallbacks to the global pool: " << stats.m_global_allocations << ", high water mark: " << stats.m_global_high_water_mark << " bytes\n";
+    out << "-> Fallbacks to malloc: " << stats.m_malloc_allocations;
+    return out;
+}
+
 
 } // namespace data_structures::rma::common
@@ -18,11 +18,14 @@
 #ifndef RMA_MEMORY_POOL_HPP_
 #define RMA_MEMORY_POOL_HPP_
 
+#include <atomic>
 //#include <cassert>
 #include <cstddef>
+#include <cstdint>
 #include <cstdlib>
 //#include <iostream>
 #include <mutex>
+#include <ostream>
 #include <new> // std::bad_alloc
 #include <stdexcept>
 
@@ -36,10 +39,12 @@ class CachedMemoryPool_ThreadUnsafe;
 template<typename T> class CachedAllocator_ThreadUnsafe; // forward decl
 class CachedMemoryPool_ThreadSafe;
 template<typename T> class CachedAllocator_ThreadSafe; // forward decl
+class CachedMemoryPool_ThreadLocal;
+template<typename T> class CachedAllocator_ThreadLocal; // forward decl
 
 // aliases
-using CachedMemoryPool = CachedMemoryPool_ThreadSafe;
-template<typename T> using CachedAllocator = CachedAllocator_ThreadSafe<T>;
+using CachedMemoryPool = CachedMemoryPool_ThreadLocal;
+template<typename T> using CachedAllocator = CachedAllocator_ThreadLocal<T>;
 
 /**
  * A simple memory pool
@@ -80,6 +85,11 @@ public:
      */
     void release(){ m_offset = 0; }
 
+    /**
+     * Amount of memory currently acquired from the pool, in bytes
+     */
+    size_t used() const { return m_offset; }
+
     /**
      * Return the pointer to the start of the underlying buffer
      */
@@ -99,6 +109,8 @@ public:
 class CachedMemoryPool_ThreadUnsafe {
     MemoryPool m_pool; // underlying memory pool
     int m_counter; // number of allocations currently in use from the pool
+    size_t m_high_water_mark = 0; // max amount of memory, in bytes, acquired at once from the pool
+    uint64_t m_num_mallocs = 0; // number of allocations that did not fit the pool and were served by malloc
 
     /**
      * Obtain a chunk of n bytes in the heap
@@ -154,6 +166,21 @@ public:
      * Check whether there is any allocation not released yet
      */
     bool empty() const { return m_counter == 0; }
+
+    /**
+     * Check whether the given pointer has been allocated from the underlying pool, rather than by malloc
+     */
+    bool contains(const void* ptr) const { return m_pool.begin() <= ptr && ptr <= m_pool.end(); }
+
+    /**
+     * Max amount of memory, in bytes, acquired at once from the underlying pool
+     */
+    size_t get_high_water_mark() const { return m_high_water_mark; }
+
+    /**
+     * Number of allocations that did not fit the underlying pool and were served by malloc
+     */
+    uint64_t get_num_mallocs() const { return m_num_mallocs; }
 };
 
 
@@ -265,6 +292,150 @@ public:
 };
 
 
+/**
+ * Counters of a CachedMemoryPool_ThreadLocal
+ */
+struct MemoryPoolStatistics {
+    uint64_t m_num_arenas = 0; // total number of thread-local arenas
+    uint64_t m_num_arenas_owned = 0; // number of arenas currently owned by a thread
+    uint64_t m_arena_capacity = 0; // capacity of a single arena, in bytes
+    uint64_t m_arena_allocations = 0; // number of allocations served by the thread-local arenas
+    uint64_t m_arena_high_water_mark = 0; // max amount of memory, in bytes, acquired at once from a single arena
+    uint64_t m_global_allocations = 0; // number of allocations that fell back to the global pool
+    uint64_t m_global_high_water_mark = 0; // max amount of memory, in bytes, acquired at once from the global pool
+    uint64_t m_malloc_allocations = 0; // number of allocations that did not fit the global pool either, served by malloc
+};
+
+std::ostream& operator<<(std::ostream& out, const MemoryPoolStatistics& stats);
+
+/**
+ * A memory pool split in thread-local arenas. Each thread claims an arena on its first allocation and, from then on,
+ * serves its requests from the arena with a bump pointer, without any lock. An allocation can be released by any thread,
+ * the arena keeps an atomic count of the allocations in use and its owner rewinds the bump pointer once all of them
+ * have been released. The requests that do not fit the arena of the thread, or issued when all arenas are owned, fall
+ * back to a global pool protected by a spin lock, and eventually to malloc.
+ */
+class CachedMemoryPool_ThreadLocal {
+    struct alignas(64) Arena {
+        std::atomic<uint64_t> m_owner { 0 }; // the id of the thread owning the arena, 0 if free
+        std::atomic<int64_t> m_counter { 0 }; // number of allocations currently in use from the arena
+        size_t m_offset = 0; // bump pointer, only altered by the owner
+        std::atomic<uint64_t> m_num_allocations { 0 }; // statistics, only altered by the owner
+        std::atomic<uint64_t> m_high_water_mark { 0 }; // statistics, only altered by the owner
+    };
+
+    // Cache of the arena owned by the current thread, for the last pool accessed
+    struct ThreadCache { uint64_t m_pool_id = 0; Arena* m_arena = nullptr; };
+    static thread_local ThreadCache t_cache;
+
+    const uint64_t m_pool_id; // unique id of this pool, to validate the thread caches
+    const size_t m_arena_capacity; // the capacity of each arena, in bytes
+    const size_t m_num_arenas; // total number of arenas
+    char* m_arena_buffer; // the memory of all arenas, contiguous
+    Arena* m_arenas; // the state of each arena
+    CachedMemoryPool_ThreadUnsafe m_global_pool; // fallback for the allocations that do not fit the arenas
+    mutable ::common::SpinLock m_global_mutex; // protect the global pool
+    std::atomic<uint64_t> m_num_global_allocations { 0 }; // statistics, number of allocations served by the global pool
+
+    // Retrieve the arena owned by the current thread, or nullptr if all arenas are owned by other threads
+    Arena* thread_arena(){ return (t_cache.m_pool_id == m_pool_id) ? t_cache.m_arena : claim_arena(); }
+
+    // Slow path of #thread_arena, find the arena already owned by the thread or claim a new one
+    Arena* claim_arena();
+
+    // Obtain a chunk of n bytes
+    void* allocate_raw(size_t n);
+
+    // Fallback to the global pool
+    void* allocate_global(size_t n);
+
+public:
+    /**
+     * Initialise the global pool with the capacity defined by the console argument --memory_pool, or the default 64MB
+     * if not set. The thread-local arenas are sized on the number of hardware threads
+     */
+    CachedMemoryPool_ThreadLocal();
+
+    /**
+     * Initialise a memory pool with the given capacities
+     * @param global_capacity the capacity of the global pool, in bytes
+     * @param num_arenas the number of thread-local arenas
+     * @param arena_capacity the capacity of each arena, in bytes
+     */
+    CachedMemoryPool_ThreadLocal(size_t global_capacity, size_t num_arenas, size_t arena_capacity);
+
+    /**
+     * Destructor
+     */
+    ~CachedMemoryPool_ThreadLocal();
+
+    /**
+     * Allocate the space of n objects of type T
+     */
+    template<typename T>
+    T* allocate(size_t n){ return (T*) allocate_raw(n * sizeof(T)); }
+
+    /**
+     * Deallocate the given object. It can be invoked by any thread.
+     */
+    void deallocate(void* ptr);
+
+    /**
+     * Get a C++ allocator for this memory pool
+     */
+    template <typename T>
+    CachedAllocator_ThreadLocal<T> allocator(){ return CachedAllocator_ThreadLocal<T>(this); }
+
+    /**
+     * Check whether there is any allocation not released yet
+     */
+    bool empty() const;
+
+    /**
+     * Retrieve the counters of the pool
+     */
+    MemoryPoolStatistics get_statistics() const;
+};
+
+/**
+ * Allocator relying on a CachedMemoryPool_ThreadLocal
+ */
+template<typename T>
+class CachedAllocator_ThreadLocal {
+    template<typename U> friend class CachedAllocator_ThreadLocal;
+    CachedMemoryPool_ThreadLocal* m_pool;
+public:
+    using value_type = T;
+
+    /**
+     * Constructor
+     */
+    CachedAllocator_ThreadLocal(CachedMemoryPool_ThreadLocal* pool);
+
+    /**
+     * Rebind constructor, required by the C++ concept
+     */
+    template<typename U>
+    CachedAllocator_ThreadLocal(const CachedAllocator_ThreadLocal<U>& other) : m_pool(other.m_pool) { }
+
+    /**
+     * Allocate storage suitable for n objects
+     */
+    T* allocate(size_t n);
+
+    /**
+     * Release the given pointer
+     */
+    void deallocate(T* ptr, size_t) noexcept;
+
+    /**
+     * Required by the C++ concept
+     */
+    bool operator==(const CachedAllocator_ThreadLocal<T>& other) const;
+    bool operator!=(const CachedAllocator_ThreadLocal<T>& other) const;
+};
+
+
 /*****************************************************************************
  *                                                                           *
  *   Implementation                                                          *
@@ -302,8 +473,10 @@ void* CachedMemoryPool_ThreadUnsafe::allocate_raw(size_t n){
     if(ptr == nullptr){ // failure
         ptr = (char*) malloc(n);
         if(ptr == nullptr) throw std::bad_alloc();
+        m_num_mallocs++;
     } else { // success
         m_counter++;
+        if(m_pool.used() > m_high_water_mark) m_high_water_mark = m_pool.used();
     }
 
 //    std::cout << "[CachedMemoryPool::allocate_raw] ptr: " << ptr << ", n: " << n << std::endl;
@@ -313,7 +486,7 @@ void* CachedMemoryPool_ThreadUnsafe::allocate_raw(size_t n){
 inline
 void CachedMemoryPool_ThreadUnsafe::deallocate_raw(void* ptr){
 //    std::cout << "[CachedMemoryPool::deallocate_raw] ptr: " << ptr << std::endl;
-    if(m_pool.begin() <= ptr && ptr <= m_pool.end()){
+    if(contains(ptr)){
         m_counter--;
         if(m_counter == 0) m_pool.release();
     } else { // rely on the standard library
@@ -367,6 +540,61 @@ bool CachedAllocator_ThreadSafe<T>::operator!=(const CachedAllocator_ThreadSafe<
     return m_allocator.operator !=(other.m_allocator);
 }
 
+inline
+void* CachedMemoryPool_ThreadLocal::allocate_raw(size_t n){
+    if(n == 0) return nullptr;
+    n = (n + alignof(std::max_align_t) -1) & ~(alignof(std::max_align_t) -1);
+
+    Arena* arena = thread_arena();
+    if(arena != nullptr){
+        // all the previous allocations have been released, by this or by other threads, rewind the bump pointer
+        if(arena->m_counter.load(std::memory_order_acquire) == 0){ arena->m_offset = 0; }
+        if(m_arena_capacity - arena->m_offset >= n){
+            char* ptr = m_arena_buffer + (arena - m_arenas) * m_arena_capacity + arena->m_offset;
+            arena->m_offset += n;
+            arena->m_counter.fetch_add(1, std::memory_order_relaxed);
+            arena->m_num_allocations.store(arena->m_num_allocations.load(std::memory_order_relaxed) +1, std::memory_order_relaxed);
+            if(arena->m_offset > arena->m_high_water_mark.load(std::memory_order_relaxed)){ arena->m_high_water_mark.store(arena->m_offset, std::memory_order_relaxed); }
+            return ptr;
+        }
+    }
+
+    return allocate_global(n);
+}
+
+inline
+void CachedMemoryPool_ThreadLocal::deallocate(void* ptr){
+    if(ptr == nullptr) return;
+    char* address = reinterpret_cast<char*>(ptr);
+    if(m_arena_buffer <= address && address < m_arena_buffer + m_num_arenas * m_arena_capacity){
+        m_arenas[(address - m_arena_buffer) / m_arena_capacity].m_counter.fetch_sub(1, std::memory_order_release);
+    } else {
+        std::scoped_lock<decltype(m_global_mutex)> lock(m_global_mutex);
+        m_global_pool.deallocate(ptr);
+    }
+}
+
+template<typename T>
+CachedAllocator_ThreadLocal<T>::CachedAllocator_ThreadLocal(CachedMemoryPool_ThreadLocal* pool) : m_pool(pool) {
+    if (pool == nullptr){ throw std::invalid_argument("Null pointer"); }
+}
+template<typename T>
+T* CachedAllocator_ThreadLocal<T>::allocate(size_t n){
+    return m_pool->allocate<T>(n);
+}
+template<typename T>
+void CachedAllocator_ThreadLocal<T>::deallocate(T* ptr, size_t) noexcept {
+    m_pool->deallocate(ptr);
+}
+template<typename T>
+bool CachedAllocator_ThreadLocal<T>::operator==(const CachedAllocator_ThreadLocal<T>& other) const {
+    return m_pool == other.m_pool;
+}
+template<typename T>
+bool CachedAllocator_ThreadLocal<T>::operator!=(const CachedAllocator_ThreadLocal<T>& other) const {
+    return !((*this) == other);
+}
+
 } // data_structures::rma::common
 
 #endif /* RMA_MEMORY_POOL_HPP_ */
@@ -18,19 +18,23 @@
 #pragma once
 
 #include <cassert>
-#include "common/miscellaneous.hpp"
+#include <cinttypes>
 
 #include "abort.hpp"
 
 namespace data_structures::rma::common {
 
+/**
+ * A pointer tagged with the global epoch when it was last installed. A thread that announced an older epoch may
+ * have observed the previous version of the related data structures and it needs to restart its operation.
+ */
 template <typename T, typename ThreadContext>
 class Pointer {
-    uint64_t m_timestamp;
+    uint64_t m_timestamp; // the global epoch when the pointer was installed
     T* m_pointer;
 
 public:
-    Pointer(T* pointer) : m_timestamp(::common::rdtscp()), m_pointer(pointer) { }
+    Pointer(T* pointer) : m_timestamp(0), m_pointer(pointer) { }
 
     T* get_unsafe() const {
         return m_pointer;
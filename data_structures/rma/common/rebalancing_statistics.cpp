@@ -20,23 +20,19 @@
 #include <algorithm>
 #include <cassert>
 #include <cmath>
-#include <mutex>
+#include <iostream>
 
-#include "common/miscellaneous.hpp" // get_thread_id
-
-using namespace common;
 using namespace std;
 
-namespace data_structures::rma::batch_processing {
+namespace data_structures::rma::common {
 
 /*****************************************************************************
  *                                                                           *
  *   DEBUG                                                                   *
  *                                                                           *
  *****************************************************************************/
-extern mutex _debug_mutex; // PackedMemoryArray.cpp
 //#define DEBUG
-#define COUT_DEBUG_FORCE(msg) { scoped_lock<mutex> lock(_debug_mutex); std::cout << "[RebalancingStatistics::" << __FUNCTION__ << "] [" << get_thread_id() << "] " << msg << std::endl; }
+#define COUT_DEBUG_FORCE(msg) std::cout << "[RebalancingStatistics::" << __FUNCTION__ << "] " << msg << std::endl
 #if defined(DEBUG)
     #define COUT_DEBUG(msg) COUT_DEBUG_FORCE(msg)
 #else
@@ -125,13 +121,23 @@ RebalancingCompleteStatistics get_rebalancing_stastistics(std::vector<Rebalancin
                 add_stat(window.m_master_num_tasks_merged, profiles[index_end].m_master_num_tasks_merged);
                 add_stat(window.m_master_launch_time, profiles[index_end].m_master_launch_time);
                 add_stat(window.m_master_release_time, profiles[index_end].m_master_release_time);
+                add_stat(window.m_master_use_rewiring, profiles[index_end].m_master_use_rewiring);
+                add_stat(window.m_master_batch_size, profiles[index_end].m_master_batch_size);
+                add_stat(window.m_master_delay, profiles[index_end].m_master_delay);
+                add_stat(window.m_master_page_faults, profiles[index_end].m_master_page_faults);
                 add_stat(window.m_worker_total_time, profiles[index_end].m_worker_total_time);
+                add_stat(window.m_worker_apma_time, profiles[index_end].m_worker_apma_time);
                 add_stat(window.m_worker_sort_time, profiles[index_end].m_worker_sort_time);
                 add_stat(window.m_worker_make_subtasks_time, profiles[index_end].m_worker_make_subtasks_time);
                 add_stat(window.m_worker_num_subtaks, profiles[index_end].m_worker_num_subtaks);
+                add_stat(window.m_worker_num_stolen_subtasks, profiles[index_end].m_worker_num_stolen_subtasks);
                 add_stat(window.m_worker_segment_cards, profiles[index_end].m_worker_segment_cards);
                 add_stat(window.m_worker_clear_blkload_queues, profiles[index_end].m_worker_clear_blkload_queues);
                 add_stat(window.m_worker_num_threads, profiles[index_end].m_worker_num_threads);
+                add_stat(window.m_worker_rewiring_time, profiles[index_end].m_worker_rewiring_time);
+                add_stat(window.m_worker_rewired_extents, profiles[index_end].m_worker_rewired_extents);
+                add_stat(window.m_worker_rewiring_syscalls, profiles[index_end].m_worker_rewiring_syscalls);
+                add_stat(window.m_worker_page_faults, profiles[index_end].m_worker_page_faults);
 
                 int64_t worker_exec_time_min = std::numeric_limits<int64_t>::max();
                 int64_t worker_exec_time_max = std::numeric_limits<int64_t>::min();
@@ -166,13 +172,23 @@ RebalancingCompleteStatistics get_rebalancing_stastistics(std::vector<Rebalancin
             finalize_stat(m_master_num_resumes);
             finalize_stat(m_master_num_tasks_merged);
             finalize_stat(m_master_release_time);
+            finalize_stat(m_master_use_rewiring);
+            finalize_stat(m_master_batch_size);
+            finalize_stat(m_master_delay);
+            finalize_stat(m_master_page_faults);
             finalize_stat(m_worker_total_time);
+            finalize_stat(m_worker_apma_time);
             finalize_stat(m_worker_sort_time);
             finalize_stat(m_worker_make_subtasks_time);
             finalize_stat(m_worker_num_subtaks);
+            finalize_stat(m_worker_num_stolen_subtasks);
             finalize_stat(m_worker_segment_cards);
             finalize_stat(m_worker_clear_blkload_queues);
             finalize_stat(m_worker_num_threads);
+            finalize_stat(m_worker_rewiring_time);
+            finalize_stat(m_worker_rewired_extents);
+            finalize_stat(m_worker_rewiring_syscalls);
+            finalize_stat(m_worker_page_faults);
             compute_avg_stddev(window.m_worker_task_exec_time_min);
             compute_avg_stddev(window.m_worker_task_exec_time_max);
             compute_avg_stddev(window.m_worker_task_exec_time_avg);
@@ -230,10 +246,16 @@ ostream& operator<<(ostream& out, const RebalancingWindowStatistics& window){
     out << "    (master) tasks merged in rebal_resume(): " << window.m_master_num_tasks_merged << "\n";
     out << "    (master) launch time: " << window.m_master_launch_time << " microsecs\n";
     out << "    (master) post processing time: " << window.m_master_release_time << " microsecs\n";
+    out << "    (master) tasks executed with rewiring: " << window.m_master_use_rewiring.m_sum << ", with copies: " << (window.m_count - window.m_master_use_rewiring.m_sum) << "\n";
+    out << "    (master) bulk loading, batch size: " << window.m_master_batch_size << "\n";
+    out << "    (master) delay of the gates before the rebalance: " << window.m_master_delay << " microsecs\n";
+    out << "    (master) page faults to allocate the storage: " << window.m_master_page_faults << "\n";
     out << "    (worker) coordinator, execution time (wall clock): " << window.m_worker_total_time << " microsecs\n";
+    out << "    (worker) APMA partitions: " << window.m_worker_apma_time << " microsecs\n";
     out << "    (worker) bulk loading, sorting time: " << window.m_worker_sort_time << " microsecs\n";
     out << "    (worker) creating the subtasks: " << window.m_worker_make_subtasks_time << " microsecs\n";
     out << "    (worker) number of subtasks created: " << window.m_worker_num_subtaks << "\n";
+    out << "    (worker) number of subtasks stolen: " << window.m_worker_num_stolen_subtasks << "\n";
     out << "    (worker) total number of threads: " << window.m_worker_num_threads << "\n";
     out << "    (worker) average execution time per subtask: " << window.m_worker_task_exec_time_avg << " microsecs\n";
     out << "    (worker) minimum execution time per subtask: " << window.m_worker_task_exec_time_min << " microsecs\n";
@@ -241,6 +263,9 @@ ostream& operator<<(ostream& out, const RebalancingWindowStatistics& window){
     out << "    (worker) median execution time per subtask: " << window.m_worker_task_exec_time_median << " microsecs\n";
     out << "    (worker) update segment cardinalities: " << window.m_worker_segment_cards << " microsecs\n";
     out << "    (worker) bulk loading, clearing queues: " << window.m_worker_clear_blkload_queues << " microsecs\n";
+    out << "    (worker) rewiring time: " << window.m_worker_rewiring_time << " microsecs\n";
+    out << "    (worker) extents rewired: " << window.m_worker_rewired_extents << ", mmap syscalls: " << window.m_worker_rewiring_syscalls << "\n";
+    out << "    (worker) page faults: " << window.m_worker_page_faults << "\n";
     return out;
 }
 
@@ -258,4 +283,20 @@ ostream& operator<<(ostream& out, const RebalancingCompleteStatistics& stats){
     return out;
 }
 
+ostream& operator<<(ostream& out, const MasterStatistics& stats){
+    out << "--- Master statistics ---\n";
+    out << "-> Messages received: " << stats.m_num_messages << ", latency avg: " << (stats.m_num_messages > 0 ? stats.m_message_latency_sum / stats.m_num_messages : 0) <<
+            " nanosecs, max: " << stats.m_message_latency_max << " nanosecs\n";
+    out << "-> Batches drained: " << stats.m_num_batches << ", avg size: " << (stats.m_num_batches > 0 ? static_cast<double>(stats.m_num_messages) / stats.m_num_batches : 0.0) <<
+            ", max size: " << stats.m_batch_size_max << "\n";
+    out << "-> Messages fetched while spinning: " << stats.m_num_spins << ", parks on the condition variable: " << stats.m_num_parks << "\n";
+    out << "-> CPU time: " << stats.m_cpu_time << " microsecs, wall clock time: " << stats.m_wallclock_time << " microsecs, utilisation: " <<
+            (stats.m_wallclock_time > 0 ? 100.0 * stats.m_cpu_time / stats.m_wallclock_time : 0.0) << "%\n";
+    out << "-> Rebalances requested by the clients: " << stats.m_requested_rebalances << ", proactive: " << stats.m_proactive_rebalances <<
+            ", client rebalances avoided: " << stats.m_proactive_avoided << ", gates inspected: " << stats.m_proactive_gates_inspected <<
+            ", proactive time: " << stats.m_proactive_time << " microsecs\n";
+    out << "-> Page faults: " << stats.m_page_faults << ", free buffers prefaulted: " << stats.m_prefault_buffers << ", prefault time: " << stats.m_prefault_time << " microsecs\n";
+    return out;
+}
+
 } // namespace
@@ -21,7 +21,7 @@
 #include <ostream>
 #include <vector>
 
-namespace data_structures::rma::batch_processing {
+namespace data_structures::rma::common {
 
 /**
  * Enable the wrapped statement only in profiling mode (-DPROFILING)
@@ -48,14 +48,24 @@ struct RebalancingStatistics {
     int64_t m_master_num_tasks_merged = 0; // the number of tasks merged in the search phase
     int64_t m_master_launch_time = 0; // in microsecs, the amount of time spent by the Master to launch this task
     int64_t m_master_release_time = 0; // in microsecs, time spent by the Master in the final stage (releasing the locks, waking up the threads)
+    int64_t m_master_use_rewiring = 1; // 1 if the cost model chose to rewire the extents of the window, 0 to copy them back in place
+    int64_t m_master_batch_size = 0; // number of updates accumulated in the queues of the gates, waiting for this rebalance
+    int64_t m_master_delay = 0; // in microsecs, the max delay in effect for the gates of this task before the rebalance
+    int64_t m_master_page_faults = 0; // number of page faults incurred by the Master to launch this task, that is to allocate or extend the storage
 
     int64_t m_worker_total_time = 0; // total time to execute the rebalancing by the workers
+    int64_t m_worker_apma_time = 0; // in microsecs, time spent to compute the cardinalities of the partitions with the APMA algorithm
     int64_t m_worker_sort_time = 0; // in microsecs, time spent to sort the elts in the bulk loading lists
     int64_t m_worker_make_subtasks_time = 0; // in microsecs, time spent to create the list of subtasks
     int64_t m_worker_num_subtaks = 0; // the number of subtasks created (=0, single queue execution)
+    int64_t m_worker_num_stolen_subtasks = 0; // the number of subtasks executed by a worker other than the owner of their deque
     int64_t m_worker_segment_cards = 0; // in microsecs, time spent to update the segment cardinalities
     int64_t m_worker_clear_blkload_queues = 0; // in microsecs, time spent to reset the bulk loading queues
     int64_t m_worker_num_threads = 1; // total number of workers loaded for the task
+    int64_t m_worker_rewiring_time = 0; // in microsecs, time spent to rewire the buffers into the sparse array
+    int64_t m_worker_rewired_extents = 0; // number of extents rewired, counting the keys and the values apart
+    int64_t m_worker_rewiring_syscalls = 0; // number of mmap syscalls issued to rewire the extents
+    int64_t m_worker_page_faults = 0; // number of page faults incurred by all workers to execute the task
     std::vector<int64_t> m_worker_task_exec_time; // the execution time of each subtask
 
 
@@ -63,6 +73,29 @@ struct RebalancingStatistics {
 };
 
 
+/**
+ * Statistics on the messages exchanged between the clients/workers and the RebalancingMaster
+ */
+struct MasterStatistics {
+    int64_t m_num_messages = 0; // total number of messages received by the master
+    int64_t m_message_latency_sum = 0; // in nanosecs, cumulative time between sending a message and the master fetching it
+    int64_t m_message_latency_max = 0; // in nanosecs, maximum time between sending a message and the master fetching it
+    int64_t m_num_batches = 0; // number of times the master drained the command queue
+    int64_t m_batch_size_max = 0; // the maximum number of messages drained at once
+    int64_t m_num_spins = 0; // number of times the master found a new message while spinning
+    int64_t m_num_parks = 0; // number of times the master went to sleep on the condition variable
+    int64_t m_wallclock_time = 0; // in microsecs, the lifetime of the master thread
+    int64_t m_cpu_time = 0; // in microsecs, the CPU time consumed by the master thread
+    int64_t m_requested_rebalances = 0; // number of tasks created on request of a client
+    int64_t m_proactive_rebalances = 0; // number of tasks started by the master on its own, for the gates about to overflow
+    int64_t m_proactive_avoided = 0; // proactive tasks completed with no client waiting on their gates, i.e. client rebalances avoided
+    int64_t m_proactive_gates_inspected = 0; // number of gates checked while looking for proactive rebalances
+    int64_t m_proactive_time = 0; // in microsecs, time spent by the master looking for & starting proactive rebalances
+    int64_t m_prefault_buffers = 0; // number of free buffers populated by the master ahead of the rebalances
+    int64_t m_prefault_time = 0; // in microsecs, time spent by the master to populate the free buffers
+    int64_t m_page_faults = 0; // number of page faults incurred by the master thread
+};
+
 /**
  * Attach a timer to a variable of RebalancingStatistics using the RAII paradigm
  */
@@ -109,14 +142,24 @@ struct RebalancingWindowStatistics{
     RebalancingFieldStatistics m_master_num_tasks_merged; // the number of tasks merged in the search phase
     RebalancingFieldStatistics m_master_launch_time; // in microsecs, the amount of time spent by the Master to launch this task
     RebalancingFieldStatistics m_master_release_time; // in microsecs, time spent by the Master in the final stage (releasing the locks, waking up the threads)
+    RebalancingFieldStatistics m_master_use_rewiring; // whether the extents were rewired (1) or copied back (0)
+    RebalancingFieldStatistics m_master_batch_size; // number of updates accumulated in the queues of the gates, waiting for the rebalance
+    RebalancingFieldStatistics m_master_delay; // in microsecs, the max delay in effect for the gates of the task before the rebalance
+    RebalancingFieldStatistics m_master_page_faults; // number of page faults incurred by the Master to launch the task
 
     RebalancingFieldStatistics m_worker_total_time; // total time to execute the rebalancing by the workers
+    RebalancingFieldStatistics m_worker_apma_time; // in microsecs, time spent to compute the cardinalities of the partitions with the APMA algorithm
     RebalancingFieldStatistics m_worker_sort_time; // in microsecs, time spent to sort the elts in the bulk loading lists
     RebalancingFieldStatistics m_worker_make_subtasks_time; // in microsecs, time spent to create the list of subtasks
     RebalancingFieldStatistics m_worker_num_subtaks; // the number of subtasks created (=0, single queue execution)
+    RebalancingFieldStatistics m_worker_num_stolen_subtasks; // the number of subtasks executed by a worker other than the owner of their deque
     RebalancingFieldStatistics m_worker_segment_cards; // in microsecs, time spent to update the segment cardinalities
     RebalancingFieldStatistics m_worker_clear_blkload_queues; // in microsecs, time spent to reset the bulk loading queues
     RebalancingFieldStatistics m_worker_num_threads; // total number of workers loaded for the task
+    RebalancingFieldStatistics m_worker_rewiring_time; // in microsecs, time spent to rewire the buffers into the sparse array
+    RebalancingFieldStatistics m_worker_rewired_extents; // number of extents rewired, counting the keys and the values apart
+    RebalancingFieldStatistics m_worker_rewiring_syscalls; // number of mmap syscalls issued to rewire the extents
+    RebalancingFieldStatistics m_worker_page_faults; // number of page faults incurred by all workers to execute the task
     RebalancingFieldStatistics m_worker_task_exec_time_avg; // the execution time of each subtask
     RebalancingFieldStatistics m_worker_task_exec_time_min; // the execution time of each subtask
     RebalancingFieldStatistics m_worker_task_exec_time_max; // the execution time of each subtask
@@ -148,6 +191,7 @@ std::ostream& operator<<(std::ostream& out, RebalancingStatistics::Type type);
 std::ostream& operator<<(std::ostream& out, const RebalancingFieldStatistics& field);
 std::ostream& operator<<(std::ostream& out, const RebalancingWindowStatistics& window);
 std::ostream& operator<<(std::ostream& out, const RebalancingCompleteStatistics& stats);
+std::ostream& operator<<(std::ostream& out, const MasterStatistics& stats);
 
 
 } // namespace
@@ -17,13 +17,24 @@
 
 #include "rewired_memory.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cerrno>
+#include <cstdio> // sscanf
 #include <cstring>
+#include <fstream>
+#include <fcntl.h> // fallocate
 #include <iostream>
 #include <linux/memfd.h>
+#include <memory>
+#if defined(HAVE_LIBNUMA)
+#include <numa.h>
+#include <numaif.h> // mbind
+#endif
 #include <string>
 #include <sys/mman.h> // mmap
+#include <sys/stat.h> // fstat
 #include <unistd.h>
 
 #include "common/configuration.hpp"
@@ -59,7 +70,8 @@ static int g_internal_id = 0;
 
 RewiredMemory::RewiredMemory(size_t pages_per_extent, size_t num_extents, size_t max_memory) :
         m_page_size(get_memory_page_size()), m_num_pages_per_extent(pages_per_extent), m_start_address(nullptr),
-        m_handle_physical_memory(-1), m_max_memory(max_memory){
+        m_handle_physical_memory(-1), m_max_memory(max_memory),
+        m_transparent_huge_pages(!configuration::use_huge_pages() && configuration::use_transparent_huge_pages()){
     // validate the user parameters
     if(pages_per_extent <= 0){ throw invalid_argument("[RewiredMemory::ctor] pages_per_extent <= 0"); }
     if(num_extents <= 0){ throw invalid_argument("[RewiredMemory::ctor] num_extents <= 0"); }
@@ -82,16 +94,35 @@ RewiredMemory::RewiredMemory(size_t pages_per_extent, size_t num_extents, size_t
     rc = ftruncate(m_handle_physical_memory, size_physical_memory);
     if(rc != 0){ RAISE("Cannot allocate the physical memory. ftruncate error: " << strerror(errno) << "(" << errno << ")"); }
 
+    // a transparent huge page can only back a virtual range aligned to its size: reserve an extra huge page of address space, then
+    // place the mapping at the first aligned address
+    void* start_address = NULL; // arbitrary
+    if(m_transparent_huge_pages){
+        constexpr size_t huge_page_size = 1ull << 21; // 2 MB
+        const size_t reserved_size = get_max_memory() + huge_page_size;
+        char* reserved = (char*) mmap(NULL, reserved_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if(reserved == MAP_FAILED){ RAISE("Cannot reserve the virtual memory: " << reserved_size << " bytes. mmap error: " << strerror(errno) << "(" << errno << ")"); }
+        char* aligned = (char*) ((reinterpret_cast<uintptr_t>(reserved) + huge_page_size -1) & ~(huge_page_size -1));
+        if(aligned > reserved){ munmap(reserved, aligned - reserved); } // release the excess, the aligned range is replaced below by MAP_FIXED
+        if(aligned + get_max_memory() < reserved + reserved_size){ munmap(aligned + get_max_memory(), (reserved + reserved_size) - (aligned + get_max_memory())); }
+        start_address = aligned;
+    }
+
     // memory map the physical memory to a virtual address
     void* mmap_ret = mmap(
-        /* starting address, NULL means arbitrary */ NULL,
+        /* starting address, NULL means arbitrary */ start_address,
         /* length in bytes */ get_max_memory(),
         /* memory protection */ PROT_READ | PROT_WRITE,
-        /* flags */ MAP_SHARED,
+        /* flags */ MAP_SHARED | (start_address != NULL ? MAP_FIXED : 0),
         /* file descriptor */ m_handle_physical_memory,
         /* offset, in terms of multiples of the page size */ 0);
-    if(mmap_ret == MAP_FAILED){ RAISE("Cannot allocate the virtual memory: " << get_max_memory() << " bytes. mmap error: " << strerror(errno) << "(" << errno << ")"); }
+    if(mmap_ret == MAP_FAILED){
+        int mmap_errno = errno;
+        if(start_address != NULL){ munmap(start_address, get_max_memory()); } // the reservation
+        RAISE("Cannot allocate the virtual memory: " << get_max_memory() << " bytes. mmap error: " << strerror(mmap_errno) << "(" << mmap_errno << ")");
+    }
     m_start_address = mmap_ret;
+    advise_huge_pages(m_start_address, get_max_memory());
 
     /**
      * In case the user attempts to access mapped memory not backed by the physical memory (as m_allocated_extents < m_reserved_extents)
@@ -103,6 +134,7 @@ RewiredMemory::RewiredMemory(size_t pages_per_extent, size_t num_extents, size_t
     for(size_t i = 0; i < num_extents; i++){
         m_translation_map.push_back(i);
     }
+    m_numa_nodes.assign(num_extents, -1);
 }
 
 
@@ -131,7 +163,15 @@ RewiredMemory::~RewiredMemory(){
  *                                                                           *
  *****************************************************************************/
 
-void RewiredMemory::validate_address(void* address){
+void RewiredMemory::advise_huge_pages(void* address, size_t length){
+    if(!m_transparent_huge_pages) return;
+
+    // it is only an advice, whether the kernel grants the huge pages depends on /sys/kernel/mm/transparent_hugepage/shmem_enabled
+    int rc = madvise(address, length, MADV_HUGEPAGE);
+    if(rc != 0){ COUT_DEBUG("madvise(MADV_HUGEPAGE) error: " << strerror(errno) << " (" << errno << ")"); }
+}
+
+void RewiredMemory::validate_address(void* address) const {
     if(((uint64_t) address - (uint64_t) m_start_address) % get_extent_size() != 0){ RAISE("Address not aligned to the extent: " << address); }
     char* start_address = (char*) get_start_address();
     char* vmem = (char*) address;
@@ -182,11 +222,177 @@ void RewiredMemory::swap(void* addr1, void* addr2){
         cerr << "[RewiredMemory::swap] second rewiring failed, start_address: " << (void*) get_start_address() <<", extent size: " << get_extent_size() << ", allocated space: " << get_allocated_memory_size() << " bytes" << endl;
         RAISE("second rewiring failed: " << (void*) vpage2 << ", " << strerror(errno) << " (" << errno << ")");
     }
+    advise_huge_pages(vpage1, get_extent_size());
+    advise_huge_pages(vpage2, get_extent_size());
 
     m_translation_map[trmap_off1] = ppage2;
     m_translation_map[trmap_off2] = ppage1;
 }
 
+size_t RewiredMemory::swap_many(const pair<void*, void*>* pairs, size_t num_pairs){
+    COUT_DEBUG("num pairs: " << num_pairs);
+    if(num_pairs == 0) return 0;
+    char* start_address = (char*) get_start_address();
+    const size_t extent_size = get_extent_size();
+
+    // the new mapping, as pairs <virtual extent, physical extent>
+    vector<pair<size_t, size_t>> remap;
+    remap.reserve(num_pairs * 2);
+    for(size_t i = 0; i < num_pairs; i++){
+        validate_address(pairs[i].first);
+        validate_address(pairs[i].second);
+        if(pairs[i].first == pairs[i].second){ RAISE("The addresses of the pair " << i << " are the same: " << pairs[i].first); }
+        size_t trmap_off1 = ((char*) pairs[i].first - start_address) / extent_size;
+        size_t trmap_off2 = ((char*) pairs[i].second - start_address) / extent_size;
+        remap.emplace_back(trmap_off1, m_translation_map[trmap_off2]);
+        remap.emplace_back(trmap_off2, m_translation_map[trmap_off1]);
+    }
+    sort(begin(remap), end(remap));
+    for(size_t i = 1; i < remap.size(); i++){
+        if(remap[i -1].first == remap[i].first){ RAISE("The extent " << (void*) (start_address + remap[i].first * extent_size) << " appears in more than one pair"); }
+    }
+
+    // coalesce the runs of extents contiguous both in the virtual and in the physical memory
+    size_t num_syscalls = 0;
+    size_t run_start = 0;
+    while(run_start < remap.size()){
+        size_t run_end = run_start +1;
+        while(run_end < remap.size() && remap[run_end].first == remap[run_end -1].first +1 && remap[run_end].second == remap[run_end -1].second +1){
+            run_end++;
+        }
+
+        char* vpage = start_address + remap[run_start].first * extent_size;
+        void* mmap_ret = mmap(
+                /* destination (virtual address) */ vpage, (run_end - run_start) * extent_size,
+                PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_FIXED,
+                /* source (physical location) */ m_handle_physical_memory, remap[run_start].second * extent_size
+        );
+        if(mmap_ret == MAP_FAILED){
+            cerr << "[RewiredMemory::swap_many] rewiring failed, start_address: " << (void*) get_start_address() << ", extent size: " << extent_size << ", allocated space: " << get_allocated_memory_size() << " bytes" << endl;
+            RAISE("rewiring failed: " << (void*) vpage << ", num extents: " << (run_end - run_start) << ", " << strerror(errno) << " (" << errno << ")");
+        }
+        num_syscalls++;
+        advise_huge_pages(vpage, (run_end - run_start) * extent_size);
+
+        // the translation map reflects the extents remapped so far, even if a later mmap fails
+        for(size_t i = run_start; i < run_end; i++){ m_translation_map[remap[i].first] = remap[i].second; }
+        run_start = run_end;
+    }
+
+    return num_syscalls;
+}
+
+void RewiredMemory::release_physical_memory(void* address, size_t num_extents){
+    COUT_DEBUG("address: " << address << ", num_extents: " << num_extents);
+    char* start_address = (char*) get_start_address();
+    const size_t extent_size = get_extent_size();
+
+    for(size_t i = 0; i < num_extents; i++){
+        char* vpage = (char*) address + i * extent_size;
+        validate_address(vpage);
+        size_t ppage = m_translation_map[(vpage - start_address) / extent_size];
+
+        int rc = fallocate(m_handle_physical_memory, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, ppage * extent_size, extent_size);
+        if(rc != 0){ RAISE("Cannot release the physical memory of the extent " << (void*) vpage << ". fallocate error: " << strerror(errno) << " (" << errno << ")"); }
+    }
+}
+
+// the constant has been introduced in Linux 5.14, it may not be yet present in the system headers
+#if !defined(MADV_POPULATE_WRITE)
+#define MADV_POPULATE_WRITE 23
+#endif
+
+// whether the kernel recognised MADV_POPULATE_WRITE
+static atomic<bool> g_madvise_populate_write = true;
+
+void RewiredMemory::prefault(void* address, size_t num_extents){
+    COUT_DEBUG("address: " << address << ", num_extents: " << num_extents);
+    if(num_extents == 0) return;
+    const size_t extent_size = get_extent_size();
+    validate_address(address);
+    validate_address((char*) address + (num_extents -1) * extent_size);
+    populate(address, num_extents * extent_size);
+}
+
+void RewiredMemory::populate(void* address, size_t length){
+    if(g_madvise_populate_write.load(memory_order_relaxed)){
+        int rc = madvise(address, length, MADV_POPULATE_WRITE);
+        if(rc == 0) return; // done
+        if(errno != EINVAL){ RAISE("Cannot populate the range [" << address << ", " << (void*) ((char*) address + length) << "). madvise error: " << strerror(errno) << " (" << errno << ")"); }
+        g_madvise_populate_write.store(false, memory_order_relaxed); // older kernel, never try again
+    }
+
+    // fall back to touch each page with an atomic no-op, not to overwrite a concurrent store. Step by the base page, the huge pages may have not been granted
+    const size_t base_page_size = sysconf(_SC_PAGESIZE);
+    for(char* page = (char*) address, *end = page + length; page < end; page += base_page_size){
+        __atomic_fetch_or(page, 0, __ATOMIC_RELAXED);
+    }
+}
+
+void RewiredMemory::set_numa_policy(void* address, size_t num_extents, NumaPolicy policy, int owner_node){
+    COUT_DEBUG("address: " << address << ", num_extents: " << num_extents << ", policy: " << policy << ", owner node: " << owner_node);
+    if(num_extents == 0) return;
+    const size_t extent_size = get_extent_size();
+    validate_address(address);
+    validate_address((char*) address + (num_extents -1) * extent_size);
+
+#if defined(HAVE_LIBNUMA)
+    if(numa_available() < 0) return; // nop
+    unique_ptr<struct bitmask, decltype(&numa_bitmask_free)> nodemask_ptr { numa_allocate_nodemask(), &numa_bitmask_free };
+    struct bitmask* nodemask = nodemask_ptr.get();
+
+    auto do_mbind = [&](char* start, size_t num_bytes, int mode){
+        const bool use_nodemask = (mode != MPOL_DEFAULT);
+        long rc = mbind(start, num_bytes, mode, use_nodemask ? nodemask->maskp : nullptr, use_nodemask ? nodemask->size +1 : 0, MPOL_MF_MOVE);
+        if(rc != 0){ RAISE("Cannot set the NUMA policy `" << policy << "' to the range [" << (void*) start << ", " << (void*) (start + num_bytes) << "). mbind error: " << strerror(errno) << " (" << errno << ")"); }
+    };
+
+    // keep track of the node bound to the physical memory of the extents [first, last)
+    auto set_numa_nodes = [&](char* first, char* last, int node){
+        for(char* vpage = first; vpage < last; vpage += extent_size){
+            m_numa_nodes[m_translation_map[(vpage - (char*) get_start_address()) / extent_size]] = node;
+        }
+    };
+
+    char* start = (char*) address;
+    char* end = start + num_extents * extent_size;
+    switch(policy){
+    case NumaPolicy::NONE:
+        do_mbind(start, num_extents * extent_size, MPOL_DEFAULT);
+        set_numa_nodes(start, end, -1);
+        break;
+    case NumaPolicy::INTERLEAVED:
+        copy_bitmask_to_bitmask(numa_all_nodes_ptr, nodemask);
+        do_mbind(start, num_extents * extent_size, MPOL_INTERLEAVE);
+        set_numa_nodes(start, end, -1);
+        break;
+    case NumaPolicy::OWNER:
+        if(owner_node < 0 || owner_node > numa_max_node()){ RAISE("Invalid owner node: " << owner_node); }
+        numa_bitmask_setbit(nodemask, owner_node);
+        do_mbind(start, num_extents * extent_size, MPOL_BIND);
+        set_numa_nodes(start, end, owner_node);
+        break;
+    case NumaPolicy::PARTITIONED: {
+        const size_t num_nodes = numa_max_node() +1;
+        for(size_t node = 0; node < num_nodes; node++){
+            size_t extent_start = num_extents * node / num_nodes;
+            size_t extent_end = num_extents * (node +1) / num_nodes;
+            if(extent_start == extent_end) continue; // less extents than nodes
+            numa_bitmask_clearall(nodemask);
+            numa_bitmask_setbit(nodemask, node);
+            do_mbind(start + extent_start * extent_size, (extent_end - extent_start) * extent_size, MPOL_BIND);
+            set_numa_nodes(start + extent_start * extent_size, start + extent_end * extent_size, node);
+        }
+    } break;
+    }
+#endif
+}
+
+int RewiredMemory::get_numa_node(void* address) const {
+    validate_address(address);
+    return m_numa_nodes[m_translation_map[((char*) address - (char*) get_start_address()) / get_extent_size()]];
+}
 
 void RewiredMemory::extend(size_t num_extents){
     if(num_extents == 0) return;
@@ -204,6 +410,7 @@ void RewiredMemory::extend(size_t num_extents){
     for(size_t i = 0; i < num_extents; i++){
         m_translation_map.push_back(start_fd +i);
     }
+    m_numa_nodes.resize(m_translation_map.size(), -1);
 }
 
 /*****************************************************************************
@@ -227,9 +434,54 @@ size_t RewiredMemory::get_allocated_memory_size() const noexcept {
     return get_extent_size() * get_allocated_extents();
 }
 
+size_t RewiredMemory::get_resident_memory_size() const {
+    struct stat info;
+    int rc = fstat(m_handle_physical_memory, &info);
+    if(rc != 0){ RAISE("Cannot retrieve the amount of resident memory. fstat error: " << strerror(errno) << " (" << errno << ")"); }
+    return static_cast<size_t>(info.st_blocks) * 512; // st_blocks is always in units of 512 bytes
+}
+
 size_t RewiredMemory::get_max_memory() const noexcept {
     return m_max_memory;
 }
 
+size_t RewiredMemory::get_huge_page_memory_size() const {
+    if(configuration::use_huge_pages()) return get_resident_memory_size(); // hugetlbfs, all pages are huge
+
+    // sum the shared memory mapped with huge pages (PMDs) among the VMAs of our mapping. The rewiring splits the mapping in many VMAs.
+    ifstream smaps("/proc/self/smaps");
+    if(!smaps.good()) return 0;
+    const uint64_t start_address = reinterpret_cast<uint64_t>(get_start_address());
+    const uint64_t end_address = start_address + get_max_memory();
+    const string key = "ShmemPmdMapped:";
+    bool inside = false; // whether the current VMA is part of our mapping
+    size_t result = 0;
+    string line;
+    while(getline(smaps, line)){
+        uint64_t vma_start = 0, vma_end = 0;
+        if(sscanf(line.c_str(), "%" SCNx64 "-%" SCNx64 " ", &vma_start, &vma_end) == 2){ // header of the next VMA
+            inside = vma_start >= start_address && vma_end <= end_address;
+        } else if(inside && line.compare(0, key.size(), key) == 0){
+            result += stoull(line.substr(key.size())) * 1024; // in kB
+        }
+    }
+
+    return result;
+}
+
+double RewiredMemory::probe_huge_pages(){
+    constexpr size_t probe_size = 1ull << 21; // 2 MB, the size of a huge page
+    const size_t page_size = get_memory_page_size();
+
+    try {
+        RewiredMemory probe { max<size_t>(1, probe_size / page_size), /* num extents */ 1, /* max memory */ max<size_t>(probe_size, page_size) };
+        probe.prefault(probe.get_start_address(), 1);
+        return static_cast<double>(probe.get_huge_page_memory_size()) / probe.get_allocated_memory_size();
+    } catch(RewiredMemoryException& e){ // e.g. no pages reserved in hugetlbfs
+        COUT_DEBUG("Cannot probe the huge pages: " << e.what());
+        return 0;
+    }
+}
+
 } // namespace data_structures::rma::common
 
@@ -20,9 +20,11 @@
 
 #include <cinttypes>
 #include <cstddef>
+#include <utility>
 #include <vector>
 
 #include "common/errorhandling.hpp"
+#include "knobs.hpp"
 
 namespace data_structures::rma::common {
 
@@ -39,14 +41,22 @@ class RewiredMemory{
     void* m_start_address; // the start address in virtual memory of the reserved region
     int m_handle_physical_memory; // the handle to the allocated physical memory, as file descriptor
     std::vector<uint32_t> m_translation_map; // an array, given an offset in virtual memory, returns the offset
+    std::vector<int32_t> m_numa_nodes; // an array, given an offset in physical memory, returns the NUMA node its pages are bound to, or -1 if not bound to a single node
     const size_t m_max_memory; // the maximum amount of virtual memory reserved for the memory mapping, in bytes
+    const bool m_transparent_huge_pages; // whether the mapping is backed by transparent huge pages (--thp), rather than hugetlbfs or base pages
 
     /**
      * Raise an exception if the given address is not valid:
      * - it's not aligned to an extent
      * - it is not part of the memory space handled by this instance
      */
-    void validate_address(void* address);
+    void validate_address(void* address) const;
+
+    /**
+     * With transparent huge pages, mark the given range of virtual memory as eligible for huge pages. A mapping created
+     * with MAP_FIXED by the rewiring does not inherit the advice of the range it replaces.
+     */
+    void advise_huge_pages(void* address, size_t length);
 public:
     /**
      * Allocate a single segment of mapped memory
@@ -76,6 +86,50 @@ public:
      */
     void swap(void* addr1, void* addr2);
 
+    /**
+     * Rewire multiple pairs of extents at once, swapping the physical addresses of the first and the second
+     * extent of each pair. An extent can appear in at most one pair. The extents are remapped in order of address,
+     * with a single mmap for each run of extents contiguous both in the virtual and in the physical memory.
+     * @return the number of mmap syscalls issued
+     */
+    size_t swap_many(const std::pair<void*, void*>* pairs, size_t num_pairs);
+
+    /**
+     * Return to the OS the physical memory backing the given extents, punching a hole in the underlying memfd.
+     * The virtual addresses remain valid, the next access to them is served by new zeroed pages.
+     */
+    void release_physical_memory(void* address, size_t num_extents = 1);
+
+    /**
+     * Populate the page tables of the given extents with writable pages, allocating their physical memory if it is not resident yet.
+     * The content of the extents is not altered. It spares the first writer to the extents a page fault for each page. The virtual range
+     * is populated with a single madvise(MADV_POPULATE_WRITE) when the kernel supports it (Linux 5.14+), otherwise the pages are touched
+     * one by one.
+     */
+    void prefault(void* address, size_t num_extents = 1);
+
+    /**
+     * Populate the page tables of the given virtual range, as #prefault, without validating the range against an instance. The
+     * content of the pages is never altered, not even by the fallback that touches them, so other threads can concurrently
+     * write into the range.
+     */
+    static void populate(void* address, size_t length);
+
+    /**
+     * Place the physical memory backing the given extents among the NUMA nodes, according to the policy. The pages already
+     * resident are migrated, the others are allocated on the selected nodes at their first access. With NumaPolicy::PARTITIONED,
+     * the extents are split in contiguous runs, one per node. The policy sticks to the physical memory: rewiring an extent
+     * moves its placement together with its content. It is a nop when libnuma is not available.
+     * @param owner_node the node to bind the memory to with NumaPolicy::OWNER, ignored by the other policies
+     */
+    void set_numa_policy(void* address, size_t num_extents, NumaPolicy policy, int owner_node = 0);
+
+    /**
+     * Retrieve the NUMA node where the physical memory currently backing the given extent is bound, or -1 if it is not bound
+     * to a single node. As the binding follows the physical memory, the node is looked up through the translation map.
+     */
+    int get_numa_node(void* address) const;
+
     /**
      * The size of a single extent, in bytes
      */
@@ -86,6 +140,25 @@ public:
      */
     size_t get_allocated_memory_size() const noexcept;
 
+    /**
+     * Retrieve the amount of physical memory actually resident, in bytes. It excludes the holes punched by #release_physical_memory
+     * and the pages allocated but never touched.
+     */
+    size_t get_resident_memory_size() const;
+
+    /**
+     * Retrieve the amount of memory currently mapped with huge pages, in bytes. With hugetlbfs (--hugetlb), it is the
+     * resident memory. With transparent huge pages (--thp), it is read from /proc/self/smaps and can be
+     * anything between 0 and the resident memory, according to what the kernel granted.
+     */
+    size_t get_huge_page_memory_size() const;
+
+    /**
+     * Map and populate a single extent of 2 MB, to check whether the kernel actually backs the rewired memory with huge pages
+     * @return the fraction, in [0, 1], of the extent mapped with huge pages
+     */
+    static double probe_huge_pages();
+
     /**
      * Retrieve the amount of allocated extents
      */
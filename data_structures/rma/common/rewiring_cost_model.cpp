@@ -0,0 +1,227 @@
+/**
+ * Copyright (C) 2018 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "rewiring_cost_model.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "common/miscellaneous.hpp" // get_memory_page_size
+#include "buffered_rewired_memory.hpp"
+
+using namespace std;
+
+namespace data_structures::rma::common {
+
+/*****************************************************************************
+ *                                                                           *
+ *   DEBUG                                                                   *
+ *                                                                           *
+ *****************************************************************************/
+//#define DEBUG
+#define COUT_DEBUG_FORCE(msg) std::cout << "[RewiringCostModel::" << __FUNCTION__ << "] " << msg << std::endl
+#if defined(DEBUG)
+    #define COUT_DEBUG(msg) COUT_DEBUG_FORCE(msg)
+#else
+    #define COUT_DEBUG(msg)
+#endif
+
+/*****************************************************************************
+ *                                                                           *
+ *   Calibration                                                             *
+ *                                                                           *
+ *****************************************************************************/
+
+RewiringCostModel::RewiringCostModel(size_t pages_per_extent) : m_fixed_rewiring(0), m_extent_rewiring(0), m_fixed_copy(0), m_extent_copy(0), m_crossover(0) {
+    calibrate(pages_per_extent);
+    compute_crossover();
+}
+
+RewiringCostModel::RewiringCostModel(double fixed_rewiring, double extent_rewiring, double fixed_copy, double extent_copy) :
+        m_fixed_rewiring(fixed_rewiring), m_extent_rewiring(extent_rewiring), m_fixed_copy(fixed_copy), m_extent_copy(extent_copy), m_crossover(0) {
+    compute_crossover();
+}
+
+const RewiringCostModel& RewiringCostModel::calibrated(size_t pages_per_extent){
+    static mutex models_mutex;
+    static unordered_map<size_t, unique_ptr<RewiringCostModel>> models; // the models calibrated so far, by pages per extent
+
+    lock_guard<mutex> lock(models_mutex);
+    auto& model = models[pages_per_extent];
+    if(model.get() == nullptr){
+        model.reset(new RewiringCostModel(pages_per_extent));
+        COUT_DEBUG(*model);
+    }
+    return *model;
+}
+
+void RewiringCostModel::calibrate(size_t pages_per_extent){
+    constexpr size_t window_lengths[] = { 1, 2, 4, 8, 16 }; // in terms of extents
+    constexpr size_t max_window_length = 16;
+    constexpr size_t num_rounds = 6; // the first round only faults the buffers in, it is not measured
+    BufferedRewiredMemory memory { pages_per_extent, max_window_length };
+    const size_t extent_size = memory.get_extent_size();
+    const size_t page_size = ::common::get_memory_page_size();
+    char* const start_address = static_cast<char*>(memory.get_start_address());
+    memset(start_address, 0, max_window_length * extent_size);
+
+    // read a word per page, as the readers do after the extent has been rewired
+    volatile char sink = 0;
+    auto touch = [&sink, extent_size, page_size](const char* window, size_t window_length){
+        for(size_t i = 0, end = window_length * extent_size; i < end; i += page_size){ sink += window[i]; }
+    };
+
+    // rebalance the window as the workers do, acquiring all the buffers at once and rewiring them in a single batch
+    void* buffers[max_window_length];
+    pair<void*, void*> pairs[max_window_length];
+    auto fill_buffers = [&](size_t window_length, int value){
+        memory.acquire_buffers(buffers, window_length);
+        for(size_t i = 0; i < window_length; i++){
+            memset(buffers[i], value, extent_size);
+            pairs[i] = make_pair(start_address + i * extent_size, buffers[i]);
+        }
+    };
+
+    // take the median of the samples, it is less sensitive to the noise of the other threads
+    auto median = [](vector<int64_t>& samples){
+        std::sort(begin(samples), end(samples));
+        return static_cast<double>(samples[samples.size() /2]);
+    };
+
+    vector<double> x, y_rewiring, y_copy; // window length, median cost of rewiring, median cost of copying
+    for(size_t window_length : window_lengths){
+        vector<int64_t> samples_rewiring, samples_copy;
+        for(size_t round = 0; round < num_rounds; round++){
+            { // rewiring
+                fill_buffers(window_length, round);
+                auto t0 = chrono::steady_clock::now();
+                memory.swap_and_release_many(pairs, window_length);
+                touch(start_address, window_length);
+                auto t1 = chrono::steady_clock::now();
+                if(round > 0) samples_rewiring.push_back(chrono::duration_cast<chrono::nanoseconds>(t1 - t0).count());
+            }
+
+            { // copy
+                fill_buffers(window_length, round);
+                auto t0 = chrono::steady_clock::now();
+                for(size_t i = 0; i < window_length; i++){
+                    memcpy(pairs[i].first, pairs[i].second, extent_size);
+                    memory.release_buffer(pairs[i].second);
+                }
+                touch(start_address, window_length);
+                auto t1 = chrono::steady_clock::now();
+                if(round > 0) samples_copy.push_back(chrono::duration_cast<chrono::nanoseconds>(t1 - t0).count());
+            }
+        }
+
+        x.push_back(window_length);
+        y_rewiring.push_back(median(samples_rewiring));
+        y_copy.push_back(median(samples_copy));
+        COUT_DEBUG("window length: " << window_length << " extents, rewiring: " << y_rewiring.back() << " nanosecs, copy: " << y_copy.back() << " nanosecs");
+    }
+
+    // least squares fit of cost = fixed + per_extent * window_length. The costs cannot be negative, if the noise
+    // yields a negative intercept, fall back to a line through the origin
+    auto fit = [&x](const vector<double>& y, double* out_fixed, double* out_per_extent){
+        const double n = x.size();
+        double sum_x = 0, sum_y = 0, sum_xx = 0, sum_xy = 0;
+        for(size_t i = 0; i < x.size(); i++){
+            sum_x += x[i]; sum_y += y[i]; sum_xx += x[i] * x[i]; sum_xy += x[i] * y[i];
+        }
+        double per_extent = (n * sum_xy - sum_x * sum_y) / (n * sum_xx - sum_x * sum_x);
+        double fixed = (sum_y - per_extent * sum_x) / n;
+        if(fixed < 0){
+            fixed = 0;
+            per_extent = sum_xy / sum_xx;
+        } else if(per_extent < 0){
+            per_extent = 0;
+            fixed = sum_y / n;
+        }
+        *out_fixed = fixed;
+        *out_per_extent = per_extent;
+    };
+    fit(y_rewiring, &m_fixed_rewiring, &m_extent_rewiring);
+    fit(y_copy, &m_fixed_copy, &m_extent_copy);
+
+    COUT_DEBUG("extent size: " << extent_size << " bytes, " << *this);
+}
+
+void RewiringCostModel::compute_crossover(){
+    // the difference between the two costs is linear in the number of extents, rewiring can only become cheaper
+    // from a certain window length on if it costs less per extent than copying. If it costs more, copying is deemed
+    // the safer choice for any window, as the window lengths of the rebalances are unbounded
+    if(m_extent_rewiring >= m_extent_copy){
+        m_crossover = (m_extent_rewiring == m_extent_copy && m_fixed_rewiring <= m_fixed_copy) ? 1 : numeric_limits<size_t>::max();
+    } else {
+        double crossover = ceil((m_fixed_rewiring - m_fixed_copy) / (m_extent_copy - m_extent_rewiring));
+        m_crossover = (crossover < 1) ? 1 : static_cast<size_t>(crossover);
+        // account for the rounding of the estimates
+        while(m_crossover > 1 && cost_rewiring(m_crossover -1) <= cost_copy(m_crossover -1)){ m_crossover--; }
+        while(cost_rewiring(m_crossover) > cost_copy(m_crossover)){ m_crossover++; }
+    }
+}
+
+/*****************************************************************************
+ *                                                                           *
+ *   Estimates                                                               *
+ *                                                                           *
+ *****************************************************************************/
+
+bool RewiringCostModel::use_rewiring(size_t num_extents) const noexcept {
+    return num_extents >= m_crossover;
+}
+
+size_t RewiringCostModel::crossover() const noexcept {
+    return m_crossover;
+}
+
+uint64_t RewiringCostModel::cost_rewiring(size_t num_extents) const noexcept {
+    if(num_extents == 0) return 0;
+    return static_cast<uint64_t>(m_fixed_rewiring + m_extent_rewiring * num_extents);
+}
+
+uint64_t RewiringCostModel::cost_copy(size_t num_extents) const noexcept {
+    if(num_extents == 0) return 0;
+    return static_cast<uint64_t>(m_fixed_copy + m_extent_copy * num_extents);
+}
+
+/*****************************************************************************
+ *                                                                           *
+ *   Dump                                                                    *
+ *                                                                           *
+ *****************************************************************************/
+
+void RewiringCostModel::dump(std::ostream& out) const {
+    out << "[RewiringCostModel] rewiring: " << m_fixed_rewiring << " + " << m_extent_rewiring << " nanosecs/extent, "
+            "copy: " << m_fixed_copy << " + " << m_extent_copy << " nanosecs/extent, crossover: ";
+    if(m_crossover == numeric_limits<size_t>::max()){ out << "never"; } else { out << m_crossover << " extents"; }
+}
+
+std::ostream& operator<<(std::ostream& out, const RewiringCostModel& model){
+    model.dump(out);
+    return out;
+}
+
+} // namespace
@@ -0,0 +1,94 @@
+/**
+ * Copyright (C) 2018 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cinttypes>
+#include <cstddef>
+#include <iostream>
+
+namespace data_structures::rma::common {
+
+/**
+ * Estimate whether, for a window of extents to rebalance, it is cheaper to rewire the buffers where the elements
+ * have been spread or to copy them back in place. Each strategy is modelled as a fixed cost per window plus a cost per
+ * extent. Rewiring pays a high fixed cost (the mmap syscalls, which RewiredMemory::swap_many coalesces over contiguous
+ * runs, and the TLB shootdowns) and a low cost per extent (the page faults of the next accesses), while copying is
+ * bound by the memory bandwidth, hence mostly proportional to the number of extents. Rewiring becomes cheaper from a
+ * certain window length on, the crossover.
+ *
+ * The costs are calibrated by a microbenchmark on the actual extent size, once per process, see #calibrated.
+ */
+class RewiringCostModel {
+    double m_fixed_rewiring; // estimated cost to rewire a window, regardless of its length, in nanosecs
+    double m_extent_rewiring; // estimated additional cost to rewire each extent of the window, in nanosecs
+    double m_fixed_copy; // estimated cost to copy back a window, regardless of its length, in nanosecs
+    double m_extent_copy; // estimated additional cost to copy back each extent of the window, in nanosecs
+    size_t m_crossover; // min number of extents from which rewiring is not more expensive than copying
+
+    // Run the microbenchmarks
+    void calibrate(size_t pages_per_extent);
+
+    // Compute the crossover from the estimated costs
+    void compute_crossover();
+
+    // Calibrate the model for extents of the given number of pages
+    RewiringCostModel(size_t pages_per_extent);
+
+public:
+    /**
+     * Create a model with the given costs, in nanosecs
+     */
+    RewiringCostModel(double fixed_rewiring, double extent_rewiring, double fixed_copy, double extent_copy);
+
+    /**
+     * Retrieve the model calibrated for extents of the given number of pages. The microbenchmarks are only executed
+     * the first time the model for a given extent size is requested, the following invocations, even from other
+     * instances of the data structure, share the same model.
+     */
+    static const RewiringCostModel& calibrated(size_t pages_per_extent);
+
+    /**
+     * Whether it is cheaper to rewire, rather than copy back, the given number of extents
+     */
+    bool use_rewiring(size_t num_extents) const noexcept;
+
+    /**
+     * The min number of extents from which rewiring is not more expensive than copying back,
+     * or std::numeric_limits<size_t>::max() if copying is always cheaper
+     */
+    size_t crossover() const noexcept;
+
+    /**
+     * Estimated cost to rewire the given number of extents, in nanosecs
+     */
+    uint64_t cost_rewiring(size_t num_extents) const noexcept;
+
+    /**
+     * Estimated cost to copy back the given number of extents, in nanosecs
+     */
+    uint64_t cost_copy(size_t num_extents) const noexcept;
+
+    /**
+     * Dump the estimated costs, for debugging purposes
+     */
+    void dump(std::ostream& out) const;
+};
+
+std::ostream& operator<<(std::ostream& out, const RewiringCostModel& model);
+
+} // namespace
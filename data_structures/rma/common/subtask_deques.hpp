@@ -0,0 +1,102 @@
+/**
+ * Copyright (C) 2018 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cassert>
+#include <cinttypes>
+#include <deque>
+#include <vector>
+
+namespace data_structures::rma::common {
+
+/**
+ * The subtasks of a rebalancing task, split in one deque for each worker of the pool. Each deque holds a contiguous
+ * block of the subtasks. A worker executes the subtasks of its own deque from the back and, once depleted, it steals
+ * the subtasks from the front of the longest deque of the other workers.
+ *
+ * The class is not thread safe, the caller must hold the mutex of the task.
+ */
+template<typename SubTask>
+class SubTaskDeques {
+    std::vector<std::deque<SubTask>> m_deques; // one deque for each worker
+    size_t m_size = 0; // total number of subtasks in the deques
+
+public:
+    /**
+     * Split the given list of subtasks in `num_workers' contiguous blocks, preserving their order
+     */
+    void assign(const std::vector<SubTask>& subtasks, size_t num_workers){
+        assert(empty() && "The subtasks of the previous execution are still pending");
+        if(num_workers == 0) num_workers = 1;
+        m_deques.clear();
+        m_deques.resize(num_workers);
+        for(size_t i = 0; i < num_workers; i++){
+            m_deques[i].assign(subtasks.begin() + subtasks.size() * i / num_workers, subtasks.begin() + subtasks.size() * (i +1) / num_workers);
+        }
+        m_size = subtasks.size();
+    }
+
+    /**
+     * Retrieve the next subtask for the given worker. Set `out_stolen' to true when the subtask was taken from the deque
+     * of another worker. Return false if there are no more subtasks to execute.
+     */
+    bool fetch(int64_t worker_id, SubTask& out_subtask, bool& out_stolen){
+        if(m_size == 0) return false;
+
+        auto& own = m_deques[worker_id % m_deques.size()];
+        if(!own.empty()){
+            out_subtask = own.back();
+            own.pop_back();
+            out_stolen = false;
+        } else {
+            std::deque<SubTask>* victim = nullptr;
+            for(auto& deque : m_deques){
+                if(victim == nullptr || deque.size() > victim->size()){ victim = &deque; }
+            }
+            assert(victim != nullptr && !victim->empty() && "m_size > 0, there must be at least one subtask to steal");
+            out_subtask = victim->front();
+            victim->pop_front();
+            out_stolen = true;
+        }
+
+        m_size--;
+        return true;
+    }
+
+    /**
+     * Invoke the given function on the next subtask the owner of each deque is going to execute
+     */
+    template<typename Function>
+    void for_each_next(Function fn) const {
+        for(auto& deque : m_deques){
+            if(!deque.empty()){ fn(deque.back()); }
+        }
+    }
+
+    /**
+     * Total number of subtasks still to execute
+     */
+    size_t size() const noexcept { return m_size; }
+
+    /**
+     * Check whether all subtasks have been fetched
+     */
+    bool empty() const noexcept { return m_size == 0; }
+};
+
+} // namespace
@@ -25,6 +25,7 @@
 
 #include "common/errorhandling.hpp"
 #include "rma/common/density_bounds.hpp"
+#include "rma/common/memory_budget.hpp"
 #include "rma/common/move_detector_info.hpp"
 #include "packed_memory_array.hpp"
 #include "partition.hpp"
@@ -51,7 +52,7 @@ extern mutex _debug_mutex; // PackedMemoryArray.cpp
 AdaptiveRebalancing::AdaptiveRebalancing(PackedMemoryArray& pma, VectorOfIntervals weights, int balance, size_t num_partitions, size_t cardinality,
         common::MoveDetectorInfo* ptr_move_detector_info, bool fill_segments) :
     m_weights(weights), /*m_partitions_length(num_partitions),*/ m_height(pma.get_thresholds().get_calibrator_tree_height()),
-    m_segment_capacity(pma.get_segment_capacity()), m_densities(pma.get_thresholds().densities()),
+    m_segment_capacity(pma.get_segment_capacity()), m_densities(pma.get_thresholds().densities()), m_memory_budget(pma.memory_budget()),
     m_ptr_move_detector_info(ptr_move_detector_info), m_fill_segments(fill_segments),
     m_partitions{ vector_of_partitions(pma.memory_pool()) }
     {
@@ -73,7 +74,9 @@ VectorOfPartitions AdaptiveRebalancing::release() {
 }
 
 std::pair<double, double> AdaptiveRebalancing::get_density(double node_height){
-    return m_densities.thresholds(m_height, node_height);
+    auto densities = m_densities.thresholds(m_height, node_height);
+    densities.second = m_memory_budget.raise_upper_threshold(densities.second, m_densities.theta_0); // as in PackedMemoryArray::get_thresholds(height)
+    return densities;
 }
 
 void AdaptiveRebalancing::emit(size_t cardinality, size_t number_of_segments){
@@ -51,6 +51,8 @@ extern mutex _debug_mutex; // PackedMemoryArray.cpp
  *****************************************************************************/
 Gate::Gate(uint32_t window_start, uint32_t window_length) : m_window_start(window_start), m_window_length(window_length), m_queue(/* initial capacity */ 2) {
     m_num_active_threads = 0;
+    m_resize_readers = false;
+    m_resize_draining = false;
     m_cardinality = 0;
     m_fence_low_key = m_fence_high_key = numeric_limits<int64_t>::min();
     m_separator_keys = nullptr; // needs to be set eventually
@@ -150,4 +152,20 @@ void Gate::wake_all(WakeList& wake_list){
     }
 }
 
+void Gate::wake_readers(){
+    COUT_DEBUG("gate id: " << gate_id());
+    assert(m_locked && "To invoke this method the internal lock must be acquired first");
+
+    // rotate the queue, keeping only the writers in their original order
+    for(size_t i = 0, sz = m_queue.size(); i < sz; i++){
+        SleepingBeauty sb = m_queue[0];
+        m_queue.pop();
+        if(sb.m_purpose == State::READ){
+            sb.m_promise->set_value(); // notify
+        } else {
+            m_queue.append(sb);
+        }
+    }
+}
+
 } // namespace
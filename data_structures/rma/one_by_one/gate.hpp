@@ -49,6 +49,8 @@ public:
     bool m_locked = false; // keep track whether the spin lock has been acquired, for debugging purposes
 #endif
     int32_t m_num_active_threads; // how many readers are accessing this gate?
+    bool m_resize_readers; // whether readers can still access the gate in the REBAL state, as a RESIZE copies the elements into a new storage. Never set by a RESIZE_REBALANCE, which rewires the storage in place
+    bool m_resize_draining; // with m_resize_readers, the resize is about to complete: no new readers are admitted, the worker waits for the active ones to leave
     uint32_t m_cardinality; // the total number of elements in this gate
     int64_t m_fence_low_key; // the minimum key that can be stored in this gate (inclusive)
     int64_t m_fence_high_key; // the maximum key that can be stored in this gate (exclusive)
@@ -145,6 +147,12 @@ public:
      */
     void wake_all(WakeList& wake_list);
 
+    /**
+     * Wake up only the readers in the queue, the writers keep waiting.
+     * Precondition: the caller holds the lock for this gate
+     */
+    void wake_readers();
+
     /**
      * Allocate an array of locks
      */
@@ -125,8 +125,16 @@ void Iterator::acquire_lock(uint64_t gate_id){
                     consumer.wait();
                 }
                 break;
-            case Gate::State::WRITE:
             case Gate::State::REBAL:
+                if(gate.m_resize_readers && !gate.m_resize_draining){ // the old storage is being copied by a resize, but it can still be read
+                    gate.m_num_active_threads++;
+                    lock.unlock();
+                    m_gate = gates + gate_id;
+                    done = true;
+                    break;
+                }
+                // fall through
+            case Gate::State::WRITE:
                 { // add the thread in the queue
                     std::promise<void> producer;
                     std::future<void> consumer = producer.get_future();
@@ -155,7 +163,8 @@ void Iterator::release_lock(){
            m_gate->wake_next(context);
        } break;
        case Gate::State::REBAL: {
-           send_message_to_rebalancer = true;
+           // with m_resize_readers, the worker executing the resize waits for the readers to leave
+           send_message_to_rebalancer = !m_gate->m_resize_readers;
        } break;
        default:
            assert(0 && "Invalid state");
@@ -209,7 +218,7 @@ void Iterator::fetch_next_chunk(){
 
     auto next_segment_id = (m_stop / m_pma->m_storage.m_segment_capacity) +1;
     if(next_segment_id % 2 == 1) return; // it means the stop offset has been moved from its fixed position due to reaching the maximum of the interval
-    if(next_segment_id > m_pma->m_storage.m_number_segments) return; // depleted
+    if(next_segment_id >= m_pma->m_storage.m_number_segments) return; // depleted
     if(next_segment_id % m_pma->get_segments_per_lock() == 0){
         // move to the next lock
         release_lock();
@@ -69,6 +69,7 @@ PackedMemoryArray::PackedMemoryArray(size_t btree_block_size, size_t pma_segment
         m_locks(Gate::allocate(1, segments_per_lock)),
         m_detector(m_knobs, 1, 8),
         m_density_bounds1(0, 0.75, 0.75, 1), /* there is rationale for these hardwired thresholds */
+        m_rewiring_cost(common::RewiringCostModel::calibrated(pages_per_extent)),
         m_rebalancer(new RebalancingMaster{ this, num_worker_threads } ),
         m_garbage_collector( new GarbageCollector(this) ),
         m_segments_per_lock(segments_per_lock){
@@ -452,8 +453,16 @@ Gate* PackedMemoryArray::reader_on_entry(int64_t key, int64_t start_gate_id) con
                     consumer.wait();
                 }
                 break;
-            case Gate::State::WRITE:
             case Gate::State::REBAL:
+                if(gate.m_resize_readers && !gate.m_resize_draining){ // the old storage is being copied by a resize, but it can still be read
+                    gate.m_num_active_threads++;
+                    lock.unlock();
+                    result = gates + gate_id;
+                    done = true;
+                    break;
+                }
+                // fall through
+            case Gate::State::WRITE:
                 { // add the thread in the queue
                     std::promise<void> producer;
                     std::future<void> consumer = producer.get_future();
@@ -485,8 +494,10 @@ void PackedMemoryArray::reader_on_exit(Gate* gate) const {
            gate->wake_next(context);
        } break;
        case Gate::State::REBAL: {
-           gate->m_writer = nullptr; // invalidate the queue of a writer
-           send_message_to_rebalancer = true;
+           if(!gate->m_resize_readers){ // otherwise the worker executing the resize waits for the readers to leave
+               gate->m_writer = nullptr; // invalidate the queue of a writer
+               send_message_to_rebalancer = true;
+           }
        } break;
        default:
            assert(0 && "Invalid state");
@@ -527,7 +538,10 @@ const common::CachedDensityBounds& PackedMemoryArray::get_thresholds() const {
 
 std::pair<double, double> PackedMemoryArray::get_thresholds(int height) const {
     assert(height >= 1 && height <= m_storage.hyperheight());
-    return get_thresholds().thresholds(height);
+    auto thresholds = get_thresholds().thresholds(height);
+    // as the memory budget nears, accept denser windows to postpone the resizes
+    thresholds.second = m_memory_budget.raise_upper_threshold(thresholds.second, get_thresholds().get_upper_threshold_leaves());
+    return thresholds;
 }
 
 void PackedMemoryArray::set_thresholds(int height_calibrator_tree){
@@ -554,6 +568,14 @@ common::CachedMemoryPool& PackedMemoryArray::memory_pool() {
     return m_memory_pool;
 }
 
+const common::MemoryBudget& PackedMemoryArray::memory_budget() const {
+    return m_memory_budget;
+}
+
+void PackedMemoryArray::update_memory_budget() {
+    m_memory_budget.update(m_knobs.get_memory_budget(), memory_footprint_resident());
+}
+
 common::Detector& PackedMemoryArray::detector(){
     return m_detector;
 }
@@ -583,6 +605,15 @@ size_t PackedMemoryArray::memory_footprint() const {
     return sizeof(decltype(*this)) + space_index + space_locks + space_storage + space_detector;
 }
 
+size_t PackedMemoryArray::memory_footprint_resident() const {
+    size_t space_index = m_index.get_unsafe()->memory_footprint();
+    size_t space_locks = get_segments_per_lock() * (sizeof(Gate) + /* separator keys */ (m_index.get_unsafe()->node_size() -1) * sizeof(int64_t));
+    size_t space_storage = m_storage.memory_footprint_resident();
+    size_t space_detector = m_detector.capacity() * m_detector.sizeof_entry() * sizeof(uint64_t);
+
+    return sizeof(decltype(*this)) + space_index + space_locks + space_storage + space_detector;
+}
+
 /*****************************************************************************
  *                                                                           *
  *   Index                                                                   *
@@ -608,6 +639,7 @@ void PackedMemoryArray::set_separator_key(uint64_t segment_id, int64_t key) {
  *                                                                           *
  *****************************************************************************/
 void PackedMemoryArray::insert(int64_t key, int64_t value){
+    m_memory_budget.throttle(); // back pressure, when the memory usage nears the budget
     get_context()->set_update(/* insert ? */ true, key, value);
     writer_main(); // update loop
 }
@@ -1000,7 +1032,8 @@ RebalancePlan PackedMemoryArray::rebalance_plan(bool is_insert, int64_t window_s
         result.m_window_length = window_length;
     } else if (is_insert){ // resize on insertion
         result.m_window_start = 0;
-        size_t ideal_number_of_segments = max<size_t>(ceil( static_cast<double>(cardinality_after) / (m_density_bounds1.get_upper_threshold_root() * m_storage.m_segment_capacity) ), m_storage.m_number_segments +1);
+        const double upper_threshold_root = m_memory_budget.raise_upper_threshold(m_density_bounds1.get_upper_threshold_root(), m_density_bounds1.get_upper_threshold_leaves());
+        size_t ideal_number_of_segments = max<size_t>(ceil( static_cast<double>(cardinality_after) / (upper_threshold_root * m_storage.m_segment_capacity) ), m_storage.m_number_segments +1);
         if(ideal_number_of_segments < density_threshold){
             result.m_window_length = m_storage.m_number_segments * 2;
             if(result.m_window_length > m_storage.get_segments_per_extent()){ // use rewiring
@@ -1403,7 +1436,7 @@ void PackedMemoryArray::spread_save(size_t segment_id, int64_t* keys_from, int64
 void PackedMemoryArray::spread_save(size_t window_start, size_t window_length, int64_t* keys_from, int64_t* values_from, size_t cardinality, const spread_detector_record* detector_record){
     int64_t* __restrict keys_to = m_storage.m_keys + window_start * m_storage.m_segment_capacity;
     int64_t* __restrict values_to = m_storage.m_values + window_start * m_storage.m_segment_capacity;
-    uint16_t* __restrict segment_sizes = m_storage.m_segment_sizes + window_start;
+    Storage::segment_size_t* __restrict segment_sizes = m_storage.m_segment_sizes + window_start;
 
     auto card_per_segment = cardinality / window_length;
     auto odd_segments = cardinality % window_length;
@@ -1640,7 +1673,7 @@ void PackedMemoryArray::do_sum(uint64_t gate_id, int64_t& next_min, int64_t max,
         if(read_all){ // read the whole content protected by this gate
             int64_t* __restrict keys = m_storage.m_keys + gate->m_window_start * m_storage.m_segment_capacity;
             int64_t* __restrict values = m_storage.m_values + gate->m_window_start * m_storage.m_segment_capacity;
-            uint16_t* __restrict cardinalities = m_storage.m_segment_sizes + gate->m_window_start;
+            Storage::segment_size_t* __restrict cardinalities = m_storage.m_segment_sizes + gate->m_window_start;
 
             sum->m_first_key = std::min(sum->m_first_key, keys[m_storage.m_segment_capacity - cardinalities[0]]);
             for(int64_t segment_id = 0, last_segment_id = gate->m_window_length; segment_id < last_segment_id; segment_id+= 2){
@@ -1660,7 +1693,7 @@ void PackedMemoryArray::do_sum(uint64_t gate_id, int64_t& next_min, int64_t max,
             sum->m_last_key = keys[m_storage.m_segment_capacity * (gate->m_window_length -1) + cardinalities[gate->m_window_length -1] -1];
         } else { // read only partially this chunk of the array
             int64_t* __restrict keys = m_storage.m_keys;
-            uint16_t* __restrict cardinalities = m_storage.m_segment_sizes;
+            Storage::segment_size_t* __restrict cardinalities = m_storage.m_segment_sizes;
 
             bool min_notfound = true;
             int64_t segment_begin = gate->find(next_min), start = 0;
@@ -28,7 +28,9 @@
 #include "rma/common/density_bounds.hpp"
 #include "rma/common/detector.hpp"
 #include "rma/common/knobs.hpp"
+#include "rma/common/memory_budget.hpp"
 #include "rma/common/memory_pool.hpp"
+#include "rma/common/rewiring_cost_model.hpp"
 #include "rma/common/static_index.hpp"
 #include "pointer.hpp"
 #include "rebalance_plan.hpp"
@@ -72,6 +74,8 @@ protected:
     CachedDensityBounds m_density_bounds1; // primary thresholds (for num_segmnets>balanced_thresholds_cutoff())
     bool m_primary_densities = false; // use the primary thresholds?
     common::CachedMemoryPool m_memory_pool;
+    const common::RewiringCostModel& m_rewiring_cost; // whether to rewire or to copy back the extents of a rebalance, shared by all instances
+    common::MemoryBudget m_memory_budget; // back pressure as the memory usage nears the budget set in the knobs
     RebalancingMaster* m_rebalancer;
     GarbageCollector* m_garbage_collector; // garbage collector
     ThreadContextList m_thread_contexts; // the list of thread contexts, to keep track of the thread epochs
@@ -171,6 +175,10 @@ protected:
     // Retrieve the number of segments after that the primary thresholds are used
     size_t balanced_thresholds_cutoff() const;
 
+    // Refresh the memory usage against the budget set in the knobs. Invoked by the RebalancingMaster at the end of each resize, when
+    // no other rebalance is in progress, so that the windows are always evaluated with the same thresholds
+    void update_memory_budget();
+
     // Dump the content of the locks
     void dump_locks(std::ostream& out, bool* integrity_check) const;
 
@@ -239,6 +247,11 @@ public:
      */
     common::CachedMemoryPool& memory_pool();
 
+    /**
+     * Current memory usage versus the budget set in the knobs, as of the last resize
+     */
+    const common::MemoryBudget& memory_budget() const;
+
     /**
      * Accessor to the underlying predictor/detector
      */
@@ -313,6 +326,7 @@ public:
      * Memory footprint
      */
     size_t memory_footprint() const override;
+    size_t memory_footprint_resident() const override;
 
 };
 
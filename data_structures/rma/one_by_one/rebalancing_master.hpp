@@ -17,6 +17,8 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <mutex>
 #include <string>
@@ -24,6 +26,8 @@
 #include <vector>
 
 #include "common/circular_array.hpp"
+#include "common/mpsc_queue.hpp"
+#include "rma/common/rebalancing_statistics.hpp"
 #include "rebalancing_pool.hpp"
 #include "rebalancing_task.hpp"
 #include "wakelist.hpp"
@@ -42,15 +46,25 @@ private:
         enum class Type { Invalid, Rebalance, TaskDone, ClientExit, Stop };
         Type m_type;
         uint64_t m_payload;
+        IF_PROFILING( std::chrono::steady_clock::time_point m_time_sent ); // when the message was pushed in the queue
         std::string to_string() const; // for debug purposes only
     };
     // Concurrent queue
-    mutable std::mutex m_mutex;
-    ::common::CircularArray<InternalTask> m_queue;
+    ::common::MPSCQueue<InternalTask> m_queue; // lock-free, the clients & the workers push, the master pops
+    ::common::CircularArray<InternalTask> m_inbox; // messages already drained from m_queue, to be processed by the master
+    std::atomic<bool> m_sleeping = false; // whether the master is, or is about to be, parked in m_condvar
+    mutable std::mutex m_mutex; // only to park & wake up the master
     std::condition_variable m_condvar;
     std::thread m_handle; // Handle to the controller thread
     bool m_resizing = false; // Whether the whole PMA is currently being resized
+    bool m_stop_requested = false; // Whether a request to stop arrived while some tasks were still pending or in execution
+    uint64_t m_proactive_cursor = 0; // the next gate to inspect for a proactive rebalance
+    uint64_t m_proactive_num_idle = 0; // number of consecutive gates inspected without starting a proactive rebalance
+    int64_t m_proactive_time = 0; // in microsecs, time spent so far by the master on the proactive rebalances
+    std::chrono::steady_clock::time_point m_proactive_epoch; // when the master started, to compute the budget for the proactive rebalances
     RebalancingPool m_thread_pool; // Thread pool
+    IF_PROFILING( std::vector<common::RebalancingStatistics> m_stats_completed_tasks );
+    IF_PROFILING( common::MasterStatistics m_master_stats );
 
     // Check if a rebalancing window is already on execution or in the todo list for the given gate id
     bool ignore_lock(uint64_t lock_id) const;
@@ -69,6 +83,15 @@ private:
     // Process the list of tasks in the todo list
     void process_todo_list();
 
+    // Place the given storage and the workers of the thread pool among the NUMA nodes, as set in the knobs
+    void apply_numa_policy(Storage* storage);
+
+    // Reorder the todo list by priority, the tasks with the most threads waiting in their gates first
+    void sort_todo_list();
+
+    // Total number of threads waiting in the gates of the given task
+    uint64_t count_waiters(const RebalancingTask* task) const;
+
     // Find the task created to process the given lock id
     RebalancingTask* get_todo_task_for(size_t lock_id) const;
 
@@ -78,9 +101,25 @@ private:
     // Increase the size of the window
     int64_t next_window_length(int64_t current_window_length) const;
 
+    // Check whether there tasks pending or in execution
+    bool busy() const;
+
     // Validate the cardinalities of the locks and segments before launching a task
     void debug_validate_launch_task(RebalancingTask* task) const;
 
+    // Push a message in the command queue, waking up the master only if it is sleeping
+    void send_message(InternalTask message);
+
+    // Drain the command queue into the inbox. Spin for a while if it is empty, then go to sleep
+    void fetch_messages();
+
+    // While idle, inspect a few gates and start the rebalance of the first one about to overflow. Return false if there is nothing
+    // left to do until the next interval, that is the budget is exhausted or no gate needs to be rebalanced
+    bool proactive_rebalance();
+
+    // While idle, populate the free buffers the next rebalances are going to acquire, see Knobs::get_prefault_buffer_memory()
+    void prefault_buffers();
+
 protected:
     void main_thread(); // Controller
 
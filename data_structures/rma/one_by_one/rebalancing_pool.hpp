@@ -21,6 +21,10 @@
 #include <mutex>
 #include <vector>
 
+namespace data_structures::rma::common {
+enum class NumaPolicy; // forward decl.
+}
+
 namespace data_structures::rma::one_by_one {
 
 // Forward declarations
@@ -29,8 +33,12 @@ class RebalancingTask;
 class RebalancingWorker;
 
 class RebalancingPool {
+    std::vector<RebalancingWorker*> m_workers; // all workers in the pool, either idle or active
     std::vector<RebalancingWorker*> m_workers_idle; // workers awaiting executions
+    const uint64_t m_num_workers; // total number of workers in the pool
     uint64_t m_num_workers_active; // number of workers acquired from the thread pool, and not release yet
+    common::NumaPolicy m_numa_policy; // how the workers are assigned to the NUMA nodes
+    int m_numa_owner; // the node where all workers run with NumaPolicy::OWNER
     mutable std::mutex m_mutex; // sync
 
 public:
@@ -48,11 +56,29 @@ public:
      */
     RebalancingWorker* acquire();
 
+    /**
+     * Acquires an idle worker from the pool, preferably one assigned to the given NUMA node
+     * Returns nullptr on failure, i.e. there are no idle workers available
+     */
+    RebalancingWorker* acquire_on_node(int numa_node);
+
     std::vector<RebalancingWorker*> acquire(size_t num_workers);
 
     void release(RebalancingWorker* worker);
 
     bool active() const;
+
+    /**
+     * Assign the workers to the NUMA nodes. With NumaPolicy::OWNER, all workers run in the node of the owner, with
+     * NumaPolicy::INTERLEAVED and NumaPolicy::PARTITIONED they are spread round robin among the nodes. The workers
+     * move to their node at the start of their next task. It is a nop if the policy is already in place.
+     */
+    void set_numa_policy(common::NumaPolicy policy, int owner_node);
+
+    /**
+     * Total number of workers in the pool, either idle or active
+     */
+    uint64_t num_workers() const noexcept { return m_num_workers; }
 };
 
 } // namespace
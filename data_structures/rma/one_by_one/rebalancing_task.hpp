@@ -18,13 +18,16 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
 #include <cinttypes>
 #include <condition_variable>
 #include <mutex>
 #include <ostream>
 #include <vector>
 
+#include "rma/common/rebalancing_statistics.hpp"
 #include "rma/common/static_index.hpp"
+#include "rma/common/subtask_deques.hpp"
 #include "rebalance_plan.hpp"
 
 namespace data_structures::rma::one_by_one {
@@ -35,6 +38,10 @@ class PackedMemoryArray;
 class RebalancingMaster;
 struct Storage;
 
+// aliases
+using RebalancingStatistics = common::RebalancingStatistics;
+using RebalancingTimer = common::RebalancingTimer;
+
 class RebalancingTask {
 public:
     PackedMemoryArray * const m_pma;
@@ -53,6 +60,9 @@ public:
     int64_t m_blocked_on_lock = -1; // only used by the Master to keep track which extent need to be processed before this task can be executed
     size_t m_num_locks = 0; // keep track of the previous number of gates, before a resize
     bool m_forced_resize; // true if |cardinality| < capacity /2
+    bool m_use_rewiring = true; // whether the extents spread into a buffer are rewired (true) or copied back in place (false)
+    bool m_proactive = false; // whether the task was started by the master on its own, rather than on request of a client
+    const std::chrono::steady_clock::time_point m_time_created = std::chrono::steady_clock::now(); // to age the priority of the task in the todo list
 
     // Only used by the workers
     struct SubTask {
@@ -62,12 +72,16 @@ public:
         int64_t m_input_extent_start, m_input_extent_end;
         int64_t m_output_extent_start, m_output_extent_end;
     };
-    std::vector<SubTask> m_subtasks;
+    common::SubTaskDeques<SubTask> m_subtasks; // one deque per worker, idle workers steal from the others
     std::vector<int64_t> m_input_watermarks;
     std::mutex m_workers_mutex;
     std::condition_variable m_workers_condvar;
     std::atomic<int64_t> m_active_workers = 0;
 
+#if defined(PROFILING)
+    RebalancingStatistics m_statistics; // time spent to perform the task
+#endif
+
     /**
      * Constructor
      */
@@ -17,10 +17,14 @@
 
 #include "rebalancing_worker.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <chrono> // debug only
 #include <condition_variable>
 #include <mutex>
+#if defined(HAVE_LIBNUMA)
+#include <numa.h>
+#endif
 #include <thread>
 #include <vector> // check all
 
@@ -74,7 +78,7 @@ thread_local std::vector<std::pair<int64_t, int64_t>> _debug_items;
 
 static RebalancingTask* const FLAG_STOP = reinterpret_cast<RebalancingTask*>(0x1);
 
-RebalancingWorker::RebalancingWorker() : m_task(nullptr), m_worker_id(-1) {
+RebalancingWorker::RebalancingWorker() : m_task(nullptr), m_worker_id(-1), m_numa_node(-1), m_numa_node_current(-2 /* not pinned yet */) {
 
 }
 
@@ -116,12 +120,33 @@ void RebalancingWorker::execute0(RebalancingTask* task, int64_t worker_id){
     lock.unlock();
 }
 
-void RebalancingWorker::main_thread() {
-    COUT_DEBUG("Started");
+void RebalancingWorker::set_numa_node(int numa_node) noexcept {
+    m_numa_node = numa_node;
+}
 
+int RebalancingWorker::get_numa_node() const noexcept {
+    return m_numa_node;
+}
+
+void RebalancingWorker::pin_to_numa_node(){
 #if defined(HAVE_LIBNUMA)
-    pin_thread_to_cpu(0, /* verbose */ false);
+    int numa_node = m_numa_node;
+    if(numa_node == m_numa_node_current) return; // already there
+    if(numa_node < 0){
+        pin_thread_to_cpu(0, /* verbose */ false);
+    } else {
+        pin_thread_to_numa_node(numa_node);
+        // drop the memory binding set by pin_thread_to_cpu, the buffers written by this worker should be allocated in its node
+        numa_set_localalloc();
+    }
+    m_numa_node_current = numa_node;
 #endif
+}
+
+void RebalancingWorker::main_thread() {
+    COUT_DEBUG("Started");
+
+    pin_to_numa_node();
 
     unique_lock<mutex> lock(m_mutex);
     while(true){
@@ -136,6 +161,7 @@ void RebalancingWorker::main_thread() {
         RebalancingPool& thread_pool = master->thread_pool();
 
         // Execute the task received
+        pin_to_numa_node();
         do_execute();
 
         // BUGFIX: when worker_id > 0, after do_execute() completed we cannot look at the content of m_task:
@@ -164,20 +190,31 @@ void RebalancingWorker::do_execute() {
     COUT_DEBUG("Task in execution: " << m_task);
 
     if(m_worker_id == 0){
+        IF_PROFILING( RebalancingTimer timer_worker_total { m_task->m_statistics.m_worker_total_time } );
         debug_content_before();
 
         // Run the APMA algorithm
+        IF_PROFILING( auto apma_t0 = chrono::steady_clock::now() );
         m_task->m_pma->rebalance_run_apma(m_task->m_plan, /* fill segments ? */ false, /* storage previous size */ m_task->m_num_locks * m_task->m_pma->get_segments_per_lock());
+        IF_PROFILING( m_task->m_statistics.m_worker_apma_time = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - apma_t0).count() );
+
+        // A resize copies the elements into a new storage, the old storage is not altered until the task completes
+        const bool resize_readers = m_task->m_plan.m_operation == RebalanceOperation::RESIZE;
+        if(resize_readers){ set_resize_readers(true); }
 
         // Update the detector
         if(m_task->m_plan.m_operation == RebalanceOperation::RESIZE_REBALANCE || m_task->m_plan.m_operation == RebalanceOperation::RESIZE){
             m_task->m_pma->m_detector.resize(m_task->get_window_length());
         }
 
-        if(m_task->m_plan.m_window_length < m_task->m_ptr_storage->get_segments_per_extent()){
+        const bool use_subtasks = m_task->m_plan.m_window_length >= m_task->m_ptr_storage->get_segments_per_extent();
+        if(!use_subtasks){
             do_execute_single();
         } else {
-            make_subtasks(); // create the list of subtasks
+            { // create the list of subtasks
+                IF_PROFILING( RebalancingTimer timer { m_task->m_statistics.m_worker_make_subtasks_time } );
+                make_subtasks();
+            }
             m_task->m_active_workers = 1; // myself
             do_execute_queue();
 
@@ -192,8 +229,14 @@ void RebalancingWorker::do_execute() {
             assert(m_task->m_subtasks.empty() && "All subtasks should have been executed");
         }
 
-        // Finish by setting the segment cardinalities of the window just rebalanced
-        update_segment_cardinalities();
+        // Finish by setting the segment cardinalities of the window just rebalanced. In case of a resize
+        // executed through the subtasks, each subtask has already set the cardinalities of its own output range.
+        if(!use_subtasks || m_task->m_plan.m_operation != RebalanceOperation::RESIZE){
+            update_segment_cardinalities();
+        }
+
+        // the master is going to replace the old storage
+        if(resize_readers){ set_resize_readers(false); }
 
         debug_content_after();
     } else { // worker_id > 0
@@ -209,6 +252,9 @@ void RebalancingWorker::do_execute() {
  *                                                                           *
  *****************************************************************************/
 void RebalancingWorker::do_execute_single(){
+    IF_PROFILING( auto t0 = chrono::steady_clock::now() );
+    IF_PROFILING( uint64_t page_faults_t0 = get_thread_page_faults() );
+
     switch(m_task->m_plan.m_operation){
     case RebalanceOperation::REBALANCE: {
         spread_local();
@@ -230,6 +276,9 @@ void RebalancingWorker::do_execute_single(){
     default:
         assert(0 && "Invalid case");
     }
+
+    IF_PROFILING( m_task->m_statistics.m_worker_task_exec_time.push_back( (int64_t) chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - t0).count() ));
+    IF_PROFILING( m_task->m_statistics.m_worker_page_faults += get_thread_page_faults() - page_faults_t0 );
 }
 
 /*****************************************************************************
@@ -238,10 +287,13 @@ void RebalancingWorker::do_execute_single(){
  *                                                                           *
  *****************************************************************************/
 void RebalancingWorker::make_subtasks(){
-    constexpr size_t CARDINALITY_THRESHOLD = 100000;
+    constexpr int64_t CARDINALITY_THRESHOLD = 100000; // upper bound to the (input) cardinality of each subtask
+    constexpr int64_t SUBTASKS_PER_WORKER = 4; // create more subtasks than workers, so that idle workers can steal the remaining ones
     Storage& storage_input = m_task->m_pma->m_storage;
     const size_t segments_per_extent = storage_input.get_segments_per_extent();
     const size_t segment_capacity = storage_input.m_segment_capacity;
+    // with resizes, also align the subtasks to the gates, so that each subtask can set the cardinalities of its own segments & gates
+    const int64_t subtask_alignment = m_task->m_plan.m_operation == RebalanceOperation::RESIZE ? max<int64_t>(segments_per_extent, m_task->m_pma->get_segments_per_lock()) : segments_per_extent;
 
     // 1. validation step, only executed if !defined(DEBUG)
 #if !defined(NDEBUG) || defined(DEBUG)
@@ -254,6 +306,12 @@ void RebalancingWorker::make_subtasks(){
     PartitionIterator apma_partitions { m_task->m_plan.m_apma_partitions };
     int64_t output_segment_id = m_task->get_window_start();
 
+    // the subtasks are still rounded up to the extents, which bounds their minimum size
+    const int64_t num_workers = m_task->m_master->thread_pool().num_workers();
+    const int64_t cardinality_threshold = std::clamp<int64_t>(m_task->m_plan.get_cardinality_after() / (num_workers * SUBTASKS_PER_WORKER), 1, CARDINALITY_THRESHOLD);
+    COUT_DEBUG("cardinality threshold: " << cardinality_threshold << ", num workers: " << num_workers);
+    vector<RebalancingTask::SubTask> subtasks;
+
     while(!apma_partitions.end()){
         RebalancingTask::SubTask subtask;
         position.roundup();
@@ -263,9 +321,9 @@ void RebalancingWorker::make_subtasks(){
         subtask.m_partition_start_offset = apma_partitions.partition_offset();
         subtask.m_output_extent_start = output_segment_id /segments_per_extent;
 
-        // create a subtask containing at least `CARDINALITY_THRESHOLD' elements in input
+        // create a subtask containing at least `cardinality_threshold' elements in input
         int64_t subtask_cardinality = 0;
-        while(subtask_cardinality < CARDINALITY_THRESHOLD && !apma_partitions.end()){
+        while(subtask_cardinality < cardinality_threshold && !apma_partitions.end()){
             int64_t cardinality = apma_partitions.cardinality_current();
             subtask_cardinality += cardinality;
             apma_partitions.move(1); // next apma partition
@@ -276,10 +334,10 @@ void RebalancingWorker::make_subtasks(){
             assert(position <= lastpos);
         }
 
-        int64_t modulus = output_segment_id % segments_per_extent;
+        int64_t modulus = output_segment_id % subtask_alignment;
 
         if(modulus > 0){
-            int64_t additional_segments = segments_per_extent - modulus;
+            int64_t additional_segments = subtask_alignment - modulus;
             for(int i = 0; i < additional_segments; i++){
                 int64_t cardinality = apma_partitions.cardinality_current();
                 subtask_cardinality += cardinality;
@@ -323,28 +381,34 @@ void RebalancingWorker::make_subtasks(){
 //        }
 //
         COUT_DEBUG(subtask << ", cardinality: " << subtask_cardinality);
-        m_task->m_subtasks.push_back(subtask);
+        subtasks.push_back(subtask);
+        IF_PROFILING( m_task->m_statistics.m_worker_num_subtaks++ );
     }
+
+    // one contiguous block of subtasks for each worker
+    m_task->m_subtasks.assign(subtasks, num_workers);
 }
 
 void RebalancingWorker::do_execute_queue(){
+    IF_PROFILING( uint64_t page_faults_t0 = get_thread_page_faults() );
     int64_t next_worker_id = 1;
     const bool is_rebalance = m_task->m_plan.m_operation == RebalanceOperation::REBALANCE || m_task->m_plan.m_operation == RebalanceOperation::RESIZE_REBALANCE;
 
     int64_t subtask_protect_extent = -1;
     int64_t input_extent_watermark = -1;
+    IF_PROFILING( vector<int64_t> execution_times );
 
     while(true){
         RebalancingTask::SubTask subtask;
 
         { // fetch the next subtask to execute
             unique_lock<mutex> lock(m_task->m_workers_mutex);
-            if(m_task->m_subtasks.empty()){
+            bool stolen = false;
+            if(!m_task->m_subtasks.fetch(m_worker_id, subtask, stolen)){
                 break; // terminate the while loop
             } else {
-                subtask = m_task->m_subtasks.back();
-                m_task->m_subtasks.pop_back();
-                COUT_DEBUG("Subtask fetched: " << subtask);
+                COUT_DEBUG("Subtask fetched: " << subtask << ", stolen: " << stolen);
+                IF_PROFILING( if(stolen){ m_task->m_statistics.m_worker_num_stolen_subtasks++; } );
 
                 if(is_rebalance){
                     if(subtask_protect_extent >= 0){ // remove the previous watermark
@@ -357,6 +421,11 @@ void RebalancingWorker::do_execute_queue(){
                     subtask_protect_extent = subtask.m_input_extent_end;
                     m_task->m_input_watermarks.push_back(subtask_protect_extent);
                     input_extent_watermark = *(std::max_element(begin(m_task->m_input_watermarks), end(m_task->m_input_watermarks)));
+                    // with stealing, the subtasks are not fetched from the last to the first anymore: also protect the input
+                    // of the subtasks still in the deques, the next subtask of each deque is the one reading the highest extents
+                    m_task->m_subtasks.for_each_next([&input_extent_watermark](const RebalancingTask::SubTask& next){
+                        input_extent_watermark = max(input_extent_watermark, next.m_input_extent_end);
+                    });
                     COUT_DEBUG("Subtask input watermark (extent): " << subtask_protect_extent);
                 }
             }
@@ -372,7 +441,9 @@ void RebalancingWorker::do_execute_queue(){
         }
 
         reclaim_past_extents(input_extent_watermark); // previous iteration
+        IF_PROFILING( auto t0 = chrono::steady_clock::now() );
         do_execute_subtask(subtask, input_extent_watermark);
+        IF_PROFILING( execution_times.push_back( chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - t0).count() ));
     }
 
     // finish rewiring the last extents
@@ -396,6 +467,9 @@ void RebalancingWorker::do_execute_queue(){
     }
     assert(m_extents_to_rewire.empty());
 
+    IF_PROFILING( { unique_lock<mutex> lock(m_task->m_workers_mutex); for(auto time : execution_times) m_task->m_statistics.m_worker_task_exec_time.push_back(time); m_task->m_statistics.m_worker_page_faults += get_thread_page_faults() - page_faults_t0; } );
+    IF_PROFILING( if(m_worker_id == 0) { m_task->m_statistics.m_worker_num_threads = next_worker_id; } );
+
     m_task->m_active_workers--;
     m_task->m_workers_condvar.notify_all();
 }
@@ -417,6 +491,14 @@ void RebalancingWorker::do_execute_subtask(RebalancingTask::SubTask& subtask, in
                 /* initial segment */ subtask.m_output_extent_start * m_task->m_ptr_storage->get_segments_per_extent(),
                 /* number of segments */ (subtask.m_output_extent_end - subtask.m_output_extent_start) * m_task->m_ptr_storage->get_segments_per_extent(),
                 apma_partitions);
+
+        // the new storage & gates are not visible yet to any other thread, set the cardinalities of the output range of this subtask
+        const int64_t segments_per_extent = m_task->m_ptr_storage->get_segments_per_extent();
+        const int64_t segments_per_lock = m_task->m_pma->get_segments_per_lock();
+        const int64_t lock_start = subtask.m_output_extent_start * segments_per_extent / segments_per_lock;
+        const int64_t lock_end = std::min<int64_t>(subtask.m_output_extent_end * segments_per_extent / segments_per_lock, m_task->get_lock_end());
+        PartitionIterator partitions { m_task->m_plan.m_apma_partitions, subtask.m_partition_start_id, subtask.m_partition_start_offset };
+        update_segment_cardinalities(lock_start, lock_end, partitions);
     } break;
     default:
         assert(0 && "Invalid case");
@@ -440,7 +522,7 @@ void RebalancingWorker::spread_local(){
     unique_ptr<int64_t, decltype(fn_deallocate)> ptr_workspace_values { memory_pool.allocate<int64_t>(plan.get_cardinality_after()), fn_deallocate };
     int64_t* __restrict workspace_keys = ptr_workspace_keys.get();
     int64_t* __restrict workspace_values = ptr_workspace_values.get();
-    uint16_t* __restrict input_cardinalities = m_task->m_ptr_storage->m_segment_sizes;
+    Storage::segment_size_t* __restrict input_cardinalities = m_task->m_ptr_storage->m_segment_sizes;
 
     // copy all input elements into the workspace
     assert(plan.m_window_start % 2 == 0 && "Expected to start from an even segment");
@@ -496,6 +578,16 @@ void RebalancingWorker::rebalance_rewire(Storage* storage, int64_t input_extent_
     const int64_t segment_capacity = storage->m_segment_capacity;
     const int64_t segments_per_extent = storage->get_segments_per_extent();
 
+    // get some space from the rewiring facility, for all the extents to rewire at once: the extents up to the watermark
+    const int64_t num_buffers = max<int64_t>(0, min<int64_t>(extent_length, input_extent_watermark - extent_start +1));
+    m_buffers_keys.resize(num_buffers);
+    m_buffers_values.resize(num_buffers);
+    if(num_buffers > 0){ // mutual exclusion
+        scoped_lock<mutex> lock(storage->m_mutex);
+        storage->m_memory_keys->acquire_buffers(m_buffers_keys.data(), num_buffers);
+        storage->m_memory_values->acquire_buffers(m_buffers_values.data(), num_buffers);
+    }
+
     for(int64_t i = extent_length -1; i>=0; i--){
         int64_t extent_id = extent_start + i;
         const bool use_rewiring = (extent_id <= input_extent_watermark);
@@ -506,13 +598,8 @@ void RebalancingWorker::rebalance_rewire(Storage* storage, int64_t input_extent_
             int64_t offset = extent_id * segments_per_extent * segment_capacity;
             spread_rewire(storage, /*in/out*/ input_position, storage->m_keys + offset, storage->m_values + offset, extent_id, apma_partitions);
         } else {
-            // get some space from the rewiring facility
-            int64_t *buffer_keys{nullptr}, *buffer_values{nullptr};
-            { // mutual exclusion
-                scoped_lock<mutex> lock(storage->m_mutex);
-                buffer_keys = (int64_t*) storage->m_memory_keys->acquire_buffer();
-                buffer_values = (int64_t*) storage->m_memory_values->acquire_buffer();
-            }
+            int64_t* buffer_keys = (int64_t*) m_buffers_keys[i];
+            int64_t* buffer_values = (int64_t*) m_buffers_values[i];
             m_extents_to_rewire.push_back(Extent2Rewire{extent_id, buffer_keys, buffer_values});
 //            COUT_DEBUG("buffer_keys: " << (void*) buffer_keys << ", buffer values: " << (void*) buffer_values << ", extent: " << extent_id);
             spread_rewire(storage, /*in/out*/ input_position, buffer_keys, buffer_values, extent_id, apma_partitions);
@@ -534,6 +621,7 @@ void RebalancingWorker::spread_rewire(Storage* storage, int64_t& input_position,
 
     int64_t* input_keys = storage->m_keys + input_initial_displacement;
     int64_t* input_values = storage->m_values + input_initial_displacement;
+    const bool nontemporal = use_nontemporal_stores();
 
     for(int64_t output_segment_id_rel = segments_per_extent -2; output_segment_id_rel >= 0; output_segment_id_rel -= 2){ // relative to the current extent
         const int64_t output_run_sz_lhs = apma_partitions.cardinality_current();
@@ -551,8 +639,13 @@ void RebalancingWorker::spread_rewire(Storage* storage, int64_t& input_position,
             size_t elements_to_copy = min(output_run_sz, input_run_sz);
             const size_t input_copy_offset = input_run_sz - elements_to_copy;
             const size_t output_copy_offset = output_run_sz - elements_to_copy;
-            memcpy(output_keys + output_copy_offset, input_keys + input_copy_offset, elements_to_copy * sizeof(output_keys[0]));
-            memcpy(output_values + output_copy_offset, input_values + input_copy_offset, elements_to_copy * sizeof(output_values[0]));
+            if(nontemporal){
+                memcpy_nontemporal(output_keys + output_copy_offset, input_keys + input_copy_offset, elements_to_copy);
+                memcpy_nontemporal(output_values + output_copy_offset, input_values + input_copy_offset, elements_to_copy);
+            } else {
+                memcpy(output_keys + output_copy_offset, input_keys + input_copy_offset, elements_to_copy * sizeof(output_keys[0]));
+                memcpy(output_values + output_copy_offset, input_values + input_copy_offset, elements_to_copy * sizeof(output_values[0]));
+            }
             input_run_sz -= elements_to_copy;
             output_run_sz -= elements_to_copy;
 
@@ -591,6 +684,8 @@ void RebalancingWorker::spread_rewire(Storage* storage, int64_t& input_position,
         apma_partitions.move(-2); // backwards
     }
 
+    if(nontemporal) store_fence(); // the extent may be rewired or read by other threads as soon as we return
+
     // update the final position
     input_position = input_keys - storage->m_keys + input_run_sz;
 }
@@ -615,7 +710,7 @@ void RebalancingWorker::resize(const Storage* input, Storage* output, int64_t in
     int64_t input_run_sz = 0;
     int64_t* __restrict input_keys = input->m_keys + input_start_position;
     int64_t* __restrict input_values = input->m_values + input_start_position;
-    uint16_t* __restrict input_sizes = input->m_segment_sizes;
+    Storage::segment_size_t* __restrict input_sizes = input->m_segment_sizes;
     if(input_segment_id % 2 == 0){ // even segments
         input_run_sz = /* even segment */ segment_capacity - input_offset + /* odd segment */ input_sizes[input_segment_id +1];
     } else { // odd segments
@@ -626,7 +721,8 @@ void RebalancingWorker::resize(const Storage* input, Storage* output, int64_t in
     // output
     int64_t* __restrict output_base_keys = output->m_keys + output_segment_id * output->m_segment_capacity;
     int64_t* __restrict output_base_values = output->m_values + output_segment_id * output->m_segment_capacity;
-//    uint16_t* __restrict output_sizes = output->m_segment_sizes + output_segment_id;
+//    Storage::segment_size_t* __restrict output_sizes = output->m_segment_sizes + output_segment_id;
+    const bool nontemporal = use_nontemporal_stores();
 
     for(size_t i = 0; i < output_num_segments; i+=2){
         const int64_t output_run_sz_lhs = apma_partitions.cardinality_current();
@@ -642,8 +738,13 @@ void RebalancingWorker::resize(const Storage* input, Storage* output, int64_t in
 
         while(output_run_sz > 0){
             size_t elements_to_copy = min(output_run_sz, input_run_sz);
-            memcpy(output_keys, input_keys, elements_to_copy * sizeof(int64_t));
-            memcpy(output_values, input_values, elements_to_copy * sizeof(int64_t));
+            if(nontemporal){
+                memcpy_nontemporal(output_keys, input_keys, elements_to_copy);
+                memcpy_nontemporal(output_values, input_values, elements_to_copy);
+            } else {
+                memcpy(output_keys, input_keys, elements_to_copy * sizeof(int64_t));
+                memcpy(output_values, input_values, elements_to_copy * sizeof(int64_t));
+            }
             input_keys += elements_to_copy; input_values += elements_to_copy;
             output_keys += elements_to_copy; output_values += elements_to_copy;
             input_run_sz -= elements_to_copy;
@@ -672,6 +773,14 @@ void RebalancingWorker::resize(const Storage* input, Storage* output, int64_t in
         // next APMA partitions
         apma_partitions.move(+2);
     }
+
+    if(nontemporal) store_fence(); // the new storage is read by other threads as soon as the resize completes
+}
+
+bool RebalancingWorker::use_nontemporal_stores() const {
+    // both keys & values are moved
+    uint64_t window_sz = m_task->m_plan.get_cardinality_after() * 2 * sizeof(int64_t);
+    return window_sz >= m_task->m_pma->knobs().get_nontemporal_threshold();
 }
 
 /*****************************************************************************
@@ -721,19 +830,54 @@ void RebalancingWorker::reclaim_past_extents(int64_t input_extent_watermark){
     int64_t segment_capacity = storage->m_segment_capacity;
 
     unique_lock<mutex> lock(storage->m_mutex);
-    do {
-        auto& metadata = m_extents_to_rewire.front();
-        auto extent_id = metadata.m_extent_id;
-        auto offset_dst = extent_id * segments_per_extent * segment_capacity;
-        auto keys_dst = storage->m_keys + offset_dst;
-        auto keys_src = metadata.m_buffer_keys;
-        auto values_dst = storage->m_values + offset_dst;
-        auto values_src = metadata.m_buffer_values;
-        m_extents_to_rewire.pop_front();
-//        COUT_DEBUG("reclaim buffers for keys: " << keys_src << ", values: " << values_src);
-        storage->m_memory_keys->swap_and_release(keys_dst, keys_src);
-        storage->m_memory_values->swap_and_release(values_dst, values_src);
-    } while (!m_extents_to_rewire.empty() && m_extents_to_rewire.front().m_extent_id > input_extent_watermark);
+    if(m_task->m_use_rewiring){
+        // collect the buffers to rewire, for the keys first and then for the values, and swap them in batch
+        IF_PROFILING( auto t0 = chrono::steady_clock::now() );
+        int64_t num_syscalls = 0;
+        size_t num_extents = 0;
+        while(num_extents < m_extents_to_rewire.size() && m_extents_to_rewire[num_extents].m_extent_id > input_extent_watermark){ num_extents++; }
+
+        m_rewire_pairs.clear();
+        for(size_t i = 0; i < num_extents; i++){
+            auto& metadata = m_extents_to_rewire[i];
+            m_rewire_pairs.emplace_back(storage->m_keys + metadata.m_extent_id * segments_per_extent * segment_capacity, metadata.m_buffer_keys);
+        }
+        num_syscalls += storage->m_memory_keys->swap_and_release_many(m_rewire_pairs.data(), m_rewire_pairs.size());
+
+        {
+            m_rewire_pairs.clear();
+            for(size_t i = 0; i < num_extents; i++){
+                auto& metadata = m_extents_to_rewire[i];
+                m_rewire_pairs.emplace_back(storage->m_values + metadata.m_extent_id * segments_per_extent * segment_capacity, metadata.m_buffer_values);
+            }
+            num_syscalls += storage->m_memory_values->swap_and_release_many(m_rewire_pairs.data(), m_rewire_pairs.size());
+        }
+
+        COUT_DEBUG("extents rewired: " << num_extents << ", mmap syscalls: " << num_syscalls);
+        m_extents_to_rewire.erase(begin(m_extents_to_rewire), begin(m_extents_to_rewire) + num_extents);
+
+        // the statistics are shared with the other workers of the task, but they are protected by the storage lock
+        IF_PROFILING( m_task->m_statistics.m_worker_rewiring_time += chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - t0).count() );
+        IF_PROFILING( m_task->m_statistics.m_worker_rewired_extents += num_extents * 2 );
+        IF_PROFILING( m_task->m_statistics.m_worker_rewiring_syscalls += num_syscalls );
+    } else { // cheaper to copy the buffers back in place
+        do {
+            auto& metadata = m_extents_to_rewire.front();
+            auto extent_id = metadata.m_extent_id;
+            auto offset_dst = extent_id * segments_per_extent * segment_capacity;
+            auto keys_dst = storage->m_keys + offset_dst;
+            auto keys_src = metadata.m_buffer_keys;
+            auto values_dst = storage->m_values + offset_dst;
+            auto values_src = metadata.m_buffer_values;
+            m_extents_to_rewire.pop_front();
+            COUT_DEBUG("reclaim buffers for keys: " << keys_src << ", values: " << values_src);
+            const size_t extent_size = storage->m_memory_keys->get_extent_size();
+            memcpy(keys_dst, keys_src, extent_size);
+            memcpy(values_dst, values_src, extent_size);
+            storage->m_memory_keys->release_buffer(keys_src);
+            storage->m_memory_values->release_buffer(values_src);
+        } while (!m_extents_to_rewire.empty() && m_extents_to_rewire.front().m_extent_id > input_extent_watermark);
+    }
 }
 
 /*****************************************************************************
@@ -742,24 +886,9 @@ void RebalancingWorker::reclaim_past_extents(int64_t input_extent_watermark){
  *                                                                           *
  *****************************************************************************/
 void RebalancingWorker::update_segment_cardinalities() {
-    uint16_t* __restrict cardinalities = m_task->m_ptr_storage->m_segment_sizes;
-    Gate* __restrict locks = m_task->m_ptr_locks;
+    IF_PROFILING( RebalancingTimer timer { m_task->m_statistics.m_worker_segment_cards } );
     PartitionIterator partitions { m_task->m_plan.m_apma_partitions };
-    int64_t segment_id = m_task->get_window_start();
-    const int64_t segments_per_lock = m_task->m_pma->get_segments_per_lock();
-    for(int64_t lock_id = m_task->get_lock_start(), end = m_task->get_lock_end(); lock_id < end; lock_id++){
-        uint32_t cardinality = 0;
-        for(int64_t j = 0; j < segments_per_lock; j++){
-            uint32_t apma_card = partitions.cardinality();
-            cardinalities[segment_id] = (uint16_t) apma_card;
-            cardinality += apma_card;
-
-            partitions.move(1);
-            segment_id++;
-        }
-
-        locks[lock_id].m_cardinality = cardinality;
-    }
+    update_segment_cardinalities(m_task->get_lock_start(), m_task->get_lock_end(), partitions);
 
 #if defined(DEBUG)
     if(m_task->m_plan.m_operation == RebalanceOperation::RESIZE_REBALANCE || m_task->m_plan.m_operation == RebalanceOperation::RESIZE){
@@ -779,6 +908,55 @@ void RebalancingWorker::update_segment_cardinalities() {
 #endif
 }
 
+void RebalancingWorker::update_segment_cardinalities(int64_t lock_start, int64_t lock_end, PartitionIterator& partitions) {
+    Storage::segment_size_t* __restrict cardinalities = m_task->m_ptr_storage->m_segment_sizes;
+    Gate* __restrict locks = m_task->m_ptr_locks;
+    const int64_t segments_per_lock = m_task->m_pma->get_segments_per_lock();
+    int64_t segment_id = lock_start * segments_per_lock;
+    for(int64_t lock_id = lock_start; lock_id < lock_end; lock_id++){
+        uint32_t cardinality = 0;
+        for(int64_t j = 0; j < segments_per_lock; j++){
+            uint32_t apma_card = partitions.cardinality();
+            cardinalities[segment_id] = (Storage::segment_size_t) apma_card;
+            cardinality += apma_card;
+
+            partitions.move(1);
+            segment_id++;
+        }
+
+        locks[lock_id].m_cardinality = cardinality;
+    }
+}
+
+/*****************************************************************************
+ *                                                                           *
+ *   Readers during a resize                                                 *
+ *                                                                           *
+ *****************************************************************************/
+void RebalancingWorker::set_resize_readers(bool value){
+    assert(m_task->m_plan.m_operation == RebalanceOperation::RESIZE && "Only resizes leave the old storage untouched");
+    Gate* gates = m_task->m_pma->m_locks.get_unsafe(); // the gates of the old storage
+    for(int64_t lock_id = 0, end = m_task->m_num_locks; lock_id < end; lock_id++){
+        Gate& gate = gates[lock_id];
+        gate.lock();
+        assert(gate.m_state == Gate::State::REBAL && "All gates should have been acquired by the task");
+        if(value){
+            gate.m_resize_readers = true;
+            gate.wake_readers();
+        } else {
+            gate.m_resize_draining = true; // stop admitting new readers, they would keep the gate busy under a steady read load
+            while(gate.m_num_active_threads > 0){ // wait for the readers to leave the gate
+                gate.unlock();
+                std::this_thread::yield();
+                gate.lock();
+            }
+            gate.m_resize_readers = false;
+            gate.m_resize_draining = false;
+        }
+        gate.unlock();
+    }
+}
+
 /*****************************************************************************
  *                                                                           *
  *   InputIterator                                                           *
@@ -798,7 +976,7 @@ void RebalancingWorker::InputPositionIterator::operator+=(int64_t shift){
     roundup();
 
     const int64_t segment_capacity = m_storage.m_segment_capacity;
-    uint16_t* __restrict cardinalities = m_storage.m_segment_sizes;
+    Storage::segment_size_t* __restrict cardinalities = m_storage.m_segment_sizes;
     int64_t segment_id = (m_position / (2* segment_capacity)) *2; // even segment
     if(segment_id >= m_storage.m_number_segments) return; // depleted
     int64_t segment_start = (segment_id +1) * segment_capacity - cardinalities[segment_id];
@@ -833,7 +1011,7 @@ void RebalancingWorker::InputPositionIterator::roundup() {
     if(!m_move2nextchunk) return;
 //    COUT_DEBUG("old position: " << m_position);
     const int64_t segment_capacity = m_storage.m_segment_capacity;
-    uint16_t* __restrict cardinalities = m_storage.m_segment_sizes;
+    Storage::segment_size_t* __restrict cardinalities = m_storage.m_segment_sizes;
     int64_t segment_id = ((m_position -1) / (2* segment_capacity)) *2; // even segment
     segment_id += 2;
     m_position = (segment_id +1) * segment_capacity - cardinalities[segment_id];
@@ -17,11 +17,14 @@
 
 #pragma once
 
+#include <atomic>
 #include <cstddef>
 #include <condition_variable>
 #include <deque>
 #include <mutex>
 #include <thread>
+#include <utility>
+#include <vector>
 
 #include "partition.hpp"
 #include "rebalancing_task.hpp"
@@ -35,11 +38,16 @@ struct Storage;
 class RebalancingWorker {
     RebalancingTask* m_task; // the task to perform
     int64_t m_worker_id; // coordinator worker ?
+    std::atomic<int> m_numa_node; // the NUMA node where the worker should run, -1 to run in the first CPU
+    int m_numa_node_current; // the NUMA node where the worker is currently pinned, only accessed by the worker thread
     std::mutex m_mutex; // controller mutex
     std::condition_variable m_condition_variable; // sync the controller on the current task
     std::thread m_handle; // current thread handle
     struct Extent2Rewire{ int64_t m_extent_id; int64_t* m_buffer_keys; int64_t* m_buffer_values; };
     std::deque<Extent2Rewire> m_extents_to_rewire; // a list of extents to be rewired
+    std::vector<void*> m_buffers_keys; // the buffers acquired for the keys of the extents to rewire, sorted by address
+    std::vector<void*> m_buffers_values; // the buffers acquired for the values of the extents to rewire, sorted by address
+    std::vector<std::pair<void*, void*>> m_rewire_pairs; // workspace to reclaim the past extents, pairs <extent in use, buffer>
 
     class InputPositionIterator{
         const Storage& m_storage;
@@ -97,6 +105,9 @@ class RebalancingWorker {
 private:
     void main_thread();
 
+    // Move the worker to the NUMA node set by the thread pool, if it is not already running there
+    void pin_to_numa_node();
+
     void do_execute();
     void do_execute_single(); // for windows < extent
     void do_execute_queue(); // for windows >= extent
@@ -128,6 +139,14 @@ private:
     void reclaim_past_extents(int64_t input_extent_watermark);
 
     void update_segment_cardinalities();
+    void update_segment_cardinalities(int64_t lock_start, int64_t lock_end, PartitionIterator& partitions); // only the gates in [lock_start, lock_end)
+
+    // Let the readers access the old storage while it is being copied by a RESIZE. When unset, wait for the active readers to leave.
+    // A RESIZE_REBALANCE extends the storage and rewires its extents in place, its readers keep waiting in the queues of the gates.
+    void set_resize_readers(bool value);
+
+    // Whether the window to rebalance or resize is large enough to copy its elements bypassing the cache
+    bool use_nontemporal_stores() const;
 
 public:
     RebalancingWorker();
@@ -139,6 +158,17 @@ public:
     void stop();
 
     void execute(RebalancingTask* task);
+
+    /**
+     * Set the NUMA node where the worker should run, -1 to run in the first CPU. The worker moves to the node
+     * at the start of its next task.
+     */
+    void set_numa_node(int numa_node) noexcept;
+
+    /**
+     * Retrieve the NUMA node where the worker should run, or -1 if it is not assigned to any node
+     */
+    int get_numa_node() const noexcept;
 };
 
 } // namespace
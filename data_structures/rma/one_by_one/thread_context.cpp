@@ -56,7 +56,10 @@ extern mutex _debug_mutex; // PackedMemoryArray.cpp
  *                                                                           *
  *****************************************************************************/
 ThreadContextList::ThreadContextList() {
-
+    for(uint64_t i = 0; i < m_capacity; i++){
+        m_contexts[i].m_epochs = &m_epochs;
+        m_contexts[i].m_epoch_slot = i;
+    }
 }
 
 ThreadContextList::~ThreadContextList() {
@@ -79,6 +82,7 @@ void ThreadContextList::resize(uint64_t size){
         }
     }
     m_size = size;
+    m_epochs.resize(size);
 }
 
 ThreadContext* ThreadContextList::operator[](uint64_t index) const {
@@ -87,12 +91,11 @@ ThreadContext* ThreadContextList::operator[](uint64_t index) const {
 }
 
 uint64_t ThreadContextList::min_epoch() const {
-    uint64_t min_epoch = numeric_limits<uint64_t>::max();
-    scoped_lock<mutex> lock(m_mutex); // this is going to be used only by the garbage collector, it's okay to lock here
-    for(uint64_t i =0; i < m_size; i++){
-        min_epoch = std::min(min_epoch, m_contexts[i].epoch());
-    }
-    return min_epoch;
+    return m_epochs.min_epoch();
+}
+
+EpochManager& ThreadContextList::epochs() const {
+    return const_cast<EpochManager&>(m_epochs);
 }
 
 /*****************************************************************************
@@ -101,7 +104,7 @@ uint64_t ThreadContextList::min_epoch() const {
  *                                                                           *
  *****************************************************************************/
 
-ThreadContext::ThreadContext() : m_timestamp(numeric_limits<uint64_t>::max()), m_hosted(false), m_has_update(false), m_queue_next(16) {
+ThreadContext::ThreadContext() : m_epochs(nullptr), m_epoch_slot(0), m_hosted(false), m_has_update(false), m_queue_next(16) {
 
 }
 
@@ -128,15 +131,15 @@ bool ThreadContext::busy() const {
 }
 
 void ThreadContext::hello() noexcept {
-    m_timestamp = rdtscp(); // cpu clock
+    m_epochs->enter(m_epoch_slot);
 }
 
 void ThreadContext::bye() noexcept {
-    m_timestamp = numeric_limits<uint64_t>::max();
+    m_epochs->exit(m_epoch_slot);
 }
 
 uint64_t ThreadContext::epoch() const noexcept {
-    return m_timestamp;
+    return m_epochs->epoch(m_epoch_slot);
 }
 
 void ThreadContext::register_thread(int thread_id){
@@ -184,7 +187,7 @@ void ThreadContext::set_update(bool is_insertion, int64_t key, int64_t value) no
 }
 
 ::std::ostream& operator<<(::std::ostream& out, const ThreadContext& context){
-    out << "[ThreadContext thread_id: " << ThreadContext::m_thread_id << ", timestamp: " << context.m_timestamp << ", "
+    out << "[ThreadContext thread_id: " << ThreadContext::m_thread_id << ", epoch: " << context.epoch() << ", "
             "hosted: " << (context.m_hosted ? "yes" : "no");
     if(context.m_has_update){
         out << ", current operation: " << context.m_has_update;
@@ -23,6 +23,7 @@
 #include <vector>
 
 #include "common/circular_array.hpp"
+#include "common/epoch_manager.hpp"
 #include "common/spin_lock.hpp"
 #include "wakelist.hpp"
 
@@ -38,7 +39,8 @@ friend class ThreadContextList;
 private:
     friend ::std::ostream& operator<<(::std::ostream& out, const ThreadContext& operation);
 
-    uint64_t m_timestamp; // the current timestamp (or epoch) for the current thread. Only utilised for the purposes of the Garbage Collector
+    ::common::EpochManager* m_epochs; // the epochs announced by the threads. Only utilised for the purposes of the Garbage Collector
+    uint64_t m_epoch_slot; // the slot in m_epochs where this context announces its epoch
     bool m_hosted; // whether a thread owns this context
 
     static thread_local int m_thread_id; // the ID of the current thread
@@ -94,12 +96,12 @@ public:
     uint64_t epoch() const noexcept;
 
     /**
-     * Set the current timestamp for the current (worker) thread
+     * Announce the current global epoch for the current (worker) thread
      */
     void hello() noexcept;
 
     /**
-     * Remove the timestamp for the current (worker) thread
+     * Remove the epoch announced by the current (worker) thread
      */
     void bye() noexcept;
 
@@ -155,8 +157,9 @@ inline ThreadContext::Update& ThreadContext::get_update() noexcept { return m_cu
  * A safe enough list of thread contexts
  */
 class ThreadContextList {
-    constexpr static uint64_t m_capacity = 128;
+    constexpr static uint64_t m_capacity = ::common::EpochManager::MAX_NUM_SLOTS;
     uint64_t m_size = 0;
+    ::common::EpochManager m_epochs; // it must outlive the contexts
     ThreadContext m_contexts[m_capacity];
     mutable std::mutex m_mutex;
 
@@ -172,6 +175,9 @@ public:
     ThreadContext* operator[](uint64_t index) const;
 
     uint64_t min_epoch() const;
+
+    // The global epoch and the announcements of the threads
+    ::common::EpochManager& epochs() const;
 };
 
 /**
@@ -22,6 +22,7 @@
 #include <vector>
 
 #include "rma/common/memory_pool.hpp"
+#include "storage.hpp"
 
 namespace data_structures::rma::one_by_one {
 
@@ -30,7 +31,7 @@ class PackedMemoryArray;
 
 struct Interval {
     uint32_t m_start;
-    uint16_t m_length;
+    uint32_t m_length;
     int16_t m_weight;
     int32_t m_associated_segment;
 
@@ -53,7 +54,7 @@ using VectorOfIntervals = std::vector<Interval, common::CachedAllocator<Interval
 class Weights {
 private:
     PackedMemoryArray& m_pma;
-    const uint16_t* m_cardinalities;
+    const Storage::segment_size_t* m_cardinalities;
     const size_t m_segment_start;
     const size_t m_segment_length;
 //    const double m_threshold;
@@ -0,0 +1,248 @@
+/**
+ * Copyright (C) 2018 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "snapshot.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "common/binary_file.hpp"
+#include "common/configuration.hpp"
+#include "common/miscellaneous.hpp"
+#include "common/timer.hpp"
+#include "interface.hpp"
+#include "iterator.hpp"
+#include "parallel.hpp"
+
+using namespace common;
+using namespace std;
+
+namespace data_structures {
+
+#define RAISE(msg) RAISE_EXCEPTION(SnapshotError, msg)
+
+/*****************************************************************************
+ *                                                                           *
+ *   Format                                                                  *
+ *                                                                           *
+ *****************************************************************************/
+/**
+ * Layout of a snapshot:
+ * - the file header
+ * - a sequence of blocks, each made of a block header followed by the keys and then the values of the block
+ * - an empty block (m_num_elements == 0), to mark the end of the snapshot
+ */
+namespace {
+
+struct FileHeader {
+    char m_magic[8]; // file signature
+    uint64_t m_version; // format of the snapshot
+    uint64_t m_num_elements; // total number of elements stored
+    uint64_t m_block_size; // max number of elements per block
+};
+
+struct BlockHeader {
+    uint64_t m_num_elements; // number of elements in the block
+    uint64_t m_checksum; // checksum of the keys & values of the block
+};
+
+constexpr char SNAPSHOT_MAGIC[8] = { 'D', 'S', 'S', 'N', 'A', 'P', '\0', '\0' };
+constexpr uint64_t SNAPSHOT_VERSION = 2;
+constexpr uint64_t SNAPSHOT_BLOCK_SIZE = 1ull << 16; // number of elements per block
+
+// Checksum of a sequence of words, one multiply-rotate per word
+uint64_t checksum(uint64_t seed, const void* data, size_t num_words){
+    const uint64_t* __restrict words = reinterpret_cast<const uint64_t*>(data);
+    uint64_t hash = seed;
+    for(size_t i = 0; i < num_words; i++){
+        hash = (hash ^ words[i]) * 0x9E3779B97F4A7C15ull;
+        hash ^= hash >> 29;
+    }
+    return hash;
+}
+
+/**
+ * Register the current thread to the data structure for the duration of the scope, if the data structure
+ * implements the ParallelCallbacks
+ */
+class ScopedWorker {
+    ParallelCallbacks* m_callbacks;
+public:
+    ScopedWorker(const Interface* data_structure) : m_callbacks(dynamic_cast<ParallelCallbacks*>(const_cast<Interface*>(data_structure))) {
+        if(m_callbacks != nullptr){
+            m_callbacks->on_init_main(1);
+            m_callbacks->on_init_worker(0);
+        }
+    }
+
+    ~ScopedWorker(){
+        if(m_callbacks != nullptr){
+            m_callbacks->on_destroy_worker(0);
+            m_callbacks->on_destroy_main();
+        }
+    }
+
+    ParallelCallbacks* callbacks() const { return m_callbacks; }
+};
+
+} // anonymous namespace
+
+/*****************************************************************************
+ *                                                                           *
+ *   Save                                                                    *
+ *                                                                           *
+ *****************************************************************************/
+
+SnapshotSummary save_snapshot(const Interface* data_structure, const string& path){
+    if(data_structure == nullptr) RAISE("Null pointer");
+    LOG_VERBOSE("Saving the snapshot `" << path << "' ...");
+    Timer timer { true };
+    ParallelCallbacks* callbacks = dynamic_cast<ParallelCallbacks*>(const_cast<Interface*>(data_structure));
+    if(callbacks != nullptr) callbacks->on_complete(); // merge the pending updates
+    ScopedWorker worker { data_structure };
+
+    BinaryFileWriter writer { path };
+    FileHeader file_header;
+    memcpy(file_header.m_magic, SNAPSHOT_MAGIC, sizeof(file_header.m_magic));
+    file_header.m_version = SNAPSHOT_VERSION;
+    file_header.m_num_elements = data_structure->size();
+    file_header.m_block_size = SNAPSHOT_BLOCK_SIZE;
+    writer.write(file_header);
+
+    SnapshotSummary summary;
+    summary.m_min_key = numeric_limits<int64_t>::max();
+    summary.m_max_key = numeric_limits<int64_t>::min();
+    vector<int64_t> keys; keys.reserve(SNAPSHOT_BLOCK_SIZE);
+    vector<int64_t> values; values.reserve(SNAPSHOT_BLOCK_SIZE);
+
+    auto write_block = [&](){
+        BlockHeader block_header;
+        block_header.m_num_elements = keys.size();
+        block_header.m_checksum = checksum(checksum(block_header.m_num_elements, keys.data(), keys.size()), values.data(), values.size());
+
+        writer.write(block_header);
+        writer.write(keys.data(), keys.size() * sizeof(int64_t));
+        writer.write(values.data(), values.size() * sizeof(int64_t));
+
+        summary.m_num_elements += keys.size();
+        keys.clear();
+        values.clear();
+    };
+
+    auto it = data_structure->iterator();
+    while(it->hasNext()){
+        auto element = it->next();
+        summary.m_min_key = min(summary.m_min_key, element.first);
+        summary.m_max_key = max(summary.m_max_key, element.first);
+        keys.push_back(element.first);
+        values.push_back(element.second);
+        if(keys.size() == SNAPSHOT_BLOCK_SIZE) write_block();
+    }
+    it.reset(); // release the iterator, it may hold locks in the data structure
+    if(!keys.empty()) write_block();
+    write_block(); // end marker
+
+    if(summary.m_num_elements != file_header.m_num_elements){
+        RAISE("Size mismatch, the iterator returned " << summary.m_num_elements << " elements, while the data structure contains " << file_header.m_num_elements << " elements");
+    }
+    writer.close();
+    summary.m_file_size = writer.bytes_written();
+
+    timer.stop();
+    LOG_VERBOSE("Snapshot `" << path << "' saved: " << summary.m_num_elements << " elements, " << to_string_with_unit_suffix(summary.m_file_size) << ", elapsed time: " << timer.milliseconds() << " millisecs");
+    return summary;
+}
+
+/*****************************************************************************
+ *                                                                           *
+ *   Load                                                                    *
+ *                                                                           *
+ *****************************************************************************/
+
+SnapshotSummary load_snapshot(Interface* data_structure, const string& path){
+    if(data_structure == nullptr) RAISE("Null pointer");
+    if(data_structure->size() > 0) RAISE("The data structure is not empty. Size: " << data_structure->size());
+    LOG_VERBOSE("Loading the snapshot `" << path << "' ...");
+    Timer timer { true };
+
+    BinaryFileReader reader { path };
+    FileHeader file_header = reader.read<FileHeader>();
+    if(memcmp(file_header.m_magic, SNAPSHOT_MAGIC, sizeof(file_header.m_magic)) != 0 || file_header.m_version != SNAPSHOT_VERSION){
+        RAISE("The file `" << path << "' is not a snapshot");
+    }
+    if(file_header.m_block_size == 0 || file_header.m_block_size > (1ull << 30)){
+        RAISE("The snapshot `" << path << "' is corrupted, invalid block size: " << file_header.m_block_size);
+    }
+
+    BulkLoading* bulk_loading = dynamic_cast<BulkLoading*>(data_structure);
+    unique_ptr<ScopedWorker> worker { new ScopedWorker(data_structure) };
+    SnapshotSummary summary;
+    summary.m_min_key = numeric_limits<int64_t>::max();
+    summary.m_max_key = numeric_limits<int64_t>::min();
+
+    vector<pair<int64_t, int64_t>> elements; // all elements, only for the bulk loading
+    if(bulk_loading != nullptr) elements.reserve(file_header.m_num_elements);
+    vector<int64_t> keys ( file_header.m_block_size );
+    vector<int64_t> values ( file_header.m_block_size );
+
+    uint64_t block_id = 0;
+    do {
+        BlockHeader block_header = reader.read<BlockHeader>();
+        if(block_header.m_num_elements == 0) break; // end marker
+        if(block_header.m_num_elements > file_header.m_block_size){
+            RAISE("Block " << block_id << " is corrupted, number of elements: " << block_header.m_num_elements);
+        }
+        const uint64_t num_elements = block_header.m_num_elements;
+        reader.read(keys.data(), num_elements * sizeof(int64_t));
+        reader.read(values.data(), num_elements * sizeof(int64_t));
+        uint64_t expected_checksum = checksum(checksum(num_elements, keys.data(), num_elements), values.data(), num_elements);
+        if(expected_checksum != block_header.m_checksum){ RAISE("Block " << block_id << " is corrupted: checksum mismatch"); }
+
+        summary.m_min_key = min(summary.m_min_key, keys[0]);
+        summary.m_max_key = max(summary.m_max_key, keys[num_elements -1]);
+        if(bulk_loading != nullptr){
+            for(uint64_t i = 0; i < num_elements; i++){ elements.emplace_back(keys[i], values[i]); }
+        } else {
+            for(uint64_t i = 0; i < num_elements; i++){ data_structure->insert(keys[i], values[i]); }
+        }
+
+        summary.m_num_elements += num_elements;
+        block_id++;
+    } while(true);
+
+    if(summary.m_num_elements != file_header.m_num_elements){
+        RAISE("The snapshot `" << path << "' is truncated, expected elements: " << file_header.m_num_elements << ", found: " << summary.m_num_elements);
+    }
+    if(bulk_loading != nullptr){
+        bulk_loading->load(elements.data(), elements.size());
+    }
+    ParallelCallbacks* callbacks = worker->callbacks();
+    worker.reset(); // unregister the current thread
+    if(callbacks != nullptr) callbacks->on_complete(); // merge the pending updates
+    summary.m_file_size = reader.bytes_read();
+
+    timer.stop();
+    LOG_VERBOSE("Snapshot `" << path << "' loaded: " << summary.m_num_elements << " elements, elapsed time: " << timer.milliseconds() << " millisecs");
+    return summary;
+}
+
+} // namespace data_structures
@@ -0,0 +1,60 @@
+/**
+ * Copyright (C) 2018 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef DATA_STRUCTURES_SNAPSHOT_HPP_
+#define DATA_STRUCTURES_SNAPSHOT_HPP_
+
+#include <cinttypes>
+#include <string>
+
+#include "common/errorhandling.hpp"
+
+namespace data_structures {
+
+class Interface; // forward declaration
+
+/**
+ * Exception raised when saving or loading a snapshot
+ */
+DEFINE_EXCEPTION(SnapshotError);
+
+/**
+ * Summary of the content of a snapshot
+ */
+struct SnapshotSummary {
+    uint64_t m_num_elements = 0; // total number of elements
+    int64_t m_min_key = 0; // the smallest key. Undefined if m_num_elements == 0
+    int64_t m_max_key = 0; // the largest key. Undefined if m_num_elements == 0
+    uint64_t m_file_size = 0; // size of the snapshot, in bytes
+};
+
+/**
+ * Save the content of the data structure, in sorted order, into the file at the given `path'. The elements are
+ * fetched through the iterator of the data structure and stored in blocks, each with its own checksum.
+ * No other thread can alter the data structure while the snapshot is in progress.
+ */
+SnapshotSummary save_snapshot(const Interface* data_structure, const std::string& path);
+
+/**
+ * Load the content of the snapshot at the given `path' into the empty data structure. It uses the interface
+ * BulkLoading, when implemented by the data structure, otherwise it inserts the elements one block at the time.
+ */
+SnapshotSummary load_snapshot(Interface* data_structure, const std::string& path);
+
+} // namespace data_structures
+
+#endif /* DATA_STRUCTURES_SNAPSHOT_HPP_ */
@@ -17,7 +17,9 @@
 
 #include "parallel_idls.hpp"
 
+#include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <condition_variable>
 #include <mutex>
 #include <iostream>
@@ -88,6 +90,67 @@ public:
 
 };
 
+/**
+ * Log-linear histogram of the latencies of the updates, in nanosecs. Each power of 2 is split into 16 buckets,
+ * so that a quantile is overestimated by at most 1/16 of its value.
+ */
+class LatencyHistogram {
+    constexpr static uint64_t SUB_BUCKETS = 16;
+    constexpr static uint64_t NUM_BUCKETS = 64 * SUB_BUCKETS;
+    uint64_t m_buckets[NUM_BUCKETS];
+    uint64_t m_count = 0; // total number of samples
+    uint64_t m_max = 0; // the maximum latency recorded
+
+    static uint64_t bucket_of(uint64_t value){
+        if(value < SUB_BUCKETS) return value;
+        uint64_t msb = 63 - __builtin_clzll(value); // >= 4
+        return SUB_BUCKETS + (msb - 4) * SUB_BUCKETS + ((value >> (msb - 4)) - SUB_BUCKETS);
+    }
+
+    // the highest value associated to the given bucket
+    static uint64_t upper_bound(uint64_t bucket){
+        if(bucket < SUB_BUCKETS) return bucket;
+        uint64_t shift = (bucket - SUB_BUCKETS) / SUB_BUCKETS;
+        uint64_t offset = (bucket - SUB_BUCKETS) % SUB_BUCKETS;
+        return ((SUB_BUCKETS + offset + 1) << shift) -1;
+    }
+
+public:
+    LatencyHistogram(){ reset(); }
+
+    void add(uint64_t latency){
+        m_buckets[bucket_of(latency)]++;
+        m_count++;
+        m_max = max(m_max, latency);
+    }
+
+    void merge(const LatencyHistogram& other){
+        for(uint64_t i = 0; i < NUM_BUCKETS; i++){ m_buckets[i] += other.m_buckets[i]; }
+        m_count += other.m_count;
+        m_max = max(m_max, other.m_max);
+    }
+
+    void reset(){
+        fill(begin(m_buckets), end(m_buckets), 0);
+        m_count = 0;
+        m_max = 0;
+    }
+
+    // Retrieve the given quantile, in (0, 1]
+    uint64_t quantile(double q) const {
+        if(m_count == 0) return 0;
+        uint64_t target = max<uint64_t>(1, static_cast<uint64_t>(q * m_count));
+        uint64_t cumulative = 0;
+        for(uint64_t i = 0; i < NUM_BUCKETS; i++){
+            cumulative += m_buckets[i];
+            if(cumulative >= target) return min(upper_bound(i), m_max);
+        }
+        return m_max;
+    }
+
+    uint64_t max_latency() const { return m_max; }
+};
+
 struct Task {
     enum class Type { UPDATE, SCAN_ALL };
     Type m_type;
@@ -101,6 +164,7 @@ static Task* _task_stop = reinterpret_cast<Task*>(0x01);
 class ExperimentParallelIDLSThread {
 public:
     uint64_t m_scan_elements = 0;
+    LatencyHistogram m_latencies; // the latencies of the updates
 private:
     thread m_handle;
     data_structures::Interface* m_interface;
@@ -158,6 +222,7 @@ private:
             distribution->fetch(keys);
             while(keys.size() > 0){
                 for(int64_t key : keys){
+                    auto t0 = chrono::steady_clock::now();
                     if(key >= 0){ // insertion
                         COUT_DEBUG("Insert " << key);
                         m_interface->insert(key, key);
@@ -166,6 +231,7 @@ private:
                         COUT_DEBUG("Remove " << key);
                         m_interface->remove(key);
                     }
+                    m_latencies.add(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - t0).count());
                 }
 
                 // fetch the next chunk of keys to insert
@@ -332,6 +398,7 @@ void ParallelIDLS::run() {
     m_keys_experiment.unset_preparation_step(); // release some memory
     uint64_t num_initial_scan_elts = 0;
     for(auto scanner : m_scan_threads){ num_initial_scan_elts += scanner->m_scan_elements; scanner->m_scan_elements = 0;/* reset */ }
+    for(auto inserter : m_insert_threads){ inserter->m_latencies.reset(); }
 
     double seconds = t_initial_inserts.microseconds() * 1000 * 1000;
     LOG_VERBOSE("Initial step: " << N_initial_inserts << " insertions. Elapsed time: " << seconds << " seconds, "
@@ -345,9 +412,16 @@ void ParallelIDLS::run() {
     m_keys_experiment.unset_insdel_step(); // release some additional memory
     uint64_t num_bulk_scan_elts = 0;
     for(auto scanner : m_scan_threads){ num_bulk_scan_elts += scanner->m_scan_elements; scanner->m_scan_elements = 0;/* reset */ }
+    LatencyHistogram latencies;
+    for(auto inserter : m_insert_threads){ latencies.merge(inserter->m_latencies); }
     LOG_VERBOSE("Update step: " << N_insdel << " updates in sequences of " << N_consecutive_operations << " operations. Elapsed time: " << seconds << " seconds, "
             "insertion throughput (" << m_insert_threads.size() << " threads): " << N_insdel / seconds << ", "
             "scan throughput (" << m_scan_threads.size() << " threads): " << num_initial_scan_elts / seconds );
+    LOG_VERBOSE("Update step, latency: p50 " << latencies.quantile(0.5) << " nanosecs, p99 " << latencies.quantile(0.99) << " nanosecs, "
+            "max " << latencies.max_latency() << " nanosecs");
+    size_t memory_reserved = m_data_structure->memory_footprint();
+    size_t memory_resident = m_data_structure->memory_footprint_resident();
+    LOG_VERBOSE("Update step, memory footprint: reserved " << to_string_with_unit_suffix(memory_reserved) << ", resident " << to_string_with_unit_suffix(memory_resident));
 
 
     config().db()->add("parallel_idls")
@@ -357,6 +431,11 @@ void ParallelIDLS::run() {
                     ("updates", N_insdel)
                     ("t_updates_millisecs", t_updates.milliseconds<uint64_t>())
                     ("scan_updates", num_bulk_scan_elts)
+                    ("latency_p50_nanosecs", latencies.quantile(0.5))
+                    ("latency_p99_nanosecs", latencies.quantile(0.99))
+                    ("latency_max_nanosecs", latencies.max_latency())
+                    ("memory_reserved_bytes", memory_reserved)
+                    ("memory_resident_bytes", memory_resident)
                     ;
 
 
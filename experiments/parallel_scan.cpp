@@ -30,6 +30,7 @@
 #include "data_structures/interface.hpp"
 #include "data_structures/iterator.hpp"
 #include "data_structures/parallel.hpp"
+#include "data_structures/snapshot.hpp"
 #include "distributions/driver.hpp"
 #include "distributions/interface.hpp"
 
@@ -165,8 +166,8 @@ void execute_workload(int worker_id, data_structures::Interface* data_structure,
 
 
 
-ParallelScan::ParallelScan(shared_ptr<data_structures::Interface> data_structure, std::chrono::seconds execution_time) :
-m_data_structure(data_structure), m_execution_time(execution_time) {
+ParallelScan::ParallelScan(shared_ptr<data_structures::Interface> data_structure, std::chrono::seconds execution_time, const string& load_snapshot, const string& save_snapshot) :
+m_data_structure(data_structure), m_execution_time(execution_time), m_load_snapshot(load_snapshot), m_save_snapshot(save_snapshot) {
     if(execution_time.count() <= 0) RAISE("[ExperimentParallelScan::ctor] The execution time per simulation is zero");
 }
 
@@ -177,14 +178,23 @@ void ParallelScan::preprocess() {
     if(m_data_structure->size() > 0)
         RAISE("The data structure is not empty. Size: " << m_data_structure->size());
 
-    // initialize the elements that we need to add
-    LOG_VERBOSE("Generating the set of elements to insert ... ");
-    auto distribution = distributions::generate_distribution();
-
 #if defined(HAVE_LIBNUMA)
     pin_thread_to_numa_node(0);
 #endif
 
+    // skip the generation and the insertion of the elements, reload them from a previous run
+    if(!m_load_snapshot.empty()){
+        auto snapshot = data_structures::load_snapshot(m_data_structure.get(), m_load_snapshot);
+        bool is_dense = snapshot.m_num_elements > 0 && static_cast<uint64_t>(snapshot.m_max_key - snapshot.m_min_key) +1 == snapshot.m_num_elements;
+        init_keys(is_dense, snapshot.m_min_key);
+        unpin_thread();
+        return;
+    }
+
+    // initialize the elements that we need to add
+    LOG_VERBOSE("Generating the set of elements to insert ... ");
+    auto distribution = distributions::generate_distribution();
+
     // Insert the elements in the data structure
     int64_t key_min = numeric_limits<int64_t>::max();
     auto data_structure = m_data_structure.get();
@@ -241,19 +251,27 @@ void ParallelScan::preprocess() {
         LOG_VERBOSE("# Build time: " << timer_build.milliseconds() << " millisecs");
     }
 
-    // Container for the keys
+    // Save the elements inserted for the next runs
+    if(!m_save_snapshot.empty()){
+        data_structures::save_snapshot(data_structure, m_save_snapshot);
+    }
+
+    init_keys(distribution->is_dense(), key_min);
+
+    unpin_thread();
+}
+
+void ParallelScan::init_keys(bool is_dense, int64_t key_min){
     Timer timer_container(true);
-    if(distribution->is_dense()){
-        m_keys.reset(new ContainerKeysDense(key_min, data_structure->size()));
+    if(is_dense){
+        m_keys.reset(new ContainerKeysDense(key_min, m_data_structure->size()));
     } else {
-        m_keys.reset(new ContainerKeysSparse(data_structure));
+        m_keys.reset(new ContainerKeysSparse(m_data_structure.get()));
     }
     timer_container.stop();
     if(timer_container.milliseconds() > 0){
         LOG_VERBOSE("# Key mapping time: " << timer_container.milliseconds() << " millisecs");
     }
-
-    unpin_thread();
 }
 
 static void log_execution_start(int numa_node, const vector<int>& cpu_ids, int num_threads){
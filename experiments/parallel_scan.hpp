@@ -20,6 +20,7 @@
 #include <chrono>
 #include <cstdint>
 #include <memory>
+#include <string>
 #include <vector>
 
 #include "interface.hpp"
@@ -33,6 +34,11 @@ class ParallelScan : public Interface {
     std::shared_ptr<data_structures::Interface> m_data_structure; // the data structure to evaluate
     const std::chrono::seconds m_execution_time; // the amount of time to run each experiment
     std::unique_ptr<ContainerKeys> m_keys; // map the keys contained in the pma
+    const std::string m_load_snapshot; // if not empty, path to the snapshot to load in place of the initial insertions
+    const std::string m_save_snapshot; // if not empty, path where to save the content of the data structure after the initial insertions
+
+    // Initialise the container of the keys, to validate the scans
+    void init_keys(bool is_dense, int64_t key_min);
 
 protected:
     void preprocess() override;
@@ -46,7 +52,7 @@ protected:
     void run() override;
 
 public:
-    ParallelScan(std::shared_ptr<data_structures::Interface> data_structure, std::chrono::seconds execution_time);
+    ParallelScan(std::shared_ptr<data_structures::Interface> data_structure, std::chrono::seconds execution_time, const std::string& load_snapshot = "", const std::string& save_snapshot = "");
 
     virtual ~ParallelScan();
 };
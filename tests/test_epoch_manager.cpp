@@ -0,0 +1,99 @@
+/**
+ * Copyright (C) 2018 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <atomic>
+#include <cinttypes>
+#include <thread>
+#include <vector>
+
+#define CATCH_CONFIG_MAIN
+#include "third-party/catch/catch.hpp"
+
+#include "common/epoch_manager.hpp"
+
+using namespace common;
+using namespace std;
+
+TEST_CASE("sanity"){
+    EpochManager epochs { /* advance threshold */ 4 };
+    epochs.resize(2);
+    REQUIRE(epochs.size() == 2);
+    REQUIRE(epochs.min_epoch() == EpochManager::NO_EPOCH); // no thread is active
+
+    uint64_t e0 = epochs.enter(0);
+    REQUIRE(e0 == epochs.current());
+    REQUIRE(epochs.epoch(0) == e0);
+    REQUIRE(epochs.epoch(1) == EpochManager::NO_EPOCH);
+    REQUIRE(epochs.min_epoch() == e0);
+
+    // an object retired now cannot be released while the thread #0 is still active
+    uint64_t r0 = epochs.retire();
+    REQUIRE(r0 == e0);
+    REQUIRE(!(r0 < epochs.min_epoch()));
+
+    // the thread #1 joins in a later epoch
+    uint64_t e1 = epochs.advance();
+    REQUIRE(e1 == e0 +1);
+    REQUIRE(epochs.enter(1) == e1);
+    REQUIRE(epochs.min_epoch() == e0);
+
+    // the thread #0 rejoins, the object can be released
+    REQUIRE(epochs.enter(0) == e1);
+    REQUIRE(r0 < epochs.min_epoch());
+    epochs.exit(0);
+    epochs.exit(1);
+    REQUIRE(epochs.min_epoch() == EpochManager::NO_EPOCH);
+
+    // the global epoch is advanced once every 4 retired objects
+    uint64_t current = epochs.current();
+    epochs.retire(); epochs.retire(); // 3 retired objects overall
+    REQUIRE(epochs.current() == current);
+    REQUIRE(epochs.retire() == current); // 4th
+    REQUIRE(epochs.current() == current +1);
+
+    REQUIRE_THROWS(epochs.resize(EpochManager::MAX_NUM_SLOTS +1));
+}
+
+TEST_CASE("multiple_threads"){
+    constexpr uint64_t num_threads = 8;
+    constexpr uint64_t num_iterations = 100000;
+    EpochManager epochs;
+    epochs.resize(num_threads);
+    atomic<uint64_t> num_errors = 0; // Catch is not thread safe
+    atomic<bool> done = false;
+
+    // the epochs announced are never older than the minimum epoch observed before entering
+    auto worker = [&](uint64_t thread_id){
+        for(uint64_t i = 0; i < num_iterations; i++){
+            uint64_t lower_bound = epochs.current();
+            uint64_t epoch = epochs.enter(thread_id);
+            if(epoch < lower_bound || epochs.epoch(thread_id) != epoch || epochs.min_epoch() > epoch){ num_errors++; }
+            if(i % 16 == 0){ epochs.retire(); }
+            epochs.exit(thread_id);
+        }
+    };
+    thread gc ([&](){ while(!done){ epochs.advance(); this_thread::yield(); } });
+
+    vector<thread> threads;
+    for(uint64_t i = 0; i < num_threads; i++){ threads.emplace_back(worker, i); }
+    for(auto& t : threads){ t.join(); }
+    done = true;
+    gc.join();
+
+    REQUIRE(num_errors == 0);
+    REQUIRE(epochs.min_epoch() == EpochManager::NO_EPOCH);
+}
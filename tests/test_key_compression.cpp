@@ -0,0 +1,92 @@
+/**
+ * Copyright (C) 2018 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cinttypes>
+#include <limits>
+#include <random>
+#include <vector>
+
+#define CATCH_CONFIG_MAIN
+#include "third-party/catch/catch.hpp"
+
+#include "rma/common/key_compression.hpp"
+
+using namespace data_structures::rma::common;
+using namespace std;
+
+// Encode the given sorted keys and check they can be retrieved back
+static void validate(const vector<int64_t>& keys, uint64_t expected_bit_width){
+    REQUIRE(KeyCompression::bit_width(keys.data(), keys.size()) == expected_bit_width);
+    vector<uint64_t> compressed(KeyCompression::compressed_size(keys.size(), expected_bit_width));
+    REQUIRE(KeyCompression::encode(keys.data(), keys.size(), compressed.data()) == compressed.size());
+
+    vector<int64_t> decoded(keys.size());
+    KeyCompression::decode(compressed.data(), keys.size(), decoded.data());
+    REQUIRE(decoded == keys);
+
+    int64_t sum = 0;
+    for(uint64_t i = 0; i < keys.size(); i++){
+        REQUIRE(KeyCompression::get(compressed.data(), i) == keys[i]);
+        sum += keys[i];
+    }
+    REQUIRE(KeyCompression::sum(compressed.data(), keys.size()) == sum);
+
+    for(uint64_t i = 0; i < keys.size(); i++){
+        REQUIRE(KeyCompression::lower_bound(compressed.data(), keys.size(), keys[i]) == static_cast<uint64_t>(lower_bound(begin(keys), end(keys), keys[i]) - begin(keys)));
+        if(keys[i] < numeric_limits<int64_t>::max()){
+            int64_t next = keys[i] +1;
+            REQUIRE(KeyCompression::lower_bound(compressed.data(), keys.size(), next) == static_cast<uint64_t>(lower_bound(begin(keys), end(keys), next) - begin(keys)));
+        }
+    }
+}
+
+TEST_CASE("corner_cases"){
+    validate({}, 0);
+    validate({ 42 }, 0);
+    validate({ -7, -7, -7, -7 }, 0); // all deltas are zero
+    validate({ 0, 1 }, 1);
+    validate({ numeric_limits<int64_t>::min(), -1, 0, numeric_limits<int64_t>::max() }, 64);
+}
+
+TEST_CASE("bit_widths"){
+    // every width, with runs long enough to have the deltas straddling two words
+    mt19937_64 random { 42 };
+    for(uint64_t width = 1; width <= 64; width++){
+        for(uint64_t num_keys : { 2, 63, 64, 65, 255 }){
+            const uint64_t max_delta = width == 64 ? numeric_limits<uint64_t>::max() : (1ull << width) -1;
+            const int64_t base = width == 64 ? numeric_limits<int64_t>::min() : numeric_limits<int64_t>::min() / 2;
+            vector<int64_t> keys(num_keys);
+            for(auto& key : keys){
+                key = static_cast<int64_t>(static_cast<uint64_t>(base) + (width == 64 ? random() : random() % (max_delta + 1)));
+            }
+            keys[0] = base; keys[1] = static_cast<int64_t>(static_cast<uint64_t>(base) + max_delta);
+            sort(begin(keys), end(keys));
+            validate(keys, width);
+        }
+    }
+}
+
+TEST_CASE("compression_ratio"){
+    // dense keys, as in a segment of a PMA loaded with consecutive keys, need a byte per key or less
+    vector<int64_t> keys(64);
+    for(uint64_t i = 0; i < keys.size(); i++){ keys[i] = 1000000000ll + i * 3; }
+    uint64_t width = KeyCompression::bit_width(keys.data(), keys.size());
+    REQUIRE(width == 8);
+    REQUIRE(KeyCompression::compressed_size(keys.size(), width) * 8 <= keys.size() * sizeof(int64_t) / 4);
+    validate(keys, width);
+}
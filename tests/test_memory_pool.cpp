@@ -0,0 +1,127 @@
+/**
+ * Copyright (C) 2018 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <atomic>
+#include <cinttypes>
+#include <thread>
+#include <vector>
+
+#define CATCH_CONFIG_MAIN
+#include "third-party/catch/catch.hpp"
+
+#include "rma/common/memory_pool.hpp"
+
+using namespace data_structures::rma::common;
+using namespace std;
+
+TEST_CASE("sanity"){
+    CachedMemoryPool_ThreadLocal pool { /* global capacity */ 4096, /* num arenas */ 2, /* arena capacity */ 1024 };
+    REQUIRE(pool.empty());
+
+    int64_t* ptr1 = pool.allocate<int64_t>(10); // arena
+    int64_t* ptr2 = pool.allocate<int64_t>(200); // global pool
+    int64_t* ptr3 = pool.allocate<int64_t>(1000); // malloc
+    for(int64_t i = 0; i < 10; i++) ptr1[i] = i;
+    for(int64_t i = 0; i < 200; i++) ptr2[i] = i;
+    for(int64_t i = 0; i < 1000; i++) ptr3[i] = i;
+    REQUIRE(!pool.empty());
+
+    auto stats = pool.get_statistics();
+    REQUIRE(stats.m_num_arenas == 2);
+    REQUIRE(stats.m_num_arenas_owned == 1);
+    REQUIRE(stats.m_arena_allocations == 1);
+    REQUIRE(stats.m_arena_high_water_mark == 80);
+    REQUIRE(stats.m_global_allocations == 2);
+    REQUIRE(stats.m_global_high_water_mark == 1600);
+    REQUIRE(stats.m_malloc_allocations == 1);
+
+    pool.deallocate(ptr1);
+    pool.deallocate(ptr2);
+    pool.deallocate(ptr3);
+    REQUIRE(pool.empty());
+
+    // the bump pointer of the arena is rewound once all its allocations are released
+    int64_t* ptr4 = pool.allocate<int64_t>(10);
+    REQUIRE(ptr4 == ptr1);
+    pool.deallocate(ptr4);
+    REQUIRE(pool.empty());
+}
+
+TEST_CASE("allocator"){
+    CachedMemoryPool_ThreadLocal pool { /* global capacity */ 1 << 20, /* num arenas */ 2, /* arena capacity */ 1 << 16 };
+    {
+        vector<int64_t, CachedAllocator_ThreadLocal<int64_t>> elements { pool.allocator<int64_t>() };
+        for(int64_t i = 0; i < 10000; i++){ elements.push_back(i); } // both the arena and the global pool
+        for(int64_t i = 0; i < 10000; i++){ REQUIRE(elements[i] == i); }
+        REQUIRE(!pool.empty());
+    }
+    auto stats = pool.get_statistics();
+    REQUIRE(stats.m_arena_allocations > 0);
+    REQUIRE(stats.m_global_allocations > 0);
+    REQUIRE(stats.m_malloc_allocations == 0);
+    REQUIRE(pool.empty());
+}
+
+TEST_CASE("release_from_other_threads"){
+    CachedMemoryPool_ThreadLocal pool { /* global capacity */ 4096, /* num arenas */ 2, /* arena capacity */ 1024 };
+
+    int64_t* ptr1 = pool.allocate<int64_t>(10);
+    int64_t* ptr2 = pool.allocate<int64_t>(10);
+    REQUIRE(ptr2 > ptr1);
+    thread([&](){ pool.deallocate(ptr1); pool.deallocate(ptr2); }).join();
+    REQUIRE(pool.empty());
+
+    int64_t* ptr3 = pool.allocate<int64_t>(10);
+    REQUIRE(ptr3 == ptr1);
+    pool.deallocate(ptr3);
+}
+
+TEST_CASE("multiple_threads"){
+    constexpr uint64_t num_threads = 8;
+    constexpr uint64_t num_arenas = 4;
+    constexpr uint64_t num_iterations = 10000;
+    CachedMemoryPool_ThreadLocal pool { /* global capacity */ 1 << 20, num_arenas, /* arena capacity */ 1 << 16 };
+    atomic<uint64_t> num_errors = 0; // Catch is not thread safe
+
+    auto worker = [&](uint64_t thread_id){
+        vector<uint64_t*> allocations;
+        for(uint64_t i = 0; i < num_iterations; i++){
+            uint64_t* ptr = pool.allocate<uint64_t>(1 + i % 16);
+            for(uint64_t j = 0; j < 1 + i % 16; j++){ ptr[j] = thread_id; }
+            allocations.push_back(ptr);
+            if(allocations.size() == 32){
+                for(auto ptr : allocations){ if(ptr[0] != thread_id){ num_errors++; } pool.deallocate(ptr); }
+                allocations.clear();
+            }
+        }
+        for(auto ptr : allocations){ pool.deallocate(ptr); }
+    };
+
+    vector<thread> threads;
+    for(uint64_t i = 0; i < num_threads; i++){ threads.emplace_back(worker, i); }
+    for(auto& t : threads){ t.join(); }
+    REQUIRE(num_errors == 0);
+    REQUIRE(pool.empty());
+
+    auto stats = pool.get_statistics();
+    REQUIRE(stats.m_num_arenas_owned <= num_arenas);
+    REQUIRE(stats.m_arena_allocations + stats.m_global_allocations == num_threads * num_iterations);
+
+    // the arenas of the terminated threads are claimed again by the new threads
+    thread([&](){ pool.deallocate(pool.allocate<uint64_t>(1)); }).join();
+    REQUIRE(pool.get_statistics().m_arena_allocations == stats.m_arena_allocations +1);
+}
@@ -0,0 +1,124 @@
+/**
+ * Copyright (C) 2018 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cinttypes>
+#include <thread>
+#include <vector>
+
+#define CATCH_CONFIG_MAIN
+#include "third-party/catch/catch.hpp"
+
+#include "common/mpsc_queue.hpp"
+
+using namespace common;
+using namespace std;
+
+TEST_CASE("sanity"){
+    int64_t a = 0; // temporary variable
+    MPSCQueue<int64_t> Q;
+    REQUIRE(Q.empty() == true);
+    REQUIRE(Q.pop(a) == false);
+
+    for(int64_t i = 1; i <= 10; i++){ Q.push(i); }
+    REQUIRE(!Q.empty());
+
+    for(int64_t i = 1; i <= 5; i++){
+        REQUIRE(Q.pop(a) == true);
+        REQUIRE(a == i);
+    }
+
+    Q.push(11);
+    for(int64_t i = 6; i <= 11; i++){
+        REQUIRE(Q.pop(a) == true);
+        REQUIRE(a == i);
+    }
+    REQUIRE(Q.empty() == true);
+    REQUIRE(Q.pop(a) == false);
+
+    // leave some elements in the queue, they should be released by the dtor
+    Q.push(12);
+    Q.push(13);
+}
+
+TEST_CASE("multiple_producers"){
+    constexpr uint64_t num_producers = 8;
+    constexpr uint64_t num_elts_per_producer = 100000;
+    MPSCQueue<uint64_t> Q;
+
+    vector<thread> producers;
+    for(uint64_t producer_id = 0; producer_id < num_producers; producer_id++){
+        producers.emplace_back([&Q, producer_id](){
+            for(uint64_t i = 0; i < num_elts_per_producer; i++){
+                Q.push(producer_id * num_elts_per_producer + i);
+            }
+        });
+    }
+
+    // the elements from the same producer must be retrieved in order
+    vector<uint64_t> next(num_producers, 0);
+    uint64_t num_elts_popped = 0;
+    while(num_elts_popped < num_producers * num_elts_per_producer){
+        uint64_t value;
+        if(!Q.pop(value)) continue;
+        uint64_t producer_id = value / num_elts_per_producer;
+        REQUIRE(producer_id < num_producers);
+        REQUIRE(value % num_elts_per_producer == next[producer_id]);
+        next[producer_id]++;
+        num_elts_popped++;
+    }
+
+    for(auto& t : producers) t.join();
+    REQUIRE(Q.empty());
+    for(uint64_t producer_id = 0; producer_id < num_producers; producer_id++){
+        REQUIRE(next[producer_id] == num_elts_per_producer);
+    }
+}
+
+TEST_CASE("recycled_nodes"){
+    // the producers keep acquiring the nodes released by the consumer, while the consumer keeps releasing new ones
+    constexpr uint64_t num_producers = 4;
+    constexpr uint64_t num_rounds = 8;
+    constexpr uint64_t num_elts_per_producer = 50000;
+    MPSCQueue<uint64_t> Q;
+
+    for(uint64_t round = 0; round < num_rounds; round++){
+        vector<thread> producers;
+        for(uint64_t producer_id = 0; producer_id < num_producers; producer_id++){
+            producers.emplace_back([&Q, producer_id](){
+                for(uint64_t i = 0; i < num_elts_per_producer; i++){
+                    Q.push(producer_id * num_elts_per_producer + i);
+                    if(i % 64 == 0) this_thread::yield(); // let the consumer release some nodes
+                }
+            });
+        }
+
+        vector<uint64_t> next(num_producers, 0);
+        uint64_t num_elts_popped = 0;
+        while(num_elts_popped < num_producers * num_elts_per_producer){
+            uint64_t value;
+            if(!Q.pop(value)) continue;
+            uint64_t producer_id = value / num_elts_per_producer;
+            REQUIRE(producer_id < num_producers);
+            REQUIRE(value % num_elts_per_producer == next[producer_id]);
+            next[producer_id]++;
+            num_elts_popped++;
+        }
+
+        for(auto& t : producers) t.join();
+        REQUIRE(Q.empty());
+    }
+}
@@ -18,9 +18,18 @@
 #define CATCH_CONFIG_MAIN
 #include "third-party/catch/catch.hpp"
 
+#include <cstring>
+#include <limits>
+#include <memory>
+#if defined(HAVE_LIBNUMA)
+#include <numa.h>
+#include <numaif.h>
+#endif
+
 #include "common/miscellaneous.hpp"
 #include "rma/common/buffered_rewired_memory.hpp"
 #include "rma/common/rewired_memory.hpp"
+#include "rma/common/rewiring_cost_model.hpp"
 
 using namespace common;
 using namespace data_structures::rma::common;
@@ -141,3 +150,334 @@ TEST_CASE("acquire_buffer"){
 
     REQUIRE(rmem.get_used_buffers() == 0); // all employed buffers should have been released
 }
+
+TEST_CASE("release_buffer"){
+    constexpr size_t extent_const = 3;
+    constexpr size_t num_extents = 4;
+    BufferedRewiredMemory rmem { extent_const, num_extents };
+    uint64_t* array = (uint64_t*) rmem.get_start_address();
+    array[0] = 1;
+
+    // copy the content of the buffer back in place, rather than rewiring it
+    uint64_t* buffer = (uint64_t*) rmem.acquire_buffer();
+    REQUIRE(rmem.get_used_buffers() == 1);
+    buffer[0] = 2;
+    memcpy(array, buffer, rmem.get_extent_size());
+    rmem.release_buffer(buffer);
+    REQUIRE(rmem.get_used_buffers() == 0);
+    REQUIRE(array[0] == 2);
+
+    // the same buffer is handed out again
+    REQUIRE(rmem.acquire_buffer() == buffer);
+
+    // not a buffer
+    REQUIRE_THROWS(rmem.release_buffer(array));
+}
+
+TEST_CASE("trim"){
+    constexpr size_t extent_const = 3;
+    constexpr size_t num_extents = 8;
+    BufferedRewiredMemory rmem { extent_const, num_extents };
+    const size_t extent_size = rmem.get_extent_size();
+    uint64_t* array = (uint64_t*) rmem.get_start_address();
+    memset(array, 0xFF, num_extents * extent_size);
+
+    // recycle half of the extents as buffer space, retain only one of them
+    rmem.set_retained_buffers(1);
+    size_t resident_before = rmem.get_resident_memory_size();
+    REQUIRE(resident_before >= num_extents * extent_size);
+    rmem.shrink(num_extents / 2);
+    REQUIRE(rmem.get_total_buffers() == num_extents / 2);
+    REQUIRE(rmem.get_used_buffers() == 0);
+    REQUIRE(rmem.get_resident_memory_size() == resident_before - (num_extents / 2 - 1) * extent_size);
+
+    // the extents still in use are untouched
+    for(size_t i = 0; i < (num_extents / 2) * extent_size / sizeof(uint64_t); i++){
+        REQUIRE(array[i] == numeric_limits<uint64_t>::max());
+    }
+
+    // the released buffers can still be acquired, their memory is allocated again on the first access
+    uint64_t* buffers[num_extents / 2];
+    for(size_t i = 0; i < num_extents / 2; i++){
+        buffers[i] = (uint64_t*) rmem.acquire_buffer();
+        buffers[i][0] = i;
+    }
+    REQUIRE(rmem.get_used_buffers() == num_extents / 2);
+    REQUIRE(rmem.get_total_buffers() == num_extents / 2); // no need to allocate new buffers
+    for(size_t i = 0; i < num_extents / 2; i++){
+        rmem.swap_and_release(array + i * extent_size / sizeof(uint64_t), buffers[i]);
+        REQUIRE(array[i * extent_size / sizeof(uint64_t)] == i);
+    }
+    REQUIRE(rmem.get_used_buffers() == 0);
+
+    // release all the free buffers
+    rmem.set_retained_buffers(0);
+    rmem.trim();
+    REQUIRE(rmem.get_used_buffers() == 0);
+    REQUIRE(rmem.get_resident_memory_size() <= (num_extents / 2) * extent_size);
+}
+
+TEST_CASE("prefault"){
+    constexpr size_t extent_const = 3;
+    constexpr size_t num_extents = 8;
+    constexpr size_t num_buffers = 4;
+    BufferedRewiredMemory rmem { extent_const, num_extents };
+    const size_t extent_size = rmem.get_extent_size();
+    uint64_t* array = (uint64_t*) rmem.get_start_address();
+    memset(array, 0xFF, num_extents * extent_size);
+    REQUIRE(rmem.get_resident_memory_size() == num_extents * extent_size);
+
+    // the buffer space is extended and populated
+    REQUIRE(rmem.prefault_buffers(num_buffers) == num_buffers);
+    REQUIRE(rmem.get_total_buffers() == num_buffers);
+    REQUIRE(rmem.get_resident_memory_size() == (num_extents + num_buffers) * extent_size);
+    REQUIRE(rmem.prefault_buffers(num_buffers) == 0); // already populated
+
+    // a buffer released in the meanwhile is the only one populated again
+    void* buffer = rmem.acquire_buffer();
+    rmem.release_buffer(buffer);
+    REQUIRE(rmem.prefault_buffers(num_buffers) == 1);
+    REQUIRE(rmem.prefault_buffers(num_buffers) == 0);
+
+    // the workers can fill the buffers without faulting them in
+    uint64_t* buffers[num_buffers];
+    rmem.acquire_buffers((void**) buffers, num_buffers);
+    uint64_t page_faults_t0 = get_thread_page_faults();
+    for(size_t i = 0; i < num_buffers; i++){ memset(buffers[i], i, extent_size); }
+    REQUIRE(get_thread_page_faults() == page_faults_t0);
+    for(size_t i = 0; i < num_buffers; i++){ rmem.release_buffer(buffers[i]); }
+
+    // the buffers returned to the OS are reclaimed first
+    rmem.set_retained_buffers(0);
+    rmem.trim();
+    REQUIRE(rmem.get_resident_memory_size() == num_extents * extent_size);
+    REQUIRE(rmem.prefault_buffers(num_buffers / 2) == num_buffers / 2);
+    REQUIRE(rmem.get_total_buffers() == num_buffers);
+    REQUIRE(rmem.get_resident_memory_size() == (num_extents + num_buffers / 2) * extent_size);
+
+    // the extents added by extending the memory in place
+    rmem.extend(num_buffers * 2, /* prefault ? */ true);
+    REQUIRE(rmem.get_total_buffers() == 0);
+    REQUIRE(rmem.get_resident_memory_size() == (num_extents + num_buffers * 2) * extent_size);
+
+    // the content of the extents in use is not altered
+    for(size_t i = 0; i < num_extents * extent_size / sizeof(uint64_t); i++){
+        REQUIRE(array[i] == numeric_limits<uint64_t>::max());
+    }
+}
+
+TEST_CASE("huge_pages"){
+    // whether the kernel grants the huge pages depends on its configuration, only check the reported coverage is consistent
+    double coverage = RewiredMemory::probe_huge_pages();
+    REQUIRE(coverage >= 0.0);
+    REQUIRE(coverage <= 1.0);
+
+    RewiredMemory rmem { /* pages per extent */ 4, /* num extents */ 4 };
+    memset(rmem.get_start_address(), 0xFF, rmem.get_allocated_memory_size());
+    rmem.swap(rmem.get_start_address(), (char*) rmem.get_start_address() + rmem.get_extent_size());
+    REQUIRE(rmem.get_huge_page_memory_size() <= rmem.get_resident_memory_size());
+}
+
+TEST_CASE("swap_many"){
+    constexpr size_t extent_const = 3;
+    constexpr size_t num_extents = 8;
+    BufferedRewiredMemory rmem { extent_const, num_extents };
+    const size_t values_per_extent = rmem.get_extent_size() / sizeof(uint64_t);
+    uint64_t* array = (uint64_t*) rmem.get_start_address();
+    for(size_t i = 0; i < num_extents * values_per_extent; i++){ array[i] = i; }
+
+    // a contiguous run of buffers into a contiguous run of extents: one mmap for the extents, one for the buffers
+    constexpr size_t num_buffers = 4;
+    uint64_t* buffers[num_buffers];
+    rmem.acquire_buffers((void**) buffers, num_buffers);
+    REQUIRE(rmem.get_used_buffers() == num_buffers);
+    pair<void*, void*> pairs[num_buffers];
+    for(size_t i = 0; i < num_buffers; i++){
+        if(i > 0){ REQUIRE(buffers[i] == buffers[i -1] + values_per_extent); }
+        buffers[i][0] = numeric_limits<uint64_t>::max() - i;
+        pairs[i] = make_pair(array + (i +2) * values_per_extent, buffers[i]);
+    }
+    REQUIRE(rmem.swap_and_release_many(pairs, num_buffers) == 2);
+    REQUIRE(rmem.get_used_buffers() == 0);
+    for(size_t i = 0; i < num_extents; i++){
+        if(i >= 2 && i < 2 + num_buffers){
+            REQUIRE(array[i * values_per_extent] == numeric_limits<uint64_t>::max() - (i -2));
+        } else {
+            REQUIRE(array[i * values_per_extent] == i * values_per_extent);
+        }
+        REQUIRE(array[i * values_per_extent +1] == (i >= 2 && i < 2 + num_buffers ? 0 : i * values_per_extent +1));
+    }
+
+    // the buffers are acquired again as a single run, holding the old content of the extents
+    rmem.acquire_buffers((void**) buffers, num_buffers);
+    for(size_t i = 0; i < num_buffers; i++){
+        if(i > 0){ REQUIRE(buffers[i] == buffers[i -1] + values_per_extent); }
+        REQUIRE(buffers[i][0] == (i +2) * values_per_extent);
+    }
+
+    // neither the extents nor the physical memory of the buffers are contiguous, one mmap each
+    for(size_t i = 0; i < num_buffers; i++){
+        buffers[i][1] = i;
+        pairs[i] = make_pair(array + (i * 2) * values_per_extent, buffers[i]);
+    }
+    REQUIRE(rmem.swap_and_release_many(pairs, num_buffers) == 2 * num_buffers);
+    for(size_t i = 0; i < num_buffers; i++){
+        REQUIRE(array[(i * 2) * values_per_extent +1] == i);
+    }
+
+    // an extent can be part of only a single pair
+    pairs[0] = make_pair(array, buffers[0]);
+    pairs[1] = make_pair(array, buffers[1]);
+    REQUIRE_THROWS_AS(rmem.swap_and_release_many(pairs, 2), const RewiredMemoryException&);
+}
+
+TEST_CASE("numa_policy"){
+    constexpr size_t extent_const = 3;
+    constexpr size_t num_extents = 8;
+    BufferedRewiredMemory rmem { extent_const, num_extents };
+    const size_t values_per_extent = rmem.get_extent_size() / sizeof(uint64_t);
+    uint64_t* array = (uint64_t*) rmem.get_start_address();
+    for(size_t i = 0; i < num_extents * values_per_extent; i++){ array[i] = i; }
+    const int64_t num_nodes = get_numa_max_node() +1; // 0 if libnuma is not available
+
+    for(auto policy : { NumaPolicy::INTERLEAVED, NumaPolicy::OWNER, NumaPolicy::PARTITIONED, NumaPolicy::NONE }){
+        rmem.set_numa_policy(policy, /* owner node */ 0);
+        REQUIRE(rmem.get_numa_policy() == policy);
+
+        // the resident pages are migrated, not discarded
+        for(size_t i = 0; i < num_extents * values_per_extent; i++){ REQUIRE(array[i] == i); }
+
+        for(size_t extent_id = 0; extent_id < num_extents; extent_id++){
+            int expected = -1;
+            if(policy == NumaPolicy::OWNER && num_nodes > 0){
+                expected = 0;
+            } else if(policy == NumaPolicy::PARTITIONED && num_nodes > 0){
+                for(int64_t node = 0; node < num_nodes; node++){
+                    if(extent_id >= num_extents * node / num_nodes && extent_id < num_extents * (node +1) / num_nodes){ expected = node; }
+                }
+            }
+            REQUIRE(rmem.get_numa_node(extent_id) == expected);
+        }
+    }
+
+    // the policy is applied again to the new extents and to the buffers rewired in place
+    rmem.set_numa_policy(NumaPolicy::PARTITIONED);
+    uint64_t* buffer = (uint64_t*) rmem.acquire_buffer();
+    for(size_t i = 0; i < values_per_extent; i++){ buffer[i] = numeric_limits<uint64_t>::max(); }
+    rmem.swap_and_release(array, buffer);
+    REQUIRE(array[0] == numeric_limits<uint64_t>::max());
+    REQUIRE(array[values_per_extent] == values_per_extent);
+    rmem.extend(num_extents);
+    REQUIRE(rmem.get_allocated_extents() - rmem.get_total_buffers() == 2 * num_extents);
+    if(num_nodes > 0){
+        REQUIRE(rmem.get_numa_node(0) == 0);
+        REQUIRE(rmem.get_numa_node(2 * num_extents -1) == num_nodes -1);
+    }
+    REQUIRE(array[values_per_extent] == values_per_extent);
+}
+
+#if defined(HAVE_LIBNUMA)
+TEST_CASE("numa_rewiring"){
+    if(numa_available() < 0) return; // nop
+    constexpr size_t num_extents = 16;
+    BufferedRewiredMemory rmem { 1, num_extents };
+    const size_t extent_size = rmem.get_extent_size();
+    const size_t values_per_extent = extent_size / sizeof(uint64_t);
+    uint64_t* array = (uint64_t*) rmem.get_start_address();
+    for(size_t i = 0; i < num_extents * values_per_extent; i++){ array[i] = i; }
+    const int num_nodes = numa_max_node() +1;
+    auto partition = [&](size_t extent_id){ // the node expected for the given extent, as range partitioned by the policy
+        int result = -1;
+        for(int node = 0; node < num_nodes; node++){
+            if(extent_id >= num_extents * node / num_nodes && extent_id < num_extents * (node +1) / num_nodes){ result = node; }
+        }
+        return result;
+    };
+
+    rmem.set_numa_policy(NumaPolicy::PARTITIONED);
+
+    // rewire the extents with buffers, filled by this thread and not bound to any node
+    uint64_t* buffer = (uint64_t*) rmem.acquire_buffer();
+    for(size_t i = 0; i < values_per_extent; i++){ buffer[i] = numeric_limits<uint64_t>::max(); }
+    rmem.swap_and_release(array + (num_extents -1) * values_per_extent, buffer);
+    void* buffers[num_extents /2];
+    pair<void*, void*> pairs[num_extents /2];
+    rmem.acquire_buffers(buffers, num_extents /2);
+    for(size_t i = 0; i < num_extents /2; i++){
+        for(size_t j = 0; j < values_per_extent; j++){ ((uint64_t*) buffers[i])[j] = i; }
+        pairs[i] = make_pair(array + (i * 2) * values_per_extent, buffers[i]);
+    }
+    rmem.swap_and_release_many(pairs, num_extents /2);
+
+    // the content is not altered by the migration. Reading it also faults in the pages of the extents rewired, for move_pages
+    for(size_t i = 0; i < values_per_extent; i++){
+        REQUIRE(array[(num_extents -1) * values_per_extent + i] == numeric_limits<uint64_t>::max());
+        REQUIRE(array[values_per_extent + i] == values_per_extent + i);
+    }
+    for(size_t i = 0; i < num_extents /2; i++){
+        REQUIRE(array[(i * 2) * values_per_extent] == i);
+    }
+
+    // the placement of the extents in use still follows the partitions, both in the policy and in the actual pages
+    void* pages[num_extents];
+    int status[num_extents];
+    for(size_t extent_id = 0; extent_id < num_extents; extent_id++){
+        pages[extent_id] = array + extent_id * values_per_extent;
+        REQUIRE(rmem.get_numa_node(extent_id) == partition(extent_id));
+
+        int mode = -1;
+        unique_ptr<struct bitmask, decltype(&numa_bitmask_free)> nodemask { numa_allocate_nodemask(), &numa_bitmask_free };
+        REQUIRE(get_mempolicy(&mode, nodemask->maskp, nodemask->size +1, pages[extent_id], MPOL_F_ADDR) == 0);
+        REQUIRE(mode == MPOL_BIND);
+        REQUIRE(numa_bitmask_isbitset(nodemask.get(), partition(extent_id)));
+    }
+    REQUIRE(move_pages(/* this process */ 0, num_extents, pages, /* only query */ nullptr, status, 0) == 0);
+    for(size_t extent_id = 0; extent_id < num_extents; extent_id++){
+        REQUIRE(status[extent_id] == partition(extent_id));
+    }
+}
+#endif
+
+TEST_CASE("cost_model"){
+    // rewiring: 10 us per window + 100 ns per extent, copy: 1 us per extent => crossover at 10000/900 = 11.1 extents
+    RewiringCostModel model { 10000, 100, 0, 1000 };
+    REQUIRE(model.cost_rewiring(0) == 0);
+    REQUIRE(model.cost_copy(0) == 0);
+    REQUIRE(model.cost_rewiring(4) == 10400);
+    REQUIRE(model.cost_copy(4) == 4000);
+    REQUIRE(model.crossover() == 12);
+    for(size_t num_extents = 1; num_extents <= 64; num_extents++){
+        REQUIRE(model.use_rewiring(num_extents) == (num_extents >= 12));
+        REQUIRE(model.use_rewiring(num_extents) == (model.cost_rewiring(num_extents) <= model.cost_copy(num_extents)));
+    }
+
+    // copying is cheaper per extent, rewiring is never chosen
+    RewiringCostModel model_copy { 10000, 2000, 0, 1000 };
+    REQUIRE(model_copy.crossover() == numeric_limits<size_t>::max());
+    REQUIRE(model_copy.use_rewiring(1) == false);
+    REQUIRE(model_copy.use_rewiring(1ull << 30) == false);
+
+    // rewiring is cheaper even for a single extent
+    RewiringCostModel model_rewiring { 100, 100, 0, 1000 };
+    REQUIRE(model_rewiring.crossover() == 1);
+    REQUIRE(model_rewiring.use_rewiring(1) == true);
+}
+
+TEST_CASE("cost_model_calibrated"){
+    const RewiringCostModel& model = RewiringCostModel::calibrated(1);
+    REQUIRE(&RewiringCostModel::calibrated(1) == &model); // calibrated only once per process
+    REQUIRE(model.cost_rewiring(16) > 0);
+    REQUIRE(model.cost_copy(16) > 0);
+    REQUIRE(model.crossover() >= 1);
+
+    // the decision switches from copying to rewiring at the crossover, if any
+    for(size_t num_extents = 1; num_extents <= 1024; num_extents++){
+        REQUIRE(model.use_rewiring(num_extents) == (num_extents >= model.crossover()));
+    }
+    if(model.crossover() != numeric_limits<size_t>::max()){
+        REQUIRE(model.cost_rewiring(model.crossover()) <= model.cost_copy(model.crossover()));
+        if(model.crossover() > 1){
+            REQUIRE(model.cost_rewiring(model.crossover() -1) > model.cost_copy(model.crossover() -1));
+        }
+    }
+}
@@ -18,9 +18,12 @@
 #define CATCH_CONFIG_MAIN
 #include "third-party/catch/catch.hpp"
 
+#include <atomic>
+#include <cstdio>
 #include <iostream>
 #include <mutex>
 #include <thread>
+#include <unistd.h>
 #include <vector>
 
 #include "common/miscellaneous.hpp"
@@ -122,6 +125,365 @@ TEST_CASE("single_thread_global_rebal"){
     pma.unregister_thread();
 }
 
+TEST_CASE("iterator_depleted"){
+    data_structures::initialise();
+
+    // fill the array up to its last segment, so that the scan ends in the last gate and must stop there
+    PackedMemoryArray pma { /* block size */ 17, /* segment size */ 32, /* pages per extent */ 1, /* worker threads */ 2, /* segments per lock */ 8 };
+    pma.register_thread(0);
+
+    constexpr int64_t sz = 30000;
+    for(int64_t i = 1; i <= sz; i++){
+        pma.insert(i, i *10);
+    }
+
+    int64_t expected = 1;
+    auto it = pma.iterator();
+    while(it->hasNext()){
+        auto p = it->next();
+        REQUIRE(p.first == expected);
+        REQUIRE(p.second == expected *10);
+        expected++;
+    }
+    REQUIRE(expected == sz +1);
+    it.reset();
+
+    pma.unregister_thread();
+}
+
+TEST_CASE("nontemporal_stores"){
+    data_structures::initialise();
+
+    PackedMemoryArray pma { /* block size */ 17, /* segment size */ 32, /* pages per extent */ 1, /* worker threads */ 2, /* segments per lock */ 8 };
+    pma.knobs().set_nontemporal_threshold(0); // always copy with non-temporal stores
+    pma.register_thread(0);
+    REQUIRE(pma.empty());
+
+    // insert the keys out of order, so that the runs to copy are not aligned
+    constexpr int64_t sz = 30000;
+    for(int64_t i = 1; i <= sz; i++){
+        int64_t key = (i * 7) % sz + 1;
+        pma.insert(key, key *10);
+        REQUIRE(pma.size() == i);
+    }
+
+    for(int64_t i = 1; i <= sz; i++){
+        REQUIRE(pma.find(i) == i * 10);
+    }
+
+    for(int64_t i = 1; i <= sz; i++){
+        REQUIRE(pma.remove(i) == i * 10);
+        REQUIRE(pma.size() == sz - i);
+    }
+
+    pma.unregister_thread();
+}
+
+TEST_CASE("nontemporal_calibration"){
+    // the threshold is measured once per process
+    uint64_t threshold = data_structures::rma::common::Knobs::calibrate_nontemporal_threshold();
+    REQUIRE(threshold >= (1ull << 20));
+    REQUIRE(data_structures::rma::common::Knobs::calibrate_nontemporal_threshold() == threshold);
+}
+
+TEST_CASE("key_only"){
+    data_structures::initialise();
+
+    PackedMemoryArray pma { /* block size */ 17, /* segment size */ 32, /* pages per extent */ 1, /* worker threads */ 2, /* segments per lock */ 8, /* key only */ true };
+    pma.register_thread(0);
+    REQUIRE(pma.empty());
+
+    // the values are ignored, each element is implicitly associated to its own key
+    constexpr int64_t sz = 30000;
+    for(int64_t i = 1; i <= sz; i++){
+        int64_t key = (i * 7) % sz + 1;
+        pma.insert(key, key *10);
+        REQUIRE(pma.size() == i);
+    }
+
+    for(int64_t i = 1; i <= sz; i++){
+        REQUIRE(pma.find(i) == i);
+    }
+    REQUIRE(pma.find(sz +1) == -1);
+
+    auto sum = pma.sum(1, sz);
+    REQUIRE(sum.m_num_elements == sz);
+    REQUIRE(sum.m_sum_keys == sz * (sz +1) /2);
+    REQUIRE(sum.m_sum_values == sum.m_sum_keys);
+
+    { // the iterator holds the gates in read mode, release it before the removals
+        int64_t expected = 1;
+        auto it = pma.iterator();
+        while(it->hasNext()){
+            auto p = it->next();
+            REQUIRE(p.first == expected);
+            REQUIRE(p.second == expected);
+            expected++;
+        }
+        REQUIRE(expected == sz +1);
+    }
+
+    for(int64_t i = 1; i <= sz; i++){
+        REQUIRE(pma.remove(i) == i);
+        REQUIRE(pma.size() == sz - i);
+    }
+
+    pma.unregister_thread();
+}
+
+TEST_CASE("huge_segments"){
+    data_structures::initialise();
+
+    // segments of 128k elements, beyond the range of a 16-bit cardinality, two segments per extent of 2 MB
+    PackedMemoryArray pma { /* block size */ 17, /* segment size */ 131072, /* pages per extent */ 512, /* worker threads */ 2, /* segments per lock */ 2 };
+    pma.register_thread(0);
+
+    constexpr int64_t sz = 100000;
+    for(int64_t i = 1; i <= sz; i++){
+        pma.insert(i, i *10);
+    }
+    REQUIRE(pma.size() == sz);
+
+    for(int64_t i = 1; i <= sz; i += 7){
+        REQUIRE(pma.find(i) == i *10);
+    }
+    REQUIRE(pma.find(sz +1) == -1);
+
+    auto sum = pma.sum(1, sz);
+    REQUIRE(sum.m_num_elements == sz);
+    REQUIRE(sum.m_sum_keys == sz * (sz +1) /2);
+    REQUIRE(sum.m_sum_values == sum.m_sum_keys * 10);
+
+    for(int64_t i = sz; i >= 1; i--){
+        REQUIRE(pma.remove(i) == i * 10);
+    }
+    REQUIRE(pma.empty());
+
+    pma.unregister_thread();
+}
+
+TEST_CASE("checkpoint"){
+    data_structures::initialise();
+    const string path = "/tmp/test_rma_baseline_" + to_string(getpid()) + ".checkpoint";
+    constexpr int64_t sz = 100000;
+
+    { // save
+        PackedMemoryArray pma { /* block size */ 17, /* segment size */ 32, /* pages per extent */ 1, /* worker threads */ 2, /* segments per lock */ 4 };
+        pma.register_thread(0);
+        for(int64_t i = 1; i <= sz; i++){
+            int64_t key = (i * 7) % sz + 1;
+            pma.insert(key, key *10);
+        }
+        pma.unregister_thread();
+        pma.checkpoint(path);
+    }
+
+    PackedMemoryArray pma { /* block size */ 17, /* segment size */ 32, /* pages per extent */ 1, /* worker threads */ 2, /* segments per lock */ 4 };
+    pma.restore(path);
+    remove(path.c_str());
+    pma.register_thread(0);
+    REQUIRE(pma.size() == sz);
+
+    for(int64_t i = 1; i <= sz; i++){
+        REQUIRE(pma.find(i) == i *10);
+    }
+    auto sum = pma.sum(1, sz);
+    REQUIRE(sum.m_num_elements == sz);
+    REQUIRE(sum.m_sum_keys == sz * (sz +1) /2);
+
+    // the restored instance must be able to rebalance and resize as usual
+    for(int64_t i = sz +1; i <= 2 * sz; i++){
+        pma.insert(i, i *10);
+    }
+    for(int64_t i = 1; i <= 2 * sz; i++){
+        REQUIRE(pma.remove(i) == i *10);
+    }
+    REQUIRE(pma.empty());
+
+    pma.unregister_thread();
+}
+
+TEST_CASE("memory_budget"){
+    data_structures::initialise();
+
+    { // back pressure
+        data_structures::rma::common::MemoryBudget budget;
+        budget.update(/* budget */ 1000, /* usage */ 900);
+        REQUIRE(budget.get_pressure() == Approx(0.9));
+        REQUIRE(budget.get_back_pressure() == Approx(0.5));
+        REQUIRE(budget.raise_upper_threshold(0.75, 1.0) == Approx(0.8125));
+        REQUIRE(budget.cap_retained_memory(1000) == 500);
+        budget.update(/* budget */ 0, /* usage */ 900); // unlimited
+        REQUIRE(budget.get_back_pressure() == 0);
+        REQUIRE(budget.raise_upper_threshold(0.75, 1.0) == 0.75);
+        REQUIRE(budget.cap_retained_memory(1000) == 1000);
+    }
+
+    constexpr int64_t sz = 20000;
+    auto run = [](uint64_t memory_budget){
+        PackedMemoryArray pma { /* block size */ 17, /* segment size */ 32, /* pages per extent */ 1, /* worker threads */ 2, /* segments per lock */ 4 };
+        pma.knobs().set_thresholds_switch(4); // resize by extents, rather than doubling the array
+        pma.knobs().set_memory_budget(memory_budget);
+        pma.register_thread(0);
+        for(int64_t i = 1; i <= sz; i++){
+            int64_t key = (i * 7) % sz + 1;
+            pma.insert(key, key *10);
+        }
+        for(int64_t i = 1; i <= sz; i++){
+            REQUIRE(pma.find(i) == i *10);
+        }
+        pma.unregister_thread();
+        REQUIRE(pma.memory_budget().get_budget() == memory_budget);
+        REQUIRE(pma.memory_budget().get_usage() > 0);
+        return make_pair(pma.memory_budget().get_back_pressure(), pma.memory_budget().get_num_throttled());
+    };
+
+    auto unlimited = run(0);
+    REQUIRE(unlimited.first == 0);
+    REQUIRE(unlimited.second == 0);
+
+    // with a tight budget, the structure must still be consistent, while the writers are slowed down
+    auto limited = run(/* 256 KB */ 1ull << 18);
+    REQUIRE(limited.first > 0);
+    REQUIRE(limited.second > 0);
+}
+
+TEST_CASE("prefault_buffers"){
+    data_structures::initialise();
+    constexpr int64_t sz = 20000;
+
+    // the master populates the free buffers when idle and the extents added by the resizes in place
+    PackedMemoryArray pma { /* block size */ 17, /* segment size */ 32, /* pages per extent */ 1, /* worker threads */ 2, /* segments per lock */ 4 };
+    pma.knobs().set_thresholds_switch(4); // resize by extents, rather than doubling the array
+    pma.knobs().set_prefault_buffer_memory(/* 64 KB */ 1ull << 16);
+    pma.register_thread(0);
+    for(int64_t i = 1; i <= sz; i++){
+        int64_t key = (i * 7) % sz + 1;
+        pma.insert(key, key *10);
+    }
+    REQUIRE(pma.size() == sz);
+    for(int64_t i = 1; i <= sz; i++){
+        REQUIRE(pma.find(i) == i *10);
+    }
+    pma.unregister_thread();
+}
+
+TEST_CASE("key_compression"){
+    data_structures::initialise();
+    constexpr int64_t sz = 30000;
+    ::data_structures::global_parallel_scan_enabled = true;
+
+    PackedMemoryArray pma { /* block size */ 17, /* segment size */ 32, /* pages per extent */ 1, /* worker threads */ 2, /* segments per lock */ 8 };
+    pma.knobs().set_key_compression(true);
+    pma.register_thread(0);
+    for(int64_t i = 1; i <= sz; i++){
+        int64_t key = (i * 7) % sz + 1;
+        pma.insert(key, key *10);
+    }
+    pma.build(); // compress all segments
+    REQUIRE(pma.size() == sz);
+    REQUIRE(pma.key_footprint() < sz * sizeof(int64_t) / 2); // consecutive keys, a few bits per key
+
+    auto validate = [&pma](int64_t min, int64_t max, int64_t step){ // the keys in [min, max] at distance `step'
+        for(int64_t key = min; key <= max; key += step){ REQUIRE(pma.find(key) == key *10); }
+        if(step > 1){ REQUIRE(pma.find(min +1) == -1); }
+        REQUIRE(pma.find(0) == -1);
+        REQUIRE(pma.find(max +1) == -1);
+
+        // full & partial sums
+        for(auto interval : { pair<int64_t, int64_t>{ min, max }, pair<int64_t, int64_t>{ min + 101 * step, max - 97 * step } }){
+            int64_t num_elements = (interval.second - interval.first) / step +1;
+            auto sum = pma.sum(interval.first, interval.second);
+            REQUIRE(sum.m_num_elements == num_elements);
+            REQUIRE(sum.m_first_key == interval.first);
+            REQUIRE(sum.m_last_key == interval.second);
+            REQUIRE(sum.m_sum_keys == (interval.first + interval.second) * num_elements /2);
+            REQUIRE(sum.m_sum_values == sum.m_sum_keys * 10);
+        }
+
+        // the iterator holds the gates in read mode, release it before the next updates
+        int64_t expected = min + 1003 * step;
+        auto it = pma.find(expected, max - 1009 * step);
+        while(it->hasNext()){
+            auto p = it->next();
+            REQUIRE(p.first == expected);
+            REQUIRE(p.second == expected * 10);
+            expected += step;
+        }
+        REQUIRE(expected == max - 1009 * step + step);
+    };
+    validate(1, sz, 1);
+
+    // the updates decompress the segments they alter, the rebalances compress them again
+    for(int64_t i = 2; i <= sz; i += 2){ REQUIRE(pma.remove(i) == i *10); }
+    REQUIRE(pma.size() == sz /2);
+    validate(1, sz -1, 2);
+    for(int64_t i = 2; i <= sz; i += 2){ pma.insert(i, i *10); }
+    for(int64_t i = sz +1; i <= 2 * sz; i++){ pma.insert(i, i *10); } // resize
+    REQUIRE(pma.size() == 2 * sz);
+    validate(1, 2 * sz, 1);
+
+    for(int64_t i = 1; i <= 2 * sz; i++){ REQUIRE(pma.remove(i) == i *10); }
+    REQUIRE(pma.empty());
+    pma.unregister_thread();
+}
+
+TEST_CASE("key_compression_parallel"){
+    data_structures::initialise();
+    constexpr int num_update_threads = 4;
+    constexpr int num_scan_threads = 2;
+    constexpr int64_t sz = 100000;
+
+    // the global rebalances compress their windows while the readers scan the array
+    PackedMemoryArray pma { /* block size */ 17, /* segment size */ 32, /* pages per extent */ 1, /* worker threads */ 4, /* segments per lock */ 4 };
+    pma.knobs().set_key_compression(true);
+    pma.set_max_number_workers(num_update_threads + num_scan_threads);
+
+    ::data_structures::global_parallel_scan_enabled = true;
+    atomic<bool> updates_done = false;
+    atomic<bool> scan_error = false; // Catch is not thread safe, check the results of the scans in the main thread
+    vector<thread> threads;
+    for(int i = 0; i < num_update_threads; i++){
+        threads.emplace_back([&](int thread_id){
+            pma.register_thread(thread_id);
+            for(int64_t key = thread_id +1; key <= sz; key += num_update_threads){
+                pma.insert(key, key *10);
+            }
+            pma.unregister_thread();
+        }, i);
+    }
+    for(int i = 0; i < num_scan_threads; i++){
+        threads.emplace_back([&](int thread_id){
+            pma.register_thread(thread_id);
+            while(!updates_done){
+                auto sum = pma.sum(0, numeric_limits<int64_t>::max());
+                if(sum.m_sum_values != sum.m_sum_keys * 10){ scan_error = true; }
+                int64_t previous = 0;
+                auto it = pma.find(1000, 2000);
+                while(it->hasNext()){
+                    auto p = it->next();
+                    if(p.first <= previous || p.first > 2000 || p.second != p.first * 10){ scan_error = true; }
+                    previous = p.first;
+                }
+            }
+            pma.unregister_thread();
+        }, num_update_threads + i);
+    }
+    for(int i = 0; i < num_update_threads; i++){ threads[i].join(); }
+    updates_done = true;
+    for(int i = num_update_threads; i < num_update_threads + num_scan_threads; i++){ threads[i].join(); }
+    REQUIRE(!scan_error);
+
+    pma.register_thread(0);
+    REQUIRE(pma.size() == sz);
+    REQUIRE(pma.key_footprint() < sz * sizeof(int64_t));
+    for(int64_t i = 1; i <= sz; i++){ REQUIRE(pma.find(i) == i *10); }
+    auto sum = pma.sum(0, numeric_limits<int64_t>::max());
+    REQUIRE(sum.m_num_elements == sz);
+    REQUIRE(sum.m_sum_keys == sz * (sz +1) /2);
+    pma.unregister_thread();
+}
+
 TEST_CASE("multi_thread_local_rebal"){
     data_structures::initialise();
     constexpr int num_threads = 8;
@@ -181,6 +543,66 @@ TEST_CASE("multi_thread_local_rebal"){
 }
 
 
+TEST_CASE("proactive_rebalancing"){
+    data_structures::initialise();
+    constexpr int num_threads = 8;
+    constexpr size_t num_elts = 30000;
+
+    PackedMemoryArray pma { /* block size */ 17, /* segment size */ 32, /* pages per extent */ 1, /* worker threads */ 2, /* segments per lock */ 4 };
+    pma.knobs().set_proactive_budget(1.0); // let the master rebalance whenever it is idle
+    pma.set_max_number_workers(num_threads);
+
+    distributions::RandomPermutationParallel sampler{ num_elts, /* seed */ 11 };
+    int threads_started = 0;
+    condition_variable _cvar;
+    mutex _mutex;
+
+    vector<thread> threads;
+    int64_t num_keys_per_thread = num_elts / num_threads;
+    int64_t num_keys_leftover = num_elts % num_threads;
+    int64_t start_position = 0;
+    for(int i = 0; i < num_threads; i++){
+        int64_t num_keys_to_insert = num_keys_per_thread + (i < num_keys_leftover);
+
+        threads.emplace_back([&](int64_t pos_start, int64_t num_keys){
+            int worker_id = -1;
+
+            { // wait for all threads to start
+                unique_lock<mutex> lock(_mutex);
+                worker_id = threads_started;
+                pma.register_thread(worker_id);
+                threads_started++;
+                _cvar.notify_all();
+                if(threads_started < num_threads) { _cvar.wait(lock, [&](){ return threads_started == num_threads; }); }
+            }
+
+            // insert the keys, pausing every now and then to leave the master idle
+            int64_t pos_end = pos_start + num_keys;
+            for(int64_t pos = pos_start; pos < pos_end; pos++){
+                int64_t key = sampler.get_raw_key(pos) +1;
+                pma.insert(key, key * 10);
+                if((pos - pos_start) % 500 == 499){ this_thread::sleep_for(chrono::milliseconds(1)); }
+            }
+
+            // done
+            pma.unregister_thread();
+        }, start_position, num_keys_to_insert);
+
+        start_position += num_keys_to_insert;
+    }
+    for(auto& t : threads) t.join(); // Zzz
+
+    pma.set_max_number_workers(1);
+    pma.register_thread(0);
+
+    REQUIRE(pma.size() == num_elts);
+    for(size_t i = 1; i <= num_elts; i++){
+        REQUIRE(pma.find(i) == i * 10);
+    }
+
+    pma.unregister_thread();
+}
+
 TEST_CASE("multi_thread_global_rebal"){
     data_structures::initialise();
     constexpr int num_threads = 8;
@@ -279,6 +701,63 @@ TEST_CASE("multi_thread_global_rebal"){
 }
 
 
+TEST_CASE("readers_during_resize"){
+    data_structures::initialise();
+    constexpr int num_writers = 4;
+    constexpr int num_readers = 4;
+    constexpr int64_t num_elts_initial = 400000; // keys 1, 2, 3, ..., loaded before starting the readers
+    constexpr int64_t num_elts_final = num_elts_initial / 4; // the writers remove all keys that are not a multiple of 4
+    std::atomic<int64_t> current_key = 0; // the key picked by the writers to be removed
+    std::atomic<bool> writers_done = false;
+    std::atomic<int64_t> num_failures = 0; // lookups by the readers that did not return the expected value
+
+    PackedMemoryArray pma { /* block size */ 17, /* segment size */ 32, /* pages per extent */ 1, /* worker threads */ 4, /* segments per lock */ 4 };
+    pma.register_thread(0);
+    for(int64_t key = 1; key <= num_elts_initial; key++){
+        pma.insert(key, key * 10);
+    }
+    pma.unregister_thread();
+    pma.set_max_number_workers(num_writers + num_readers);
+
+    // the removals shrink the storage, always with a RESIZE into a new storage, while the readers keep looking up the remaining keys
+    vector<thread> threads;
+    for(int worker_id = 0; worker_id < num_writers + num_readers; worker_id++){
+        threads.emplace_back([&](int thread_id){
+            pma.register_thread(thread_id);
+
+            if(thread_id < num_writers){
+                int64_t i = 0;
+                while( (i = (current_key++)) < num_elts_initial - num_elts_final){
+                    int64_t key = i / 3 * 4 + i % 3 +1;
+                    if(pma.remove(key) != key * 10){ num_failures++; }
+                }
+            } else {
+                uint64_t seed = thread_id;
+                while(!writers_done){
+                    seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+                    int64_t key = ((seed >> 33) % num_elts_final +1) * 4;
+                    if(pma.find(key) != key * 10){ num_failures++; }
+                }
+            }
+
+            pma.unregister_thread();
+        }, worker_id);
+    }
+    for(int i = 0; i < num_writers; i++) threads[i].join();
+    writers_done = true;
+    for(int i = num_writers; i < num_writers + num_readers; i++) threads[i].join();
+
+    REQUIRE(num_failures == 0);
+
+    pma.set_max_number_workers(1);
+    pma.register_thread(0);
+    REQUIRE(pma.size() == num_elts_final);
+    for(int64_t key = 1; key <= num_elts_initial; key++){
+        REQUIRE(pma.find(key) == ((key % 4 == 0) ? key * 10 : -1));
+    }
+    pma.unregister_thread();
+}
+
 TEST_CASE("sum_sequential"){
     data_structures::initialise();
     using Implementation = PackedMemoryArray;
@@ -138,6 +138,33 @@ TEST_CASE("single_thread_global_rebal"){
     pma.unregister_thread();
 }
 
+TEST_CASE("iterator_depleted"){
+    data_structures::initialise();
+
+    // fill the array up to its last segment, so that the scan ends in the last gate and must stop there
+    PackedMemoryArray pma { /* block size */ 17, /* segment size */ 32, /* pages per extent */ 1, /* worker threads */ 2, /* segments per lock */ 8 };
+    pma.register_thread(0);
+
+    constexpr int64_t sz = 30000;
+    for(int64_t i = 1; i <= sz; i++){
+        pma.insert(i, i *10);
+    }
+    pma.on_complete(); // wait for the rebalancer to process the insertions
+
+    int64_t expected = 1;
+    auto it = pma.iterator();
+    while(it->hasNext()){
+        auto p = it->next();
+        REQUIRE(p.first == expected);
+        REQUIRE(p.second == expected *10);
+        expected++;
+    }
+    REQUIRE(expected == sz +1);
+    it.reset();
+
+    pma.unregister_thread();
+}
+
 TEST_CASE("multi_thread_local_rebal"){
     data_structures::initialise();
     constexpr int num_threads = 8;
@@ -466,6 +493,108 @@ TEST_CASE("multi_thread_delayed"){
     REQUIRE(pma.empty());
 }
 
+TEST_CASE("multi_thread_delayed_scattered"){
+    data_structures::initialise();
+    constexpr int num_threads = 8;
+    constexpr int64_t num_elts = 2000000;
+    constexpr int64_t stride = 1000003; // prime, the keys are inserted in a scattered order, so that the batches span many gates
+    std::atomic<int64_t> current_key = 0; // the key picked by the worker to be inserted
+
+    // with the delay, the queues of many gates build up and are merged into large batches, shared by the workers of the rebalance
+    PackedMemoryArray pma { /* block size */ 17, /* segment size */ 32, /* pages per extent */ 1, /* worker threads */ 4, /* segments per lock */ 4,
+        /* delay */ 200ms /* millisecs */ };
+    pma.set_max_number_workers(num_threads);
+
+    vector<thread> threads;
+    for(int worker_id = 0; worker_id < num_threads; worker_id++){
+        threads.emplace_back([&](int thread_id){
+            pma.register_thread(thread_id);
+
+            int64_t i = 0;
+            while( (i = (current_key++)) < num_elts){
+                int64_t key = (i * stride) % num_elts +1;
+                pma.insert(key, key * 100);
+            }
+
+            pma.unregister_thread();
+        }, worker_id);
+    }
+    for(auto& t : threads) t.join(); // Zzz
+    pma.on_complete(); // give some time to the rebalancer to ultimate the insertions
+
+    pma.set_max_number_workers(1);
+    pma.register_thread(0);
+    REQUIRE(pma.size() == num_elts);
+    for(int64_t key = 1; key <= num_elts; key++){
+        REQUIRE(pma.find(key) == key * 100);
+    }
+    pma.unregister_thread();
+}
+
+TEST_CASE("multi_thread_adaptive_delay"){
+    data_structures::initialise();
+    constexpr int num_threads = 4;
+    constexpr int64_t num_elts = 20000; // preloaded keys, spaced by 1000
+    constexpr int64_t num_hot_elts = 2560; // one key after each preloaded key in [hot_min, hot_min + num_hot_elts * 1000), inserted in a burst
+    constexpr int64_t hot_min = (num_elts - num_hot_elts) / 2 * 1000;
+    constexpr int64_t hot_key = hot_min + num_hot_elts / 2 * 1000; // the keys in (hot_key +1, hot_key +1000) are inserted at a slow pace
+    constexpr int64_t num_cold_elts = 64;
+
+    // the delay of each gate adapts in [0, 100] millisecs
+    PackedMemoryArray pma { /* block size */ 17, /* segment size */ 32, /* pages per extent */ 1, /* worker threads */ 4, /* segments per lock */ 4,
+        /* delay min */ 0ms, /* delay max */ 100ms };
+    pma.set_max_number_workers(num_threads);
+
+    pma.register_thread(0);
+    for(int64_t i = 1; i <= num_elts; i++){
+        pma.insert(i * 1000, i * 100);
+    }
+    pma.on_complete();
+    pma.unregister_thread();
+
+    // hot gates, a burst of insertions scattered over a few dozens of gates: their rebalances are deferred to accumulate larger batches
+    std::atomic<int64_t> current_key = 0; // the key picked by the worker to be inserted
+    vector<thread> threads;
+    for(int worker_id = 0; worker_id < num_threads; worker_id++){
+        threads.emplace_back([&](int thread_id){
+            pma.register_thread(thread_id);
+
+            int64_t key = 0;
+            while( (key = (current_key++)) < num_hot_elts){
+                int64_t actual_key = hot_min + (key * 997 % num_hot_elts) * 1000 +1;
+                pma.insert(actual_key, actual_key * 100);
+            }
+
+            pma.unregister_thread();
+        }, worker_id);
+    }
+    for(auto& t : threads) t.join(); // Zzz
+    pma.on_complete(); // give some time to the rebalancer to ultimate the insertions
+    REQUIRE(pma.get_rebalance_delay(hot_key) > 0ms);
+
+    // the same gate turns cold, a trickle of insertions that would not fill a segment within the max delay: rebalance immediately
+    this_thread::sleep_for(1s);
+    pma.register_thread(0);
+    for(int64_t i = 2; i < num_cold_elts +2; i++){
+        pma.insert(hot_key + i, (hot_key + i) * 100);
+        this_thread::sleep_for(5ms);
+    }
+    pma.on_complete();
+    REQUIRE(pma.get_rebalance_delay(hot_key) == 0ms);
+
+    REQUIRE(pma.size() == num_elts + num_hot_elts + num_cold_elts);
+    for(int64_t i = 1; i <= num_elts; i++){
+        REQUIRE(pma.find(i * 1000) == i * 100);
+    }
+    for(int64_t key = hot_min +1; key < hot_min + num_hot_elts * 1000; key += 1000){
+        REQUIRE(pma.find(key) == key * 100);
+    }
+    for(int64_t key = hot_key +2; key < hot_key + num_cold_elts +2; key++){
+        REQUIRE(pma.find(key) == key * 100);
+    }
+    pma.unregister_thread();
+}
+
 TEST_CASE("sum_sequential"){
     data_structures::initialise();
     using Implementation = PackedMemoryArray;
@@ -18,6 +18,7 @@
 #define CATCH_CONFIG_MAIN
 #include "third-party/catch/catch.hpp"
 
+#include <atomic>
 #include <iostream>
 #include <mutex>
 #include <thread>
@@ -127,6 +128,32 @@ TEST_CASE("single_thread_global_rebal"){
     pma.unregister_thread();
 }
 
+TEST_CASE("iterator_depleted"){
+    data_structures::initialise();
+
+    // fill the array up to its last segment, so that the scan ends in the last gate and must stop there
+    PackedMemoryArray pma { /* block size */ 17, /* segment size */ 32, /* pages per extent */ 1, /* worker threads */ 2, /* segments per lock */ 8 };
+    pma.register_thread(0);
+
+    constexpr int64_t sz = 30000;
+    for(int64_t i = 1; i <= sz; i++){
+        pma.insert(i, i *10);
+    }
+
+    int64_t expected = 1;
+    auto it = pma.iterator();
+    while(it->hasNext()){
+        auto p = it->next();
+        REQUIRE(p.first == expected);
+        REQUIRE(p.second == expected *10);
+        expected++;
+    }
+    REQUIRE(expected == sz +1);
+    it.reset();
+
+    pma.unregister_thread();
+}
+
 TEST_CASE("multi_thread_local_rebal"){
     data_structures::initialise();
     constexpr int num_threads = 8;
@@ -185,6 +212,65 @@ TEST_CASE("multi_thread_local_rebal"){
     pma.unregister_thread();
 }
 
+TEST_CASE("priority_scheduling"){
+    data_structures::initialise();
+    constexpr int num_threads = 8;
+    constexpr size_t num_elts = 1ull << 15;
+
+    PackedMemoryArray pma { /* block size */ 17, /* segment size */ 32, /* pages per extent */ 1, /* worker threads */ 2, /* segments per lock */ 4 };
+    pma.set_max_number_workers(num_threads);
+    pma.knobs().set_scheduling_policy(data_structures::rma::common::SchedulingPolicy::PRIORITY);
+
+    distributions::RandomPermutationParallel sampler{ num_elts, /* seed */ 7 };
+    int threads_started = 0;
+    condition_variable _cvar;
+    mutex _mutex;
+
+    vector<thread> threads;
+    int64_t num_keys_per_thread = num_elts / num_threads;
+    int64_t num_keys_leftover = num_elts % num_threads;
+    int64_t start_position = 0;
+    for(int i = 0; i < num_threads; i++){
+        int64_t num_keys_to_insert = num_keys_per_thread + (i < num_keys_leftover);
+
+        threads.emplace_back([&](int64_t pos_start, int64_t num_keys){
+            int worker_id = -1;
+
+            { // wait for all threads to start
+                unique_lock<mutex> lock(_mutex);
+                worker_id = threads_started;
+                pma.register_thread(worker_id);
+                threads_started++;
+                _cvar.notify_all();
+                if(threads_started < num_threads) { _cvar.wait(lock, [&](){ return threads_started == num_threads; }); }
+            }
+
+            // insert the keys
+            int64_t pos_end = pos_start + num_keys;
+            for(int64_t pos = pos_start; pos < pos_end; pos++){
+                int64_t key = sampler.get_raw_key(pos) +1;
+                pma.insert(key, key * 10);
+            }
+
+            // done
+            pma.unregister_thread();
+        }, start_position, num_keys_to_insert);
+
+        start_position += num_keys_to_insert;
+    }
+    for(auto& t : threads) t.join(); // Zzz
+
+    pma.set_max_number_workers(1);
+    pma.register_thread(0);
+
+    REQUIRE(pma.size() == num_elts);
+    for(size_t i = 1; i <= num_elts; i++){
+        REQUIRE(pma.find(i) == i * 10);
+    }
+
+    pma.unregister_thread();
+}
+
 TEST_CASE("multi_thread_global_rebal"){
     data_structures::initialise();
     constexpr int num_threads = 8;
@@ -362,6 +448,63 @@ TEST_CASE("multi_thread_sequential"){
     REQUIRE(pma.empty());
 }
 
+TEST_CASE("readers_during_resize"){
+    data_structures::initialise();
+    constexpr int num_writers = 4;
+    constexpr int num_readers = 4;
+    constexpr int64_t num_elts_initial = 400000; // keys 1, 2, 3, ..., loaded before starting the readers
+    constexpr int64_t num_elts_final = num_elts_initial / 4; // the writers remove all keys that are not a multiple of 4
+    std::atomic<int64_t> current_key = 0; // the key picked by the writers to be removed
+    std::atomic<bool> writers_done = false;
+    std::atomic<int64_t> num_failures = 0; // lookups by the readers that did not return the expected value
+
+    PackedMemoryArray pma { /* block size */ 17, /* segment size */ 32, /* pages per extent */ 1, /* worker threads */ 4, /* segments per lock */ 4 };
+    pma.register_thread(0);
+    for(int64_t key = 1; key <= num_elts_initial; key++){
+        pma.insert(key, key * 10);
+    }
+    pma.unregister_thread();
+    pma.set_max_number_workers(num_writers + num_readers);
+
+    // the removals shrink the storage, always with a RESIZE into a new storage, while the readers keep looking up the remaining keys
+    vector<thread> threads;
+    for(int worker_id = 0; worker_id < num_writers + num_readers; worker_id++){
+        threads.emplace_back([&](int thread_id){
+            pma.register_thread(thread_id);
+
+            if(thread_id < num_writers){
+                int64_t i = 0;
+                while( (i = (current_key++)) < num_elts_initial - num_elts_final){
+                    int64_t key = i / 3 * 4 + i % 3 +1;
+                    pma.remove(key); // this variant does not report the value removed
+                }
+            } else {
+                uint64_t seed = thread_id;
+                while(!writers_done){
+                    seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+                    int64_t key = ((seed >> 33) % num_elts_final +1) * 4;
+                    if(pma.find(key) != key * 10){ num_failures++; }
+                }
+            }
+
+            pma.unregister_thread();
+        }, worker_id);
+    }
+    for(int i = 0; i < num_writers; i++) threads[i].join();
+    writers_done = true;
+    for(int i = num_writers; i < num_writers + num_readers; i++) threads[i].join();
+
+    REQUIRE(num_failures == 0);
+
+    pma.set_max_number_workers(1);
+    pma.register_thread(0);
+    REQUIRE(pma.size() == num_elts_final);
+    for(int64_t key = 1; key <= num_elts_initial; key++){
+        REQUIRE(pma.find(key) == ((key % 4 == 0) ? key * 10 : -1));
+    }
+    pma.unregister_thread();
+}
+
 TEST_CASE("sum_sequential"){
     data_structures::initialise();
     using Implementation = PackedMemoryArray;
@@ -0,0 +1,110 @@
+/**
+ * Copyright (C) 2018 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cinttypes>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+
+#define CATCH_CONFIG_MAIN
+#include "third-party/catch/catch.hpp"
+
+#include "data_structures/abtree/sequential/abtree.hpp"
+#include "data_structures/driver.hpp"
+#include "data_structures/rma/baseline/packed_memory_array.hpp"
+#include "data_structures/snapshot.hpp"
+
+using namespace data_structures;
+using namespace std;
+
+static string snapshot_path(){
+    return "/tmp/test_snapshot_" + to_string(getpid()) + ".snapshot";
+}
+
+// Save a baseline RMA with `sz' sparse keys into the given path
+static void save_rma(const string& path, int64_t sz){
+    rma::baseline::PackedMemoryArray pma { /* block size */ 17, /* segment size */ 32, /* pages per extent */ 1, /* worker threads */ 2, /* segments per lock */ 4 };
+    pma.register_thread(0);
+    for(int64_t i = 1; i <= sz; i++){
+        int64_t key = ((i * 7) % sz + 1) * 3;
+        pma.insert(key, key *10);
+    }
+    pma.unregister_thread();
+
+    auto summary = save_snapshot(&pma, path);
+    REQUIRE(summary.m_num_elements == sz);
+    REQUIRE(summary.m_min_key == 3);
+    REQUIRE(summary.m_max_key == sz * 3);
+}
+
+TEST_CASE("parallel_callbacks"){
+    data_structures::initialise();
+    const string path = snapshot_path();
+    constexpr int64_t sz = 200000;
+    save_rma(path, sz);
+
+    rma::baseline::PackedMemoryArray pma { /* block size */ 17, /* segment size */ 32, /* pages per extent */ 1, /* worker threads */ 2, /* segments per lock */ 4 };
+    auto summary = load_snapshot(&pma, path);
+    remove(path.c_str());
+    REQUIRE(summary.m_num_elements == sz);
+    REQUIRE(pma.size() == sz);
+
+    pma.set_max_number_workers(1);
+    pma.register_thread(0);
+    for(int64_t i = 1; i <= sz; i++){
+        REQUIRE(pma.find(i * 3) == i * 30);
+        REQUIRE(pma.find(i * 3 +1) == -1);
+    }
+    pma.unregister_thread();
+}
+
+TEST_CASE("bulk_loading"){
+    data_structures::initialise();
+    const string path = snapshot_path();
+    constexpr int64_t sz = 200000;
+    save_rma(path, sz);
+
+    abtree::sequential::ABTree abtree { 64 };
+    auto summary = load_snapshot(&abtree, path);
+    remove(path.c_str());
+    REQUIRE(summary.m_num_elements == sz);
+    REQUIRE(abtree.size() == sz);
+    for(int64_t i = 1; i <= sz; i++){
+        REQUIRE(abtree.find(i * 3) == i * 30);
+    }
+}
+
+TEST_CASE("corrupted"){
+    data_structures::initialise();
+    const string path = snapshot_path();
+    save_rma(path, /* sz */ 1000);
+
+    { // flip a byte in the middle of the first block
+        fstream file { path, ios::in | ios::out | ios::binary };
+        file.seekg(200);
+        char c = 0;
+        file.read(&c, 1);
+        c ^= 0x1;
+        file.seekp(200);
+        file.write(&c, 1);
+    }
+
+    abtree::sequential::ABTree abtree { 64 };
+    REQUIRE_THROWS_AS(load_snapshot(&abtree, path), const SnapshotError&);
+    remove(path.c_str());
+}
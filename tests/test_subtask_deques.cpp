@@ -0,0 +1,90 @@
+/**
+ * Copyright (C) 2018 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cinttypes>
+#include <vector>
+
+#define CATCH_CONFIG_MAIN
+#include "third-party/catch/catch.hpp"
+
+#include "rma/common/subtask_deques.hpp"
+
+using namespace data_structures::rma::common;
+using namespace std;
+
+TEST_CASE("owner"){
+    vector<int> subtasks { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+    SubTaskDeques<int> deques;
+    deques.assign(subtasks, 2); // [0, 5) & [5, 10)
+    REQUIRE(deques.size() == 10);
+
+    vector<int> next;
+    deques.for_each_next([&next](int subtask){ next.push_back(subtask); });
+    REQUIRE((next == vector<int>{ 4, 9 }));
+
+    // each owner proceeds from the back of its own block
+    int subtask = -1; bool stolen = true;
+    REQUIRE(deques.fetch(0, subtask, stolen));
+    REQUIRE(subtask == 4);
+    REQUIRE(!stolen);
+    REQUIRE(deques.fetch(1, subtask, stolen));
+    REQUIRE(subtask == 9);
+    REQUIRE(!stolen);
+    REQUIRE(deques.size() == 8);
+}
+
+TEST_CASE("steal"){
+    vector<int> subtasks { 0, 1, 2, 3, 4, 5, 6, 7 };
+    SubTaskDeques<int> deques;
+    deques.assign(subtasks, 4); // [0, 2), [2, 4), [4, 6), [6, 8)
+
+    int subtask = -1; bool stolen = false;
+    // deplete the deque of worker #3
+    REQUIRE(deques.fetch(3, subtask, stolen)); REQUIRE(subtask == 7); REQUIRE(!stolen);
+    REQUIRE(deques.fetch(3, subtask, stolen)); REQUIRE(subtask == 6); REQUIRE(!stolen);
+    // worker #3 steals from the front of the longest deque
+    REQUIRE(deques.fetch(3, subtask, stolen)); REQUIRE(subtask == 0); REQUIRE(stolen);
+    REQUIRE(deques.fetch(3, subtask, stolen)); REQUIRE(subtask == 2); REQUIRE(stolen);
+
+    // worker #2 still has its own block
+    REQUIRE(deques.fetch(2, subtask, stolen)); REQUIRE(subtask == 5); REQUIRE(!stolen);
+
+    vector<int> fetched;
+    while(deques.fetch(1, subtask, stolen)){ fetched.push_back(subtask); }
+    sort(begin(fetched), end(fetched));
+    REQUIRE((fetched == vector<int>{ 1, 3, 4 }));
+    REQUIRE(deques.empty());
+    REQUIRE(!deques.fetch(0, subtask, stolen));
+}
+
+TEST_CASE("more_workers_than_subtasks"){
+    vector<int> subtasks { 0, 1 };
+    SubTaskDeques<int> deques;
+    deques.assign(subtasks, 8);
+    REQUIRE(deques.size() == 2);
+
+    int subtask = -1; bool stolen = false;
+    REQUIRE(deques.fetch(0, subtask, stolen));
+    REQUIRE(deques.fetch(0, subtask, stolen));
+    REQUIRE(deques.empty());
+    REQUIRE(!deques.fetch(0, subtask, stolen));
+
+    // reuse the instance
+    deques.assign(subtasks, 1);
+    REQUIRE(deques.fetch(5, subtask, stolen)); REQUIRE(subtask == 1); REQUIRE(!stolen);
+}
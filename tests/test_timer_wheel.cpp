@@ -0,0 +1,116 @@
+/**
+ * Copyright (C) 2018 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <chrono>
+#include <cinttypes>
+#include <random>
+#include <vector>
+
+#define CATCH_CONFIG_MAIN
+#include "third-party/catch/catch.hpp"
+
+#include "common/timer_wheel.hpp"
+
+using namespace common;
+using namespace std;
+
+using Clock = TimerWheel::Clock;
+using Timer = TimerWheel::Timer;
+
+TEST_CASE("sanity"){
+    auto t0 = Clock::now();
+    TimerWheel wheel { chrono::microseconds(100), t0 };
+    REQUIRE(wheel.empty());
+    REQUIRE(wheel.next_deadline() == Clock::time_point::max());
+
+    Timer timers[3];
+    wheel.schedule(&timers[0], t0 + chrono::milliseconds(1));
+    wheel.schedule(&timers[1], t0 + chrono::milliseconds(2));
+    wheel.schedule(&timers[2], t0 + chrono::milliseconds(3));
+    REQUIRE(wheel.size() == 3);
+    REQUIRE(timers[1].scheduled());
+    REQUIRE(wheel.next_deadline() <= t0 + chrono::milliseconds(1));
+
+    wheel.cancel(&timers[1]);
+    REQUIRE(!timers[1].scheduled());
+    REQUIRE(wheel.size() == 2);
+    wheel.cancel(&timers[1]); // nop
+
+    vector<Timer*> fired;
+    auto callback = [&fired](Timer* timer){ fired.push_back(timer); };
+
+    wheel.advance(t0 + chrono::microseconds(999), callback);
+    REQUIRE(fired.empty()); // too early
+    wheel.advance(t0 + chrono::milliseconds(1), callback);
+    REQUIRE(fired.size() == 1);
+    REQUIRE(fired[0] == &timers[0]);
+    REQUIRE(!timers[0].scheduled());
+
+    wheel.advance(t0 + chrono::milliseconds(5), callback);
+    REQUIRE(fired.size() == 2);
+    REQUIRE(fired[1] == &timers[2]);
+    REQUIRE(wheel.empty());
+
+    // a deadline in the past fires at the next advance
+    wheel.schedule(&timers[1], t0);
+    wheel.advance(t0 + chrono::milliseconds(5), callback);
+    REQUIRE(fired.size() == 2);
+    wheel.advance(t0 + chrono::milliseconds(6), callback);
+    REQUIRE(fired.size() == 3);
+    REQUIRE(fired[2] == &timers[1]);
+
+    // expire_all fires everything, regardless of the deadline
+    wheel.schedule(&timers[0], t0 + chrono::seconds(10));
+    wheel.schedule(&timers[1], t0 + chrono::hours(10)); // beyond the horizon
+    wheel.expire_all(callback);
+    REQUIRE(fired.size() == 5);
+    REQUIRE(wheel.empty());
+
+    // leave a timer in the wheel, it should be discarded by the dtor
+    wheel.schedule(&timers[2], t0 + chrono::seconds(1));
+}
+
+TEST_CASE("cascade"){
+    // every timer must fire in the tick of its deadline, also after being cascaded from the upper levels
+    auto t0 = Clock::time_point(); // epoch
+    const auto resolution = chrono::microseconds(1);
+    TimerWheel wheel { resolution, t0 };
+
+    constexpr uint64_t num_timers = 20000;
+    constexpr uint64_t max_delay = 1ull << 26; // beyond the horizon of the wheel
+    mt19937_64 random { 42 };
+    vector<Timer> timers(num_timers);
+    vector<uint64_t> expiry(num_timers);
+    for(uint64_t i = 0; i < num_timers; i++){
+        expiry[i] = 1 + (i < num_timers / 2 ? random() % 5000 : random() % max_delay);
+        wheel.schedule(&timers[i], t0 + expiry[i] * resolution);
+    }
+
+    uint64_t num_fired = 0;
+    uint64_t now = 0;
+    while(!wheel.empty()){
+        auto deadline = wheel.next_deadline();
+        REQUIRE(deadline > t0 + now * resolution);
+        now = (deadline - t0) / resolution;
+        wheel.advance(deadline, [&](Timer* timer){
+            uint64_t i = timer - timers.data();
+            REQUIRE(expiry[i] == now);
+            num_fired++;
+        });
+    }
+    REQUIRE(num_fired == num_timers);
+}